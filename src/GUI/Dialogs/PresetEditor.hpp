@@ -171,7 +171,7 @@ public:
             "support_material_contact_distance"s, "support_material_buildplate_only"s, "dont_support_bridges"s,
             "notes"s,
             "complete_objects"s, "extruder_clearance_radius"s, "extruder_clearance_height"s,
-            "gcode_comments"s, "output_filename_format"s,
+            "gcode_comments"s, "gcode_compression"s, "output_filename_format"s,
             "post_process"s,
             "perimeter_extruder"s, "infill_extruder"s, "solid_infill_extruder"s,
             "support_material_extruder"s, "support_material_interface_extruder"s,
@@ -223,7 +223,7 @@ public:
         {
             "bed_shape"s, "z_offset"s, "z_steps_per_mm"s, "has_heatbed"s,
             "gcode_flavor"s, "use_relative_e_distances"s,
-            "serial_port"s, "serial_speed"s,
+            "serial_port"s, "serial_speed"s, "serial_window"s, "serial_window_bytes"s,
             "host_type"s, "print_host"s, "octoprint_apikey"s,
             "use_firmware_retraction"s, "pressure_advance"s, "vibration_limit"s,
             "use_volumetric_e"s,
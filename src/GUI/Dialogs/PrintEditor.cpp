@@ -305,6 +305,7 @@ void PrintEditor::_build() {
         {
             auto* optgroup = page->new_optgroup("Output file", "disk.svg");
             optgroup->append_single_option_line("gcode_comments");
+            optgroup->append_single_option_line("gcode_compression");
             optgroup->append_single_option_line("label_printed_objects");
             optgroup->append_single_option_line("output_filename_format");
         }
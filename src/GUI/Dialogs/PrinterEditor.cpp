@@ -78,6 +78,8 @@ void PrinterEditor::_build() {
             auto* optgroup = page->new_optgroup("USB/Serial connection", "connection.svg");
             optgroup->append_single_option_line("serial_port");
             optgroup->append_single_option_line("serial_speed");
+            optgroup->append_single_option_line("serial_window");
+            optgroup->append_single_option_line("serial_window_bytes");
         }
         {
             auto* optgroup = page->new_optgroup("Print server upload", "server.svg");
@@ -1,4 +1,9 @@
 #include "ExtrusionGeometry.hpp"
+#include <algorithm>
+#include "Layer.hpp"
+#include "Print.hpp"
+#include "ExtrusionEntity.hpp"
+#include "ExtrusionEntityCollection.hpp"
 
 namespace Slic3r {
 
@@ -170,49 +175,199 @@ GLVertexArray::load_mesh(const TriangleMesh &mesh)
 
 
 
-void ExtrusionGeometry::extrusion_to_instanced(const Lines &lines, const std::vector<double> &widths,
-    const std::vector<double> &heights, double top_z, const Point &copy,
-    const float* color, std::vector<InstanceData>& instances)
+double ExtrusionGeometry::get_stadium_width(double mm3_per_mm, double height, double default_width)
 {
-    size_t count = lines.size();
-    instances.reserve(instances.size() + count);
-
-    for (size_t i = 0; i < count; ++i) {
-        const Line &line = lines[i];
-        double w = widths[i];
-        double h = heights[i];
-        double z = top_z - h * 0.5;
-
-        Point p1 = line.a;
-        Point p2 = line.b;
-        p1.translate(copy);
-        p2.translate(copy);
-
-        InstanceData inst;
-        inst.posA[0] = (float)unscale(p1.x); 
-        inst.posA[1] = (float)unscale(p1.y); 
-        inst.posA[2] = (float)z;
-        inst.width   = (float)w;
-        
-        inst.posB[0] = (float)unscale(p2.x); 
-        inst.posB[1] = (float)unscale(p2.y); 
-        inst.posB[2] = (float)z;
-        inst.height  = (float)h;
+    if (mm3_per_mm <= 0) return default_width;
+    // Stadium model formula: w = A/h + h(1 - PI/4)
+    return mm3_per_mm / height + height * (1.0 - M_PI / 4.0);
+}
+
+/// Adds a segment per line of a path, skipping repeated points; color is the one of the path
+/// or of its loop.
+static void
+_path_to_instanced(const ExtrusionPath &path, double top_z, const Point &copy,
+    const float* color, std::vector<ExtrusionGeometry::InstanceData>* instances)
+{
+    const Points &points = path.polyline.points;
+    if (points.size() < 2) return;
+    const double w = ExtrusionGeometry::get_stadium_width(path.mm3_per_mm, path.height, path.width);
+    const double h = path.height;
+    const float z = (float)(top_z - h * 0.5);
 
-        inst.color[0] = color[0];
-        inst.color[1] = color[1];
-        inst.color[2] = color[2];
-        inst.color[3] = color[3];
+    ExtrusionGeometry::InstanceData inst;
+    inst.posA[2] = z;
+    inst.posB[2] = z;
+    inst.width   = (float)w;
+    inst.height  = (float)h;
+    std::copy(color, color + 4, inst.color);
 
-        instances.push_back(inst);
+    const Point* a = &points.front();
+    for (size_t i = 1; i < points.size(); ++i) {
+        const Point &b = points[i];
+        if (b.coincides_with(*a)) continue;
+        inst.posA[0] = (float)unscale(a->x + copy.x);
+        inst.posA[1] = (float)unscale(a->y + copy.y);
+        inst.posB[0] = (float)unscale(b.x + copy.x);
+        inst.posB[1] = (float)unscale(b.y + copy.y);
+        instances->push_back(inst);
+        a = &b;
     }
 }
 
-double ExtrusionGeometry::get_stadium_width(double mm3_per_mm, double height, double default_width)
+static void
+_entity_to_instanced(const ExtrusionEntity &entity, double top_z, const Point &copy,
+    const ExtrusionGeometry::RoleColors &colors, ExtrusionGeometry::LayerInstances* layer)
 {
-    if (mm3_per_mm <= 0) return default_width;
-    // Stadium model formula: w = A/h + h(1 - PI/4)
-    return mm3_per_mm / height + height * (1.0 - M_PI / 4.0);
+    if (entity.is_collection()) {
+        for (const ExtrusionEntity* e : static_cast<const ExtrusionEntityCollection&>(entity).entities)
+            _entity_to_instanced(*e, top_z, copy, colors, layer);
+        return;
+    }
+
+    // loops have the color of their first path
+    const ExtrusionLoop* loop = entity.is_loop() ? static_cast<const ExtrusionLoop*>(&entity) : nullptr;
+    if (loop != nullptr && loop->paths.empty()) return;
+    const ExtrusionRole role = (loop != nullptr) ? loop->paths.front().role : static_cast<const ExtrusionPath&>(entity).role;
+    if (role == erNone || size_t(role) >= colors.size()) return;
+    const ExtrusionGeometry::RoleColor &color = colors[role];
+
+    std::vector<ExtrusionGeometry::InstanceData>* instances = &layer->chunks[color.key];
+    if (loop != nullptr) {
+        for (const ExtrusionPath &path : loop->paths)
+            _path_to_instanced(path, top_z, copy, color.color, instances);
+    } else {
+        _path_to_instanced(static_cast<const ExtrusionPath&>(entity), top_z, copy, color.color, instances);
+    }
+}
+
+ExtrusionGeometry::LayerInstances
+ExtrusionGeometry::layer_to_instanced(const Layer &layer, const RoleColors &colors)
+{
+    LayerInstances result;
+    result.print_z = layer.print_z;
+    const SupportLayer* support_layer = dynamic_cast<const SupportLayer*>(&layer);
+    for (const Point &copy : layer.object()->_shifted_copies) {
+        if (support_layer != nullptr) {
+            _entity_to_instanced(support_layer->support_fills, layer.print_z, copy, colors, &result);
+            _entity_to_instanced(support_layer->support_interface_fills, layer.print_z, copy, colors, &result);
+        } else {
+            for (const LayerRegion* region : layer.regions) {
+                _entity_to_instanced(region->perimeters, layer.print_z, copy, colors, &result);
+                _entity_to_instanced(region->fills, layer.print_z, copy, colors, &result);
+            }
+        }
+    }
+    return result;
+}
+
+std::vector<ExtrusionGeometry::LayerInstances>
+ExtrusionGeometry::layers_to_instanced(const std::vector<const Layer*> &layers, const RoleColors &colors, int threads)
+{
+    std::vector<LayerInstances> result(layers.size());
+    if (layers.empty()) return result;
+    parallelize<size_t>(
+        0, layers.size() - 1,
+        [&layers, &colors, &result](size_t i) { result[i] = layer_to_instanced(*layers[i], colors); },
+        threads
+    );
+    // layers are few compared to their instances
+    std::stable_sort(result.begin(), result.end(),
+        [](const LayerInstances &a, const LayerInstances &b) { return a.print_z < b.print_z; });
+    return result;
+}
+
+void
+ExtrusionGeometry::add_instanced(const std::vector<LayerInstances> &layers,
+    const std::map<uint32_t, InstanceBuffer*> &buffers, int threads)
+{
+    std::vector<std::pair<InstanceBuffer*, std::vector<std::pair<double, const std::vector<InstanceData>*>>>> work;
+    for (const auto &buffer : buffers) {
+        std::vector<std::pair<double, const std::vector<InstanceData>*>> chunks;
+        for (const LayerInstances &layer : layers) {
+            const auto chunk = layer.chunks.find(buffer.first);
+            if (chunk != layer.chunks.end() && !chunk->second.empty())
+                chunks.emplace_back(layer.print_z, &chunk->second);
+        }
+        if (!chunks.empty()) work.emplace_back(buffer.second, std::move(chunks));
+    }
+    if (work.empty()) return;
+    parallelize<size_t>(
+        0, work.size() - 1,
+        [&work](size_t i) { work[i].first->add(work[i].second); },
+        threads
+    );
+}
+
+size_t
+ExtrusionGeometry::InstanceBuffer::count_up_to(double print_z) const
+{
+    const auto layer = std::upper_bound(this->layers.begin(), this->layers.end(), print_z,
+        [](double z, const std::pair<double, size_t> &l) { return z < l.first; });
+    return (layer == this->layers.begin()) ? 0 : std::prev(layer)->second;
+}
+
+void
+ExtrusionGeometry::InstanceBuffer::clear()
+{
+    this->instances.clear();
+    this->layers.clear();
+    this->bb = BoundingBoxf3();
+    this->unchanged = 0;
+}
+
+void
+ExtrusionGeometry::InstanceBuffer::add(const std::vector<std::pair<double, const std::vector<InstanceData>*>> &chunks)
+{
+    if (chunks.empty()) return;
+
+    size_t added = 0;
+    for (const auto &chunk : chunks) {
+        added += chunk.second->size();
+        for (const InstanceData &inst : *chunk.second) {
+            this->bb.merge(Pointf3(inst.posA[0], inst.posA[1], inst.posA[2]));
+            this->bb.merge(Pointf3(inst.posB[0], inst.posB[1], inst.posB[2]));
+        }
+    }
+
+    // layers at the same Z go after the ones already there
+    // (without an exact reserve, which would copy the buffer at each of the adds of a print)
+    if (this->layers.empty() || chunks.front().first >= this->layers.back().first) {
+        for (const auto &chunk : chunks) {
+            this->instances.insert(this->instances.end(), chunk.second->begin(), chunk.second->end());
+            this->layers.emplace_back(chunk.first, this->instances.size());
+        }
+        return;
+    }
+
+    // the instances of the layers up to the first chunk keep their place
+    const auto first_moved = std::upper_bound(this->layers.begin(), this->layers.end(), chunks.front().first,
+        [](double z, const std::pair<double, size_t> &l) { return z < l.first; });
+    if (first_moved != this->layers.begin())
+        this->unchanged = std::min(this->unchanged, std::prev(first_moved)->second);
+    else
+        this->unchanged = 0;
+
+    std::vector<InstanceData> instances;
+    std::vector<std::pair<double, size_t>> layers;
+    instances.reserve(this->instances.size() + added);
+    layers.reserve(this->layers.size() + chunks.size());
+    size_t begin = 0;
+    auto chunk = chunks.begin();
+    for (const auto &layer : this->layers) {
+        for (; chunk != chunks.end() && chunk->first < layer.first; ++chunk) {
+            instances.insert(instances.end(), chunk->second->begin(), chunk->second->end());
+            layers.emplace_back(chunk->first, instances.size());
+        }
+        instances.insert(instances.end(), this->instances.begin() + begin, this->instances.begin() + layer.second);
+        layers.emplace_back(layer.first, instances.size());
+        begin = layer.second;
+    }
+    for (; chunk != chunks.end(); ++chunk) {
+        instances.insert(instances.end(), chunk->second->begin(), chunk->second->end());
+        layers.emplace_back(chunk->first, instances.size());
+    }
+    this->instances.swap(instances);
+    this->layers.swap(layers);
 }
 
 }
\ No newline at end of file
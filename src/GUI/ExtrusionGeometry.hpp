@@ -5,9 +5,16 @@
 #include "../../libslic3r/Point.hpp"
 #include "../../libslic3r/Line.hpp"
 #include "../../libslic3r/TriangleMesh.hpp"
+#include "../../libslic3r/BoundingBox.hpp"
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
 
 namespace Slic3r {
 
+class Layer;
+
 class GLVertexArray {
     public:
     std::vector<float> verts, norms, tube_coords;
@@ -65,11 +72,56 @@ class ExtrusionGeometry
         float color[4];
     };
 
-    static void extrusion_to_instanced(const Lines &lines, const std::vector<double> &widths,
-        const std::vector<double> &heights, double top_z, const Point &copy,
-        const float* color, std::vector<InstanceData>& instances);
-
     static double get_stadium_width(double mm3_per_mm, double height, double default_width);
+
+    /// Color of the toolpaths of an extrusion role: roles of the same key go to the same
+    /// buffer.
+    struct RoleColor {
+        uint32_t key;
+        float color[4];
+    };
+    /// Indexed by ExtrusionRole; erNone and the roles past the end are not drawn.
+    typedef std::vector<RoleColor> RoleColors;
+
+    /// Instances of the toolpaths of a layer, for all the copies of its object,
+    /// in a chunk per color key.
+    struct LayerInstances {
+        double print_z {0};
+        std::map<uint32_t, std::vector<InstanceData>> chunks;
+    };
+
+    /// Instances of a color key, ordered by layer: the instances of the layers up to a Z
+    /// are a prefix, which is what the preview draws.
+    struct InstanceBuffer {
+        std::vector<InstanceData> instances;
+        /// print_z of each layer, by increasing Z, and the end of its instances
+        std::vector<std::pair<double, size_t>> layers;
+        BoundingBoxf3 bb;
+        /// Leading instances which add() and clear() left as they were since it was last set,
+        /// by the copy of the buffer on the GPU: the others are the ones to upload.
+        size_t unchanged {0};
+
+        /// Number of instances of the layers up to print_z, included.
+        size_t count_up_to(double print_z) const;
+        void clear();
+        /// Adds layer chunks of its key, sorted by print_z; layers above the last one are
+        /// appended, others are merged in a single pass.
+        void add(const std::vector<std::pair<double, const std::vector<InstanceData>*>> &chunks);
+    };
+
+    /// Builds the instances of a layer of an object or of its support.
+    static LayerInstances layer_to_instanced(const Layer &layer, const RoleColors &colors);
+
+    /// Builds the instances of layers on parallel threads, sorted by print_z.
+    static std::vector<LayerInstances> layers_to_instanced(const std::vector<const Layer*> &layers,
+        const RoleColors &colors, int threads = boost::thread::hardware_concurrency());
+
+    /// Adds the chunks of layers sorted by print_z to the buffers of their keys, one buffer
+    /// per thread; keys without a buffer are skipped. No instance is sorted, and adding the
+    /// layers of a print by increasing Z, as they are finished, only appends to the buffers.
+    static void add_instanced(const std::vector<LayerInstances> &layers,
+        const std::map<uint32_t, InstanceBuffer*> &buffers,
+        int threads = boost::thread::hardware_concurrency());
 };
 
 }
@@ -24,6 +24,17 @@ void VertexBuffer::unbind() {
 void VertexBuffer::upload_data(const void* data, size_t size, GLenum usage) {
     bind();
     glBufferData(GL_ARRAY_BUFFER, size, data, usage);
+    m_capacity = size;
+}
+
+void VertexBuffer::allocate(size_t size, GLenum usage) {
+    upload_data(nullptr, size, usage);
+}
+
+void VertexBuffer::update_data(size_t offset, const void* data, size_t size) {
+    if (size == 0) return;
+    bind();
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
 }
 
 // VertexArray Implementation
@@ -18,14 +18,20 @@ public:
     
     // Upload data
     void upload_data(const void* data, size_t size, GLenum usage = GL_STATIC_DRAW);
+    // Allocate size bytes, left undefined until update_data()
+    void allocate(size_t size, GLenum usage = GL_STATIC_DRAW);
+    // Overwrite a range of the bytes allocated by the last upload_data() or allocate()
+    void update_data(size_t offset, const void* data, size_t size);
     
     GLuint get_id() const { return m_id; }
+    size_t get_capacity() const { return m_capacity; }
     size_t get_count() const { return m_count; }
     void set_count(size_t count) { m_count = count; }
 
 private:
     GLuint m_id = 0;
     size_t m_count = 0; 
+    size_t m_capacity = 0;
 };
 
 class VertexArray {
@@ -147,7 +147,7 @@ Plater::Plater(wxWindow* parent, const wxString& title) :
         if (sel != wxNOT_FOUND) {
             wxTheApp->CallAfter([this, sel]() {
                 wxString page_text = preview_notebook->GetPageText(sel);
-                if (page_text == _("Preview") && preview3D) {
+                if (page_text == _("Preview") && preview3D && !m_slicing_active) {
                      preview3D->load_print();
                 }
             });
@@ -622,28 +622,33 @@ void Plater::refresh_canvases() {
 
     if (this->canvas3D != nullptr)
         this->canvas3D->update();
-    if (this->preview3D != nullptr)
+    // the process publishes its layers to the preview itself
+    if (this->preview3D != nullptr && !m_slicing_active)
         this->preview3D->reload_print();
 
 }
 
 void Plater::arrange() {
-    // TODO pause background process
     const Slic3r::BoundingBoxf bb {Slic3r::BoundingBoxf(this->config->get<ConfigOptionPoints>("bed_shape").values)};
     if (this->objects.size() == 0U) { // abort
         return; 
     }
+    this->pause_background_process();
     bool success {this->model->arrange_objects(this->config->config().min_object_distance(), &bb)};
 
     if (success) {
     } else {
     }
     this->on_model_change(true);
+    this->resume_background_process();
 }
 
 void Plater::on_model_change(bool force_autocenter) {
     Log::info(LogChannel, L"Called on_modal_change");
 
+    // the instances may move: process again below
+    this->stop_background_process();
+
     // reload the select submenu (if already initialized)
     {
         auto* menu = this->GetFrame()->plater_select_menu;
@@ -669,6 +674,7 @@ void Plater::on_model_change(bool force_autocenter) {
         this->model->center_instances_around_point(this->bed_centerf());
     }
     this->refresh_canvases();
+    this->start_background_process();
 }
 
 ObjRef Plater::selected_object() {
@@ -1228,20 +1234,142 @@ void Plater::object_list_changed() {
 }
 
 void Plater::stop_background_process() {
+    // the process stops at its next cancellation point
+    this->print->cancellation.cancel();
     if (m_slicing_thread.joinable()) {
         m_slicing_thread.join();
     }
+    this->print->cancellation.reset();
+    this->print->status_cb = nullptr;
+    this->print->layer_done_cb = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_finished_layers_mutex);
+        m_finished_layers.clear();
+    }
+    m_slicing_generation++;
+    if (m_slicing_progress != nullptr) {
+        m_slicing_progress->Destroy();
+        m_slicing_progress = nullptr;
+    }
 }
 
-void Plater::start_background_process() {
-    //TODO
+void Plater::start_background_process(bool force) {
+    if (!force && !ui_settings->background_processing) return;
+    if (this->objects.empty() || m_slicing_paused) return;
+    if (m_slicing_active) {
+        // its result is still valid, as changes stop it
+        m_slicing_forced = m_slicing_forced || force;
+        return;
+    }
+    if (m_slicing_thread.joinable()) m_slicing_thread.join();
+
+    // Apply config
+    this->load_current_presets();
+    
+    // Auto-detect threads if not set or set to 1
+    if (this->print->config.threads.value <= 1) {
+        this->print->config.threads.value = std::thread::hardware_concurrency();
+         if (this->print->config.threads.value == 0) this->print->config.threads.value = 2;
+    }
+
+    // Validate
+    try {
+        this->print->validate();
+    } catch (std::exception& e) {
+        if (force)
+            wxMessageBox(wxString::FromUTF8(e.what()), _("Configuration Error"), wxICON_ERROR);
+        else
+            Slic3r::Log::warn(LogChannel, std::string("Not processing: ") + e.what());
+        return;
+    }
+
+    m_slicing_forced = force;
+    const size_t generation = m_slicing_generation;
+    {
+        std::lock_guard<std::mutex> lock(m_finished_layers_mutex);
+        m_finished_layers.clear();
+    }
+    if (this->preview3D) this->preview3D->start_progressive();
+    if (force)
+        m_slicing_progress = new wxProgressDialog(_("Slicing"), _("Processing..."), 100, this, wxPD_AUTO_HIDE);
+
+    // The callbacks run on the threads of the process: they queue events on the Plater,
+    // which are dropped with the Plater, and ignored once the process is stopped.
+    this->print->status_cb = [this, generation](int percent, const std::string& msg) {
+        this->CallAfter([this, generation, percent, msg]() {
+            if (generation == m_slicing_generation && m_slicing_progress != nullptr)
+                m_slicing_progress->Update(percent, wxString::FromUTF8(msg.c_str()));
+        });
+    };
+    this->print->layer_done_cb = [this, generation](const Layer* layer) {
+        std::lock_guard<std::mutex> lock(m_finished_layers_mutex);
+        if (m_finished_layers.empty())
+            this->CallAfter([this, generation]() { this->flush_finished_layers(generation); });
+        m_finished_layers.push_back(layer);
+    };
+
+    m_slicing_active = true;
+    m_slicing_thread = std::thread([this, generation]() {
+        std::string error;
+        try {
+            this->print->reload_model_instances();
+            this->print->process();
+        } catch (CancelledException&) {
+            // stopped: the Plater is changing the print
+            m_slicing_active = false;
+            return;
+        } catch (std::exception& e) {
+            error = e.what();
+        }
+        m_slicing_active = false;
+
+        this->CallAfter([this, generation, error]() {
+            if (generation != m_slicing_generation) return;
+            this->flush_finished_layers(generation);
+            this->print->status_cb = nullptr;
+            this->print->layer_done_cb = nullptr;
+            if (m_slicing_progress != nullptr) {
+                m_slicing_progress->Destroy();
+                m_slicing_progress = nullptr;
+            }
+
+            if (!error.empty()) {
+                if (m_slicing_forced)
+                    wxMessageBox(wxString::FromUTF8(error.c_str()), _("Slicing Error"), wxICON_ERROR);
+                else
+                    Slic3r::Log::error(LogChannel, "Processing failed: " + error);
+            } else if (m_slicing_forced) {
+                // Switch execution to Preview tab
+                this->preview_notebook->SetSelection(1);
+            }
+            m_slicing_forced = false;
+        });
+    });
+}
+
+void Plater::flush_finished_layers(size_t generation) {
+    // a flush queued by a stopped process must leave the layers of the current one alone
+    if (generation != m_slicing_generation) return;
+    std::vector<const Layer*> layers;
+    {
+        std::lock_guard<std::mutex> lock(m_finished_layers_mutex);
+        std::swap(layers, m_finished_layers);
+    }
+    if (this->preview3D) this->preview3D->add_layers(layers);
 }
 
 void Plater::pause_background_process() {
-    //TODO
+    if (m_slicing_paused) return;
+    m_slicing_restart = m_slicing_active;
+    this->stop_background_process();
+    m_slicing_paused = true;
 }
+
 void Plater::resume_background_process() {
-    //TODO
+    if (!m_slicing_paused) return;
+    m_slicing_paused = false;
+    // restarts the process stopped by the pause, or processes the changes in the background
+    this->start_background_process(m_slicing_restart && m_slicing_forced);
 }
 
 ThemedMenu* Plater::object_menu() {
@@ -1323,16 +1451,20 @@ void Plater::set_number_of_copies() {
     this->pause_background_process();
 
     ObjRef obj {this->selected_object()};
-    if (obj == this->objects.end()) return;
-
-    int idx = this->get_object_index(obj->identifier);
-    if (idx < 0) return;
+    int idx = (obj == this->objects.end()) ? -1 : this->get_object_index(obj->identifier);
+    if (idx < 0) {
+        this->resume_background_process();
+        return;
+    }
 
     auto* model_object { this->model->objects.at(idx) };
 
     long copies = -1;
     copies = wxGetNumberFromUser("", _("Enter the number of copies of the selected object:"), _("Copies"), model_object->instances.size(), 0, 1000, this);
-    if (copies < 0) return;
+    if (copies < 0) {
+        this->resume_background_process();
+        return;
+    }
     long instance_count = 0;
     if (model_object->instances.size() <= LONG_MAX) {
         instance_count = static_cast<long>(model_object->instances.size());
@@ -1341,9 +1473,9 @@ void Plater::set_number_of_copies() {
     }
     long diff {copies - instance_count };
 
-    if      (diff == 0) { this->resume_background_process(); }
-    else if (diff > 0)  { this->increase(diff); }
+    if      (diff > 0)  { this->increase(diff); }
     else if (diff < 0)  { this->decrease(-diff); }
+    this->resume_background_process();
 }
 void Plater::center_selected_object_on_bed() {
     ObjRef obj {this->selected_object()};
@@ -1439,6 +1571,9 @@ void Plater::export_gcode() {
         return;
     std::string output_file = saveFileDialog.GetPath().ToStdString();
 
+    // The export goes on from the steps the background process finished
+    this->pause_background_process();
+
     // Apply config
     this->load_current_presets();
     this->print->apply_config(this->config->config());
@@ -1448,6 +1583,7 @@ void Plater::export_gcode() {
         this->print->validate();
     } catch (std::exception& e) {
         wxMessageBox(wxString::FromUTF8(e.what()), _("Configuration Error"), wxICON_ERROR);
+        this->resume_background_process();
         return;
     }
 
@@ -1477,6 +1613,7 @@ void Plater::export_gcode() {
     
     // Cleanup callback
     this->print->status_cb = nullptr;
+    this->resume_background_process();
 }
 
 
@@ -1486,97 +1623,9 @@ void Plater::slice() {
         return;
     }
 
-    // Apply config
-    this->load_current_presets();
-    this->print->apply_config(this->config->config());
-    
-    // Auto-detect threads if not set or set to 1
-    if (this->print->config.threads.value <= 1) {
-        this->print->config.threads.value = std::thread::hardware_concurrency();
-         if (this->print->config.threads.value == 0) this->print->config.threads.value = 2;
-    }
-
-    // Validate
-    try {
-        this->print->validate();
-    } catch (std::exception& e) {
-        wxMessageBox(wxString::FromUTF8(e.what()), _("Configuration Error"), wxICON_ERROR);
-        return;
-    }
-
-    // Create a progress handling mechanism that works across threads
-    // We cannot use wxProgressDialog in modal mode effectively if we want non-blocking (well, we can but we want background)
-    // For now, let's keep the dialog but show it non-modally or use a flag.
-    // Actually, "Background slicing" usually implies the UI remains responsive. 
-    // Let's use a non-modal ProgressDialog or just a status bar update. 
-    // For specific user request "background sliceing like prusa", PrusaSlicer shows a progress bar in the bottom right 
-    // and lets you rotate the view.
-
-    // Using a simpler approach: Standard thread.
-    
-    // Disable slice button to prevent double-click
-    // TODO: Disable UI controls
-    
-    auto* progressDialog = new wxProgressDialog(_("Slicing"), _("Processing..."), 100, this, wxPD_APP_MODAL | wxPD_AUTO_HIDE);
-    // Note: wxPD_APP_MODAL blocks the UI interaction. 
-    // If we want TRUE background slicing, we should remove wxPD_APP_MODAL and potentially use the status bar.
-    // But for now, ensuring it runs in a thread prevents "Not Responding" windows ghosting.
-    
-    // To allow UI updates, we pass the pointer. Mutable lambda.
-
-    // Ensure previous thread is joined before starting new one
-    stop_background_process();
-
-    m_slicing_active = true;
-    m_slicing_thread = std::thread([this, progressDialog]() {
-        try {
-            // Ensure Print object has the latest Model state
-             // This touches Model which might be main-thread only if not careful, but usually Model is data.
-             // reload_model_instances() reads model instances. 
-             // We should probably do this on main thread before spawning? 
-             // Let's assume it's safe or do it before.
-            
-            // Set status callback
-            this->print->status_cb = [progressDialog](int percent, const std::string& msg) {
-                wxTheApp->CallAfter([progressDialog, percent, msg]() {
-                    progressDialog->Update(percent, wxString::FromUTF8(msg.c_str()));
-                });
-            };
-
-            // Process
-            // reload_model_instances interacts with ModelObject which touches Pointf, safe.
-            this->print->reload_model_instances();
-            this->print->process();
-
-            // Success
-            wxTheApp->CallAfter([this, progressDialog]() {
-                progressDialog->Close();
-                progressDialog->Destroy();
-                
-                // Update Preview
-                if(this->preview3D) this->preview3D->reload_print();
-
-                // Switch execution to Preview tab
-                this->preview_notebook->SetSelection(1); 
-                
-                // Optional: Flash notification or simple message
-                // wxMessageBox(_("Slicing Complete"), _("Done"), wxICON_INFORMATION);
-            });
-
-        } catch (std::exception& e) {
-             std::string msg = e.what();
-             wxTheApp->CallAfter([this, progressDialog, msg]() {
-                progressDialog->Close();
-                progressDialog->Destroy();
-                wxMessageBox(wxString::FromUTF8(msg.c_str()), _("Slicing Error"), wxICON_ERROR);
-            });
-        }
-        
-        // Cleanup callback
-        this->print->status_cb = nullptr;
-        m_slicing_active = false;
-        
-    });
+    // Processes the steps not done yet in the background, showing the layers in the preview
+    // as they are finished; changes to the model or to the settings stop it.
+    this->start_background_process(true);
 }
 
 void Plater::update_quick_settings() {
@@ -1594,7 +1643,7 @@ void Plater::update_quick_settings() {
 
     // 3. Define Keys
     const std::vector<std::string> printer_keys = {
-        "z_offset", "extruders_count", "has_heatbed", "serial_port", "serial_speed", "host_type", "print_host", "octoprint_apikey",
+        "z_offset", "extruders_count", "has_heatbed", "serial_port", "serial_speed", "serial_window", "serial_window_bytes", "host_type", "print_host", "octoprint_apikey",
         "gcode_flavor", "use_relative_e_distances", "use_firmware_retraction", "use_volumetric_e", "pressure_advance", "vibration_limit",
         "z_steps_per_mm", "use_set_and_wait_extruder", "use_set_and_wait_bed", "fan_percentage", "start_gcode", "end_gcode",
         "before_layer_gcode", "layer_gcode", "toolchange_gcode", "between_objects_gcode", "nozzle_diameter", "min_layer_height",
@@ -1630,7 +1679,7 @@ void Plater::update_quick_settings() {
         "extrusion_width", "first_layer_extrusion_width", "perimeter_extrusion_width", "external_perimeter_extrusion_width",
         "infill_extrusion_width", "solid_infill_extrusion_width", "top_infill_extrusion_width", "support_material_interface_extrusion_width",
         "support_material_extrusion_width", "infill_overlap", "bridge_flow_ratio", "xy_size_compensation", "resolution", "complete_objects",
-        "extruder_clearance_radius", "extruder_clearance_height", "gcode_comments", "label_printed_objects", "output_filename_format",
+        "extruder_clearance_radius", "extruder_clearance_height", "gcode_comments", "gcode_compression", "label_printed_objects", "output_filename_format",
         "post_process", "notes"
     };
 
@@ -9,10 +9,12 @@
 #include <wx/toolbar.h>
 
 #include <wx/simplebook.h>
+#include <wx/progdlg.h>
 
 #include <stack>
 #include <thread>
 #include <atomic>
+#include <mutex>
 
 #include "libslic3r.h"
 #include "Model.hpp"
@@ -276,10 +278,17 @@ private:
     void object_list_changed();
 
     /// Halt ongoing background processes.
+    /// The steps they finished are kept, so processing again starts from the first step
+    /// invalidated since.
     void stop_background_process();
 
-    void start_background_process();
+    /// Processes the print on a background thread if background processing is enabled and
+    /// it is not running already, showing its layers in the preview as they are finished.
+    /// \param force even if background processing is disabled, to slice now
+    void start_background_process(bool force = false);
 
+    /// Stops the background process while the model is changed;
+    /// resume_background_process() starts it again if it was running.
     void pause_background_process();
     void resume_background_process();
 
@@ -298,6 +307,20 @@ private:
 
     std::thread m_slicing_thread;
     std::atomic<bool> m_slicing_active {false};
+    /// Whether the process is paused, and whether it was running when paused.
+    bool m_slicing_paused {false}, m_slicing_restart {false};
+    /// Whether the process was started by slice(), which shows its progress and result.
+    bool m_slicing_forced {false};
+    /// Incremented by stop_background_process(), so that the events of a stopped process
+    /// still queued on the UI thread are dropped.
+    size_t m_slicing_generation {0};
+    wxProgressDialog* m_slicing_progress {nullptr};
+
+    /// Layers finished by the process, not yet added to the preview.
+    std::vector<const Layer*> m_finished_layers;
+    std::mutex m_finished_layers_mutex;
+    /// Adds the finished layers to the preview, on the UI thread.
+    void flush_finished_layers(size_t generation);
 };
 
 
@@ -103,8 +103,7 @@ void Plate3D::update(){
         const auto &modelobj = model->objects.at(object.identifier);
         for(ModelInstance *instance: modelobj->instances){
             for(ModelVolume* volume: modelobj->volumes){
-                TriangleMesh copy = volume->mesh;
-                instance->transform_mesh(&copy);
+                TriangleMesh copy = volume->get_transformed_mesh(instance->get_trafo_matrix());
                 GLVertexArray model;
                 model.load_mesh(copy);
                 
@@ -116,7 +115,7 @@ void Plate3D::update(){
                 
                 // OBB Support
                 vol.is_obb = true;
-                vol.raw_bbox = volume->mesh.bounding_box();
+                vol.raw_bbox = volume->bounding_box();
                 
                 // Convert TransformationMatrix (double) to glm::mat4 (float)
                 // TransformationMatrix is row-major but GLM is column-major?
@@ -1,4 +1,6 @@
 #include "Preview3D.hpp"
+#include <algorithm>
+#include <set>
 #include <wx/event.h>
 #include "libslic3r.h"
 #include "ExtrusionEntity.hpp"
@@ -15,97 +17,52 @@ void PreviewScene3D::load_print_toolpaths(std::shared_ptr<Slic3r::Print> print)
     
     if(!print || print->objects.empty()) return;
 
-    CanvasThemeColors theme = CanvasTheme::GetColors();
+    std::vector<const Layer*> print_layers;
+    for (auto* object : print->objects) {
+        print_layers.insert(print_layers.end(), object->layers.begin(), object->layers.end());
+        print_layers.insert(print_layers.end(), object->support_layers.begin(), object->support_layers.end());
+    }
+    this->add_layer_toolpaths(print_layers);
+}
 
-    struct VolData {
-        std::vector<Slic3r::ExtrusionGeometry::InstanceData> instances;
-    };
-    std::map<unsigned long, VolData> vol_map; // Key: RGB value
-
-    // Helper to process extrusion collection recursively
-    std::function<void(const ExtrusionEntityCollection&, const Point&, double, std::map<unsigned long, VolData>&)> process_collection;
-    process_collection = [&](const ExtrusionEntityCollection& collection, const Point& copy, double top_z, std::map<unsigned long, VolData>& vol_map) {
-        for(const auto* entity : collection.entities) {
-            Lines lines;
-            std::vector<double> widths;
-            std::vector<double> heights;
-            ExtrusionRole role = erNone;
-
-            if (const auto* path = dynamic_cast<const ExtrusionPath*>(entity)) {
-                Polyline polyline = path->polyline;
-                polyline.remove_duplicate_points();
-                // Translation handled by extrusion_to_instanced
-                lines = polyline.lines();
-                
-                double w = ::Slic3r::ExtrusionGeometry::get_stadium_width(path->mm3_per_mm, path->height, path->width);
-                widths.assign(lines.size(), w);
-                heights.assign(lines.size(), path->height);
-                role = path->role;
-            } else if (const auto* loop = dynamic_cast<const ExtrusionLoop*>(entity)) {
-                for(const auto& path : loop->paths) {
-                    Polyline polyline = path.polyline;
-                    polyline.remove_duplicate_points();
-                    // Translation handled by extrusion_to_instanced
-                    Lines path_lines = polyline.lines();
-                    lines.insert(lines.end(), path_lines.begin(), path_lines.end());
-                    
-                    double w = ::Slic3r::ExtrusionGeometry::get_stadium_width(path.mm3_per_mm, path.height, path.width);
-                    widths.insert(widths.end(), path_lines.size(), w);
-                    heights.insert(heights.end(), path_lines.size(), path.height);
-                }
-                if (!loop->paths.empty()) role = loop->paths.front().role;
-            } else if (const auto* sub = dynamic_cast<const ExtrusionEntityCollection*>(entity)) {
-                process_collection(*sub, copy, top_z, vol_map);
-                continue;
-            }
+void PreviewScene3D::add_layer_toolpaths(const std::vector<const Layer*>& print_layers) {
+    CanvasThemeColors theme = CanvasTheme::GetColors();
 
-            if(!lines.empty() && role != erNone) {
-                wxColor c = theme.get_role_color(role);
-                unsigned long color_key = c.GetRGB();
-                float gl_color[4] = { c.Red()/255.0f, c.Green()/255.0f, c.Blue()/255.0f, 1.0f };
-                
-                ::Slic3r::ExtrusionGeometry::extrusion_to_instanced(lines, widths, heights, top_z, copy, gl_color, vol_map[color_key].instances);
-            }
-        }
-    };
+    ExtrusionGeometry::RoleColors colors;
+    for (int role = erNone; role <= erSupportMaterialInterface; ++role) {
+        wxColor c = theme.get_role_color(ExtrusionRole(role));
+        colors.push_back({ (uint32_t)c.GetRGB(), { c.Red()/255.0f, c.Green()/255.0f, c.Blue()/255.0f, 1.0f } });
+    }
 
-    for (auto* object : print->objects) {
-        for(const auto& copy : object->_shifted_copies) {
-            for (auto* layer : object->layers) {
-                for (auto* region : layer->regions) {
-                    process_collection(region->perimeters, copy, layer->print_z, vol_map);
-                    process_collection(region->fills, copy, layer->print_z, vol_map);
-                }
-            }
-            for (auto* layer : object->support_layers) {
-                process_collection(layer->support_fills, copy, layer->print_z, vol_map);
-                process_collection(layer->support_interface_fills, copy, layer->print_z, vol_map);
-            }
+    // Build the instances of the layers in parallel, in chunks per layer and color
+    const std::vector<ExtrusionGeometry::LayerInstances> layer_instances
+        = ExtrusionGeometry::layers_to_instanced(print_layers, colors);
+
+    // Add them to the volume of their color, in Z order to allow drawing only up to specific layer
+    std::set<uint32_t> keys;
+    for (const auto& layer : layer_instances) {
+        for (const auto& chunk : layer.chunks) {
+            if (!keys.insert(chunk.first).second) continue;
+            const auto vol = std::find_if(this->volumes.begin(), this->volumes.end(),
+                [&chunk](const Volume& v) { return v.is_instanced && v.color.GetRGB() == chunk.first; });
+            if (vol != this->volumes.end()) continue;
+            Volume new_vol;
+            new_vol.color.SetRGB(chunk.first);
+            new_vol.origin = Pointf3(0,0,0);
+            new_vol.is_instanced = true;
+            this->volumes.push_back(new_vol);
         }
     }
+    std::map<uint32_t, ExtrusionGeometry::InstanceBuffer*> buffers;
+    for (auto& vol : this->volumes) {
+        if (vol.is_instanced) buffers[(uint32_t)vol.color.GetRGB()] = &vol.instances;
+    }
+    ExtrusionGeometry::add_instanced(layer_instances, buffers);
 
-    // Finalize volumes
-    for(auto& pair : vol_map) {
-        Volume vol;
-        vol.color.SetRGB(pair.first);
-        vol.origin = Pointf3(0,0,0);
-        vol.instances = std::move(pair.second.instances);
-        
-        // Sort instances by Z height (PosA.z) to allow drawing only up to specific layer
-        std::sort(vol.instances.begin(), vol.instances.end(), [](const Slic3r::ExtrusionGeometry::InstanceData& a, const Slic3r::ExtrusionGeometry::InstanceData& b) {
-            return a.posA[2] < b.posA[2];
-        });
-
-        vol.is_instanced = true;
+    for (auto& vol : this->volumes) {
+        if (!vol.is_instanced || keys.count((uint32_t)vol.color.GetRGB()) == 0) continue;
+        vol.bb = vol.instances.bb;
         vol.gpu_dirty = true;
-        
-        // Compute BB roughly
-        for(const auto& inst : vol.instances) {
-            vol.bb.merge(Pointf3(inst.posA[0], inst.posA[1], inst.posA[2]));
-            vol.bb.merge(Pointf3(inst.posB[0], inst.posB[1], inst.posB[2]));
-        }
-        
-        this->volumes.push_back(vol);
     }
 }
 
@@ -210,6 +167,7 @@ void Preview3D::load_print() {
         
         _enabled = true;
         std::sort(layers_z.begin(),layers_z.end());
+        layers_z.erase(std::unique(layers_z.begin(), layers_z.end()), layers_z.end());
         slider->SetRange(0, layers_z.size()-1);
         z_idx = slider->GetValue();
         // If invalid z_idx,  move the slider to the top
@@ -227,6 +185,40 @@ void Preview3D::load_print() {
     
     set_z(layers_z.at(z_idx));
 }
+void Preview3D::start_progressive() {
+    canvas.resetObjects();
+    layers_z.clear();
+    // the layers come from add_layers(), the print being processed
+    loaded = true;
+    _enabled = false;
+    slider->Hide();
+    Layout();
+    canvas.Refresh();
+}
+
+void Preview3D::add_layers(const std::vector<const Layer*>& layers) {
+    if (layers.empty()) return;
+
+    // follow the top layer if it is shown
+    const bool at_top = !_enabled || slider->GetValue() + 1 >= (int)layers_z.size();
+    for (const auto* layer : layers) {
+        // an object layer and a support layer, or layers of several objects, may share their Z
+        const auto it = std::upper_bound(layers_z.begin(), layers_z.end(), (float)layer->print_z);
+        if (it != layers_z.begin() && *(it - 1) == (float)layer->print_z) continue;
+        layers_z.insert(it, layer->print_z);
+    }
+    canvas.add_layer_toolpaths(layers);
+
+    _enabled = true;
+    slider->SetRange(0, layers_z.size()-1);
+    if (at_top) slider->SetValue(layers_z.size()-1);
+    if (!slider->IsShown()) {
+        slider->Show();
+        Layout();
+    }
+    set_z(layers_z.at(slider->GetValue()));
+}
+
 void Preview3D::set_z(float z) {
     if(!_enabled) return;
     z_label->SetLabel(std::to_string(z));
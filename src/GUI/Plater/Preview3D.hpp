@@ -18,6 +18,8 @@ public:
     PreviewScene3D(wxWindow* parent, const wxSize& size) : Scene3D(parent,size){}
 
     void load_print_toolpaths(std::shared_ptr<Slic3r::Print> print);
+    /// Adds the toolpaths of layers of the print, of objects or support.
+    void add_layer_toolpaths(const std::vector<const Layer*>& print_layers);
     void set_toolpaths_range(float min_z, float max_z);
     
     // Expose set_bed_shape
@@ -46,6 +48,10 @@ class Preview3D : public wxPanel {
 public:
     void reload_print();
     void load_print();
+    /// Clears the preview, to show the layers of the print being processed as they are
+    /// added; load_print() does not read the print until the next reload_print().
+    void start_progressive();
+    void add_layers(const std::vector<const Layer*>& layers);
     void set_bed_shape(const std::vector<Point>& shape);
     Preview3D(wxWindow* parent, const wxSize& size, std::shared_ptr<Slic3r::Print> _print, std::vector<PlaterObject>& _objects, std::shared_ptr<Model> _model, std::shared_ptr<Config> _config);
     void enabled(bool enable = true) {}
@@ -446,26 +446,33 @@ void Scene3D::draw_volumes() {
                  if(!volume.instance_buffer) volume.instance_buffer = std::make_shared<GL::VertexBuffer>();
                  // Upload SSBO
                  // Note: InstanceData size is 48 bytes
-                 volume.instance_buffer->upload_data(volume.instances.data(), volume.instances.size() * sizeof(ExtrusionGeometry::InstanceData), GL_DYNAMIC_DRAW);
-                 volume.instance_count = volume.instances.size();
+                 const ExtrusionGeometry::InstanceBuffer& instances = volume.instances;
+                 const size_t size = instances.instances.size() * sizeof(ExtrusionGeometry::InstanceData);
+                 size_t unchanged = std::min(instances.unchanged, volume.instance_count);
+                 if (size > volume.instance_buffer->get_capacity()) {
+                     // grow geometrically, so that the layers of a print being sliced are
+                     // mostly appended in place
+                     volume.instance_buffer->allocate(std::max(size, 2 * volume.instance_buffer->get_capacity()), GL_DYNAMIC_DRAW);
+                     unchanged = 0;
+                 }
+                 // only the instances added or moved since the last upload
+                 volume.instance_buffer->update_data(unchanged * sizeof(ExtrusionGeometry::InstanceData),
+                     instances.instances.data() + unchanged, size - unchanged * sizeof(ExtrusionGeometry::InstanceData));
+                 volume.instances.unchanged = instances.instances.size();
+                 volume.instance_count = instances.instances.size();
                  volume.gpu_dirty = false;
              }
              
              if(volume.instance_count > 0 && volume.instance_buffer) {
                  // Determine how many instances to draw based on Z clipping
-                 // Binary search for the first instance that is ABOVe clipping Z
-                 // Since instances are sorted by Z, we can just draw 0..Index
+                 // Since instances are ordered by layer, we can just draw the ones of the
+                 // layers up to the clipping Z
                  
                  GLsizei draw_count = (GLsizei)volume.instance_count;
                  
                  // Optimization: Only search if clipping is active (somewhere below max)
                  if (m_clipping_z < 10000.0f) {
-                     // We find the first element that has Z > clipping_z + small margin
-                     auto it = std::upper_bound(volume.instances.begin(), volume.instances.end(), m_clipping_z + 0.01f, 
-                         [](float val, const Slic3r::ExtrusionGeometry::InstanceData& inst) {
-                             return val < inst.posA[2];
-                         });
-                      draw_count = (GLsizei)std::distance(volume.instances.begin(), it);
+                      draw_count = (GLsizei)std::min(volume.instances.count_up_to(m_clipping_z + 0.01f), volume.instance_count);
                  }
 
                  if (draw_count > 0) {
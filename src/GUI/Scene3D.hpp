@@ -49,7 +49,7 @@ struct Volume {
     
     // Instancing
     bool is_instanced = false;
-    std::vector<ExtrusionGeometry::InstanceData> instances;
+    ExtrusionGeometry::InstanceBuffer instances; ///< by layer, the ones up to the clipping Z drawn
     std::shared_ptr<GL::VertexBuffer> instance_buffer;
     size_t instance_count = 0;
 };
@@ -33,6 +33,17 @@ ZipArchive::add_entry (std::string entry_path, std::string file_path)
     return stats;
 }
 
+mz_bool
+ZipArchive::add_entry_from_memory (std::string entry_path, const std::string &data)
+{
+    stats = 0;
+    // Check if it's in the write mode.
+    if(mode != 'W')
+        return stats;
+    stats = mz_zip_writer_add_mem(&archive, entry_path.c_str(), data.data(), data.size(), ZIP_DEFLATE_COMPRESSION);
+    return stats;
+}
+
 mz_bool
 ZipArchive::extract_entry (std::string entry_path, std::string file_path)
 {
@@ -44,6 +55,21 @@ ZipArchive::extract_entry (std::string entry_path, std::string file_path)
     return stats;
 }
 
+mz_bool
+ZipArchive::extract_entry (std::string entry_path, const std::function<bool(const char*, size_t)> &callback)
+{
+    stats = 0;
+    // Check if it's in the read mode.
+    if (mode != 'R')
+        return stats;
+    // Miniz stops extracting when the callback returns less than the size of the chunk.
+    const mz_file_write_func write = [](void *opaque, mz_uint64, const void *buf, size_t n) -> size_t {
+        return (*static_cast<const std::function<bool(const char*, size_t)>*>(opaque))(static_cast<const char*>(buf), n) ? n : 0;
+    };
+    stats = mz_zip_reader_extract_file_to_callback(&archive, entry_path.c_str(), write, const_cast<std::function<bool(const char*, size_t)>*>(&callback), 0);
+    return stats;
+}
+
 mz_bool
 ZipArchive::finalize()
 {
@@ -4,6 +4,7 @@
 #define MINIZ_HEADER_FILE_ONLY
 #define ZIP_DEFLATE_COMPRESSION 8
 
+#include <functional>
 #include <string>
 #include <iostream>
 #include "miniz/miniz.h"
@@ -30,12 +31,24 @@ public:
     /// \return mz_bool 0: failure 1: success.
     mz_bool add_entry (std::string entry_path, std::string file_path);
 
+    /// Add a buffer in memory to the current zip archive.
+    /// \param entry_path string the path of the entry in the zip archive.
+    /// \param data string the content of the entry.
+    /// \return mz_bool 0: failure 1: success.
+    mz_bool add_entry_from_memory (std::string entry_path, const std::string &data);
+
     /// Extract a zip entry to a file on the disk.
     /// \param entry_path string the path of the entry in the zip archive.
     /// \param file_path string the path of the file in the disk.
     /// \return mz_bool 0: failure 1: success.
     mz_bool extract_entry (std::string entry_path, std::string file_path);
 
+    /// Extract a zip entry in chunks, passing each one to the callback as soon as it is inflated.
+    /// \param entry_path string the path of the entry in the zip archive.
+    /// \param callback function receiving the chunks in order, returning false to stop the extraction.
+    /// \return mz_bool 0: failure or stopped by the callback 1: success.
+    mz_bool extract_entry (std::string entry_path, const std::function<bool(const char*, size_t)> &callback);
+
     /// Finalize the archive and free any allocated memory.
     /// \return mz_bool 0: failure 1: success.
     mz_bool finalize();
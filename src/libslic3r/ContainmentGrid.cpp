@@ -0,0 +1,202 @@
+#include "ContainmentGrid.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace Slic3r {
+
+ContainmentGrid::ContainmentGrid(const ExPolygons &expolygons)
+    : _expolygons(expolygons), _cell_size(1), _cols(0), _rows(0)
+{
+    this->_bboxes.reserve(this->_expolygons.size());
+    for (size_t i = 0; i < this->_expolygons.size(); ++i) {
+        const ExPolygon &expolygon = this->_expolygons[i];
+        this->_bboxes.push_back(BoundingBox(expolygon.contour.points));
+
+        for (const Polygon &polygon : (Polygons)expolygon) {
+            const Points &points = polygon.points;
+            for (size_t j = 0; j < points.size(); ++j)
+                this->_edges.push_back(Edge(points[j], points[(j + 1) % points.size()], i));
+        }
+    }
+    if (this->_edges.empty()) return;
+
+    Point min = this->_edges.front().a;
+    Point max = min;
+    for (const Edge &edge : this->_edges) {
+        min.x = std::min(min.x, edge.a.x);
+        min.y = std::min(min.y, edge.a.y);
+        max.x = std::max(max.x, edge.a.x);
+        max.y = std::max(max.y, edge.a.y);
+    }
+    this->_origin = min;
+
+    // aim at a couple of edges per cell, without letting a very thin bounding box
+    // produce more cells than edges along its long side
+    const double width  = std::max<double>(1, max.x - min.x);
+    const double height = std::max<double>(1, max.y - min.y);
+    const size_t n = this->_edges.size();
+    this->_cell_size = std::max<coord_t>(1, coord_t(std::sqrt(width * height * 2. / n)));
+    this->_cell_size = std::max<coord_t>(this->_cell_size, coord_t(std::max(width, height) / n));
+    this->_cols = size_t(width  / this->_cell_size) + 1;
+    this->_rows = size_t(height / this->_cell_size) + 1;
+
+    // bucket the edges as compressed rows: count, then fill
+    this->_cell_start.assign(this->_cols * this->_rows + 1, 0);
+    for (const Edge &edge : this->_edges)
+        this->_visit_cells(edge.a, edge.b, [this](size_t cell) { ++this->_cell_start[cell + 1]; });
+    for (size_t i = 1; i < this->_cell_start.size(); ++i)
+        this->_cell_start[i] += this->_cell_start[i - 1];
+
+    this->_cell_edges.resize(this->_cell_start.back());
+    std::vector<size_t> cursor(this->_cell_start.begin(), this->_cell_start.end() - 1);
+    for (size_t i = 0; i < n; ++i)
+        this->_visit_cells(this->_edges[i].a, this->_edges[i].b,
+            [this, &cursor, i](size_t cell) { this->_cell_edges[cursor[cell]++] = i; });
+}
+
+void
+ContainmentGrid::clear()
+{
+    *this = ContainmentGrid();
+}
+
+size_t
+ContainmentGrid::_col(double x) const
+{
+    const double col = std::floor((x - this->_origin.x) / this->_cell_size);
+    return col <= 0 ? 0 : std::min(size_t(col), this->_cols - 1);
+}
+
+size_t
+ContainmentGrid::_row(double y) const
+{
+    const double row = std::floor((y - this->_origin.y) / this->_cell_size);
+    return row <= 0 ? 0 : std::min(size_t(row), this->_rows - 1);
+}
+
+/// Calls visit() with the index of each cell the segment ab passes through,
+/// padded by one unit so that rounding never misses a cell.
+template <class Visitor> void
+ContainmentGrid::_visit_cells(const Point &a, const Point &b, Visitor visit) const
+{
+    const double ymin = std::min(a.y, b.y);
+    const double ymax = std::max(a.y, b.y);
+    const size_t row_max = this->_row(ymax + 1);
+    for (size_t row = this->_row(ymin - 1); row <= row_max; ++row) {
+        // x extent of the part of the segment lying within this row
+        double x0 = std::min(a.x, b.x);
+        double x1 = std::max(a.x, b.x);
+        if (a.y != b.y) {
+            const double band_min = this->_origin.y + double(row) * this->_cell_size;
+            const double lo = std::max(ymin, std::min(ymax, band_min));
+            const double hi = std::max(ymin, std::min(ymax, band_min + this->_cell_size));
+            const double x_lo = a.x + double(b.x - a.x) * (lo - a.y) / double(b.y - a.y);
+            const double x_hi = a.x + double(b.x - a.x) * (hi - a.y) / double(b.y - a.y);
+            x0 = std::min(x_lo, x_hi);
+            x1 = std::max(x_lo, x_hi);
+        }
+        const size_t col_max = this->_col(x1 + 1);
+        for (size_t col = this->_col(x0 - 1); col <= col_max; ++col)
+            visit(row * this->_cols + col);
+    }
+}
+
+/// Same crossing rule as Polygon::contains(), casting the ray to the closest side of the grid.
+/// Each crossing is only counted in the cell it falls into, as edges span several cells.
+bool
+ContainmentGrid::_contains_point(size_t expolygon, const Point &point) const
+{
+    const size_t row = this->_row(point.y);
+    const size_t col = this->_col(point.x);
+    const bool to_right = (this->_cols - 1 - col) <= col;
+
+    bool result = false;
+    for (size_t c = col; c < this->_cols; to_right ? ++c : --c) {
+        const size_t cell = row * this->_cols + c;
+        for (size_t k = this->_cell_start[cell]; k < this->_cell_start[cell + 1]; ++k) {
+            const Edge &edge = this->_edges[this->_cell_edges[k]];
+            if (edge.expolygon != expolygon || (edge.a.y > point.y) == (edge.b.y > point.y)) continue;
+            const double x = (double)(edge.b.x - edge.a.x) * (double)(point.y - edge.a.y) / (double)(edge.b.y - edge.a.y) + (double)edge.a.x;
+            if ((to_right ? (double)point.x < x : x < (double)point.x) && this->_col(x) == c)
+                result = !result;
+        }
+    }
+    return result;
+}
+
+static inline int64_t
+_orientation(const Point &a, const Point &b, const Point &c)
+{
+    return int64_t(b.x - a.x) * int64_t(c.y - a.y) - int64_t(b.y - a.y) * int64_t(c.x - a.x);
+}
+
+/// Whether c, collinear with ab, lies on the segment ab.
+static inline bool
+_on_segment(const Point &a, const Point &b, const Point &c)
+{
+    return std::min(a.x, b.x) <= c.x && c.x <= std::max(a.x, b.x)
+        && std::min(a.y, b.y) <= c.y && c.y <= std::max(a.y, b.y);
+}
+
+enum SegmentContact { scNone, scTouching, scCrossing };
+
+static SegmentContact
+_segment_contact(const Point &p, const Point &q, const Point &a, const Point &b)
+{
+    const int64_t d1 = _orientation(a, b, p);
+    const int64_t d2 = _orientation(a, b, q);
+    const int64_t d3 = _orientation(p, q, a);
+    const int64_t d4 = _orientation(p, q, b);
+    if (((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+        return scCrossing;
+    if ((d1 == 0 && _on_segment(a, b, p)) || (d2 == 0 && _on_segment(a, b, q))
+        || (d3 == 0 && _on_segment(p, q, a)) || (d4 == 0 && _on_segment(p, q, b)))
+        return scTouching;
+    return scNone;
+}
+
+bool
+ContainmentGrid::any_contains(const Polyline &polyline) const
+{
+    if (this->_edges.empty() || polyline.points.empty()) return false;
+
+    // only expolygons whose bounding box covers the polyline may contain it
+    const BoundingBox bb(polyline.points);
+    std::vector<SegmentContact> contact(this->_expolygons.size(), scCrossing);
+    bool any_candidate = false;
+    for (size_t i = 0; i < this->_bboxes.size(); ++i) {
+        const BoundingBox &other = this->_bboxes[i];
+        if (bb.min.x >= other.min.x && bb.min.y >= other.min.y
+            && bb.max.x <= other.max.x && bb.max.y <= other.max.y) {
+            contact[i] = (polyline.points.size() < 2) ? scTouching : scNone;
+            any_candidate = true;
+        }
+    }
+    if (!any_candidate) return false;
+
+    // a polyline crossing the boundary of an expolygon leaves it
+    for (size_t j = 1; j < polyline.points.size(); ++j) {
+        const Point &p = polyline.points[j - 1];
+        const Point &q = polyline.points[j];
+        this->_visit_cells(p, q, [this, &contact, &p, &q](size_t cell) {
+            for (size_t k = this->_cell_start[cell]; k < this->_cell_start[cell + 1]; ++k) {
+                const Edge &edge = this->_edges[this->_cell_edges[k]];
+                if (contact[edge.expolygon] == scCrossing) continue;
+                const SegmentContact c = _segment_contact(p, q, edge.a, edge.b);
+                if (c != scNone) contact[edge.expolygon] = c;
+            }
+        });
+    }
+
+    for (size_t i = 0; i < this->_expolygons.size(); ++i) {
+        if (contact[i] == scNone) {
+            // the polyline lies either fully inside or fully outside
+            if (this->_contains_point(i, polyline.points.front())) return true;
+        } else if (contact[i] == scTouching) {
+            if (this->_expolygons[i].contains(polyline)) return true;
+        }
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef slic3r_ContainmentGrid_hpp_
+#define slic3r_ContainmentGrid_hpp_
+
+#include "libslic3r.h"
+#include "BoundingBox.hpp"
+#include "ExPolygon.hpp"
+#include "Polyline.hpp"
+#include <vector>
+
+namespace Slic3r {
+
+/// Answers "is this polyline fully inside one of these expolygons" without testing
+/// the polyline against every edge of every expolygon.
+/// The edges are bucketed in a uniform grid, so that a query only looks at the edges
+/// lying in the cells crossed by the polyline. An expolygon whose boundary is not
+/// touched by the polyline contains it if it contains its first point, which is tested
+/// by casting a ray along a single row of cells.
+/// Polylines touching a boundary without crossing it fall back to ExPolygon::contains(),
+/// so that the results are the same as testing each expolygon.
+class ContainmentGrid
+{
+    public:
+    ContainmentGrid() : _cell_size(1), _cols(0), _rows(0) {};
+    explicit ContainmentGrid(const ExPolygons &expolygons);
+
+    /// Whether any of the expolygons contains the whole polyline.
+    bool any_contains(const Polyline &polyline) const;
+    bool empty() const { return this->_expolygons.empty(); };
+    void clear();
+
+    private:
+    struct Edge {
+        Point   a, b;
+        size_t  expolygon;
+        Edge(const Point &a, const Point &b, size_t expolygon) : a(a), b(b), expolygon(expolygon) {};
+    };
+
+    ExPolygons              _expolygons;
+    std::vector<BoundingBox> _bboxes;
+    std::vector<Edge>       _edges;
+    Point                   _origin;
+    coord_t                 _cell_size;
+    size_t                  _cols, _rows;
+    /// Edges of cell i are _cell_edges[_cell_start[i]] to _cell_edges[_cell_start[i+1]-1].
+    std::vector<size_t>     _cell_start;
+    std::vector<size_t>     _cell_edges;
+
+    size_t _col(double x) const;
+    size_t _row(double y) const;
+    template <class Visitor> void _visit_cells(const Point &a, const Point &b, Visitor visit) const;
+    bool _contains_point(size_t expolygon, const Point &point) const;
+};
+
+}
+
+#endif
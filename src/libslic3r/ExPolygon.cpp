@@ -8,6 +8,7 @@
 #include "poly2tri/poly2tri.h"
 #include <algorithm>
 #include <cassert>
+#include <iterator>
 #include <list>
 
 namespace Slic3r {
@@ -299,14 +300,11 @@ ExPolygon::medial_axis(const ExPolygon &bounds, double max_width, double min_wid
                         --idx_point;
                     }
                 }
-                //remove points that are outside of the geometry
-                for (unsigned int idx_point = 0; idx_point < polyline.points.size(); ++idx_point) {
-                    //distance of 1 is on the sclaed coordinates, so it correspond to SCALE_FACTOR, so it's very small
-                    if (!bounds.contains_b(polyline.points[idx_point])) {
-                        polyline.points.erase(polyline.points.begin() + idx_point);
-                        --idx_point;
-                    }
-                }
+                //remove points that are outside of the geometry (single compaction pass)
+                polyline.points.erase(
+                    std::remove_if(polyline.points.begin(), polyline.points.end(),
+                        [&bounds](const Point &p) { return !bounds.contains_b(p); }),
+                    polyline.points.end());
                 if (polyline.points.size() < 2) {
                     //remove self
                     pp.erase(pp.begin() + i);
@@ -410,24 +408,22 @@ ExPolygon::medial_axis(const ExPolygon &bounds, double max_width, double min_wid
         }
     }
     
-    for (size_t i = 0; i < pp.size(); ++i) {
-        ThickPolyline& polyline = pp[i];
-
-        //  remove too short polylines
-        // (we can't do this check before endpoints extension and clipping because we don't
-        // know how long will the endpoints be extended since it depends on polygon thickness
-        // which is variable - extension will be <= max_width/2 on each side)
-        if ((polyline.endpoints.first || polyline.endpoints.second)
-            && polyline.length() < max_w * 2) {
-            pp.erase(pp.begin() + i);
-            --i;
-            continue;
-        }
-
-    }
-
+    //  remove too short polylines
+    // (we can't do this check before endpoints extension and clipping because we don't
+    // know how long will the endpoints be extended since it depends on polygon thickness
+    // which is variable - extension will be <= max_width/2 on each side)
+    // This is done in a single compaction pass instead of erasing one by one, and the
+    // surviving polylines are moved rather than copied into the output.
+    const double min_length = max_w * 2;
+    pp.erase(
+        std::remove_if(pp.begin(), pp.end(), [min_length](const ThickPolyline &polyline) {
+            return (polyline.endpoints.first || polyline.endpoints.second)
+                && polyline.length() < min_length;
+        }),
+        pp.end());
     
-    polylines->insert(polylines->end(), pp.begin(), pp.end());
+    polylines->reserve(polylines->size() + pp.size());
+    std::move(pp.begin(), pp.end(), std::back_inserter(*polylines));
 }
 
 void
@@ -58,6 +58,9 @@ public:
 };
 
 typedef std::vector<ExtrusionEntity*> ExtrusionEntitiesPtr;
+/// Non-owning list of entities of collections, used to group and order
+/// extrusions without copying them.
+typedef std::vector<const ExtrusionEntity*> ExtrusionEntitiesConstPtr;
 
 class ExtrusionPath : public ExtrusionEntity
 {
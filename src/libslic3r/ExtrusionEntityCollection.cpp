@@ -11,6 +11,12 @@ ExtrusionEntityCollection::ExtrusionEntityCollection(const ExtrusionEntityCollec
     this->append(collection.entities);
 }
 
+ExtrusionEntityCollection::ExtrusionEntityCollection(ExtrusionEntityCollection &&collection)
+    : no_sort(false)
+{
+    this->swap(collection);
+}
+
 ExtrusionEntityCollection::ExtrusionEntityCollection(const ExtrusionPaths &paths)
     : no_sort(false)
 {
@@ -24,6 +30,13 @@ ExtrusionEntityCollection& ExtrusionEntityCollection::operator= (const Extrusion
     return *this;
 }
 
+ExtrusionEntityCollection& ExtrusionEntityCollection::operator= (ExtrusionEntityCollection &&other)
+{
+    ExtrusionEntityCollection tmp(std::move(other));
+    this->swap(tmp);
+    return *this;
+}
+
 void
 ExtrusionEntityCollection::swap (ExtrusionEntityCollection &c)
 {
@@ -58,11 +71,8 @@ ExtrusionEntityCollection::operator ExtrusionPaths() const
 ExtrusionEntityCollection*
 ExtrusionEntityCollection::clone() const
 {
-    ExtrusionEntityCollection* coll = new ExtrusionEntityCollection(*this);
-    for (size_t i = 0; i < coll->entities.size(); ++i) {
-        coll->entities[i] = this->entities[i]->clone();
-    }
-    return coll;
+    // the copy constructor already clones the entities
+    return new ExtrusionEntityCollection(*this);
 }
 
 void
@@ -119,6 +129,18 @@ ExtrusionEntityCollection::append(const Polylines &polylines, const ExtrusionPat
     }
 }
 
+void
+ExtrusionEntityCollection::append(Polylines &&polylines, const ExtrusionPath &templ)
+{
+    this->entities.reserve(this->entities.size() + polylines.size());
+    for (Polyline &polyline : polylines) {
+        ExtrusionPath *path = templ.clone();
+        path->polyline.points.swap(polyline.points);
+        this->entities.push_back(path);
+    }
+    polylines.clear();
+}
+
 void
 ExtrusionEntityCollection::replace(size_t i, const ExtrusionEntity &entity)
 {
@@ -195,6 +217,40 @@ ExtrusionEntityCollection::chained_path_from(Point start_near, ExtrusionEntityCo
     }
 }
 
+void
+ExtrusionEntityCollection::chained_path_from(const ExtrusionEntitiesConstPtr &entities, Point start_near,
+    std::vector<size_t>* order, std::vector<bool>* reversed, bool no_reverse)
+{
+    order->reserve(order->size() + entities.size());
+    reversed->reserve(reversed->size() + entities.size());
+    
+    // indices of the entities not ordered yet and their endpoints
+    std::vector<size_t> remaining;
+    Points endpoints;
+    remaining.reserve(entities.size());
+    endpoints.reserve(2 * entities.size());
+    for (size_t i = 0; i < entities.size(); ++i) {
+        remaining.push_back(i);
+        endpoints.push_back(entities[i]->first_point());
+        endpoints.push_back((no_reverse || !entities[i]->can_reverse())
+            ? entities[i]->first_point() : entities[i]->last_point());
+    }
+    
+    while (!remaining.empty()) {
+        // find nearest point
+        const int start_index = start_near.nearest_point_index(endpoints);
+        const int path_index  = start_index/2;
+        const ExtrusionEntity* entity = entities[remaining[path_index]];
+        // never reverse loops, since it's pointless for chained path and callers might depend on orientation
+        const bool reverse = start_index % 2 && !no_reverse && entity->can_reverse();
+        order->push_back(remaining[path_index]);
+        reversed->push_back(reverse);
+        remaining.erase(remaining.begin() + path_index);
+        endpoints.erase(endpoints.begin() + 2*path_index, endpoints.begin() + 2*path_index + 2);
+        start_near = reverse ? entity->first_point() : entity->last_point();
+    }
+}
+
 Polygons
 ExtrusionEntityCollection::grow() const
 {
@@ -225,26 +281,32 @@ void
 ExtrusionEntityCollection::flatten(ExtrusionEntityCollection* retval, bool preserve_ordering) const
 {
     if (this->no_sort and preserve_ordering) {
-        /// if we want to preserve ordering and we can't sort, break out the unsorted ones first.
-        ExtrusionEntityCollection *unsortable = new ExtrusionEntityCollection(*this);
-        retval->append(*unsortable);
-        unsortable->entities.clear();
+        /// if we want to preserve ordering and we can't sort, keep the unsortable collection whole.
+        retval->append(*this);
+    } else {
         for (ExtrusionEntitiesPtr::const_iterator it = this->entities.begin(); it != this->entities.end(); ++it) {
             if ((*it)->is_collection()) {
-                ExtrusionEntityCollection* collection = dynamic_cast<ExtrusionEntityCollection*>(*it);
-                collection->flatten(unsortable, preserve_ordering);
-            }
-            else {
-                unsortable->append(**it);
+                const ExtrusionEntityCollection* collection = dynamic_cast<const ExtrusionEntityCollection*>(*it);
+                collection->flatten(retval, preserve_ordering);
+            } else {
+                retval->append(**it);
             }
         }
+    }
+}
+
+void
+ExtrusionEntityCollection::flatten(ExtrusionEntitiesConstPtr* retval, bool preserve_ordering) const
+{
+    if (this->no_sort and preserve_ordering) {
+        retval->push_back(this);
     } else {
         for (ExtrusionEntitiesPtr::const_iterator it = this->entities.begin(); it != this->entities.end(); ++it) {
             if ((*it)->is_collection()) {
-                ExtrusionEntityCollection* collection = dynamic_cast<ExtrusionEntityCollection*>(*it);
-                retval->append(collection->flatten(preserve_ordering).entities);
+                const ExtrusionEntityCollection* collection = dynamic_cast<const ExtrusionEntityCollection*>(*it);
+                collection->flatten(retval, preserve_ordering);
             } else {
-                retval->append(**it);
+                retval->push_back(*it);
             }
         }
     }
@@ -20,8 +20,10 @@ class ExtrusionEntityCollection : public ExtrusionEntity
     bool no_sort;
     ExtrusionEntityCollection(): no_sort(false) {};
     ExtrusionEntityCollection(const ExtrusionEntityCollection &collection);
+    ExtrusionEntityCollection(ExtrusionEntityCollection &&collection);
     ExtrusionEntityCollection(const ExtrusionPaths &paths);
     ExtrusionEntityCollection& operator= (const ExtrusionEntityCollection &other);
+    ExtrusionEntityCollection& operator= (ExtrusionEntityCollection &&other);
     ~ExtrusionEntityCollection();
 
     /// Operator to convert and flatten this collection to a single vector of ExtrusionPaths.
@@ -45,11 +47,20 @@ class ExtrusionEntityCollection : public ExtrusionEntity
     void append(const ExtrusionEntitiesPtr &entities);
     void append(const ExtrusionPaths &paths);
     void append(const Polylines &polylines, const ExtrusionPath &templ);
+    /// Moves the polylines into new paths instead of copying them.
+    void append(Polylines &&polylines, const ExtrusionPath &templ);
     void replace(size_t i, const ExtrusionEntity &entity);
     void remove(size_t i);
     ExtrusionEntityCollection chained_path(bool no_reverse = false, std::vector<size_t>* orig_indices = NULL) const;
     void chained_path(ExtrusionEntityCollection* retval, bool no_reverse = false, std::vector<size_t>* orig_indices = NULL) const;
     void chained_path_from(Point start_near, ExtrusionEntityCollection* retval, bool no_reverse = false, std::vector<size_t>* orig_indices = NULL) const;
+
+    /// Orders entities by the same greedy nearest neighbor search as chained_path_from(),
+    /// without copying them.
+    /// \param order output: indices of the entities in extrusion order.
+    /// \param reversed output: whether the entity at the same position in order has to be extruded backwards.
+    static void chained_path_from(const ExtrusionEntitiesConstPtr &entities, Point start_near,
+        std::vector<size_t>* order, std::vector<bool>* reversed, bool no_reverse = false);
     void reverse();
     Point first_point() const;
     Point last_point() const;
@@ -68,6 +79,10 @@ class ExtrusionEntityCollection : public ExtrusionEntity
     /// \param preserve_ordering Flag to method that will flatten if and only if the underlying collection is sortable when True (default: False).
     ExtrusionEntityCollection flatten(bool preserve_ordering = false) const;
 
+    /// Same as flatten(), but appends pointers to the entities of this collection instead of copies.
+    /// The pointers are valid as long as this collection is not modified.
+    void flatten(ExtrusionEntitiesConstPtr* retval, bool preserve_ordering = false) const;
+
 
     double min_mm3_per_mm() const;
     Polyline as_polyline() const {
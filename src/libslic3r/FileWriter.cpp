@@ -0,0 +1,163 @@
+#include "FileWriter.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <boost/nowide/cstdio.hpp>
+#include <miniz/miniz.h>
+
+namespace Slic3r {
+
+FileWriter::FileWriter(const std::string &path, Mode mode, size_t buffer_size, size_t buffers)
+    : _path(path), _file(nullptr), _deflate(nullptr), _crc(MZ_CRC32_INIT), _size(0),
+        _buffers(std::max(size_t(2), buffers)), _current(0), _closing(false)
+{
+    this->_file = boost::nowide::fopen(path.c_str(), (mode == Text) ? "w" : "wb");
+    if (this->_file == nullptr)
+        throw std::runtime_error("Cannot create " + path + ": " + std::strerror(errno));
+
+    // the destructor doesn't run if the constructor throws
+    try {
+        if (mode == Gzip) {
+            tdefl_compressor* deflate = tdefl_compressor_alloc();
+            this->_deflate = deflate;
+            tdefl_init(deflate, &FileWriter::_put_compressed, this,
+                int(tdefl_create_comp_flags_from_zip_params(MZ_DEFAULT_LEVEL, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY)));
+            // member header: deflate, no name nor time, unknown OS
+            static const char header[10] = { '\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff' };
+            this->_write(header, sizeof(header));
+        }
+
+        for (size_t i = 0; i < this->_buffers.size(); ++i) {
+            this->_buffers[i].resize(std::max(size_t(1), buffer_size));
+            if (i != this->_current) this->_free.push_back(i);
+        }
+        std::vector<char> &buffer = this->_buffers[this->_current];
+        this->setp(buffer.data(), buffer.data() + buffer.size());
+
+        this->_thread = boost::thread(&FileWriter::_write_buffers, this);
+    } catch (...) {
+        if (this->_deflate != nullptr)
+            tdefl_compressor_free(static_cast<tdefl_compressor*>(this->_deflate));
+        std::fclose(this->_file);
+        boost::nowide::remove(path.c_str());
+        throw;
+    }
+}
+
+FileWriter::~FileWriter()
+{
+    try {
+        this->close();
+    } catch (...) {
+    }
+}
+
+FileWriter::int_type
+FileWriter::overflow(int_type c)
+{
+    this->_next_buffer();
+    if (c != traits_type::eof()) {
+        *this->pptr() = traits_type::to_char_type(c);
+        this->pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+void
+FileWriter::_next_buffer()
+{
+    boost::unique_lock<boost::mutex> lock(this->_mutex);
+    this->_filled.emplace_back(this->_current, size_t(this->pptr() - this->pbase()));
+    this->_cond.notify_all();
+    while (this->_free.empty())
+        this->_cond.wait(lock);
+    this->_current = this->_free.back();
+    this->_free.pop_back();
+    std::vector<char> &buffer = this->_buffers[this->_current];
+    this->setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+void
+FileWriter::_write_buffers()
+{
+    boost::unique_lock<boost::mutex> lock(this->_mutex);
+    while (true) {
+        while (this->_filled.empty() && !this->_closing)
+            this->_cond.wait(lock);
+        if (this->_filled.empty()) return;
+        const std::pair<size_t, size_t> filled = this->_filled.front();
+        this->_filled.pop_front();
+        lock.unlock();
+
+        // after an error, the data is dropped so that the writing code is not blocked
+        const char* data = this->_buffers[filled.first].data();
+        if (this->_error.empty()) {
+            if (this->_deflate != nullptr) {
+                this->_crc = uint32_t(mz_crc32(this->_crc, reinterpret_cast<const unsigned char*>(data), filled.second));
+                if (tdefl_compress_buffer(static_cast<tdefl_compressor*>(this->_deflate), data, filled.second, TDEFL_NO_FLUSH) != TDEFL_STATUS_OKAY
+                    && this->_error.empty())
+                    this->_error = "compression failed";
+            } else {
+                this->_write(data, filled.second);
+            }
+        }
+        this->_size += filled.second;
+
+        lock.lock();
+        this->_free.push_back(filled.first);
+        this->_cond.notify_all();
+    }
+}
+
+void
+FileWriter::_write(const char* data, size_t size)
+{
+    if (size > 0 && this->_error.empty() && std::fwrite(data, 1, size, this->_file) != size)
+        this->_error = std::strerror(errno);
+}
+
+int
+FileWriter::_put_compressed(const void* data, int size, void* writer)
+{
+    FileWriter* self = static_cast<FileWriter*>(writer);
+    self->_write(static_cast<const char*>(data), size_t(size));
+    return self->_error.empty() ? MZ_TRUE : MZ_FALSE;
+}
+
+void
+FileWriter::close()
+{
+    if (this->_file == nullptr) return;
+
+    {
+        boost::lock_guard<boost::mutex> lock(this->_mutex);
+        this->_filled.emplace_back(this->_current, size_t(this->pptr() - this->pbase()));
+        this->_closing = true;
+        this->_cond.notify_all();
+    }
+    this->_thread.join();
+    this->setp(nullptr, nullptr);
+
+    if (this->_deflate != nullptr) {
+        if (this->_error.empty() && tdefl_compress_buffer(static_cast<tdefl_compressor*>(this->_deflate), nullptr, 0, TDEFL_FINISH) != TDEFL_STATUS_DONE
+            && this->_error.empty())
+            this->_error = "compression failed";
+        tdefl_compressor_free(static_cast<tdefl_compressor*>(this->_deflate));
+        this->_deflate = nullptr;
+        // member trailer: CRC-32 and size of the data, little-endian
+        char trailer[8];
+        for (size_t i = 0; i < 4; ++i) {
+            trailer[i]     = char((this->_crc >> (8 * i)) & 0xff);
+            trailer[4 + i] = char((this->_size >> (8 * i)) & 0xff);
+        }
+        this->_write(trailer, sizeof(trailer));
+    }
+
+    if (std::fclose(this->_file) != 0 && this->_error.empty())
+        this->_error = std::strerror(errno);
+    this->_file = nullptr;
+    if (!this->_error.empty())
+        throw std::runtime_error("Failed to write " + this->_path + ": " + this->_error);
+}
+
+}
@@ -0,0 +1,72 @@
+#ifndef slic3r_FileWriter_hpp_
+#define slic3r_FileWriter_hpp_
+
+#include "libslic3r.h"
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <boost/thread.hpp>
+
+namespace Slic3r {
+
+/// Stream buffer writing a file from a background thread, so that the code writing into it
+/// does not wait for the disk, except for a free buffer when the disk cannot keep up: the
+/// data not written yet is bounded by the buffers, whatever the size of the file.
+/// The file can be compressed to gzip by miniz's deflate, on the same background thread.
+class FileWriter : public std::streambuf {
+    public:
+    enum Mode {
+        Text,       ///< with the line endings of the platform
+        Binary,
+        Gzip,       ///< compressed, with '\n' line endings
+    };
+
+    /// Creates the file; throws std::runtime_error if it cannot.
+    /// \param buffer_size bytes of each buffer
+    /// \param buffers number of buffers, being filled, waiting or being written
+    FileWriter(const std::string &path, Mode mode = Binary,
+        size_t buffer_size = 4 << 20, size_t buffers = 4);
+
+    /// Closes the file if close() was not called, ignoring errors.
+    ~FileWriter();
+
+    /// Writes the remaining data and closes the file; throws std::runtime_error if any
+    /// write failed.
+    void close();
+
+    protected:
+    int_type overflow(int_type c) override;
+    /// Does nothing: partial buffers are only written by close(), so flushing the stream
+    /// (std::endl) costs nothing.
+    int sync() override { return 0; };
+
+    private:
+    std::string _path;
+    std::FILE* _file;
+    void* _deflate;         ///< tdefl_compressor, in Gzip mode
+    uint32_t _crc;
+    uint64_t _size;         ///< uncompressed
+    std::string _error;
+
+    std::vector<std::vector<char>> _buffers;
+    size_t _current;        ///< buffer being filled
+    std::deque<std::pair<size_t, size_t>> _filled;  ///< buffers and their sizes, in order
+    std::vector<size_t> _free;
+    bool _closing;
+    boost::mutex _mutex;
+    boost::condition_variable _cond;
+    boost::thread _thread;
+
+    /// Hands the current buffer over to the thread and takes a free one.
+    void _next_buffer();
+    void _write_buffers();
+    void _write(const char* data, size_t size);
+    static int _put_compressed(const void* data, int size, void* writer);
+};
+
+}
+
+#endif
@@ -9,90 +9,152 @@
 
 namespace Slic3r {
 
-
-
-static inline double f(double x, double z_sin, double z_cos, bool vertical, bool flip)
+/// Evaluates the wave at the n abscissas x into y.
+/// The loop invariant terms are hoisted and the loop body has no branches,
+/// so that the compiler can vectorize the batch.
+static void
+sample_wave(const double* x, double* y, size_t n, double z_sin, double z_cos, bool vertical, bool flip)
 {
     if (vertical) {
-        double phase_offset = (z_cos < 0 ? M_PI : 0) + M_PI;
-        double a   = sin(x + phase_offset);
-        double b   = - z_cos;
-        double res = z_sin * cos(x + phase_offset + (flip ? M_PI : 0.));
-        double r   = sqrt(a*a + b*b);
-        return asin(a/r) + asin(res/r) + M_PI;
-    }
-    else {
-        double phase_offset = z_sin < 0 ? M_PI : 0.;
-        double a   = cos(x + phase_offset);
-        double b   = - z_sin;
-        double res = z_cos * sin(x + phase_offset + (flip ? 0 : M_PI));
-        double r   = sqrt(a*a + b*b);
-        return (asin(a/r) + asin(res/r) + 0.5 * M_PI);
+        const double phase_offset = (z_cos < 0 ? M_PI : 0) + M_PI;
+        const double b2     = z_cos * z_cos;
+        // cos(x + pi) == -cos(x)
+        const double res_k  = flip ? -z_sin : z_sin;
+        for (size_t i = 0; i < n; ++i) {
+            const double a   = sin(x[i] + phase_offset);
+            const double res = res_k * cos(x[i] + phase_offset);
+            const double r   = sqrt(a*a + b2);
+            y[i] = asin(a/r) + asin(res/r) + M_PI;
+        }
+    } else {
+        const double phase_offset = z_sin < 0 ? M_PI : 0.;
+        const double b2     = z_sin * z_sin;
+        // sin(x + pi) == -sin(x)
+        const double res_k  = flip ? z_cos : -z_cos;
+        for (size_t i = 0; i < n; ++i) {
+            const double a   = cos(x[i] + phase_offset);
+            const double res = res_k * sin(x[i] + phase_offset);
+            const double r   = sqrt(a*a + b2);
+            y[i] = asin(a/r) + asin(res/r) + 0.5 * M_PI;
+        }
     }
 }
 
+/// Tiles one period of the wave up to width and maps it to the scaled coordinates.
 static inline Polyline make_wave(
     const std::vector<Pointf>& one_period, double width, double height, double offset, double scaleFactor,
-    double z_cos, double z_sin, bool vertical)
+    bool vertical)
 {
-    std::vector<Pointf> points = one_period;
-    double period = points.back().x;
-    points.pop_back();
-    int n = points.size();
-    do {
-        points.emplace_back(Pointf(points[points.size()-n].x + period, points[points.size()-n].y));
-    } while (points.back().x < width);
-    points.back().x = width;
-
-    // and construct the final polyline to return:
+    const double period = one_period.back().x;
+    const size_t n      = one_period.size() - 1;
+    
     Polyline polyline;
-    for (Pointf& point : points) {
+    polyline.points.reserve(size_t(width / period + 1.) * n + 1);
+    // The whole first period, then shifted copies of its points until the width is reached.
+    for (size_t i = 0; ; ++ i) {
+        Pointf point(one_period[i % n].x + period * double(i / n), one_period[i % n].y);
+        const bool last = i >= n && point.x >= width;
+        if (last)
+            point.x = width;
+        
         point.y += offset;
         point.y = std::max(0., std::min(height, point.y));
         if (vertical)
             std::swap(point.x, point.y);
         polyline.points.emplace_back(Point(coord_t(point.x * scaleFactor), coord_t(point.y * scaleFactor)));
+        if (last) break;
     }
-
     return polyline;
 }
 
-
-static bool sortPointf (Pointf& lfs,Pointf& rhs) { return lfs.x < rhs.x || (lfs.x == rhs.x && lfs.y < rhs.y); }
-
+/// Samples one period of the wave. Wherever a sample is too far from the line connecting
+/// its neighbours, both intervals around it are split, so that the sampling density
+/// follows the curvature. All the points inserted by a pass are evaluated in a single batch.
 static std::vector<Pointf> make_one_period(double width, double scaleFactor, double z_cos, double z_sin, bool vertical, bool flip)
 {
-    std::vector<Pointf> points;
+    std::vector<double> xs;
     double dx = M_PI_4; // very coarse spacing to begin with
     double limit = std::min(2*M_PI, width);
     for (double x = 0.; x < limit + EPSILON; x += dx) {  // so the last point is there too
         x = std::min(x, limit);
-        points.emplace_back(Pointf(x,f(x, z_sin,z_cos, vertical, flip)));
+        xs.push_back(x);
     }
-
-    // now we will check all internal points and in case some are too far from the line connecting its neighbours,
-    // we will add one more point on each side:
+    std::vector<double> ys(xs.size());
+    sample_wave(xs.data(), ys.data(), xs.size(), z_sin, z_cos, vertical, flip);
+    
     const double tolerance = .1;
-    for (unsigned int i=1;i<points.size()-1;++i) {
-        Pointf& lp = points[i-1]; // left point
-        Pointf& tp = points[i];   // this point
-        Pointf& rp = points[i+1]; // right point
-        // calculate distance of the point to the line:
-        double dist_mm = unscale(scaleFactor * std::abs( (rp.y - lp.y)*tp.x + (lp.x - rp.x)*tp.y + (rp.x*lp.y - rp.y*lp.x) ) / std::hypot((rp.y - lp.y),(lp.x - rp.x)));
-
-        if (dist_mm > tolerance) {                               // if the difference from straight line is more than this
-            double x = 0.5f * (points[i-1].x + points[i].x);
-            points.emplace_back(Pointf(x, f(x, z_sin, z_cos, vertical, flip)));
-            x = 0.5f * (points[i+1].x + points[i].x);
-            points.emplace_back(Pointf(x, f(x, z_sin, z_cos, vertical, flip)));
-            std::sort(points.begin(), points.end(), sortPointf);            // we added the points to the end, but need them all in order
-            --i;                                                // decrement i so we also check the first newly added point
+    std::vector<bool>   split;
+    std::vector<double> mid_x, mid_y, new_xs, new_ys;
+    // A split interval is at least 1/2^20 of the initial spacing, this limits the passes.
+    for (size_t pass = 0; pass < 20; ++ pass) {
+        // find the intervals to split
+        split.assign(xs.size() - 1, false);
+        bool any = false;
+        for (size_t i = 1; i + 1 < xs.size(); ++ i) {
+            const double lx = xs[i-1], ly = ys[i-1];    // left point
+            const double tx = xs[i],   ty = ys[i];      // this point
+            const double rx = xs[i+1], ry = ys[i+1];    // right point
+            // calculate distance of the point to the line:
+            const double dist_mm = unscale(scaleFactor * std::abs( (ry - ly)*tx + (lx - rx)*ty + (rx*ly - ry*lx) ) / std::hypot((ry - ly), (lx - rx)));
+            if (dist_mm > tolerance) {
+                split[i-1] = split[i] = true;
+                any = true;
+            }
+        }
+        if (!any) break;
+        
+        mid_x.clear();
+        for (size_t i = 0; i < split.size(); ++ i)
+            if (split[i])
+                mid_x.push_back(0.5 * (xs[i] + xs[i+1]));
+        mid_y.assign(mid_x.size(), 0.);
+        sample_wave(mid_x.data(), mid_y.data(), mid_x.size(), z_sin, z_cos, vertical, flip);
+        
+        // merge the new points, keeping them sorted by x
+        new_xs.clear();
+        new_ys.clear();
+        for (size_t i = 0, j = 0; i < xs.size(); ++ i) {
+            new_xs.push_back(xs[i]);
+            new_ys.push_back(ys[i]);
+            if (i < split.size() && split[i]) {
+                new_xs.push_back(mid_x[j]);
+                new_ys.push_back(mid_y[j]);
+                ++ j;
+            }
         }
+        xs.swap(new_xs);
+        ys.swap(new_ys);
     }
+    
+    std::vector<Pointf> points;
+    points.reserve(xs.size());
+    for (size_t i = 0; i < xs.size(); ++ i)
+        points.emplace_back(Pointf(xs[i], ys[i]));
     return points;
 }
 
-static Polylines make_gyroid_waves(double gridZ, double density_adjusted, double line_spacing, double width, double height)
+const std::vector<Pointf>&
+FillGyroid::_one_period(double width, double scaleFactor, double z, bool vertical, bool flip)
+{
+    // the sampled period doesn't depend on the surface, unless it is narrower than a period
+    const double limit = std::min(2*M_PI, width);
+    for (const WavePeriod &period : this->_wave_periods)
+        if (period.z == z && period.scale_factor == scaleFactor && period.limit == limit
+            && period.vertical == vertical && period.flip == flip)
+            return period.points;
+
+    // drop the periods of the previous layers
+    if (!this->_wave_periods.empty() && this->_wave_periods.front().z != z)
+        this->_wave_periods.clear();
+    this->_wave_periods.push_back(WavePeriod {
+        z, scaleFactor, limit, vertical, flip,
+        make_one_period(width, scaleFactor, cos(z), sin(z), vertical, flip)
+    });
+    return this->_wave_periods.back().points;
+}
+
+Polylines
+FillGyroid::_make_waves(double gridZ, double density_adjusted, double line_spacing, double width, double height)
 {
     const double scaleFactor = scale_(line_spacing) / density_adjusted;
  //scale factor for 5% : 8 712 388
@@ -112,16 +174,20 @@ static Polylines make_gyroid_waves(double gridZ, double density_adjusted, double
         std::swap(width,height);
     }
 
-    std::vector<Pointf> one_period = make_one_period(width, scaleFactor, z_cos, z_sin, vertical, flip); // creates one period of the waves, so it doesn't have to be recalculated all the time
     Polylines result;
-
-    for (double y0 = lower_bound; y0 < upper_bound+EPSILON; y0 += 2*M_PI)           // creates odd polylines
-            result.emplace_back(make_wave(one_period, width, height, y0, scaleFactor, z_cos, z_sin, vertical));
+    {
+        // creates one period of the waves, so it doesn't have to be recalculated all the time
+        const std::vector<Pointf> &one_period = this->_one_period(width, scaleFactor, z, vertical, flip);
+        for (double y0 = lower_bound; y0 < upper_bound+EPSILON; y0 += 2*M_PI)       // creates odd polylines
+            result.emplace_back(make_wave(one_period, width, height, y0, scaleFactor, vertical));
+    }
 
     flip = !flip;                                                                   // even polylines are a bit shifted
-    one_period = make_one_period(width, scaleFactor, z_cos, z_sin, vertical, flip); // updates the one period sample
-    for (double y0 = lower_bound + M_PI; y0 < upper_bound+EPSILON; y0 += 2*M_PI)    // creates even polylines
-            result.emplace_back(make_wave(one_period, width, height, y0, scaleFactor, z_cos, z_sin, vertical));
+    {
+        const std::vector<Pointf> &one_period = this->_one_period(width, scaleFactor, z, vertical, flip);
+        for (double y0 = lower_bound + M_PI; y0 < upper_bound+EPSILON; y0 += 2*M_PI) // creates even polylines
+            result.emplace_back(make_wave(one_period, width, height, y0, scaleFactor, vertical));
+    }
 
     return result;
 }
@@ -143,7 +209,7 @@ void FillGyroid::_fill_surface_single(
     bb.min.align_to_grid(Point(2*M_PI*distance, 2*M_PI*distance));
 
     // generate pattern
-    Polylines   polylines = make_gyroid_waves(
+    Polylines   polylines = this->_make_waves(
         scale_(this->z),
         density_adjusted,
         this->spacing(),
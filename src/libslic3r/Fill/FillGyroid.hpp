@@ -22,6 +22,26 @@ public:
 
 protected:
 
+    /// One period of a gyroid wave, sampled with the trigonometric refinement
+    /// of make_one_period() and then tiled over the bounding box of each surface.
+    struct WavePeriod
+    {
+        double  z;
+        double  scale_factor;
+        double  limit;
+        bool    vertical;
+        bool    flip;
+        std::vector<Pointf> points;
+    };
+    /// The wave periods of the last print Z; the instance is reused for all the
+    /// surfaces of a layer, and for the next layers by the FillPool.
+    std::vector<WavePeriod> _wave_periods;
+
+    const std::vector<Pointf>& _one_period(double width, double scale_factor,
+        double z, bool vertical, bool flip);
+    Polylines _make_waves(double gridZ, double density_adjusted, double line_spacing,
+        double width, double height);
+
     virtual void _fill_surface_single(
         unsigned int                     thickness_layers,
         const std::pair<float, Point>   &direction, 
@@ -0,0 +1,35 @@
+#include "FillPool.hpp"
+
+namespace Slic3r {
+
+std::unique_ptr<Fill>
+FillPool::acquire(const PrintRegion* region, InfillPattern pattern)
+{
+    {
+        boost::lock_guard<boost::mutex> l(this->_mutex);
+        std::vector< std::unique_ptr<Fill> > &idle = this->_idle[Key(region, pattern)];
+        if (!idle.empty()) {
+            std::unique_ptr<Fill> fill = std::move(idle.back());
+            idle.pop_back();
+            return fill;
+        }
+    }
+    return std::unique_ptr<Fill>(Fill::new_from_type(pattern));
+}
+
+void
+FillPool::release(const PrintRegion* region, InfillPattern pattern, std::unique_ptr<Fill> &&fill)
+{
+    if (!fill) return;
+    boost::lock_guard<boost::mutex> l(this->_mutex);
+    this->_idle[Key(region, pattern)].push_back(std::move(fill));
+}
+
+void
+FillPool::clear()
+{
+    boost::lock_guard<boost::mutex> l(this->_mutex);
+    this->_idle.clear();
+}
+
+} // namespace Slic3r
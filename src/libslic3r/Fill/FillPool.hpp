@@ -0,0 +1,43 @@
+#ifndef slic3r_FillPool_hpp_
+#define slic3r_FillPool_hpp_
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <boost/thread.hpp>
+
+#include "../libslic3r.h"
+
+#include "Fill.hpp"
+
+namespace Slic3r {
+
+class PrintRegion;
+
+/// Keeps the infill generators of a PrintObject alive from one layer to the next,
+/// so that the pattern caches they hold (hexagon math, gyroid wave periods) are
+/// built once per region instead of once per surface.
+/// A generator is lent to a single thread at a time, so the generators themselves
+/// don't need to be thread-safe.
+class FillPool
+{
+public:
+    /// Returns an idle generator of the given pattern used by region, or a new one.
+    std::unique_ptr<Fill> acquire(const PrintRegion* region, InfillPattern pattern);
+
+    /// Gives back a generator obtained from acquire() for later reuse.
+    void release(const PrintRegion* region, InfillPattern pattern, std::unique_ptr<Fill> &&fill);
+
+    /// Deletes all the idle generators.
+    void clear();
+
+private:
+    typedef std::pair<const PrintRegion*, InfillPattern> Key;
+    std::map< Key, std::vector< std::unique_ptr<Fill> > > _idle;
+    boost::mutex _mutex;
+};
+
+} // namespace Slic3r
+
+#endif // slic3r_FillPool_hpp_
@@ -33,6 +33,8 @@ FillRectilinear::_fill_single_direction(ExPolygon expolygon,
     
     // We ignore this->bounding_box because it doesn't matter; we're doing align_to_grid below.
     BoundingBox bounding_box    = expolygon.contour.bounding_box();
+    const coord_t contour_min_x = bounding_box.min.x;
+    const coord_t contour_max_x = bounding_box.max.x;
     
     // Ignore too small expolygons.
     if (bounding_box.size().x < min_spacing) return;
@@ -63,7 +65,7 @@ FillRectilinear::_fill_single_direction(ExPolygon expolygon,
     }
     
     // Find all the polygons points intersecting the rectilinear vertical lines and store
-    // them in an std::map<> (grid) which orders them automatically by x and y.
+    // them in the grid, which orders them automatically by x and y.
     // For each intersection point we store its position (upper/lower): upper means it's
     // the upper endpoint of an intersection line, and vice versa.
     // Whenever between two intersection points we find vertices of the original polygon,
@@ -88,9 +90,27 @@ FillRectilinear::_fill_single_direction(ExPolygon expolygon,
         IntersectionPoint(coord_t x, coord_t y, ipType _type) : Point(x,y), type(_type) {};
     };
     typedef std::map<coord_t,IntersectionPoint> vertical_t; // <y,point>
-    typedef std::map<coord_t,vertical_t>        grid_t;     // <x,<y,point>>
+    
+    // All the intersection points lie on the vertical lines x = x0 + i * spacing,
+    // so the lines are stored in a vector indexed by i instead of a map keyed by x.
+    struct grid_t {
+        coord_t                 x0;
+        coord_t                 spacing;
+        std::vector<vertical_t> columns;
+        
+        vertical_t& operator[](coord_t x) { return this->columns[(x - this->x0) / this->spacing]; };
+        coord_t x(size_t column) const { return this->x0 + coord_t(column) * this->spacing; };
+    };
     
     grid_t grid;
+    {
+        // first vertical line at or left of the contour
+        const coord_t dx = contour_min_x - bounding_box.min.x;
+        const coord_t first = (dx >= 0) ? (dx / line_spacing) : -((line_spacing - 1 - dx) / line_spacing);
+        grid.x0         = bounding_box.min.x + first * line_spacing;
+        grid.spacing    = line_spacing;
+        grid.columns.resize((contour_max_x - grid.x0) / line_spacing + 1);
+    }
     {
         const Polygons polygons = expolygon;
         for (Polygons::const_iterator polygon = polygons.begin(); polygon != polygons.end(); ++polygon) {
@@ -220,8 +240,7 @@ FillRectilinear::_fill_single_direction(ExPolygon expolygon,
                     }
                     
                     // Store the skipped polygon vertices along with this point.
-                    ip.skipped = skipped_points;
-                    skipped_points.clear();
+                    ip.skipped.swap(skipped_points);
                     
                     #ifdef DEBUG_RECTILINEAR
                     printf("NEW POINT at %f,%f\n", unscale(ip.x), unscale(ip.y));
@@ -230,8 +249,8 @@ FillRectilinear::_fill_single_direction(ExPolygon expolygon,
                     #endif
                     
                     // Store the point.
-                    v[ip.y] = ip;
                     ips.push_back(ip);
+                    v[ip.y] = std::move(ip);
                 }
                 
                 // We're now going past the final point, so save it.
@@ -298,9 +317,10 @@ FillRectilinear::_fill_single_direction(ExPolygon expolygon,
     svg.draw(expolygon);
     
     printf("GRID:\n");
-    for (grid_t::const_iterator it = grid.begin(); it != grid.end(); ++it) {
-        printf("x = %f:\n", unscale(it->first));
-        for (vertical_t::const_iterator v = it->second.begin(); v != it->second.end(); ++v) {
+    for (size_t i = 0; i < grid.columns.size(); ++i) {
+        if (grid.columns[i].empty()) continue;
+        printf("x = %f:\n", unscale(grid.x(i)));
+        for (vertical_t::const_iterator v = grid.columns[i].begin(); v != grid.columns[i].end(); ++v) {
             const IntersectionPoint &ip = v->second;
             printf("   y = %f (%s, next = %f,%f, extra = %zu)\n", unscale(v->first),
                 ip.type == IntersectionPoint::ipTypeLower ? "lower"
@@ -322,13 +342,15 @@ FillRectilinear::_fill_single_direction(ExPolygon expolygon,
     const size_t n_polylines_out_old = out->size();
     
     // Loop until we have no more vertical lines available.
-    while (!grid.empty()) {
+    // Lines are only ever removed, so the first non empty one never moves back.
+    size_t first_column = 0;
+    while (first_column < grid.columns.size()) {
         // Get the first x coordinate.
-        vertical_t &v = grid.begin()->second;
+        vertical_t &v = grid.columns[first_column];
         
-        // If this x coordinate does not have any y coordinate, remove it.
+        // If this x coordinate does not have any y coordinate, skip it.
         if (v.empty()) {
-            grid.erase(grid.begin());
+            ++ first_column;
             continue;
         }
         
@@ -338,12 +360,14 @@ FillRectilinear::_fill_single_direction(ExPolygon expolygon,
         assert(v.size() % 2 == 0);
         
         // Get the first lower point.
+        // Only the position and type of the current point are needed, not its connection.
         vertical_t::iterator it = v.begin();  // minimum x,y
-        IntersectionPoint p = it->second;
-        if (p.type != IntersectionPoint::ipTypeLower) {
+        Point p = it->second;
+        IntersectionPoint::ipType p_type = it->second.type;
+        if (p_type != IntersectionPoint::ipTypeLower) {
             // Degenerate polygon, this shouldn't happen.
             // We used to have an assert here, but let's be tolerant.
-            grid.erase(p.x);
+            grid[p.x].clear();
             continue;
         }
         
@@ -354,12 +378,12 @@ FillRectilinear::_fill_single_direction(ExPolygon expolygon,
         
         while (true) {
             // Complete the vertical line by finding the corresponding upper or lower point.
-            if (p.type == IntersectionPoint::ipTypeUpper) {
+            if (p_type == IntersectionPoint::ipTypeUpper) {
                 // find first point along c.x with y < c.y
                 if (it == grid[p.x].begin()) {
                     // Degenerate polygon, this shouldn't happen.
                     // We used to have an assert here, but let's be tolerant.
-                    grid.erase(p.x);
+                    grid[p.x].clear();
                     break;
                 }
                 --it;
@@ -369,17 +393,18 @@ FillRectilinear::_fill_single_direction(ExPolygon expolygon,
                 if (it == grid[p.x].end()) {
                     // Degenerate polygon, this shouldn't happen.
                     // We used to have an assert here, but let's be tolerant.
-                    grid.erase(p.x);
+                    grid[p.x].clear();
                     break;
                 }
             }
             
             // Append the point to our polyline.
-            IntersectionPoint b = it->second;
-            if (b.type == p.type) {
+            // Its connection is taken over, as the point is removed from the grid below.
+            IntersectionPoint b = std::move(it->second);
+            if (b.type == p_type) {
                 // Degenerate polygon, this shouldn't happen.
                 // We used to have an assert here, but let's be tolerant.
-                grid.erase(p.x);
+                grid[p.x].clear();
                 break;
             }
             polyline.append(b);
@@ -390,7 +415,6 @@ FillRectilinear::_fill_single_direction(ExPolygon expolygon,
                 vertical_t &v = grid[p.x];
                 v.erase(p.y);
                 v.erase(it);
-                if (v.empty()) grid.erase(p.x);
             }
             // Do we have a connection starting from here?
             // If not, stop the polyline.
@@ -415,8 +439,7 @@ FillRectilinear::_fill_single_direction(ExPolygon expolygon,
             }
             
             // Is the final point still available?
-            if (grid.count(b.next.back().x) == 0
-                || grid[b.next.back().x].count(b.next.back().y) == 0)
+            if (grid[b.next.back().x].count(b.next.back().y) == 0)
                 // We already used this point or we might have removed this
                 // point while building the grid because it's collinear (middle); in either
                 // cases the connection line from the previous one is legit and worth having.
@@ -424,15 +447,16 @@ FillRectilinear::_fill_single_direction(ExPolygon expolygon,
             
             // Retrieve the intersection point. The next loop will find the correspondent
             // endpoint of the vertical line.
-            it = grid[ b.next.back().x ].find(b.next.back().y);
-            p  = it->second;
+            it      = grid[ b.next.back().x ].find(b.next.back().y);
+            p       = it->second;
+            p_type  = it->second.type;
             
             // If the connection brought us to another x coordinate, we expect the point 
             // type to be the same.
-            if (!(p.type == b.type && p.x > b.x) && !(p.type != b.type && p.x == b.x)) {
+            if (!(p_type == b.type && p.x > b.x) && !(p_type != b.type && p.x == b.x)) {
                 // Degenerate polygon, this shouldn't happen.
                 // We used to have an assert here, but let's be tolerant.
-                grid.erase(p.x);
+                grid[p.x].clear();
                 break;
             }
         }
@@ -1,8 +1,10 @@
 #include "GCode.hpp"
 #include "ExtrusionEntity.hpp"
+#include "ToolpathFile.hpp"
 #include <algorithm>
 #include <cstdlib>
 #include <math.h>
+#include <sstream>
 
 #define FLAVOR_IS(val) this->config.gcode_flavor == val
 
@@ -10,15 +12,13 @@ namespace Slic3r {
 
 AvoidCrossingPerimeters::AvoidCrossingPerimeters()
     : use_external_mp(false), use_external_mp_once(false), disable_once(true),
-        _external_mp(NULL), _layer_mp(NULL)
+        _external_mp(NULL), _layer_mps(8)
 {
 }
 
 AvoidCrossingPerimeters::~AvoidCrossingPerimeters()
 {
     delete this->_external_mp;
-    
-    delete this->_layer_mp;
 }
 
 void
@@ -32,9 +32,11 @@ AvoidCrossingPerimeters::init_external_mp(const ExPolygons &islands)
 void
 AvoidCrossingPerimeters::init_layer_mp(const ExPolygons &islands)
 {
-    delete this->_layer_mp;
+    IslandsCacheKey key(islands);
+    if (this->_layer_mps.find(key, &this->_layer_mp)) return;
     
-    this->_layer_mp = new MotionPlanner(islands);
+    this->_layer_mp = std::make_shared<MotionPlanner>(islands);
+    this->_layer_mps.insert(std::move(key), std::shared_ptr<MotionPlanner>(this->_layer_mp));
 }
 
 Polyline
@@ -196,10 +198,11 @@ Wipe::wipe(GCode &gcodegen, bool toolchange)
 #define EXTRUDER_CONFIG(OPT) this->config.OPT.get_at(this->writer.extruder()->id)
 
 GCode::GCode()
-    : placeholder_parser(NULL), enable_loop_clipping(true), enable_cooling_markers(false), layer_count(0),
+    : placeholder_parser(NULL), enable_loop_clipping(true), enable_cooling_markers(false),
+        enable_toolpath_markers(false), layer_count(0),
         layer_index(-1), layer(NULL), first_layer(false), elapsed_time(0.0),
         elapsed_time_bridges(0.0), elapsed_time_external(0.0), volumetric_speed(0),
-        _last_pos_defined(false)
+        _extrusion_length(0), _last_pos_defined(false)
 {
 }
 
@@ -273,6 +276,23 @@ GCode::change_layer(const Layer &layer)
     if (this->config.avoid_crossing_perimeters)
         this->avoid_crossing_perimeters.init_layer_mp(union_ex(layer.slices, true));
     
+    // index the areas in which travel moves don't need retraction
+    // (fill_density is a region option, so it is only checked in needs_retraction())
+    this->_internal_slices.clear();
+    if (this->config.only_retract_when_crossing_perimeters) {
+        ExPolygons internal_slices;
+        FOREACH_LAYERREGION(&layer, layerm) {
+            for (const Surface &surface : (*layerm)->slices.surfaces)
+                if (surface.is_internal()) internal_slices.push_back(surface.expolygon);
+        }
+        this->_internal_slices = ContainmentGrid(internal_slices);
+    }
+    const SupportLayer* support_layer = dynamic_cast<const SupportLayer*>(&layer);
+    if (support_layer != NULL)
+        this->_support_islands = ContainmentGrid(support_layer->support_islands.expolygons);
+    else
+        this->_support_islands.clear();
+    
     std::string gcode;
     if (this->layer_count > 0) {
         gcode += this->writer.update_progress(this->layer_index, this->layer_count);
@@ -566,6 +586,12 @@ GCode::_extrude(ExtrusionPath path, std::string description, double speed)
     double F = speed * 60;  // convert mm/sec to mm/min
     
     // extrude arc or line
+    if (this->enable_toolpath_markers) {
+        std::ostringstream marker;
+        marker << ToolpathFile::path_marker << int(path.role) << " " << this->writer.extruder()->id
+            << " " << path.width << " " << path.height << "\n";
+        gcode += marker.str();
+    }
     if (path.is_bridge() && this->enable_cooling_markers)
         gcode += ";_BRIDGE_FAN_START\n";
     std::string comment = ";_EXTRUDE_SET_SPEED";
@@ -596,6 +622,8 @@ GCode::_extrude(ExtrusionPath path, std::string description, double speed)
         this->wipe.path = path.polyline;
         this->wipe.path.reverse();
     }
+    if (this->enable_toolpath_markers)
+        gcode += std::string(ToolpathFile::path_end_marker) + "\n";
     if (path.is_bridge() && this->enable_cooling_markers)
         gcode += ";_BRIDGE_FAN_END\n";
     
@@ -670,8 +698,7 @@ GCode::needs_retraction(const Polyline &travel, ExtrusionRole role)
     }
     
     if (role == erSupportMaterial) {
-        const SupportLayer* support_layer = dynamic_cast<const SupportLayer*>(this->layer);
-        if (support_layer != NULL && support_layer->support_islands.contains(travel)) {
+        if (this->_support_islands.any_contains(travel)) {
             // skip retraction if this is a travel move inside a support material island
             return false;
         }
@@ -679,7 +706,7 @@ GCode::needs_retraction(const Polyline &travel, ExtrusionRole role)
     
     if (this->config.only_retract_when_crossing_perimeters && this->layer != NULL) {
         if (this->config.fill_density.value > 0
-            && this->layer->any_internal_region_slice_contains(travel)) {
+            && this->_internal_slices.any_contains(travel)) {
             /*  skip retraction if travel is contained in an internal slice *and*
                 internal infill is enabled (so that stringing is entirely not visible)  */
             return false;
@@ -5,12 +5,15 @@
 #include "ExPolygon.hpp"
 #include "GCodeWriter.hpp"
 #include "Layer.hpp"
+#include "LayerResultCache.hpp"
 #include "MotionPlanner.hpp"
 #include "Point.hpp"
 #include "PlaceholderParser.hpp"
 #include "Print.hpp"
 #include "PrintConfig.hpp"
 #include "ConditionalGCode.hpp"
+#include "ContainmentGrid.hpp"
+#include <memory>
 #include <string>
 #include <vector>
 #include <set>
@@ -38,7 +41,10 @@ class AvoidCrossingPerimeters {
     
     private:
     MotionPlanner* _external_mp;
-    MotionPlanner* _layer_mp;
+    std::shared_ptr<MotionPlanner> _layer_mp;
+    /// Planners of the last layers, so that layers with the same islands share
+    /// their lazily built graphs instead of computing them again.
+    ResultCache< IslandsCacheKey, std::shared_ptr<MotionPlanner> > _layer_mps;
 };
 
 class OozePrevention {
@@ -83,6 +89,9 @@ class GCode {
     // of the G-code lines: _EXTRUDE_SET_SPEED, _WIPE, _BRIDGE_FAN_START, _BRIDGE_FAN_END
     // Those comments are received and consumed (removed from the G-code) by the CoolingBuffer.pm Perl module.
     bool enable_cooling_markers;
+    // If enabled, the G-code generator will put the role, extruder, width and height of the
+    // extrusion paths in comments around their moves, for ToolpathWriter to consume.
+    bool enable_toolpath_markers;
     size_t layer_count;
     int layer_index; // just a counter
     const Layer* layer;
@@ -145,6 +154,10 @@ class GCode {
     Pointf3 _cog;
     float _extrusion_length;
     bool _last_pos_defined;
+    /// Internal region slices and support islands of the current layer,
+    /// indexed in change_layer() for the containment tests of needs_retraction().
+    ContainmentGrid _internal_slices;
+    ContainmentGrid _support_islands;
     std::string _extrude(ExtrusionPath path, std::string description = "", double speed = -1);
 };
 
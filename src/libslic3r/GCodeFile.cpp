@@ -0,0 +1,188 @@
+#include "GCodeFile.hpp"
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#ifdef _WIN32
+#include <boost/nowide/convert.hpp>
+#endif
+
+namespace Slic3r {
+
+/// Strips a line of its comment and surrounding whitespace, as GCodeSender does.
+static std::string_view
+_strip(const char* begin, const char* end)
+{
+    const char* comment = static_cast<const char*>(std::memchr(begin, ';', end - begin));
+    if (comment != nullptr) end = comment;
+    while (begin < end && std::isspace(static_cast<unsigned char>(*begin))) ++begin;
+    while (end > begin && std::isspace(static_cast<unsigned char>(end[-1]))) --end;
+    return std::string_view(begin, end - begin);
+}
+
+/// Value of a word of a command, such as Z of "G1 Z0.3 F7800"; false if it has none.
+static bool
+_word(std::string_view line, char letter, double* value)
+{
+    for (size_t pos = line.find(' '); pos != std::string_view::npos; pos = line.find(' ', pos + 1)) {
+        if (pos + 1 < line.size() && line[pos + 1] == letter)
+            return std::from_chars(line.data() + pos + 2, line.data() + line.size(), *value).ec == std::errc();
+    }
+    return false;
+}
+
+/// Whether line is command, such as G1 of "G1 X10" but not of "G10".
+static bool
+_is(std::string_view line, const char* command)
+{
+    const size_t length = std::strlen(command);
+    return line.compare(0, length, command) == 0 && (line.size() == length || line[length] == ' ');
+}
+
+GCodeFile::GCodeFile(const std::string &path)
+    : _data(nullptr), _size(0), _line_count(0), _position(0), _offset(0)
+{
+    using namespace boost::interprocess;
+    try {
+        if (boost::filesystem::file_size(path) > 0) {
+            #ifdef _WIN32
+            file_mapping mapping(boost::nowide::widen(path).c_str(), read_only);
+            #else
+            file_mapping mapping(path.c_str(), read_only);
+            #endif
+            this->_region.reset(new mapped_region(mapping, read_only));
+            this->_data = static_cast<const char*>(this->_region->get_address());
+            this->_size = this->_region->get_size();
+        }
+    } catch (interprocess_exception &e) {
+        throw std::runtime_error("Cannot read G-code file " + path + ": " + e.what());
+    } catch (boost::filesystem::filesystem_error &e) {
+        throw std::runtime_error("Cannot read G-code file " + path + ": " + e.what());
+    }
+
+    // as written with gcode_compression
+    if (this->_size >= 2 && this->_data[0] == '\x1f' && this->_data[1] == '\x8b')
+        throw std::runtime_error("Cannot send G-code file " + path + ": it is compressed, decompress it first");
+
+    if (this->_region) this->_region->advise(mapped_region::advice_sequential);
+    this->_scan();
+    this->_read(0);
+}
+
+GCodeFile::~GCodeFile()
+{}
+
+void
+GCodeFile::_scan()
+{
+    // state of the machine, for the layers
+    bool relative = false, relative_e = false;
+    double z = 0, e = 0;
+    bool z_moved = false;   // since the last extrusion
+    size_t z_line = 0;      // of the first move to a new Z since the last extrusion
+    double z_e = 0;         // at z_line
+    double layer_z = NAN;
+
+    const char* end = this->_data + this->_size;
+    for (const char* p = this->_data; p < end; ) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (eol == nullptr) eol = end;
+        const std::string_view line = _strip(p, eol);
+        if (!line.empty()) {
+            if (this->_line_count % checkpoint_lines == 0)
+                this->_checkpoints.push_back(p - this->_data);
+
+            double value;
+            if (_is(line, "G0") || _is(line, "G1")) {
+                const bool xy = _word(line, 'X', &value) || _word(line, 'Y', &value);
+                if (_word(line, 'Z', &value)) {
+                    const double new_z = relative ? z + value : value;
+                    if (!xy && new_z != z && !z_moved) {
+                        // lifts and travels before the layer belong to it
+                        z_moved = true;
+                        z_line = this->_line_count;
+                        z_e = e;
+                    }
+                    z = new_z;
+                }
+                if (_word(line, 'E', &value)) {
+                    const bool extruding = (relative || relative_e) ? (value > 0) : (value > e);
+                    e = (relative || relative_e) ? e + value : value;
+                    if (extruding && xy) {
+                        if (z_moved && !(std::abs(z - layer_z) < EPSILON)) {
+                            this->_layers.push_back(Layer { z, z_e, z_line });
+                            layer_z = z;
+                        }
+                        z_moved = false;
+                    }
+                }
+            } else if (_is(line, "G90")) {
+                relative = false;
+            } else if (_is(line, "G91")) {
+                relative = true;
+            } else if (_is(line, "M82")) {
+                relative_e = false;
+            } else if (_is(line, "M83")) {
+                relative_e = true;
+            } else if (_is(line, "G92") && _word(line, 'E', &value)) {
+                e = value;
+            }
+            this->_line_count++;
+        }
+        p = eol + 1;
+    }
+}
+
+void
+GCodeFile::_read(size_t offset)
+{
+    const char* end = this->_data + this->_size;
+    for (const char* p = this->_data + offset; p < end; ) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (eol == nullptr) eol = end;
+        this->_front = _strip(p, eol);
+        this->_offset = std::min(size_t(eol + 1 - this->_data), this->_size);
+        if (!this->_front.empty()) return;
+        p = eol + 1;
+    }
+    this->_front = std::string_view();
+    this->_offset = this->_size;
+}
+
+void
+GCodeFile::pop()
+{
+    if (this->at_end()) return;
+    this->_position++;
+    this->_read(this->_offset);
+}
+
+void
+GCodeFile::seek(size_t line)
+{
+    if (line >= this->_line_count) {
+        this->_position = this->_line_count;
+        this->_front = std::string_view();
+        this->_offset = this->_size;
+        return;
+    }
+    // from the checkpoint before it
+    this->_position = line - line % checkpoint_lines;
+    this->_read(this->_checkpoints[line / checkpoint_lines]);
+    while (this->_position < line)
+        this->pop();
+}
+
+bool
+GCodeFile::seek_layer(size_t layer)
+{
+    if (layer >= this->_layers.size()) return false;
+    this->seek(this->_layers[layer].line);
+    return true;
+}
+
+}
@@ -0,0 +1,73 @@
+#ifndef slic3r_GCodeFile_hpp_
+#define slic3r_GCodeFile_hpp_
+
+#include "libslic3r.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace boost { namespace interprocess { class mapped_region; } }
+
+namespace Slic3r {
+
+/// A G-code file to send, mapped in memory: GCodeSender reads its lines from the mapping as
+/// it sends them, stripped of comments and blanks, instead of holding them all as strings.
+/// Opening it scans the file once for the number of lines to send, an index of every
+/// checkpoint_lines-th of them and the layers.
+/// It is not thread safe; GCodeSender guards it with its queue.
+class GCodeFile {
+    public:
+    /// Lines between two entries of the line index.
+    static const size_t checkpoint_lines = 4096;
+
+    struct Layer {
+        double z;
+        double e;       ///< position of the extruder at the start of the layer
+        size_t line;    ///< first line to send of the layer: the first move to a new Z after
+                        ///< the previous layer, or a lift before it
+    };
+
+    /// Throws std::runtime_error if the file cannot be read, or is compressed with gzip.
+    explicit GCodeFile(const std::string &path);
+    ~GCodeFile();
+
+    /// Number of lines to send, not blank once stripped of comments.
+    size_t line_count() const { return this->_line_count; };
+    /// Layers start with a move to a new Z on a line of its own, followed by extrusions at
+    /// that Z; so a spiral vase is one layer.
+    const std::vector<Layer>& layers() const { return this->_layers; };
+
+    /// Index of the line to send next.
+    size_t position() const { return this->_position; };
+    bool at_end() const { return this->_position >= this->_line_count; };
+    /// Line to send next, without comment nor surrounding whitespace;
+    /// empty at the end. Valid until the file is destroyed.
+    std::string_view front() const { return this->_front; };
+    void pop();
+    /// Sends line next (the end if past it).
+    void seek(size_t line);
+    /// Sends the first line of layer next; false if there is no such layer.
+    bool seek_layer(size_t layer);
+
+    private:
+    std::unique_ptr<boost::interprocess::mapped_region> _region;
+    const char* _data;
+    size_t _size;
+    size_t _line_count;
+    std::vector<size_t> _checkpoints;   ///< offsets of the lines 0, checkpoint_lines...
+    std::vector<Layer> _layers;
+
+    size_t _position;
+    size_t _offset;         ///< after _front
+    std::string_view _front;
+
+    /// Reads the next line to send from offset, setting _front and _offset.
+    void _read(size_t offset);
+    void _scan();
+};
+
+}
+
+#endif
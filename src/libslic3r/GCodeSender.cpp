@@ -1,11 +1,15 @@
 #include "GCodeSender.hpp"
+#include <charconv>
+#include <chrono>
+#include <iomanip>
 #include <iostream>
 #include <istream>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
-#include <boost/lexical_cast.hpp>
 
 #if defined(__APPLE__) || defined(__OpenBSD__)
 #include <termios.h>
@@ -52,10 +56,52 @@ constexpr auto KEEP_SENT = 20;
 namespace asio = boost::asio;
 
 GCodeSender::GCodeSender()
-    : io(), serial(io), open(false),
-      connected(false), error(false), can_send(false), queue_paused(false), sent(0)
+    : GCodeSender(nullptr, std::unique_ptr<asio::io_context>(new asio::io_context()))
 {}
 
+GCodeSender::GCodeSender(asio::io_context &io)
+    : GCodeSender(&io, nullptr)
+{}
+
+GCodeSender::GCodeSender(asio::io_context* io, std::unique_ptr<asio::io_context> own_io)
+    : own_io(std::move(own_io)), io(io != nullptr ? *io : *this->own_io),
+      strand(this->io), serial(this->io), timer(this->io), open(false),
+      connected(false), error(false), pending(0), can_send(false), queue_paused(false), sent(0),
+      window_lines(1), window_bytes(0), in_flight_bytes(0), resend_line(0), resend_duplicates(0),
+      skip_oks(0), grbl(false), writing(false), acknowledged(0), sent_lines(0), sent_bytes(0)
+{}
+
+// Binds a completion handler to the strand, counting it as pending until it has run.
+template <class Handler>
+auto
+GCodeSender::on_strand(Handler handler)
+{
+    {
+        boost::lock_guard<boost::mutex> l(this->state_mutex);
+        this->pending++;
+    }
+    return asio::bind_executor(this->strand, [this, handler](auto... args) {
+        handler(args...);
+        this->done();
+    });
+}
+
+// Runs handler on the strand, counting it as pending until it has run.
+template <class Handler>
+void
+GCodeSender::post(Handler handler)
+{
+    asio::post(this->on_strand(handler));
+}
+
+void
+GCodeSender::done()
+{
+    boost::lock_guard<boost::mutex> l(this->state_mutex);
+    this->pending--;
+    this->state_cond.notify_all();
+}
+
 GCodeSender::~GCodeSender()
 {
     this->disconnect();
@@ -82,15 +128,21 @@ GCodeSender::connect(std::string devname, unsigned int baud_rate)
         // set baud rate again because set_option overwrote it
         this->set_baud_rate(baud_rate);
         this->open = true;
-        this->reset();
     } catch (boost::system::system_error &e) {
         this->set_error_status(true);
         return false;
     }
     
     // a reset firmware expect line numbers to start again from 1
-    this->sent = 0;
+    this->sent = 1;
     this->last_sent.clear();
+    this->grbl = false;
+    
+    // drop what a previous connection left unwritten
+    this->writing = false;
+    this->write_buffer.consume(this->write_buffer.size());
+    this->read_buffer.consume(this->read_buffer.size());
+    this->acknowledged = this->sent_lines = this->sent_bytes = 0;
     
     /* Initialize debugger */
 #ifdef DEBUG_SERIAL
@@ -99,16 +151,16 @@ GCodeSender::connect(std::string devname, unsigned int baud_rate)
     
     // this gives some work to the io_service before it is started
     // (post() runs the supplied function in its thread)
-    boost::asio::post(this->io, boost::bind(&GCodeSender::do_read, this));
+    this->post(boost::bind(&GCodeSender::do_read, this));
     
-    // start reading in the background thread
-    boost::thread t(boost::bind(&asio::io_context::run, &this->io));
-    this->background_thread.swap(t);
+    // reset the printer, then probe it
+    this->post(boost::bind(&GCodeSender::do_reset, this, boost::system::error_code(), 0, true));
     
-    // always send a M105 to check for connection because firmware might be silent on connect 
-    boost::this_thread::sleep(boost::posix_time::milliseconds(1000));
-    this->sent++;
-    this->send("M105", true);
+    // start reading in the background thread
+    if (this->own_io) {
+        boost::thread t(boost::bind(&asio::io_context::run, &this->io));
+        this->background_thread.swap(t);
+    }
     
     return true;
 }
@@ -157,11 +209,21 @@ void
 GCodeSender::disconnect()
 {
     if (!this->open) return;
+    // it waits for the handlers, which would never run if it was one of them
+    if (this->io.get_executor().running_in_this_thread())
+        throw std::logic_error("GCodeSender::disconnect() called from a thread of its io_context");
     this->open = false;
-    this->connected = false;
-    boost::asio::post(this->io, boost::bind(&GCodeSender::do_close, this));
-    this->background_thread.join();
-    this->io.restart();
+    this->set_connected(false);
+    this->post(boost::bind(&GCodeSender::do_close, this));
+    if (this->own_io) {
+        this->background_thread.join();
+        this->io.restart();
+    } else {
+        // the handlers still to run would use this sender after its destruction
+        boost::unique_lock<boost::mutex> l(this->state_mutex);
+        while (this->pending > 0)
+            this->state_cond.wait(l);
+    }
     /*
     if (this->error_status()) {
         throw(boost::system::system_error(boost::system::error_code(),
@@ -184,20 +246,23 @@ GCodeSender::is_connected() const
 bool
 GCodeSender::wait_connected(unsigned int timeout) const
 {
-    using namespace boost::posix_time;
-    ptime t0 = second_clock::local_time() + seconds(timeout);
-    while (!this->connected) {
-        if (second_clock::local_time() > t0) return false;
-        boost::this_thread::sleep(boost::posix_time::milliseconds(100));
-    }
-    return true;
+    boost::unique_lock<boost::mutex> l(this->state_mutex);
+    return this->state_cond.timed_wait(l, boost::posix_time::seconds(timeout), [this] { return this->connected; });
+}
+
+void
+GCodeSender::set_connected(bool connected)
+{
+    boost::lock_guard<boost::mutex> l(this->state_mutex);
+    this->connected = connected;
+    this->state_cond.notify_all();
 }
 
 size_t
 GCodeSender::queue_size() const
 {
     boost::lock_guard<boost::mutex> l(this->queue_mutex);
-    return this->queue.size();
+    return this->queue.size() + (this->file ? this->file->line_count() - this->file->position() : 0);
 }
 
 void
@@ -229,6 +294,7 @@ GCodeSender::purge_queue(bool priority)
         // clear queue
         std::queue<std::string> empty;
         std::swap(this->queue, empty);
+        this->file.reset();
         this->queue_paused = false;
     }
 }
@@ -266,6 +332,7 @@ GCodeSender::do_close()
 {
     this->set_error_status(false);
     boost::system::error_code ec;
+    this->timer.cancel(ec);
     this->serial.cancel(ec);
     if (ec) this->set_error_status(true);
     this->serial.close(ec);
@@ -294,12 +361,12 @@ GCodeSender::do_read()
         this->serial,
         this->read_buffer,
         '\n',
-        boost::bind(
+        this->on_strand(boost::bind(
             &GCodeSender::on_read,
             this,
             asio::placeholders::error,
             asio::placeholders::bytes_transferred
-        )
+        ))
     );
 }
 
@@ -342,46 +409,75 @@ GCodeSender::on_read(const boost::system::error_code& error,
              || boost::starts_with(line, "Grbl ")
              || boost::starts_with(line, "ok")
              || boost::contains(line, "T:"))) {
-            this->connected = true;
+            this->set_connected(true);
             {
                 boost::lock_guard<boost::mutex> l(this->queue_mutex);
                 this->can_send = true;
+                this->grbl = boost::starts_with(line, "Grbl ");
+                // whatever was sent before was answered, or lost in a restart
+                this->clear_window();
             }
             this->send();
         } else if (boost::starts_with(line, "ok")) {
             {
                 boost::lock_guard<boost::mutex> l(this->queue_mutex);
-                this->can_send = true;
+                this->acknowledge();
             }
             this->send();
         } else if (boost::istarts_with(line, "resend")  // Marlin uses "Resend: "
                 || boost::istarts_with(line, "rs")) {
-            // extract the first number from line
+            // extract the first number from line: the number of the line to send again
             boost::algorithm::trim_left_if(line, !boost::algorithm::is_digit());
-            size_t toresend = boost::lexical_cast<size_t>(line.substr(0, line.find_first_not_of("0123456789")));
-            toresend++; // N is 0-based
-            if (toresend >= this->sent - this->last_sent.size() && toresend < this->last_sent.size()) {
-                {
-                    boost::lock_guard<boost::mutex> l(this->queue_mutex);
-                    
-                    // move the unsent lines to priqueue
-                    this->priqueue.insert(
-                        this->priqueue.begin(),  // insert at the beginning
-                        this->last_sent.begin() + toresend - (this->sent - this->last_sent.size()) - 1,
-                        this->last_sent.end()
-                    );
-                    
-                    // we can empty last_sent because it's not useful anymore
-                    this->last_sent.clear();
-                    
-                    // start resending with the requested line number
-                    this->sent = toresend - 1;
-                    this->can_send = true;
+            size_t toresend = 0;
+            std::from_chars(line.data(), line.data() + line.size(), toresend);
+            boost::unique_lock<boost::mutex> l(this->queue_mutex);
+            if (toresend == this->resend_line && this->resend_duplicates > 0) {
+                // the printer rejects each line of the window sent after the one it asked
+                // for, asking for it again
+                this->resend_duplicates--;
+                if (this->window_lines > 1) this->skip_oks++;
+            } else if (toresend >= this->sent - this->last_sent.size() && toresend < this->sent) {
+                // move the lines from the requested one to priqueue
+                const size_t lines = this->sent - toresend;
+                this->priqueue.insert(
+                    this->priqueue.begin(),  // insert at the beginning
+                    this->last_sent.end() - lines,
+                    this->last_sent.end()
+                );
+                this->last_sent.erase(this->last_sent.end() - lines, this->last_sent.end());
+                
+                // the lines before it are still waiting for their ok, the ones after it
+                // are rejected
+                this->resend_line = toresend;
+                this->resend_duplicates = 0;
+                while (!this->in_flight.empty() && this->in_flight.back().first >= toresend) {
+                    if (this->in_flight.back().first > toresend) this->resend_duplicates++;
+                    this->in_flight_bytes -= this->in_flight.back().second;
+                    this->in_flight.pop_back();
                 }
+                // with a single line in flight, the ok following the request lets the
+                // next line go, as it always did
+                this->skip_oks = (this->window_lines > 1) ? 1 : 0;
+                
+                // start resending with the requested line number
+                this->sent = toresend;
+                this->can_send = true;
+                l.unlock();
                 this->send();
             } else {
                 printf("Cannot resend %zu (oldest we have is %zu)\n", toresend, this->sent - this->last_sent.size());
             }
+        } else if (this->grbl && boost::starts_with(line, "error:")) {
+            // Grbl answers a line it rejects with an error instead of an ok
+            {
+                boost::lock_guard<boost::mutex> l(this->queue_mutex);
+                this->acknowledge();
+            }
+            {
+                boost::lock_guard<boost::mutex> l(this->log_mutex);
+                this->log.push(line);
+            }
+            this->send();
         } else if (boost::starts_with(line, "wait")) {
             // ignore
         } else {
@@ -409,17 +505,30 @@ GCodeSender::on_read(const boost::system::error_code& error,
     this->do_read();
 }
 
+// strip comments and whitespace from a line to send
+static std::string
+_strip(std::string line)
+{
+    size_t comment_pos = line.find_first_of(';');
+    if (comment_pos != std::string::npos)
+        line.erase(comment_pos, std::string::npos);
+    boost::algorithm::trim(line);
+    return line;
+}
+
 void
 GCodeSender::send(const std::vector<std::string> &lines, bool priority)
 {
-    // append lines to queue
+    // append lines to queue, skipping the empty ones
     {
         boost::lock_guard<boost::mutex> l(this->queue_mutex);
         for (std::vector<std::string>::const_iterator line = lines.begin(); line != lines.end(); ++line) {
+            std::string stripped = _strip(*line);
+            if (stripped.empty()) continue;
             if (priority) {
-                this->priqueue.push_back(*line);
+                this->priqueue.push_back(std::move(stripped));
             } else {
-                this->queue.push(*line);
+                this->queue.push(std::move(stripped));
             }
         }
     }
@@ -429,22 +538,60 @@ GCodeSender::send(const std::vector<std::string> &lines, bool priority)
 void
 GCodeSender::send(const std::string &line, bool priority)
 {
+    std::string stripped = _strip(line);
+    if (stripped.empty()) return;
+    
     // append line to queue
     {
         boost::lock_guard<boost::mutex> l(this->queue_mutex);
         if (priority) {
-            this->priqueue.push_back(line);
+            this->priqueue.push_back(std::move(stripped));
         } else {
-            this->queue.push(line);
+            this->queue.push(std::move(stripped));
         }
     }
     this->send();
 }
 
+void
+GCodeSender::send(std::shared_ptr<GCodeFile> file)
+{
+    {
+        boost::lock_guard<boost::mutex> l(this->queue_mutex);
+        this->file = file;
+    }
+    this->send();
+}
+
+bool
+GCodeSender::seek_layer(size_t layer)
+{
+    {
+        boost::lock_guard<boost::mutex> l(this->queue_mutex);
+        if (!this->file || !this->file->seek_layer(layer)) return false;
+        
+        // the E of the extrusions of the layer follows the one the file had at its start,
+        // whatever the extruder did since
+        std::ostringstream ss;
+        ss << "G92 E" << std::fixed << std::setprecision(5) << this->file->layers()[layer].e;
+        this->priqueue.push_back(ss.str());
+    }
+    this->send();
+    return true;
+}
+
 void
 GCodeSender::send()
 {
-    boost::asio::post(this->io, boost::bind(&GCodeSender::do_send, this));
+    this->post(boost::bind(&GCodeSender::do_send, this));
+}
+
+void
+GCodeSender::set_window(size_t lines, size_t bytes)
+{
+    boost::lock_guard<boost::mutex> l(this->queue_mutex);
+    this->window_lines = std::max(size_t(1), lines);
+    this->window_bytes = bytes;
 }
 
 void
@@ -452,67 +599,106 @@ GCodeSender::do_send()
 {
     boost::lock_guard<boost::mutex> l(this->queue_mutex);
     
-    // printer is not connected or we're still waiting for the previous ack
-    if (!this->can_send) return;
+    // printer is not connected, or the lines sent before are still being written
+    if (!this->can_send || this->writing) return;
     
-    std::string line;
-    while (!this->priqueue.empty() || (!this->queue.empty() && !this->queue_paused)) {
-        if (!this->priqueue.empty()) {
-            line = this->priqueue.front();
-            this->priqueue.pop_front();
-        } else {
-            line = this->queue.front();
-            this->queue.pop();
-        }
+    // until the printer answers, we wait for the ack of each line
+    const size_t window_lines = this->connected ? this->window_lines : 1;
+    
+    std::ostream os(&this->write_buffer);
+    std::string full_line;
+    char number[24];
+    while (this->in_flight.size() < window_lines
+        && (!this->priqueue.empty() || (!this->queue_paused && (!this->queue.empty() || (this->file && !this->file->at_end()))))) {
+        const std::string_view line = !this->priqueue.empty() ? std::string_view(this->priqueue.front())
+            : !this->queue.empty() ? std::string_view(this->queue.front()) : this->file->front();
         
-        // strip comments
-        size_t comment_pos = line.find_first_of(';');
-        if (comment_pos != std::string::npos)
-            line.erase(comment_pos, std::string::npos);
-        boost::algorithm::trim(line);
+        // compute full line
+        full_line = "N";
+        full_line.append(number, std::to_chars(number, number + sizeof(number), this->sent).ptr);
+        full_line += ' ';
+        full_line += line;
+        
+        // calculate checksum
+        int cs = 0;
+        for (std::string::const_iterator it = full_line.begin(); it != full_line.end(); ++it)
+           cs = cs ^ *it;
+        full_line += '*';
+        full_line.append(number, std::to_chars(number, number + sizeof(number), cs).ptr);
+        full_line += '\n';
+        
+        // the line has to fit in the printer's buffer, unless it is the only one in it
+        if (this->window_bytes > 0 && !this->in_flight.empty()
+            && this->in_flight_bytes + full_line.size() > this->window_bytes)
+            break;
         
-        // if line is not empty, send it
-        if (!line.empty()) break;
-        // if line is empty, process next item in queue
-    }
-    if (line.empty()) return;
-    
-    // compute full line
-    std::string full_line = "N" + boost::lexical_cast<std::string>(this->sent) + " " + line;
-    this->sent++;
-    
-    // calculate checksum
-    int cs = 0;
-    for (std::string::const_iterator it = full_line.begin(); it != full_line.end(); ++it)
-       cs = cs ^ *it;
-    
-    // write line to device
-    full_line += "*";
-    full_line += boost::lexical_cast<std::string>(cs);
-    full_line += "\n";
-    
 #ifdef DEBUG_SERIAL
     fs << ">> " << full_line << std::flush;
 #endif
+        
+        // we can't supply asio::buffer(full_line) to async_write() because full_line is on the
+        // stack and the buffer would lose its underlying storage causing memory corruption
+        os << full_line;
+        this->in_flight.emplace_back(this->sent, full_line.size());
+        this->in_flight_bytes += full_line.size();
+        this->sent++;
+        this->sent_lines++;
+        this->sent_bytes += full_line.size();
+        
+        this->last_sent.emplace_back(line);
+        if (!this->priqueue.empty()) {
+            this->priqueue.pop_front();
+        } else if (!this->queue.empty()) {
+            this->queue.pop();
+        } else {
+            this->file->pop();
+        }
+    }
     
-    this->last_sent.push_back(line);
-    this->can_send = false;
-    
-    if (this->last_sent.size() > KEEP_SENT)
-        this->last_sent.erase(this->last_sent.begin(), this->last_sent.end() - KEEP_SENT);
+    // keep enough lines to resend the whole window
+    const size_t keep = KEEP_SENT + this->window_lines;
+    if (this->last_sent.size() > keep)
+        this->last_sent.erase(this->last_sent.begin(), this->last_sent.end() - keep);
     
-    // we can't supply asio::buffer(full_line) to async_write() because full_line is on the
-    // stack and the buffer would lose its underlying storage causing memory corruption
-    std::ostream os(&this->write_buffer);
-    os << full_line;
-    asio::async_write(this->serial, this->write_buffer, boost::bind(&GCodeSender::on_write, this, boost::asio::placeholders::error,
-                boost::asio::placeholders::bytes_transferred));
+    // write lines to device
+    if (this->write_buffer.size() == 0) return;
+    this->writing = true;
+    asio::async_write(this->serial, this->write_buffer, this->on_strand(boost::bind(&GCodeSender::on_write, this,
+                boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred)));
+}
+
+void
+GCodeSender::acknowledge()
+{
+    // each line gets one ok, in order; Marlin's ADVANCED_OK tells the last line received,
+    // not the one acknowledged, so there is nothing more to read from it.
+    // The oks following resend requests acknowledge no line.
+    if (this->skip_oks > 0) {
+        this->skip_oks--;
+    } else if (!this->in_flight.empty()) {
+        this->in_flight_bytes -= this->in_flight.front().second;
+        this->in_flight.pop_front();
+        this->acknowledged++;
+    }
+}
+
+void
+GCodeSender::clear_window()
+{
+    this->in_flight.clear();
+    this->in_flight_bytes = 0;
+    this->resend_duplicates = 0;
+    this->skip_oks = 0;
 }
 
 void
 GCodeSender::on_write(const boost::system::error_code& error,
     size_t bytes_transferred)
 {
+    {
+        boost::lock_guard<boost::mutex> l(this->queue_mutex);
+        this->writing = false;
+    }
     this->set_error_status(false);
     if (error) {
         if (this->open) {
@@ -549,17 +735,54 @@ GCodeSender::set_DTR(bool on)
 void
 GCodeSender::reset()
 {
-    this->set_DTR(false);
-    boost::this_thread::sleep(boost::posix_time::milliseconds(200));
-    this->set_DTR(true);
-    boost::this_thread::sleep(boost::posix_time::milliseconds(200));
-    this->set_DTR(false);
-    boost::this_thread::sleep(boost::posix_time::milliseconds(1000));
-    {
-        boost::lock_guard<boost::mutex> l(this->queue_mutex);
-        this->can_send = true;
+    this->post(boost::bind(&GCodeSender::do_reset, this, boost::system::error_code(), 0, false));
+}
+
+// One step of the reset, run by the timer after the previous one;
+// probe sends a M105 once the printer is reset.
+void
+GCodeSender::do_reset(const boost::system::error_code& error, int step, bool probe)
+{
+    if (error || !this->open) return;
+    
+    int delay = 0;   // ms before the next step
+    switch (step) {
+        case 0: this->set_DTR(false); delay = 200; break;
+        case 1: this->set_DTR(true); delay = 200; break;
+        case 2: this->set_DTR(false); delay = 1000; break;
+        case 3:
+            {
+                boost::lock_guard<boost::mutex> l(this->queue_mutex);
+                this->can_send = true;
+                // the printer forgot the lines sent before, but when connecting it may
+                // already have answered and received lines
+                if (!probe) this->clear_window();
+            }
+            // send a M105 to check for connection because firmware might be silent on connect
+            if (probe) delay = 1000;
+            break;
+        case 4:
+            if (!this->connected) this->send("M105", true);
+            break;
     }
+    if (delay == 0) return;
+    
+    this->timer.expires_after(std::chrono::milliseconds(delay));
+    this->timer.async_wait(this->on_strand(boost::bind(&GCodeSender::do_reset, this,
+        asio::placeholders::error, step + 1, probe)));
 }
 
+GCodeSender::Stats
+GCodeSender::stats() const
+{
+    boost::lock_guard<boost::mutex> l(this->queue_mutex);
+    return Stats {
+        this->queue.size() + this->priqueue.size() + (this->file ? this->file->line_count() - this->file->position() : 0),
+        this->in_flight.size(),
+        this->sent_lines,
+        this->acknowledged,
+        this->sent_bytes,
+    };
 }
 
+}
@@ -2,6 +2,11 @@
 #define slic3r_GCodeSender_hpp_
 
 #include "libslic3r.h"
+#include "GCodeFile.hpp"
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
 #include <queue>
 #include <string>
 #include <vector>
@@ -27,15 +32,42 @@ using boost::placeholders::_2;
 
 class GCodeSender : private boost::noncopyable {
     public:
+    /// Counters of a sender since it connected.
+    struct Stats {
+        size_t queued;          ///< lines waiting to be sent, priority ones included
+        size_t in_flight;       ///< lines sent and waiting for their ok
+        uint64_t sent;          ///< lines sent, resent ones included
+        uint64_t acknowledged;  ///< lines acknowledged
+        uint64_t bytes;         ///< bytes sent
+    };
+    
+    /// Runs its own io_context in a background thread.
     GCodeSender();
+    /// Runs on io, which the caller runs in as many threads as it likes (see GCodeSenderPool);
+    /// the handlers of a sender never run concurrently.
+    explicit GCodeSender(asio::io_context &io);
+    /// Disconnects, see disconnect().
     ~GCodeSender();
+    /// Opens the port and returns; the printer is then reset and probed in the background,
+    /// until is_connected().
     bool connect(std::string devname, unsigned int baud_rate);
     void send(const std::vector<std::string> &lines, bool priority = false);
     void send(const std::string &s, bool priority = false);
+    /// Sends a file after the queued lines, reading its lines as they are sent;
+    /// it replaces the file being sent, if any.
+    void send(std::shared_ptr<GCodeFile> file);
+    /// Continues the file from the start of a layer (see GCodeFile::layers()), setting the
+    /// position of the extruder to the one of the layer; false if there is no such layer.
+    /// Pause the queue before, and resume it after.
+    bool seek_layer(size_t layer);
+    /// Closes the port once the handlers of the sender have run, waiting for them.
+    /// Throws std::logic_error if called from a thread running its io_context, such as
+    /// a completion handler, as it would wait for itself.
     void disconnect();
     bool error_status() const;
     bool is_connected() const;
     bool wait_connected(unsigned int timeout = 3) const;
+    /// Lines waiting to be sent, those of the file included.
     size_t queue_size() const;
     void pause_queue();
     void resume_queue();
@@ -44,11 +76,22 @@ class GCodeSender : private boost::noncopyable {
     std::string getT() const;
     std::string getB() const;
     void set_DTR(bool on);
+    /// Pulses DTR to reset the printer, in the background.
     void reset();
+    Stats stats() const;
+    
+    /// Lets up to `lines` lines wait for their acknowledgement at once, instead of one, and
+    /// no more than `bytes` bytes of them if not 0 (Grbl's character counting: the size of
+    /// its receive buffer minus one). Lines the printer asks for again are resent from
+    /// the window, as for a single line.
+    void set_window(size_t lines, size_t bytes = 0);
     
     private:
-    asio::io_context io;
+    std::unique_ptr<asio::io_context> own_io;   // if the sender runs its own, before io
+    asio::io_context &io;
+    asio::io_context::strand strand;
     asio::serial_port serial;
+    asio::steady_timer timer;   // steps of the reset
     boost::thread background_thread;
     boost::asio::streambuf read_buffer, write_buffer;
     bool open;      // whether the serial socket is connected
@@ -56,23 +99,47 @@ class GCodeSender : private boost::noncopyable {
     bool error;
     mutable boost::mutex error_mutex;
     
-    // this mutex guards queue, priqueue, can_send, queue_paused, sent, last_sent
+    // this mutex guards pending, and connected when it changes
+    mutable boost::mutex state_mutex;
+    mutable boost::condition_variable state_cond;
+    size_t pending; // handlers posted or waiting for an operation, which disconnect() waits for
+    
+    // this mutex guards queue, priqueue, can_send, queue_paused, sent, last_sent,
+    // the window and writing
     mutable boost::mutex queue_mutex;
     std::queue<std::string> queue;
+    std::shared_ptr<GCodeFile> file;    // after queue
     std::list<std::string> priqueue;
     bool can_send;
     bool queue_paused;
     size_t sent;
     std::vector<std::string> last_sent;
+    size_t window_lines, window_bytes;
+    std::deque<std::pair<size_t, size_t>> in_flight;    // numbers and sizes of the lines waiting for an ok
+    size_t in_flight_bytes;
+    size_t resend_line, resend_duplicates;  // requests for resend_line still expected
+    size_t skip_oks;        // oks following the resend requests, which acknowledge no line
+    bool grbl;              // which answers each line with an ok or an error
+    bool writing;           // whether an async_write() of write_buffer is in progress
+    uint64_t acknowledged, sent_lines, sent_bytes;
     
     // this mutex guards log, T, B
     mutable boost::mutex log_mutex;
     std::queue<std::string> log;
     std::string T, B;
     
+    /// Runs on io, or on own_io if io is nullptr.
+    GCodeSender(asio::io_context* io, std::unique_ptr<asio::io_context> own_io);
     void set_baud_rate(unsigned int baud_rate);
     void set_error_status(bool e);
+    void set_connected(bool connected);
+    template <class Handler> auto on_strand(Handler handler);
+    template <class Handler> void post(Handler handler);
+    void done();
+    void do_reset(const boost::system::error_code& error, int step, bool probe);
     void do_send();
+    void acknowledge();
+    void clear_window();
     void on_write(const boost::system::error_code& error, size_t bytes_transferred);
     void do_close();
     void do_read();
@@ -0,0 +1,109 @@
+#include "GCodeSenderPool.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace Slic3r {
+
+GCodeSenderPool::GCodeSenderPool(unsigned int threads)
+    : work(asio::make_work_guard(io))
+{
+    if (threads == 0)
+        threads = std::min(4u, std::max(1u, boost::thread::hardware_concurrency()));
+    for (unsigned int i = 0; i < threads; ++i)
+        this->threads.create_thread(boost::bind(&asio::io_context::run, &this->io));
+}
+
+GCodeSenderPool::~GCodeSenderPool()
+{
+    // the senders need the threads to disconnect
+    {
+        boost::lock_guard<boost::mutex> l(this->printers_mutex);
+        this->printers.clear();
+    }
+    this->work.reset();
+    this->threads.join_all();
+}
+
+GCodeSender*
+GCodeSenderPool::add(const std::string &name, const std::string &devname, unsigned int baud_rate)
+{
+    if (this->get(name) != nullptr)
+        throw std::invalid_argument("A printer is already named " + name);
+    
+    std::unique_ptr<GCodeSender> sender(new GCodeSender(this->io));
+    if (!sender->connect(devname, baud_rate))
+        return nullptr;
+    
+    boost::lock_guard<boost::mutex> l(this->printers_mutex);
+    Printer &printer = this->printers[name];
+    if (printer.sender)
+        throw std::invalid_argument("A printer is already named " + name);
+    printer.sender = std::move(sender);
+    printer.sampled = std::chrono::steady_clock::now();
+    printer.acknowledged = printer.bytes = 0;
+    return printer.sender.get();
+}
+
+GCodeSender*
+GCodeSenderPool::get(const std::string &name) const
+{
+    boost::lock_guard<boost::mutex> l(this->printers_mutex);
+    const auto printer = this->printers.find(name);
+    return (printer == this->printers.end()) ? nullptr : printer->second.sender.get();
+}
+
+void
+GCodeSenderPool::remove(const std::string &name)
+{
+    std::unique_ptr<GCodeSender> sender;
+    {
+        boost::lock_guard<boost::mutex> l(this->printers_mutex);
+        const auto printer = this->printers.find(name);
+        if (printer == this->printers.end()) return;
+        sender = std::move(printer->second.sender);
+        this->printers.erase(printer);
+    }
+    // disconnects it, outside of the lock
+}
+
+std::vector<std::string>
+GCodeSenderPool::names() const
+{
+    boost::lock_guard<boost::mutex> l(this->printers_mutex);
+    std::vector<std::string> names;
+    names.reserve(this->printers.size());
+    for (const auto &printer : this->printers)
+        names.push_back(printer.first);
+    return names;
+}
+
+std::vector<GCodeSenderPool::Metrics>
+GCodeSenderPool::metrics()
+{
+    boost::lock_guard<boost::mutex> l(this->printers_mutex);
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<Metrics> metrics;
+    metrics.reserve(this->printers.size());
+    for (auto &named : this->printers) {
+        Printer &printer = named.second;
+        Metrics m;
+        m.name      = named.first;
+        m.connected = printer.sender->is_connected();
+        m.error     = printer.sender->error_status();
+        m.stats     = printer.sender->stats();
+        
+        // the counters start again from 0 when the sender connects again
+        if (m.stats.acknowledged < printer.acknowledged || m.stats.bytes < printer.bytes)
+            printer.acknowledged = printer.bytes = 0;
+        const double seconds = std::chrono::duration<double>(now - printer.sampled).count();
+        m.lines_per_second = (seconds > 0) ? (m.stats.acknowledged - printer.acknowledged) / seconds : 0;
+        m.bytes_per_second = (seconds > 0) ? (m.stats.bytes - printer.bytes) / seconds : 0;
+        printer.sampled      = now;
+        printer.acknowledged = m.stats.acknowledged;
+        printer.bytes        = m.stats.bytes;
+        metrics.push_back(m);
+    }
+    return metrics;
+}
+
+}
@@ -0,0 +1,63 @@
+#ifndef slic3r_GCodeSenderPool_hpp_
+#define slic3r_GCodeSenderPool_hpp_
+
+#include "libslic3r.h"
+#include "GCodeSender.hpp"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Slic3r {
+
+/// Drives many printers from a few threads: its GCodeSenders share one io_context, run by
+/// a pool of threads, instead of a thread each.
+class GCodeSenderPool : private boost::noncopyable {
+    public:
+    /// State of a printer, with its throughput since the previous call to metrics().
+    struct Metrics {
+        std::string name;
+        bool connected;
+        bool error;
+        GCodeSender::Stats stats;
+        double lines_per_second;    ///< acknowledged
+        double bytes_per_second;    ///< sent
+    };
+    
+    /// \param threads running the senders; 0 for the number of cores, up to 4
+    explicit GCodeSenderPool(unsigned int threads = 0);
+    /// Disconnects the printers.
+    ~GCodeSenderPool();
+    
+    /// Adds a printer and starts connecting to it, as GCodeSender::connect();
+    /// returns nullptr if its port cannot be opened.
+    /// Throws std::invalid_argument if name is already used.
+    GCodeSender* add(const std::string &name, const std::string &devname, unsigned int baud_rate);
+    /// Returns nullptr if there is no printer with this name.
+    GCodeSender* get(const std::string &name) const;
+    /// Disconnects a printer and removes it.
+    void remove(const std::string &name);
+    std::vector<std::string> names() const;
+    /// Metrics of all the printers, by name.
+    std::vector<Metrics> metrics();
+    
+    private:
+    struct Printer {
+        std::unique_ptr<GCodeSender> sender;
+        std::chrono::steady_clock::time_point sampled;  ///< last call to metrics()
+        uint64_t acknowledged, bytes;                   ///< at the last call to metrics()
+    };
+    
+    asio::io_context io;
+    asio::executor_work_guard<asio::io_context::executor_type> work;
+    boost::thread_group threads;
+    // this mutex guards printers
+    mutable boost::mutex printers_mutex;
+    std::map<std::string, Printer> printers;
+};
+
+}
+
+#endif
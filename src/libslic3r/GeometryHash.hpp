@@ -0,0 +1,63 @@
+#ifndef slic3r_GeometryHash_hpp_
+#define slic3r_GeometryHash_hpp_
+
+#include "libslic3r.h"
+#include "ExPolygon.hpp"
+#include <functional>
+
+namespace Slic3r {
+
+/// Helpers for content-addressed caches of geometry results.
+/// Hashes are only used to find candidates; callers must confirm a match
+/// with the exact same_geometry() comparisons.
+
+inline void
+hash_combine(size_t &seed, size_t value)
+{
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+inline void
+hash_combine(size_t &seed, double value)
+{
+    hash_combine(seed, std::hash<double>()(value));
+}
+
+inline void
+hash_geometry(size_t &seed, const Polygon &polygon)
+{
+    hash_combine(seed, polygon.points.size());
+    for (const Point &p : polygon.points) {
+        hash_combine(seed, std::hash<coord_t>()(p.x));
+        hash_combine(seed, std::hash<coord_t>()(p.y));
+    }
+}
+
+inline void
+hash_geometry(size_t &seed, const ExPolygon &expolygon)
+{
+    hash_geometry(seed, expolygon.contour);
+    hash_combine(seed, expolygon.holes.size());
+    for (const Polygon &hole : expolygon.holes)
+        hash_geometry(seed, hole);
+}
+
+inline bool
+same_geometry(const Polygon &a, const Polygon &b)
+{
+    return a.points == b.points;
+}
+
+inline bool
+same_geometry(const ExPolygon &a, const ExPolygon &b)
+{
+    if (!same_geometry(a.contour, b.contour) || a.holes.size() != b.holes.size())
+        return false;
+    for (size_t i = 0; i < a.holes.size(); ++i)
+        if (!same_geometry(a.holes[i], b.holes[i])) return false;
+    return true;
+}
+
+}
+
+#endif
@@ -9,7 +9,7 @@
 
 namespace Slic3r { namespace IO {
 
-enum ExportFormat { AMF, OBJ, POV, STL, SVG, TMF, Gcode };
+enum ExportFormat { AMF, OBJ, POV, STL, SVG, TMF, Gcode, Toolpaths };
 
 extern const std::map<ExportFormat,std::string> extensions;
 extern const std::map<ExportFormat,bool(*)(const Model&,std::string)> write_model;
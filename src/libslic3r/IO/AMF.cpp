@@ -3,6 +3,7 @@
 #include <fstream>
 #include <cstring>
 #include <map>
+#include <queue>
 #include <string>
 #include <boost/move/move.hpp>
 #include <boost/nowide/fstream.hpp>
@@ -140,6 +141,16 @@ struct AMFParserContext
     ModelVolume             *m_volume;
     // Faces collected for the current m_volume.
     std::vector<int>         m_volume_facets;
+    // Vertices of an object and the faces of its volumes, copied into the volumes once
+    // the whole document is parsed, so that they are built and repaired in parallel.
+    struct ObjectMesh {
+        std::vector<float>                                  vertices;
+        std::vector<std::pair<ModelVolume*, std::vector<int>>> volumes;
+    };
+    // Volumes of the current m_object with their faces.
+    std::vector<std::pair<ModelVolume*, std::vector<int>>> m_object_volumes;
+    // Meshes of the parsed objects, built into their volumes by endDocument().
+    std::vector<ObjectMesh>  m_meshes;
     // Current material allocated for an amf/metadata subtree.
     ModelMaterial           *m_material;
     // Current instance allocated for an amf/constellation/instance subtree.
@@ -363,30 +374,21 @@ void AMFParserContext::endElement(const char *name)
         m_value[2].clear();
         break;
 
-    // Closing the current volume. Create an STL from m_volume_facets pointing to m_object_vertices.
+    // Closing the current volume. Its STL is created from m_volume_facets pointing to m_object_vertices
+    // by endDocument().
     case NODE_TYPE_VOLUME:
-    {
 		assert(m_object && m_volume);
-        stl_file &stl = m_volume->mesh.stl;
-        stl.stats.type = inmemory;
-        stl.stats.number_of_facets = int(m_volume_facets.size() / 3);
-        stl.stats.original_num_facets = stl.stats.number_of_facets;
-        stl_allocate(&stl);
-        for (size_t i = 0; i < m_volume_facets.size();) {
-            stl_facet &facet = stl.facet_start[i/3];
-            for (unsigned int v = 0; v < 3; ++ v)
-                memcpy(&facet.vertex[v].x, &m_object_vertices[m_volume_facets[i ++] * 3], 3 * sizeof(float));
-        }
-        stl_get_size(&stl);
-        m_volume->mesh.repair();
+        m_object_volumes.push_back(std::make_pair(m_volume, std::move(m_volume_facets)));
         m_volume_facets.clear();
         m_volume = NULL;
         break;
-    }
 
     case NODE_TYPE_OBJECT:
         assert(m_object);
+        if (! m_object_volumes.empty())
+            m_meshes.push_back(ObjectMesh{ std::move(m_object_vertices), std::move(m_object_volumes) });
         m_object_vertices.clear();
+        m_object_volumes.clear();
         m_object = NULL;
         break;
 
@@ -442,6 +444,33 @@ void AMFParserContext::endElement(const char *name)
 
 void AMFParserContext::endDocument()
 {
+    // Create the STL of each volume and repair it, in parallel.
+    std::queue<std::pair<size_t, size_t>> volumes;
+    for (size_t i = 0; i < m_meshes.size(); ++ i)
+        for (size_t j = 0; j < m_meshes[i].volumes.size(); ++ j)
+            volumes.push(std::make_pair(i, j));
+    parallelize<std::pair<size_t, size_t>>(
+        volumes,
+        [this](std::pair<size_t, size_t> volume_idx) {
+            const ObjectMesh &object_mesh = m_meshes[volume_idx.first];
+            const std::vector<int> &facets = object_mesh.volumes[volume_idx.second].second;
+            TriangleMesh &mesh = object_mesh.volumes[volume_idx.second].first->mutable_mesh();
+            stl_file &stl = mesh.stl;
+            stl.stats.type = inmemory;
+            stl.stats.number_of_facets = int(facets.size() / 3);
+            stl.stats.original_num_facets = stl.stats.number_of_facets;
+            stl_allocate(&stl);
+            for (size_t i = 0; i < facets.size();) {
+                stl_facet &facet = stl.facet_start[i/3];
+                for (unsigned int v = 0; v < 3; ++ v)
+                    memcpy(&facet.vertex[v].x, &object_mesh.vertices[facets[i ++] * 3], 3 * sizeof(float));
+            }
+            stl_get_size(&stl);
+            mesh.repair();
+        }
+    );
+    m_meshes.clear();
+
     for (const auto &object : m_object_instances_map) {
         if (object.second.idx == -1) {
             printf("Undefined object %s referenced in constellation\n", object.first.c_str());
@@ -566,10 +595,15 @@ AMF::write(const Model& model, std::string output_file)
 
         Pointf3 origin_translation = object->origin_translation();
         
+        // Copies of the meshes with shared vertices, leaving the facets shared by the volumes untouched.
+        std::vector<TriangleMesh> meshes;
+        meshes.reserve(object->volumes.size());
+        
         for (ModelVolume *volume : object->volumes) {
-            volume->mesh.require_shared_vertices();
+            meshes.push_back(volume->mesh());
+            meshes.back().require_shared_vertices();
             vertices_offsets.push_back(num_vertices);
-            const auto &stl = volume->mesh.stl;
+            const auto &stl = meshes.back().stl;
             for (size_t i = 0; i < static_cast<size_t>(stl.stats.shared_vertices); ++i)
                 // Subtract origin_translation in order to restore the coordinates of the parts
                 // before they were imported. Otherwise, when this AMF file is reimported parts
@@ -608,11 +642,12 @@ AMF::write(const Model& model, std::string output_file)
             if (volume->modifier)
                 file << "        <metadata type=\"slic3r.modifier\">1</metadata>" << endl;
             
-            for (int i = 0; i < volume->mesh.stl.stats.number_of_facets; ++i) {
+            const auto &stl = meshes[i_volume].stl;
+            for (int i = 0; i < stl.stats.number_of_facets; ++i) {
                 file << "        <triangle>" << endl;
                 for (int j = 0; j < 3; ++ j)
                     file << "          <v" << (j+1) << ">"
-                         << (volume->mesh.stl.v_indices[i].vertex[j] + vertices_offset)
+                         << (stl.v_indices[i].vertex[j] + vertices_offset)
                          << "</v" << (j+1) << ">" << endl;
                 file << "        </triangle>" << endl;
             }
@@ -0,0 +1,374 @@
+#include "../IO.hpp"
+#include "../IndexedMesh.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#ifdef _WIN32
+#include <boost/nowide/convert.hpp>
+#endif
+
+namespace Slic3r { namespace IO {
+
+/// Offset of the face indices which are relative to the vertices of their chunk.
+static const int64_t _OBJ_RELATIVE = int64_t(1) << 62;
+
+/// Vertices and faces read from a range of whole lines of an OBJ file.
+struct _OBJChunk
+{
+    const char* begin;
+    const char* end;
+    std::vector<stl_vertex> vertices;
+    /// Number of vertices of each face.
+    std::vector<uint32_t> face_sizes;
+    /// 0-based vertex indices of the faces. The negative indices of the file count back from
+    /// the last vertex read, and are stored as an index in this chunk minus _OBJ_RELATIVE,
+    /// since the number of vertices of the previous chunks is only known once they are read.
+    std::vector<int64_t> indices;
+    /// Number of faces read before each 'o' or 'g' line.
+    std::vector<size_t> shape_faces;
+    /// Triangles of the faces, and the number of them before each 'o' or 'g' line.
+    std::vector<IndexedMesh::Triangle> triangles;
+    std::vector<size_t> shape_triangles;
+    std::string error;
+};
+
+static inline const char*
+_skip_blanks(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+    return p;
+}
+
+static inline const char*
+_skip_token(const char* p, const char* end)
+{
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') ++p;
+    return p;
+}
+
+/// Reads the vertices and the faces of the lines of a chunk, ignoring normals, texture
+/// coordinates, materials and anything else.
+static void
+_read_obj_chunk(_OBJChunk* chunk)
+{
+    const char* end = chunk->end;
+    for (const char* p = chunk->begin; p < end; ) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (eol == nullptr) eol = end;
+        p = _skip_blanks(p, eol);
+        if (eol - p >= 2 && (p[1] == ' ' || p[1] == '\t')) {
+            if (p[0] == 'v') {
+                stl_vertex v;
+                float* coords[3] = { &v.x, &v.y, &v.z };
+                p += 2;
+                for (float* coord : coords) {
+                    p = _skip_blanks(p, eol);
+                    if (p < eol && *p == '+') ++p;
+                    *coord = 0;
+                    p = _skip_token(std::from_chars(p, eol, *coord).ptr, eol);
+                }
+                chunk->vertices.push_back(v);
+            } else if (p[0] == 'f') {
+                uint32_t face_size = 0;
+                for (p = _skip_blanks(p + 2, eol); p < eol; p = _skip_blanks(p, eol)) {
+                    // only the vertex index of "v", "v/vt", "v//vn" or "v/vt/vn"
+                    int64_t index = 0;
+                    std::from_chars(p, eol, index);
+                    if (index == 0) {
+                        chunk->error = "Failed to parse a face index (e.g. zero value for face index)";
+                        return;
+                    }
+                    chunk->indices.push_back(index > 0
+                        ? index - 1
+                        : int64_t(chunk->vertices.size()) + index - _OBJ_RELATIVE);
+                    ++face_size;
+                    p = _skip_token(p, eol);
+                }
+                // faces must have 3 or more vertices
+                if (face_size < 3)
+                    chunk->indices.resize(chunk->indices.size() - face_size);
+                else
+                    chunk->face_sizes.push_back(face_size);
+            } else if (p[0] == 'o' || p[0] == 'g') {
+                chunk->shape_faces.push_back(chunk->face_sizes.size());
+            }
+        }
+        p = eol + 1;
+    }
+}
+
+/// Splits a polygon into triangles by ear clipping in the plane of its two dominant axes,
+/// the way tiny_obj_loader did it. The polygon is consumed.
+static void
+_triangulate(const std::vector<stl_vertex> &vertices, std::vector<uint32_t>* polygon_ptr,
+    std::vector<IndexedMesh::Triangle>* triangles)
+{
+    std::vector<uint32_t> &polygon = *polygon_ptr;
+    const auto coord = [&vertices](uint32_t v, size_t axis) {
+        return axis == 0 ? vertices[v].x : axis == 1 ? vertices[v].y : vertices[v].z;
+    };
+
+    // find the two axes to work in
+    size_t axes[2] = { 1, 2 };
+    size_t n = polygon.size();
+    for (size_t k = 0; k < n; ++k) {
+        const stl_vertex &v0 = vertices[polygon[k]];
+        const stl_vertex &v1 = vertices[polygon[(k + 1) % n]];
+        const stl_vertex &v2 = vertices[polygon[(k + 2) % n]];
+        const float e0x = v1.x - v0.x, e0y = v1.y - v0.y, e0z = v1.z - v0.z;
+        const float e1x = v2.x - v1.x, e1y = v2.y - v1.y, e1z = v2.z - v1.z;
+        const float cx = std::fabs(e0y * e1z - e0z * e1y);
+        const float cy = std::fabs(e0z * e1x - e0x * e1z);
+        const float cz = std::fabs(e0x * e1y - e0y * e1x);
+        const float epsilon = std::numeric_limits<float>::epsilon();
+        if (cx > epsilon || cy > epsilon || cz > epsilon) {
+            // found a corner
+            if (!(cx > cy && cx > cz)) {
+                axes[0] = 0;
+                if (cz > cx && cz > cy) axes[1] = 1;
+            }
+            break;
+        }
+    }
+
+    float area = 0;
+    for (size_t k = 0; k < n; ++k)
+        area += (coord(polygon[k], axes[0]) * coord(polygon[(k + 1) % n], axes[1])
+            - coord(polygon[k], axes[1]) * coord(polygon[(k + 1) % n], axes[0])) * 0.5f;
+
+    // arbitrary max loop count to protect against unexpected errors
+    int max_rounds = 10;
+    size_t guess = 0;
+    while (polygon.size() > 3 && max_rounds > 0) {
+        n = polygon.size();
+        if (guess >= n) {
+            max_rounds -= 1;
+            guess -= n;
+        }
+        IndexedMesh::Triangle ear;
+        float vx[3], vy[3];
+        for (size_t k = 0; k < 3; ++k) {
+            ear[k] = polygon[(guess + k) % n];
+            vx[k] = coord(ear[k], axes[0]);
+            vy[k] = coord(ear[k], axes[1]);
+        }
+        // skip internal angles
+        if (((vx[1] - vx[0]) * (vy[2] - vy[1]) - (vy[1] - vy[0]) * (vx[2] - vx[1])) * area < 0) {
+            guess += 1;
+            continue;
+        }
+        // check all other vertices in case they are inside this triangle
+        bool overlap = false;
+        for (size_t other = 3; other < n && !overlap; ++other) {
+            const float tx = coord(polygon[(guess + other) % n], axes[0]);
+            const float ty = coord(polygon[(guess + other) % n], axes[1]);
+            for (size_t i = 0, j = 2; i < 3; j = i++)
+                if (((vy[i] > ty) != (vy[j] > ty)) && (tx < (vx[j] - vx[i]) * (ty - vy[i]) / (vy[j] - vy[i]) + vx[i]))
+                    overlap = !overlap;
+        }
+        if (overlap) {
+            guess += 1;
+            continue;
+        }
+        triangles->push_back(ear);
+        polygon.erase(polygon.begin() + (guess + 1) % n);
+    }
+    if (polygon.size() == 3)
+        triangles->push_back(IndexedMesh::Triangle{{ polygon[0], polygon[1], polygon[2] }});
+}
+
+/// Reads the vertices of an OBJ file and the triangles of each shape started by an 'o' or
+/// 'g' line, in parallel over chunks of the memory-mapped file.
+static void
+_read_obj(const std::string &input_file, std::vector<stl_vertex>* vertices,
+    std::vector<IndexedMesh::Triangle>* triangles, std::vector<size_t>* shape_triangles)
+{
+    using namespace boost::interprocess;
+    shape_triangles->assign(1, 0);
+    const size_t size = size_t(boost::filesystem::file_size(input_file));
+    if (size == 0) {
+        shape_triangles->push_back(0);
+        return;
+    }
+    #ifdef _WIN32
+    file_mapping file(boost::nowide::widen(input_file).c_str(), read_only);
+    #else
+    file_mapping file(input_file.c_str(), read_only);
+    #endif
+    mapped_region region(file, read_only);
+    const char* data = static_cast<const char*>(region.get_address());
+    region.advise(mapped_region::advice_sequential);
+
+    // split the file into chunks of whole lines, several per thread for balancing
+    const size_t threads = std::max(1u, boost::thread::hardware_concurrency());
+    const size_t chunk_size = std::max(size_t(1) << 20, size / (4 * threads) + 1);
+    std::vector<_OBJChunk> chunks;
+    for (const char* begin = data; begin < data + size; ) {
+        const char* end = begin + std::min(chunk_size, size_t(data + size - begin));
+        if (end < data + size) {
+            const char* eol = static_cast<const char*>(std::memchr(end, '\n', data + size - end));
+            end = (eol == nullptr) ? data + size : eol + 1;
+        }
+        chunks.push_back(_OBJChunk());
+        chunks.back().begin = begin;
+        chunks.back().end = end;
+        begin = end;
+    }
+
+    std::queue<size_t> queue;
+    for (size_t i = 0; i < chunks.size(); ++i) queue.push(i);
+    parallelize<size_t>(queue, [&chunks](size_t i) { _read_obj_chunk(&chunks[i]); }, int(threads));
+
+    // gather the vertices, which all the faces may refer to
+    std::vector<size_t> vertices_offsets(chunks.size() + 1, 0);
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (!chunks[i].error.empty())
+            throw std::runtime_error(chunks[i].error);
+        vertices_offsets[i + 1] = vertices_offsets[i] + chunks[i].vertices.size();
+    }
+    if (vertices_offsets.back() > size_t(std::numeric_limits<uint32_t>::max()))
+        throw std::runtime_error("Too many vertices in OBJ file");
+    vertices->resize(vertices_offsets.back());
+    for (size_t i = 0; i < chunks.size(); ++i) queue.push(i);
+    parallelize<size_t>(queue, [&chunks, &vertices_offsets, vertices](size_t i) {
+        std::copy(chunks[i].vertices.begin(), chunks[i].vertices.end(), vertices->begin() + vertices_offsets[i]);
+        chunks[i].vertices = std::vector<stl_vertex>();
+    }, int(threads));
+
+    // resolve the indices and triangulate the faces
+    for (size_t i = 0; i < chunks.size(); ++i) queue.push(i);
+    parallelize<size_t>(queue, [&chunks, &vertices_offsets, vertices](size_t i) {
+        _OBJChunk &chunk = chunks[i];
+        std::vector<uint32_t> polygon;
+        size_t shape = 0;
+        for (size_t face = 0, index = 0; face < chunk.face_sizes.size(); ++face) {
+            for (; shape < chunk.shape_faces.size() && chunk.shape_faces[shape] == face; ++shape)
+                chunk.shape_triangles.push_back(chunk.triangles.size());
+            polygon.clear();
+            for (uint32_t k = 0; k < chunk.face_sizes[face]; ++k, ++index) {
+                int64_t v = chunk.indices[index];
+                if (v < 0) v += _OBJ_RELATIVE + int64_t(vertices_offsets[i]);
+                if (v < 0 || v >= int64_t(vertices->size())) {
+                    chunk.error = "Face index out of range";
+                    return;
+                }
+                polygon.push_back(uint32_t(v));
+            }
+            if (polygon.size() == 3)
+                chunk.triangles.push_back(IndexedMesh::Triangle{{ polygon[0], polygon[1], polygon[2] }});
+            else
+                _triangulate(*vertices, &polygon, &chunk.triangles);
+        }
+        for (; shape < chunk.shape_faces.size(); ++shape)
+            chunk.shape_triangles.push_back(chunk.triangles.size());
+        chunk.face_sizes = std::vector<uint32_t>();
+        chunk.indices = std::vector<int64_t>();
+    }, int(threads));
+
+    // concatenate the triangles, keeping the start of each shape
+    size_t n_triangles = 0;
+    for (const _OBJChunk &chunk : chunks) {
+        if (!chunk.error.empty())
+            throw std::runtime_error(chunk.error);
+        n_triangles += chunk.triangles.size();
+    }
+    triangles->reserve(n_triangles);
+    for (_OBJChunk &chunk : chunks) {
+        for (size_t start : chunk.shape_triangles)
+            shape_triangles->push_back(triangles->size() + start);
+        triangles->insert(triangles->end(), chunk.triangles.begin(), chunk.triangles.end());
+        chunk.triangles = std::vector<IndexedMesh::Triangle>();
+    }
+    shape_triangles->push_back(triangles->size());
+}
+
+/// Mesh made of a range of triangles, with only the vertices they use.
+static IndexedMesh
+_obj_shape(const std::vector<stl_vertex> &vertices,
+    std::vector<IndexedMesh::Triangle>::const_iterator begin, std::vector<IndexedMesh::Triangle>::const_iterator end)
+{
+    IndexedMesh mesh;
+    mesh.triangles.assign(begin, end);
+    if (3 * mesh.triangles.size() >= vertices.size()) {
+        // most of the vertices are used
+        std::vector<uint32_t> remap(vertices.size(), std::numeric_limits<uint32_t>::max());
+        for (IndexedMesh::Triangle &triangle : mesh.triangles)
+            for (uint32_t &v : triangle) {
+                if (remap[v] == std::numeric_limits<uint32_t>::max()) {
+                    remap[v] = uint32_t(mesh.vertices.size());
+                    mesh.vertices.push_back(vertices[v]);
+                }
+                v = remap[v];
+            }
+    } else {
+        std::vector<uint32_t> used;
+        used.reserve(3 * mesh.triangles.size());
+        for (const IndexedMesh::Triangle &triangle : mesh.triangles)
+            used.insert(used.end(), triangle.begin(), triangle.end());
+        std::sort(used.begin(), used.end());
+        used.erase(std::unique(used.begin(), used.end()), used.end());
+        mesh.vertices.reserve(used.size());
+        for (uint32_t v : used)
+            mesh.vertices.push_back(vertices[v]);
+        for (IndexedMesh::Triangle &triangle : mesh.triangles)
+            for (uint32_t &v : triangle)
+                v = uint32_t(std::lower_bound(used.begin(), used.end(), v) - used.begin());
+    }
+    return mesh;
+}
+
+bool
+OBJ::read(std::string input_file, TriangleMesh* mesh)
+{
+    std::vector<stl_vertex> vertices;
+    std::vector<IndexedMesh::Triangle> triangles;
+    std::vector<size_t> shape_triangles;
+    _read_obj(input_file, &vertices, &triangles, &shape_triangles);
+
+    *mesh = _obj_shape(vertices, triangles.begin(), triangles.end()).to_triangle_mesh();
+    mesh->check_topology();
+    return true;
+}
+
+bool
+OBJ::read(std::string input_file, Model* model)
+{
+    // TODO: check that file exists
+
+    std::vector<stl_vertex> vertices;
+    std::vector<IndexedMesh::Triangle> triangles;
+    std::vector<size_t> shape_triangles;
+    _read_obj(input_file, &vertices, &triangles, &shape_triangles);
+
+    ModelObject* object = model->add_object();
+    object->name        = boost::filesystem::path(input_file).filename().string();
+    object->input_file  = input_file;
+
+    // Build a volume for each shape which has triangles.
+    std::vector<TriangleMesh> meshes(shape_triangles.size() - 1);
+    parallelize<size_t>(
+        0, meshes.size() - 1,
+        [&vertices, &triangles, &shape_triangles, &meshes](size_t i) {
+            if (shape_triangles[i] == shape_triangles[i + 1]) return;
+            meshes[i] = _obj_shape(vertices, triangles.begin() + shape_triangles[i],
+                triangles.begin() + shape_triangles[i + 1]).to_triangle_mesh();
+            meshes[i].check_topology();
+        }
+    );
+    for (TriangleMesh &mesh : meshes) {
+        if (mesh.facets_count() == 0) continue;
+        ModelVolume* volume = object->add_volume(std::move(mesh));
+        volume->name        = object->name;
+    }
+
+    return true;
+}
+
+} }
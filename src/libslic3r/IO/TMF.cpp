@@ -1,14 +1,43 @@
 #include "TMF.hpp"
+#include <charconv>
+#include <queue>
+#include <sstream>
 
 namespace Slic3r { namespace IO {
 
+/// Write a coordinate in the shortest form which reads back to the same float.
+static inline void
+write_number(std::ostream& fout, float value)
+{
+    char buf[32];
+    const std::to_chars_result result = std::to_chars(buf, buf + sizeof(buf), value);
+    fout.write(buf, result.ptr - buf);
+}
+
+/// Read a number attribute without going through the locale as atof() does.
+template <typename T> static inline T
+read_number(const char* value)
+{
+    while (isspace((unsigned char)*value) || *value == '+')
+        ++value;
+    T number = 0;
+    std::from_chars(value, value + strlen(value), number);
+    return number;
+}
+
+/// Write an index without going through the locale of the stream.
+static inline void
+write_number(std::ostream& fout, int value)
+{
+    char buf[16];
+    const std::to_chars_result result = std::to_chars(buf, buf + sizeof(buf), value);
+    fout.write(buf, result.ptr - buf);
+}
+
 bool
 TMFEditor::write_types()
 {
-    // Create a new .[Content_Types].xml file to add to the zip file later.
-    boost::nowide::ofstream fout(".[Content_Types].xml", std::ios::out | std::ios::trunc);
-    if(!fout.is_open())
-        return false;
+    std::ostringstream fout;
 
     // Write 3MF Types.
     fout << "<?xml version=\"1.0\" encoding=\"UTF-8\"?> \n";
@@ -16,51 +45,31 @@ TMFEditor::write_types()
     fout << "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>\n";
     fout << "<Default Extension=\"model\" ContentType=\"application/vnd.ms-package.3dmanufacturing-3dmodel+xml\"/>\n";
     fout << "</Types>\n";
-    fout.close();
 
     // Create [Content_Types].xml in the zip archive.
-    if(!zip_archive->add_entry("[Content_Types].xml", ".[Content_Types].xml"))
-        return false;
-
-    // Remove the created .[Content_Types].xml file.
-    if (remove(".[Content_Types].xml") != 0)
-        return false;
-
-    return true;
+    return zip_archive->add_entry_from_memory("[Content_Types].xml", fout.str());
 }
 
 bool
 TMFEditor::write_relationships()
 {
-    // Create a new .rels file to add to the zip file later.
-    boost::nowide::ofstream fout(".rels", std::ios::out | std::ios::trunc);
-    if(!fout.is_open())
-        return false;
+    std::ostringstream fout;
 
     // Write the primary 3dmodel relationship.
     fout << "<?xml version=\"1.0\" encoding=\"UTF-8\"?> \n"
                           << "<Relationships xmlns=\"" << namespaces.at("relationships") <<
                   "\">\n<Relationship Id=\"rel0\" Target=\"/3D/3dmodel.model\" Type=\"http://schemas.microsoft.com/3dmanufacturing/2013/01/3dmodel\" /></Relationships>\n";
-    fout.close();
 
     // Create .rels in "_rels" folder in the zip archive.
-    if(!zip_archive->add_entry("_rels/.rels", ".rels"))
-        return false;
-
-    // Remove the created .rels file.
-    if (remove(".rels") != 0)
-        return false;
-
-    return true;
+    return zip_archive->add_entry_from_memory("_rels/.rels", fout.str());
 }
 
 bool
 TMFEditor::write_model()
 {
-    // Create a new .3dmodel.model file to add to the zip file later.
-    boost::nowide::ofstream fout(".3dmodel.model", std::ios::out | std::ios::trunc);
-    if(!fout.is_open())
-        return false;
+    // The document is built in memory and compressed into the archive from there,
+    // so that nothing is written to the working directory.
+    std::ostringstream fout;
 
     // Add the XML document header.
     fout << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
@@ -89,21 +98,13 @@ TMFEditor::write_model()
 
     // Close the model element.
     fout << "</model>\n";
-    fout.close();
 
     // Create .3dmodel.model in "3D" folder in the zip archive.
-    if(!zip_archive->add_entry("3D/3dmodel.model", ".3dmodel.model"))
-        return false;
-
-    // Remove the created .rels file.
-    if (remove(".3dmodel.model") != 0)
-        return false;
-
-    return true;
+    return zip_archive->add_entry_from_memory("3D/3dmodel.model", std::move(fout).str());
 }
 
 bool
-TMFEditor::write_metadata(boost::nowide::ofstream& fout)
+TMFEditor::write_metadata(std::ostream& fout)
 {
     // Write the model metadata.
     for (const auto metadata : model->metadata){
@@ -117,7 +118,7 @@ TMFEditor::write_metadata(boost::nowide::ofstream& fout)
 }
 
 bool
-TMFEditor::write_object(boost::nowide::ofstream& fout, const ModelObject* object, int index)
+TMFEditor::write_object(std::ostream& fout, const ModelObject* object, int index)
 {
     // Create the new object element.
     fout << "        <object id=\"" << (index + object_id) << "\" type=\"model\"";
@@ -146,12 +147,17 @@ TMFEditor::write_object(boost::nowide::ofstream& fout, const ModelObject* object
 
     Pointf3 origin_translation = object->origin_translation();
 
+    // Copies of the meshes with shared vertices, leaving the facets shared by the volumes untouched.
+    std::vector<TriangleMesh> meshes;
+    meshes.reserve(object->volumes.size());
+
     for (const auto volume : object->volumes){
         // Require mesh vertices.
-        volume->mesh.require_shared_vertices();
+        meshes.push_back(volume->mesh());
+        meshes.back().require_shared_vertices();
 
         vertices_offsets.push_back(num_vertices);
-        const auto &stl = volume->mesh.stl;
+        const auto &stl = meshes.back().stl;
         for (int i = 0; i < stl.stats.shared_vertices; ++i)
         {
 
@@ -161,10 +167,13 @@ TMFEditor::write_object(boost::nowide::ofstream& fout, const ModelObject* object
             // thus any additional part added will not align with the others.
             // In order to do this we compensate for this translation in the instance placement
             // below.
-            fout << "                    <vertex";
-            fout << " x=\"" << (stl.v_shared[i].x - origin_translation.x) << "\"";
-            fout << " y=\"" << (stl.v_shared[i].y - origin_translation.y) << "\"";
-            fout << " z=\"" << (stl.v_shared[i].z - origin_translation.z) << "\"/>\n";
+            fout << "                    <vertex x=\"";
+            write_number(fout, float(stl.v_shared[i].x - origin_translation.x));
+            fout << "\" y=\"";
+            write_number(fout, float(stl.v_shared[i].y - origin_translation.y));
+            fout << "\" z=\"";
+            write_number(fout, float(stl.v_shared[i].z - origin_translation.z));
+            fout << "\"/>\n";
         }
         num_vertices += stl.stats.shared_vertices;
     }
@@ -180,15 +189,18 @@ TMFEditor::write_object(boost::nowide::ofstream& fout, const ModelObject* object
     int num_triangles = 0;
     int i_volume = 0;
 
-    for (const auto volume : object->volumes) {
+    for (const auto &mesh : meshes) {
         int vertices_offset = vertices_offsets[i_volume];
         triangles_offsets.push_back(num_triangles);
 
         // Add the volume triangles to the triangles list.
-        for (int i = 0; i < volume->mesh.stl.stats.number_of_facets; ++i){
+        const auto &stl = mesh.stl;
+        for (int i = 0; i < stl.stats.number_of_facets; ++i){
             fout << "                    <triangle";
             for (int j = 0; j < 3; j++){
-                fout << " v" << (j+1) << "=\"" << (volume->mesh.stl.v_indices[i].vertex[j] + vertices_offset) << "\"";
+                fout << " v" << (j+1) << "=\"";
+                write_number(fout, stl.v_indices[i].vertex[j] + vertices_offset);
+                fout << "\"";
             }
             fout << "/>\n";
             num_triangles++;
@@ -236,7 +248,7 @@ TMFEditor::write_object(boost::nowide::ofstream& fout, const ModelObject* object
 }
 
 bool
-TMFEditor::write_build(boost::nowide::ofstream& fout)
+TMFEditor::write_build(std::ostream& fout)
 {
     // Create build element.
     fout << "    <build> \n";
@@ -276,56 +288,34 @@ TMFEditor::write_build(boost::nowide::ofstream& fout)
 bool
 TMFEditor::read_model()
 {
-    // Extract 3dmodel.model entry.
-    if(!zip_archive->extract_entry("3D/3dmodel.model", "3dmodel.model"))
-        return false;
-
-    // Read 3D/3dmodel.model file.
     XML_Parser parser = XML_ParserCreate(NULL);
     if (! parser) {
         std::cout << ("Couldn't allocate memory for parser\n");
         return false;
     }
 
-    boost::nowide::ifstream fin("3dmodel.model", std::ios::in);
-    if (!fin.is_open()) {
-        boost::nowide::cerr << "Cannot open file: " << "3dmodel.model" << std::endl;
-        return false;
-    }
-
     // Create model parser.
     TMFParserContext ctx(parser, model);
     XML_SetUserData(parser, (void*)&ctx);
     XML_SetElementHandler(parser, TMFParserContext::startElement, TMFParserContext::endElement);
     XML_SetCharacterDataHandler(parser, TMFParserContext::characters);
 
-    char buff[8192];
-    bool result = false;
-    while (!fin.eof()) {
-        fin.read(buff, sizeof(buff));
-        if (fin.bad()) {
-            printf("3MF model parser: Read error\n");
-            break;
-        }
-        if (XML_Parse(parser, buff, fin.gcount(), fin.eof()) == XML_STATUS_ERROR) {
+    // Parse 3D/3dmodel.model while it is inflated, without extracting it to the disk.
+    const auto parse = [parser](const char* buff, size_t len, bool is_final) {
+        if (XML_Parse(parser, buff, int(len), is_final) == XML_STATUS_ERROR) {
             printf("3MF model parser: Parse error at line %lu:\n%s\n",
                    XML_GetCurrentLineNumber(parser),
                    XML_ErrorString(XML_GetErrorCode(parser)));
-            break;
+            return false;
         }
-        if (fin.eof()) {
-            result = true;
-            break;
-        }
-    }
+        return true;
+    };
+    bool result = zip_archive->extract_entry("3D/3dmodel.model",
+            [&parse](const char* buff, size_t len) { return parse(buff, len, false); })
+        && parse(nullptr, 0, true);
 
-    // Free the parser and close the file.
+    // Free the parser.
     XML_ParserFree(parser);
-    fin.close();
-
-    // Remove the extracted 3dmodel.model file.
-    if (remove("3dmodel.model") != 0)
-        return false;
 
     if (result)
         ctx.endDocument();
@@ -553,20 +543,16 @@ TMFParserContext::startElement(const char *name, const char **atts)
                 const char* object_id = get_attribute(atts, "objectid");
                 if(!object_id)
                     this->stop();
-                ModelObject* component_object = m_model.objects[m_objects_indices[object_id]];
-                ModelVolume* volume = m_object->add_volume(component_object->raw_mesh());
-                if(!volume)
-                    this->stop();
+                // The volume is added once the mesh of the component object is built.
+                Component component { m_object, m_model.objects[m_objects_indices[object_id]], false, TransformationMatrix() };
 
                 const char* transformation_matrix = get_attribute(atts, "transform");
                 if(transformation_matrix){
-                    TransformationMatrix trafo;
-
-                    if(!extract_trafo(transformation_matrix, trafo))
+                    if(!extract_trafo(transformation_matrix, component.trafo))
                         this->stop();
-
-                    volume->apply_transformation(trafo);
+                    component.transformed = true;
                 }
+                m_components.push_back(component);
                 node_type_new =NODE_TYPE_COMPONENT;
             } else if (strcmp(name, "slic3r:volumes") == 0) {
                 node_type_new = NODE_TYPE_SLIC3R_VOLUMES;
@@ -579,9 +565,9 @@ TMFParserContext::startElement(const char *name, const char **atts)
                 const char* z = get_attribute(atts, "z");
                 if ( !x || !y || !z)
                     this->stop();
-                m_object_vertices.push_back(atof(x));
-                m_object_vertices.push_back(atof(y));
-                m_object_vertices.push_back(atof(z));
+                m_object_vertices.push_back(read_number<float>(x));
+                m_object_vertices.push_back(read_number<float>(y));
+                m_object_vertices.push_back(read_number<float>(z));
                 node_type_new = NODE_TYPE_VERTEX;
             } else if (strcmp(name, "triangle") == 0) {
                 const char* v1 = get_attribute(atts, "v1");
@@ -590,9 +576,9 @@ TMFParserContext::startElement(const char *name, const char **atts)
                 if (!v1 || !v2 || !v3)
                     this->stop();
                 // Add it to the volume facets.
-                m_volume_facets.push_back(atoi(v1));
-                m_volume_facets.push_back(atoi(v2));
-                m_volume_facets.push_back(atoi(v3));
+                m_volume_facets.push_back(read_number<int>(v1));
+                m_volume_facets.push_back(read_number<int>(v2));
+                m_volume_facets.push_back(read_number<int>(v3));
                 node_type_new = NODE_TYPE_TRIANGLE;
             } else if (strcmp(name, "slic3r:volume") == 0) {
                 // Read start offset of the triangles.
@@ -655,22 +641,12 @@ TMFParserContext::endElement()
         case NODE_TYPE_OBJECT:
             if(!m_object)
                 this->stop();
+            build_volumes();
             m_object_vertices.clear();
             m_volume_facets.clear();
+            m_object_volumes.clear();
             m_object = nullptr;
             break;
-        case NODE_TYPE_MODEL:
-        {
-            size_t deleted_objects_count = 0;
-            // According to 3MF spec. we must output objects found in item.
-            for (size_t i = 0; i < m_output_objects.size(); i++) {
-                if (m_output_objects[i]) {
-                    m_model.delete_object(i - deleted_objects_count);
-                    deleted_objects_count++;
-                }
-            }
-        }
-            break;
         case NODE_TYPE_SLIC3R_VOLUME:
             m_volume = nullptr;
             m_value[0].clear();
@@ -698,9 +674,60 @@ TMFParserContext::characters(const XML_Char *s, int len)
 }
 
 void
-TMFParserContext::endDocument()
+TMFParserContext::build_volumes()
 {
+    if (m_object_volumes.empty()) return;
+
+    // Build and repair the volumes in parallel.
+    std::queue<size_t> volumes;
+    for (size_t i = 0; i < m_object_volumes.size(); ++i)
+        volumes.push(i);
+    parallelize<size_t>(
+        volumes,
+        [this](size_t volume_idx) {
+            ModelVolume* volume;
+            int start_offset, end_offset;
+            std::tie(volume, start_offset, end_offset) = m_object_volumes[volume_idx];
+
+            TriangleMesh &mesh = volume->mutable_mesh();
+            stl_file &stl = mesh.stl;
+            stl.stats.type = inmemory;
+            stl.stats.number_of_facets = (1 + end_offset - start_offset) / 3;
+            stl.stats.original_num_facets = stl.stats.number_of_facets;
+            stl_allocate(&stl);
+            int i_facet = 0;
+            for (int i = start_offset; i <= end_offset ;) {
+                stl_facet &facet = stl.facet_start[i_facet / 3];
+                for (unsigned int v = 0; v < 3; ++v) {
+                    memcpy(&facet.vertex[v].x, &m_object_vertices[m_volume_facets[i++] * 3], 3 * sizeof(float));
+                    i_facet++;
+                }
+            }
+            stl_get_size(&stl);
+            mesh.repair();
+        }
+    );
+}
 
+void
+TMFParserContext::endDocument()
+{
+    // Add the components, now that the objects they refer to are complete.
+    for (const Component &component : m_components) {
+        ModelVolume* volume = component.object->add_volume(component.component_object->raw_mesh());
+        if (component.transformed)
+            volume->apply_transformation(component.trafo);
+    }
+    m_components.clear();
+
+    size_t deleted_objects_count = 0;
+    // According to 3MF spec. we must output objects found in item.
+    for (size_t i = 0; i < m_output_objects.size(); i++) {
+        if (m_output_objects[i]) {
+            m_model.delete_object(i - deleted_objects_count);
+            deleted_objects_count++;
+        }
+    }
 }
 
 void
@@ -755,22 +782,8 @@ TMFParserContext::add_volume(int start_offset, int end_offset, bool modifier)
     m_volume = m_object->add_volume(TriangleMesh());
     if(!m_volume || (end_offset < start_offset)) return nullptr;
 
-    // Add the triangles.
-    stl_file &stl = m_volume->mesh.stl;
-    stl.stats.type = inmemory;
-    stl.stats.number_of_facets = (1 + end_offset - start_offset) / 3;
-    stl.stats.original_num_facets = stl.stats.number_of_facets;
-    stl_allocate(&stl);
-    int i_facet = 0;
-    for (int i = start_offset; i <= end_offset ;) {
-        stl_facet &facet = stl.facet_start[i_facet / 3];
-        for (unsigned int v = 0; v < 3; ++v) {
-            memcpy(&facet.vertex[v].x, &m_object_vertices[m_volume_facets[i++] * 3], 3 * sizeof(float));
-            i_facet++;
-        }
-    }
-    stl_get_size(&stl);
-    m_volume->mesh.repair();
+    // Its triangles are added when the object is parsed.
+    m_object_volumes.push_back(std::make_tuple(m_volume, start_offset, end_offset));
     m_volume->modifier = modifier;
 
     return m_volume;
@@ -8,6 +8,7 @@
 #include <string>
 #include <cstring>
 #include <map>
+#include <tuple>
 #include <vector>
 #include <algorithm>
 #include <cmath>
@@ -59,17 +60,17 @@ private:
     bool write_model();
 
     /// Write the metadata of the model. This function is called by writeModel() function.
-    bool write_metadata(boost::nowide::ofstream& fout);
+    bool write_metadata(std::ostream& fout);
 
     /// Write object of the current model. This function is called by writeModel() function.
-    /// \param fout boost::nowide::ofstream& fout output stream.
+    /// \param fout std::ostream& fout output stream.
     /// \param object ModelObject* a pointer to the object to be written.
     /// \param index int the index of the object to be read
     /// \return bool 1: write operation is successful , otherwise not.
-    bool write_object(boost::nowide::ofstream& fout, const ModelObject* object, int index);
+    bool write_object(std::ostream& fout, const ModelObject* object, int index);
 
     /// Write the build element.
-    bool write_build(boost::nowide::ofstream& fout);
+    bool write_build(std::ostream& fout);
 
     /// Read the Model.
     bool read_model();
@@ -129,6 +130,21 @@ struct TMFParserContext{
     std::vector<int> m_volume_facets;
     ///< Faces collected for all volumes of the current object.
 
+    std::vector<std::tuple<ModelVolume*, int, int>> m_object_volumes;
+    ///< Volumes added to the current object, waiting for their facets, with the first
+    ///< and the last index of their vertices in m_volume_facets.
+
+    /// A component of an object, added as a volume once the meshes of the objects are built.
+    struct Component {
+        ModelObject* object;
+        ModelObject* component_object;
+        bool transformed;
+        TransformationMatrix trafo;
+    };
+
+    std::vector<Component> m_components;
+    ///< Components in document order, as they may refer to objects made of components.
+
     std::string m_value[3];
     ///< Generic string buffer for metadata, etc.
 
@@ -141,6 +157,8 @@ struct TMFParserContext{
     void startElement(const char *name, const char **atts);
     void endElement();
     void endDocument();
+    /// Build and repair the volumes of the current object, once its vertices and facets are parsed.
+    void build_volumes();
     void characters(const XML_Char *s, int len);
     void stop();
 
@@ -149,7 +167,7 @@ struct TMFParserContext{
     /// \return TransformationMatrix a matrix that contains the complete defined transformation.
     bool extract_trafo(std::string matrix, TransformationMatrix& trafo);
 
-    /// Add a new volume to the current object.
+    /// Add a new volume to the current object. Its facets are filled in by build_volumes().
     /// \param start_offset size_t the start index in the m_volume_facets vector.
     /// \param end_offset size_t the end index in the m_volume_facets vector.
     /// \param modifier bool whether the volume is modifier or not.
@@ -0,0 +1,147 @@
+#include "IndexedMesh.hpp"
+#include "TriangleMesh.hpp"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace Slic3r {
+
+/// Hashes the bit patterns of the coordinates, so that only identical vertices are merged.
+struct _VertexKey
+{
+    uint32_t bits[3];
+
+    explicit _VertexKey(const stl_vertex &v) {
+        std::memcpy(&this->bits[0], &v.x, sizeof(float));
+        std::memcpy(&this->bits[1], &v.y, sizeof(float));
+        std::memcpy(&this->bits[2], &v.z, sizeof(float));
+    };
+    bool operator==(const _VertexKey &other) const {
+        return this->bits[0] == other.bits[0] && this->bits[1] == other.bits[1] && this->bits[2] == other.bits[2];
+    };
+};
+
+struct _VertexKeyHash
+{
+    size_t operator()(const _VertexKey &key) const {
+        size_t seed = key.bits[0];
+        seed ^= key.bits[1] + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        seed ^= key.bits[2] + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed;
+    };
+};
+
+IndexedMesh::IndexedMesh(const TriangleMesh &mesh)
+{
+    const stl_file &stl = mesh.stl;
+    const size_t n_facets = size_t(std::max(0, stl.stats.number_of_facets));
+    this->triangles.reserve(n_facets);
+
+    if (stl.v_shared != nullptr && stl.v_indices != nullptr) {
+        this->vertices.assign(stl.v_shared, stl.v_shared + stl.stats.shared_vertices);
+        for (size_t i = 0; i < n_facets; ++i) {
+            const int* v = stl.v_indices[i].vertex;
+            this->triangles.push_back(Triangle{{ uint32_t(v[0]), uint32_t(v[1]), uint32_t(v[2]) }});
+        }
+        return;
+    }
+
+    std::unordered_map<_VertexKey, uint32_t, _VertexKeyHash> index;
+    index.reserve(n_facets);
+    this->vertices.reserve(n_facets / 2 + 3);
+    for (size_t i = 0; i < n_facets; ++i) {
+        Triangle triangle;
+        for (size_t j = 0; j < 3; ++j) {
+            const stl_vertex &v = stl.facet_start[i].vertex[j];
+            const auto it = index.emplace(_VertexKey(v), uint32_t(this->vertices.size()));
+            if (it.second) this->vertices.push_back(v);
+            triangle[j] = it.first->second;
+        }
+        this->triangles.push_back(triangle);
+    }
+}
+
+TriangleMesh
+IndexedMesh::to_triangle_mesh() const
+{
+    TriangleMesh mesh;
+    stl_file &stl = mesh.stl;
+    stl.stats.type = inmemory;
+    stl.stats.number_of_facets = int(this->triangles.size());
+    stl.stats.original_num_facets = stl.stats.number_of_facets;
+    stl_allocate(&stl);
+    for (size_t i = 0; i < this->triangles.size(); ++i) {
+        stl_facet &facet = stl.facet_start[i];
+        for (size_t j = 0; j < 3; ++j)
+            facet.vertex[j] = this->vertex(i, j);
+        facet.normal = this->normal(i);
+    }
+    stl_get_size(&stl);
+    return mesh;
+}
+
+stl_normal
+IndexedMesh::normal(size_t triangle) const
+{
+    stl_facet facet;
+    for (size_t j = 0; j < 3; ++j)
+        facet.vertex[j] = this->vertex(triangle, j);
+    float normal[3];
+    stl_calculate_normal(normal, &facet);
+    stl_normalize_vector(normal);
+    stl_normal n;
+    n.x = normal[0];
+    n.y = normal[1];
+    n.z = normal[2];
+    return n;
+}
+
+BoundingBoxf3
+IndexedMesh::bounding_box() const
+{
+    BoundingBoxf3 bb;
+    for (const stl_vertex &v : this->vertices)
+        bb.merge(Pointf3(v.x, v.y, v.z));
+    return bb;
+}
+
+void
+IndexedMesh::transform(const TransformationMatrix &trafo)
+{
+    // same arithmetic as admesh's stl_transform()
+    for (stl_vertex &v : this->vertices) {
+        const double x = v.x, y = v.y, z = v.z;
+        v.x = float(trafo.m00 * x + trafo.m01 * y + trafo.m02 * z + trafo.m03);
+        v.y = float(trafo.m10 * x + trafo.m11 * y + trafo.m12 * z + trafo.m13);
+        v.z = float(trafo.m20 * x + trafo.m21 * y + trafo.m22 * z + trafo.m23);
+    }
+    // keep the triangles counter-clockwise when mirroring
+    if (trafo.determinante() < 0)
+        for (Triangle &triangle : this->triangles)
+            std::swap(triangle[0], triangle[1]);
+}
+
+void
+IndexedMesh::merge(const IndexedMesh &other)
+{
+    const uint32_t offset = uint32_t(this->vertices.size());
+    this->vertices.insert(this->vertices.end(), other.vertices.begin(), other.vertices.end());
+    this->triangles.reserve(this->triangles.size() + other.triangles.size());
+    for (const Triangle &triangle : other.triangles)
+        this->triangles.push_back(Triangle{{ triangle[0] + offset, triangle[1] + offset, triangle[2] + offset }});
+}
+
+void
+IndexedMesh::clear()
+{
+    this->vertices.clear();
+    this->triangles.clear();
+}
+
+size_t
+IndexedMesh::memory_size() const
+{
+    return this->vertices.capacity() * sizeof(stl_vertex) + this->triangles.capacity() * sizeof(Triangle);
+}
+
+}
@@ -0,0 +1,60 @@
+#ifndef slic3r_IndexedMesh_hpp_
+#define slic3r_IndexedMesh_hpp_
+
+#include "libslic3r.h"
+#include <admesh/stl.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "BoundingBox.hpp"
+#include "TransformationMatrix.hpp"
+
+namespace Slic3r {
+
+class TriangleMesh;
+
+/// Compact triangle mesh: a buffer of shared vertices and three vertex indices per
+/// triangle, about 24 bytes per triangle for a closed mesh against the 50 bytes of an
+/// admesh facet, plus its neighbors and the shared vertices built on demand.
+/// Normals are not stored but computed from the vertices when asked for.
+/// Conversions from and to TriangleMesh keep the vertex coordinates and the order of
+/// the facets, so TriangleMesh is only needed where admesh works on the facets (repair,
+/// split, cut, file output).
+class IndexedMesh
+{
+    public:
+    typedef std::array<uint32_t, 3> Triangle;
+
+    std::vector<stl_vertex> vertices;
+    std::vector<Triangle> triangles;
+
+    IndexedMesh() {};
+
+    /// Uses the shared vertices of mesh when it has them, and merges the vertices
+    /// having the same coordinates otherwise.
+    explicit IndexedMesh(const TriangleMesh &mesh);
+
+    /// Facets for admesh, with normals computed from the vertices; not repaired.
+    TriangleMesh to_triangle_mesh() const;
+
+    size_t facets_count() const { return this->triangles.size(); };
+    bool empty() const { return this->triangles.empty(); };
+    const stl_vertex& vertex(size_t triangle, size_t i) const {
+        return this->vertices[this->triangles[triangle][i]];
+    };
+    /// Unit normal of a triangle as admesh computes it (counter-clockwise vertices
+    /// seen from outside), or a null vector for a degenerate triangle.
+    stl_normal normal(size_t triangle) const;
+
+    BoundingBoxf3 bounding_box() const;
+    void transform(const TransformationMatrix &trafo);
+    /// Appends the triangles of other, without merging their vertices with ours.
+    void merge(const IndexedMesh &other);
+    void clear();
+    /// Bytes used by the vertices and triangles.
+    size_t memory_size() const;
+};
+
+}
+
+#endif
@@ -1,8 +1,10 @@
 #include "Layer.hpp"
 #include "ClipperUtils.hpp"
 #include "Geometry.hpp"
+#include "GeometryHash.hpp"
 #include "Print.hpp"
 #include "Log.hpp"
+#include <algorithm>
 
 namespace Slic3r {
 
@@ -196,6 +198,11 @@ Layer::make_perimeters()
             }
         }
         
+        // keep the perimeters of groups whose slices and config didn't change
+        if (std::all_of(layerms.begin(), layerms.end(),
+            [](const LayerRegion* l) { return l->perimeters_valid; }))
+            continue;
+        
         if (layerms.size() == 1) {  // optimization
             (*layerm)->fill_surfaces.surfaces.clear();
             (*layerm)->make_perimeters((*layerm)->slices, &(*layerm)->fill_surfaces);
@@ -224,13 +231,14 @@ Layer::make_perimeters()
             (*layerm)->make_perimeters(new_slices, &fill_surfaces);
             
             // assign fill_surfaces to each layer
+            for (LayerRegionPtrs::iterator l = layerms.begin(); l != layerms.end(); ++l)
+                (*l)->fill_surfaces.surfaces.clear();
             if (!fill_surfaces.surfaces.empty()) {
                 for (LayerRegionPtrs::iterator l = layerms.begin(); l != layerms.end(); ++l) {
                     ExPolygons expp = intersection_ex(
                         (Polygons) fill_surfaces,
                         (Polygons) (*l)->slices
                     );
-                    (*l)->fill_surfaces.surfaces.clear();
                     
                     for (ExPolygons::iterator ex = expp.begin(); ex != expp.end(); ++ex) {
                         Surface s = fill_surfaces.surfaces.front();  // clone type and extra_perimeters
@@ -240,10 +248,33 @@ Layer::make_perimeters()
                 }
             }
         }
+        
+        for (LayerRegion* l : layerms) {
+            l->untyped_slices          = l->slices;
+            l->perimeter_fill_surfaces = l->fill_surfaces;
+            l->perimeters_valid        = true;
+            l->fills_valid             = false;
+        }
     }
 }
 
+/// Whether a and b hold exactly the same surfaces in the same order.
+static bool
+_same_surfaces(const Surfaces &a, const Surfaces &b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (a[i].surface_type           != b[i].surface_type
+            || a[i].thickness           != b[i].thickness
+            || a[i].thickness_layers    != b[i].thickness_layers
+            || a[i].bridge_angle        != b[i].bridge_angle
+            || !same_geometry(a[i].expolygon, b[i].expolygon))
+            return false;
+    return true;
+}
+
 /// Iterates over all of the LayerRegion and invokes LayerRegion->make_fill()
+/// for those whose fills are not up to date
 /// Asserts that the fills created are not NULL
 void
 Layer::make_fills()
@@ -254,7 +285,14 @@ Layer::make_fills()
     #endif
     
     FOREACH_LAYERREGION(this, it_layerm) {
-        (*it_layerm)->make_fill();
+        LayerRegion &layerm = **it_layerm;
+        // keep the fills of regions whose fill_surfaces, perimeters and config didn't change
+        if (layerm.fills_valid && _same_surfaces(layerm.filled_surfaces.surfaces, layerm.fill_surfaces.surfaces))
+            continue;
+        
+        layerm.make_fill();
+        layerm.filled_surfaces = layerm.fill_surfaces;
+        layerm.fills_valid = true;
         
         #ifndef NDEBUG
         for (size_t i = 0; i < (*it_layerm)->fills.entities.size(); ++i)
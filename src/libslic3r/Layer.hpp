@@ -55,6 +55,21 @@ class LayerRegion
     /// Ordered collection of extrusion paths to fill surfaces
     /// (this collection contains only ExtrusionEntityCollection objects)
     ExtrusionEntityCollection fills;
+
+    /// Copy of slices as sliced (with the extra_perimeters computed by PrintObject::make_perimeters())
+    /// and of fill_surfaces as generated along with the perimeters, from which
+    /// detect_surfaces_type() and prepare_infill() start again as they alter them in place
+    SurfaceCollection untyped_slices;
+    SurfaceCollection perimeter_fill_surfaces;
+
+    /// Copy of the fill_surfaces the fills were generated from
+    SurfaceCollection filled_surfaces;
+
+    /// Whether perimeters, thin_fills and perimeter_fill_surfaces are up to date
+    /// with the slices and the region config
+    bool perimeters_valid;
+    /// Whether fills are up to date with filled_surfaces, thin_fills and the region config
+    bool fills_valid;
     
     /// Flow object which provides methods to predict material spacing.
     Flow flow(FlowRole role, bool bridge = false, double width = -1) const;
@@ -79,9 +94,12 @@ class LayerRegion
     /// Mutex object for slices.
     mutable boost::mutex _slices_mutex;
 
+    /// Generates the infill of fill_surfaces (without the thin fills).
+    void _make_infill();
+
     ///Constructor
     LayerRegion(Layer *layer, PrintRegion *region)
-        : _layer(layer), _region(region) {};
+        : perimeters_valid(false), fills_valid(false), _layer(layer), _region(region) {};
     ///Destructor
     ~LayerRegion() {};
 };
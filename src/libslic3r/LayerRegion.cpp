@@ -43,6 +43,28 @@ LayerRegion::make_perimeters(const SurfaceCollection &slices, SurfaceCollection*
     this->perimeters.clear();
     this->thin_fills.clear();
     
+    // Prismatic objects repeat the same slices layer after layer: reuse the
+    // toolpaths of an earlier layer having exactly the same inputs.
+    PrintObject &object = *this->layer()->object();
+    const Layer* lower_layer = this->layer()->lower_layer;
+    PerimeterCacheKey key(
+        this->region(),
+        slices.surfaces,
+        (lower_layer != NULL && this->region()->config.overhangs) ? lower_layer->slices.expolygons : ExPolygons(),
+        this->layer()->height,
+        this->layer()->id() == 0
+    );
+    {
+        PerimeterCacheValue cached;
+        if (object.perimeter_cache.find(key, &cached)) {
+            this->perimeters.swap(cached.perimeters);
+            this->thin_fills.swap(cached.thin_fills);
+            append_to(fill_surfaces->surfaces, cached.fill_surfaces);
+            return;
+        }
+    }
+    const size_t fill_surfaces_count = fill_surfaces->surfaces.size();
+    
     PerimeterGenerator g(
         // input:
         &slices,
@@ -66,8 +88,15 @@ LayerRegion::make_perimeters(const SurfaceCollection &slices, SurfaceCollection*
     g.ext_perimeter_flow    = this->flow(frExternalPerimeter);
     g.overhang_flow         = this->region()->flow(frPerimeter, -1, true, false, -1, *this->layer()->object());
     g.solid_infill_flow     = this->flow(frSolidInfill);
+    g.medial_axis_cache     = &object.medial_axis_cache;
     
     g.process();
+    
+    PerimeterCacheValue value;
+    value.perimeters    = this->perimeters;
+    value.thin_fills    = this->thin_fills;
+    value.fill_surfaces.assign(fill_surfaces->surfaces.begin() + fill_surfaces_count, fill_surfaces->surfaces.end());
+    object.perimeter_cache.insert(std::move(key), std::move(value));
 }
 
 /// Processes bridges with holes which are internal features.
@@ -21,6 +21,14 @@ struct SurfaceGroupAttrib
     int     pattern;    ///< pattern is of type InfillPattern, -1 for an unset pattern.
 };
 
+/// Whether the infill generated by a pattern depends on the print Z
+/// (and not only on the alternating layer direction).
+static bool
+_fill_pattern_depends_on_z(InfillPattern pattern)
+{
+    return pattern == ipGyroid || pattern == ip3DHoneycomb || pattern == ipCubic;
+}
+
 /// The LayerRegion at this point of time may contain
 /// surfaces of various types (internal/bridge/top/bottom/solid).
 /// The infills are generated on the groups of surfaces with a compatible type.
@@ -31,11 +39,50 @@ LayerRegion::make_fill()
 {
     this->fills.clear();
     
+    // Infill of layers having the same fill surfaces, height and infill direction
+    // is identical, so it is generated once and copied to the other layers.
+    const PrintRegionConfig &config = this->region()->config;
+    const bool depends_on_z = _fill_pattern_depends_on_z(config.fill_pattern.value)
+        || _fill_pattern_depends_on_z(config.top_infill_pattern.value)
+        || _fill_pattern_depends_on_z(config.bottom_infill_pattern.value);
+    
+    PrintObject &object = *this->layer()->object();
+    FillCacheKey key(
+        this->region(),
+        this->fill_surfaces.surfaces,
+        this->layer()->height,
+        this->layer()->id() == 0,
+        Geometry::deg2rad(config.fill_angle.value),
+        this->layer()->id(),
+        depends_on_z ? this->layer()->print_z : 0.
+    );
+    if (!object.fill_cache.find(key, &this->fills)) {
+        this->_make_infill();
+        object.fill_cache.insert(std::move(key), ExtrusionEntityCollection(this->fills));
+    }
+
+    // add thin fill regions
+    // thin_fills are of C++ Slic3r::ExtrusionEntityCollection, perl type Slic3r::ExtrusionPath::Collection
+    // Unpacks the collection, creates multiple collections per path so that they will
+    // be individually included in the nearest neighbor search.
+    // The path type could be ExtrusionPath, ExtrusionLoop or ExtrusionEntityCollection.
+    for (ExtrusionEntitiesPtr::const_iterator thin_fill = this->thin_fills.entities.begin(); thin_fill != this->thin_fills.entities.end(); ++ thin_fill) {
+        ExtrusionEntityCollection* coll = new ExtrusionEntityCollection();
+        this->fills.entities.push_back(coll);
+        coll->append(**thin_fill);
+    }
+}
+
+/// Generates the infill of this->fill_surfaces into this->fills.
+void
+LayerRegion::_make_infill()
+{
     const double fill_density          = this->region()->config.fill_density;
     const Flow   infill_flow           = this->flow(frInfill);
     const Flow   solid_infill_flow     = this->flow(frSolidInfill);
     const Flow   top_solid_infill_flow = this->flow(frTopSolidInfill);
     const coord_t perimeter_spacing    = this->flow(frPerimeter).scaled_spacing();
+    FillPool     &fill_pool            = this->layer()->object()->fill_pool;
 
     SurfaceCollection surfaces;
     
@@ -180,20 +227,15 @@ LayerRegion::make_fill()
         } else if (density <= 0)
             continue;
         
-        // get filler object
-        #if SLIC3R_CPPVER >= 11
-            std::unique_ptr<Fill> f = std::unique_ptr<Fill>(Fill::new_from_type(fill_pattern));
-        #else
-            std::auto_ptr<Fill> f = std::auto_ptr<Fill>(Fill::new_from_type(fill_pattern));
-        #endif
+        // get filler object, reusing the one (and its pattern caches) of a previous layer
+        std::unique_ptr<Fill> f = fill_pool.acquire(this->region(), fill_pattern);
         
         // switch to rectilinear if this pattern doesn't support solid infill
-        if (density > 99 && !f->can_solid())
-            #if SLIC3R_CPPVER >= 11
-                f = std::unique_ptr<Fill>(Fill::new_from_type(ipRectilinear));
-            #else
-                f = std::auto_ptr<Fill>(Fill::new_from_type(ipRectilinear));
-            #endif
+        if (density > 99 && !f->can_solid()) {
+            fill_pool.release(this->region(), fill_pattern, std::move(f));
+            fill_pattern = ipRectilinear;
+            f = fill_pool.acquire(this->region(), fill_pattern);
+        }
         
         f->bounding_box = this->layer()->object()->bounding_box();
         
@@ -253,8 +295,10 @@ LayerRegion::make_fill()
             << " endpoints_overlap: " << f->endpoints_overlap << std::endl << std::endl;
         */
         Polylines polylines = f->fill_surface(surface);
-        if (polylines.empty())
+        if (polylines.empty()) {
+            fill_pool.release(this->region(), fill_pattern, std::move(f));
             continue;
+        }
 
         // calculate actual flow from spacing (which might have been adjusted by the infill
         // pattern generator)
@@ -288,17 +332,8 @@ LayerRegion::make_fill()
             
             coll->append(STDMOVE(polylines), templ);
         }
-    }
-
-    // add thin fill regions
-    // thin_fills are of C++ Slic3r::ExtrusionEntityCollection, perl type Slic3r::ExtrusionPath::Collection
-    // Unpacks the collection, creates multiple collections per path so that they will
-    // be individually included in the nearest neighbor search.
-    // The path type could be ExtrusionPath, ExtrusionLoop or ExtrusionEntityCollection.
-    for (ExtrusionEntitiesPtr::const_iterator thin_fill = this->thin_fills.entities.begin(); thin_fill != this->thin_fills.entities.end(); ++ thin_fill) {
-        ExtrusionEntityCollection* coll = new ExtrusionEntityCollection();
-        this->fills.entities.push_back(coll);
-        coll->append(**thin_fill);
+        
+        fill_pool.release(this->region(), fill_pattern, std::move(f));
     }
 }
 
@@ -0,0 +1,134 @@
+#include "LayerResultCache.hpp"
+#include "GeometryHash.hpp"
+#include <set>
+
+namespace Slic3r {
+
+// Cached results are only reused for exactly the same inputs: as the generators are
+// deterministic, the G-code is then the same whichever layer computed a result first,
+// with or without the caches.
+
+static size_t
+_hash_islands(const ExPolygons &expolygons)
+{
+    size_t hash = expolygons.size();
+    for (const ExPolygon &expolygon : expolygons)
+        hash_geometry(hash, expolygon);
+    return hash;
+}
+
+static size_t
+_hash_surfaces(const Surfaces &surfaces)
+{
+    size_t hash = surfaces.size();
+    for (const Surface &surface : surfaces) {
+        hash_geometry(hash, surface.expolygon);
+        hash_combine(hash, size_t(surface.surface_type));
+        hash_combine(hash, surface.thickness);
+        hash_combine(hash, size_t(surface.thickness_layers));
+        hash_combine(hash, surface.bridge_angle);
+        hash_combine(hash, size_t(surface.extra_perimeters));
+    }
+    return hash;
+}
+
+static bool
+_same(const ExPolygon &a, const ExPolygon &b)
+{
+    return same_geometry(a, b);
+}
+
+static bool
+_same(const Surface &a, const Surface &b)
+{
+    return a.surface_type       == b.surface_type
+        && a.thickness          == b.thickness
+        && a.thickness_layers   == b.thickness_layers
+        && a.bridge_angle       == b.bridge_angle
+        && a.extra_perimeters   == b.extra_perimeters
+        && same_geometry(a.expolygon, b.expolygon);
+}
+
+/// Whether the items are the same, in the same order, which the results depend on.
+template <class T> static bool
+_same(const std::vector<T> &a, const std::vector<T> &b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (!_same(a[i], b[i])) return false;
+    return true;
+}
+
+PerimeterCacheKey::PerimeterCacheKey(const PrintRegion* region, const Surfaces &slices,
+    const ExPolygons &lower_slices, coordf_t layer_height, bool first_layer)
+    : hash(0), region(region), slices(slices), lower_slices(lower_slices),
+        layer_height(layer_height), first_layer(first_layer)
+{
+    hash_combine(this->hash, size_t(region));
+    hash_combine(this->hash, _hash_surfaces(this->slices));
+    hash_combine(this->hash, _hash_islands(this->lower_slices));
+    hash_combine(this->hash, layer_height);
+    hash_combine(this->hash, size_t(first_layer));
+}
+
+bool
+PerimeterCacheKey::operator==(const PerimeterCacheKey &other) const
+{
+    return this->hash           == other.hash
+        && this->region         == other.region
+        && this->layer_height   == other.layer_height
+        && this->first_layer    == other.first_layer
+        && _same(this->slices, other.slices)
+        && _same(this->lower_slices, other.lower_slices);
+}
+
+FillCacheKey::FillCacheKey(const PrintRegion* region, const Surfaces &fill_surfaces, coordf_t layer_height,
+    bool first_layer, float angle, size_t layer_id, coordf_t z)
+    : hash(0), region(region), fill_surfaces(fill_surfaces), layer_height(layer_height),
+        first_layer(first_layer), angle(angle), z(z)
+{
+    // The infill direction alternates with a period of 2 (3 for honeycomb) layers,
+    // counted in units of thickness_layers (combined infill), as Fill::_infill_direction() does.
+    std::set<unsigned short> thickness_layers;
+    for (const Surface &surface : fill_surfaces)
+        thickness_layers.insert(std::max<unsigned short>(surface.thickness_layers, 1));
+    for (unsigned short n : thickness_layers)
+        this->angle_phases.emplace_back(n, (layer_id / n) % 6);
+
+    hash_combine(this->hash, size_t(region));
+    hash_combine(this->hash, _hash_surfaces(this->fill_surfaces));
+    hash_combine(this->hash, layer_height);
+    hash_combine(this->hash, size_t(first_layer));
+    hash_combine(this->hash, double(angle));
+    for (const std::pair<unsigned short, size_t> &phase : this->angle_phases) {
+        hash_combine(this->hash, size_t(phase.first));
+        hash_combine(this->hash, phase.second);
+    }
+    hash_combine(this->hash, z);
+}
+
+bool
+FillCacheKey::operator==(const FillCacheKey &other) const
+{
+    return this->hash           == other.hash
+        && this->region         == other.region
+        && this->layer_height   == other.layer_height
+        && this->first_layer    == other.first_layer
+        && this->angle          == other.angle
+        && this->angle_phases   == other.angle_phases
+        && this->z              == other.z
+        && _same(this->fill_surfaces, other.fill_surfaces);
+}
+
+IslandsCacheKey::IslandsCacheKey(const ExPolygons &islands)
+    : hash(_hash_islands(islands)), islands(islands)
+{}
+
+bool
+IslandsCacheKey::operator==(const IslandsCacheKey &other) const
+{
+    return this->hash == other.hash
+        && _same(this->islands, other.islands);
+}
+
+}
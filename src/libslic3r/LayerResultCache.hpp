@@ -0,0 +1,155 @@
+#ifndef slic3r_LayerResultCache_hpp_
+#define slic3r_LayerResultCache_hpp_
+
+#include "libslic3r.h"
+#include "ExPolygon.hpp"
+#include "ExtrusionEntityCollection.hpp"
+#include "Surface.hpp"
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <boost/thread.hpp>
+
+namespace Slic3r {
+
+class PrintRegion;
+
+/// Thread-safe LRU map used to memoize per-layer results.
+/// Key must provide a `size_t hash` member and an operator== deciding whether
+/// a cached value can be reused, so that a hash collision never returns a wrong result.
+template <class Key, class Value>
+class ResultCache
+{
+    public:
+    struct Stats {
+        size_t hits     {0};
+        size_t misses   {0};
+        double hit_rate() const { return (hits + misses) == 0 ? 0. : double(hits) / double(hits + misses); }
+    };
+
+    explicit ResultCache(size_t max_entries = 64) : _max_entries(max_entries) {};
+
+    /// Copies the value stored for key into value and returns true, if any.
+    bool find(const Key &key, Value* value) {
+        boost::lock_guard<boost::mutex> l(this->_mutex);
+        auto range = this->_index.equal_range(key.hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (!(it->second->first == key)) continue;
+            // move to front (most recently used)
+            this->_entries.splice(this->_entries.begin(), this->_entries, it->second);
+            *value = it->second->second;
+            ++this->_stats.hits;
+            return true;
+        }
+        ++this->_stats.misses;
+        return false;
+    };
+
+    void insert(Key &&key, Value &&value) {
+        boost::lock_guard<boost::mutex> l(this->_mutex);
+        if (this->_max_entries == 0) return;
+
+        // evict the least recently used entries
+        while (this->_entries.size() >= this->_max_entries) {
+            typename Entries::iterator last = std::prev(this->_entries.end());
+            auto range = this->_index.equal_range(last->first.hash);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == last) {
+                    this->_index.erase(it);
+                    break;
+                }
+            }
+            this->_entries.erase(last);
+        }
+
+        this->_entries.emplace_front(std::move(key), std::move(value));
+        this->_index.emplace(this->_entries.front().first.hash, this->_entries.begin());
+    };
+
+    /// Drops all the entries and resets the statistics.
+    void clear() {
+        boost::lock_guard<boost::mutex> l(this->_mutex);
+        this->_index.clear();
+        this->_entries.clear();
+        this->_stats = Stats();
+    };
+
+    Stats stats() const {
+        boost::lock_guard<boost::mutex> l(this->_mutex);
+        return this->_stats;
+    };
+
+    private:
+    typedef std::list< std::pair<Key,Value> > Entries;
+    size_t _max_entries;
+    /// Most recently used entries are kept at the front.
+    Entries _entries;
+    std::unordered_multimap<size_t, typename Entries::iterator> _index;
+    Stats _stats;
+    mutable boost::mutex _mutex;
+};
+
+/// Everything LayerRegion::make_perimeters() depends on besides the
+/// (per object constant) configuration of its region.
+struct PerimeterCacheKey
+{
+    size_t              hash;
+    const PrintRegion*  region;
+    Surfaces            slices;
+    /// Only populated when overhang detection needs the lower layer.
+    ExPolygons          lower_slices;
+    coordf_t            layer_height;
+    bool                first_layer;
+
+    PerimeterCacheKey(const PrintRegion* region, const Surfaces &slices, const ExPolygons &lower_slices,
+        coordf_t layer_height, bool first_layer);
+    bool operator==(const PerimeterCacheKey &other) const;
+};
+
+/// Output of LayerRegion::make_perimeters().
+/// Toolpaths are planar, so they can be reused at any Z as long as the layer height matches.
+struct PerimeterCacheValue
+{
+    ExtrusionEntityCollection   perimeters;
+    ExtrusionEntityCollection   thin_fills;
+    Surfaces                    fill_surfaces;
+};
+
+/// Everything the infill generated by LayerRegion::make_fill() depends on besides the
+/// (per object constant) configuration of its region.
+struct FillCacheKey
+{
+    size_t              hash;
+    const PrintRegion*  region;
+    Surfaces            fill_surfaces;
+    coordf_t            layer_height;
+    bool                first_layer;
+    /// Base infill direction, in radians.
+    float               angle;
+    /// Alternation phase of the infill direction for each distinct thickness_layers
+    /// (number of combined layers, 1 without combined infill), as (thickness_layers, phase).
+    std::vector<std::pair<unsigned short, size_t>> angle_phases;
+    /// Print Z for patterns depending on it, 0 otherwise.
+    coordf_t            z;
+
+    FillCacheKey(const PrintRegion* region, const Surfaces &fill_surfaces, coordf_t layer_height,
+        bool first_layer, float angle, size_t layer_id, coordf_t z);
+    bool operator==(const FillCacheKey &other) const;
+};
+
+/// Islands of a layer, matched exactly as the keys above.
+struct IslandsCacheKey
+{
+    size_t              hash;
+    ExPolygons          islands;
+
+    IslandsCacheKey(const ExPolygons &islands);
+    bool operator==(const IslandsCacheKey &other) const;
+};
+
+typedef ResultCache<PerimeterCacheKey, PerimeterCacheValue> PerimeterResultCache;
+typedef ResultCache<FillCacheKey, ExtrusionEntityCollection> FillResultCache;
+
+}
+
+#endif
@@ -0,0 +1,110 @@
+#include "MedialAxisCache.hpp"
+#include "GeometryHash.hpp"
+#include <chrono>
+
+namespace Slic3r {
+
+size_t
+MedialAxisCache::_hash(const ExPolygon &expolygon, const ExPolygon &bounds,
+    double max_width, double min_width)
+{
+    size_t seed = 0;
+    hash_geometry(seed, expolygon);
+    hash_geometry(seed, bounds);
+    hash_combine(seed, max_width);
+    hash_combine(seed, min_width);
+    return seed;
+}
+
+void
+MedialAxisCache::medial_axis(const ExPolygon &expolygon, const ExPolygon &bounds,
+    double max_width, double min_width, ThickPolylines* polylines)
+{
+    const size_t hash = _hash(expolygon, bounds, max_width, min_width);
+    if (this->_lookup(hash, expolygon, bounds, max_width, min_width, polylines))
+        return;
+
+    // Build the skeleton outside the lock so that other threads keep working.
+    Entry entry { hash, expolygon, bounds, max_width, min_width, ThickPolylines(), 0 };
+    const auto start = std::chrono::steady_clock::now();
+    expolygon.medial_axis(bounds, max_width, min_width, &entry.result);
+    entry.compute_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    polylines->insert(polylines->end(), entry.result.begin(), entry.result.end());
+    this->_store(std::move(entry));
+}
+
+bool
+MedialAxisCache::_lookup(size_t hash, const ExPolygon &expolygon, const ExPolygon &bounds,
+    double max_width, double min_width, ThickPolylines* polylines)
+{
+    boost::lock_guard<boost::mutex> l(this->_mutex);
+
+    auto range = this->_index.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        Entry &entry = *it->second;
+        if (entry.max_width != max_width || entry.min_width != min_width
+            || !same_geometry(entry.expolygon, expolygon)
+            || !same_geometry(entry.bounds, bounds))
+            continue;
+
+        // move to front (most recently used)
+        this->_entries.splice(this->_entries.begin(), this->_entries, it->second);
+        polylines->insert(polylines->end(), entry.result.begin(), entry.result.end());
+        ++this->_stats.hits;
+        this->_stats.saved_time += entry.compute_time;
+        return true;
+    }
+    ++this->_stats.misses;
+    return false;
+}
+
+void
+MedialAxisCache::_store(Entry &&entry)
+{
+    boost::lock_guard<boost::mutex> l(this->_mutex);
+
+    this->_stats.compute_time += entry.compute_time;
+    if (this->_max_entries == 0) return;
+
+    // evict the least recently used entries
+    while (this->_entries.size() >= this->_max_entries) {
+        Entries::iterator last = std::prev(this->_entries.end());
+        auto range = this->_index.equal_range(last->hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == last) {
+                this->_index.erase(it);
+                break;
+            }
+        }
+        this->_entries.erase(last);
+    }
+
+    this->_entries.push_front(std::move(entry));
+    this->_index.emplace(this->_entries.front().hash, this->_entries.begin());
+}
+
+void
+MedialAxisCache::clear()
+{
+    boost::lock_guard<boost::mutex> l(this->_mutex);
+    this->_index.clear();
+    this->_entries.clear();
+    this->_stats = Stats();
+}
+
+MedialAxisCache::Stats
+MedialAxisCache::stats() const
+{
+    boost::lock_guard<boost::mutex> l(this->_mutex);
+    return this->_stats;
+}
+
+size_t
+MedialAxisCache::size() const
+{
+    boost::lock_guard<boost::mutex> l(this->_mutex);
+    return this->_entries.size();
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef slic3r_MedialAxisCache_hpp_
+#define slic3r_MedialAxisCache_hpp_
+
+#include "libslic3r.h"
+#include "ExPolygon.hpp"
+#include "Polyline.hpp"
+#include <list>
+#include <unordered_map>
+#include <boost/thread.hpp>
+
+namespace Slic3r {
+
+/// Memoizes ExPolygon::medial_axis() results.
+/// Prismatic objects produce the very same thin wall and gap fill regions
+/// layer after layer, so the Voronoi skeleton of an identical
+/// (expolygon, bounds, max_width, min_width) tuple is computed once and reused.
+/// Entries are keyed by a hash of the input geometry and compared exactly on lookup,
+/// so a hash collision can never return a wrong skeleton.
+/// All methods are thread-safe.
+class MedialAxisCache
+{
+    public:
+    /// Cache statistics, reported after each perimeter pass.
+    struct Stats {
+        size_t hits     {0};
+        size_t misses   {0};
+        double compute_time {0};   ///< seconds spent building skeletons on misses
+        double saved_time   {0};   ///< seconds of skeleton building avoided by hits
+        double hit_rate() const { return (hits + misses) == 0 ? 0. : double(hits) / double(hits + misses); }
+    };
+
+    /// \param max_entries Maximum number of skeletons kept; least recently used ones are evicted.
+    explicit MedialAxisCache(size_t max_entries = 4096) : _max_entries(max_entries) {};
+
+    /// Appends the medial axis of expolygon (clipped to bounds) to polylines,
+    /// computing it only if no identical input was seen before.
+    void medial_axis(const ExPolygon &expolygon, const ExPolygon &bounds,
+        double max_width, double min_width, ThickPolylines* polylines);
+
+    /// Drops all the cached skeletons and resets the statistics.
+    void clear();
+
+    Stats stats() const;
+    size_t size() const;
+
+    private:
+    struct Entry {
+        size_t      hash;
+        ExPolygon   expolygon;
+        ExPolygon   bounds;
+        double      max_width;
+        double      min_width;
+        ThickPolylines  result;
+        double      compute_time;   ///< seconds it took to build this entry
+    };
+    typedef std::list<Entry> Entries;
+
+    size_t _max_entries;
+    /// Most recently used entries are kept at the front.
+    Entries _entries;
+    std::unordered_multimap<size_t, Entries::iterator> _index;
+    Stats _stats;
+    mutable boost::mutex _mutex;
+
+    static size_t _hash(const ExPolygon &expolygon, const ExPolygon &bounds,
+        double max_width, double min_width);
+    bool _lookup(size_t hash, const ExPolygon &expolygon, const ExPolygon &bounds,
+        double max_width, double min_width, ThickPolylines* polylines);
+    void _store(Entry &&entry);
+};
+
+}
+
+#endif
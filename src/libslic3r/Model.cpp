@@ -502,6 +502,15 @@ ModelObject::add_volume(const TriangleMesh &mesh)
     return v;
 }
 
+ModelVolume*
+ModelObject::add_volume(TriangleMesh &&mesh)
+{
+    ModelVolume* v = new ModelVolume(this, std::move(mesh));
+    this->volumes.push_back(v);
+    this->invalidate_bounding_box();
+    return v;
+}
+
 ModelVolume*
 ModelObject::add_volume(const ModelVolume &other)
 {
@@ -599,7 +608,7 @@ void
 ModelObject::repair()
 {
     for (ModelVolumePtrs::const_iterator v = this->volumes.begin(); v != this->volumes.end(); ++v)
-        (*v)->mesh.repair();
+        if (!(*v)->untransformed_mesh().repaired) (*v)->mutable_mesh().repair();
 }
 
 Pointf3 
@@ -630,7 +639,7 @@ ModelObject::raw_mesh() const
     TriangleMesh mesh;
     for (ModelVolumePtrs::const_iterator v = this->volumes.begin(); v != this->volumes.end(); ++v) {
         if ((*v)->modifier) continue;
-        mesh.merge((*v)->mesh);
+        mesh.merge((*v)->mesh());
     }
     return mesh;
 }
@@ -903,7 +912,7 @@ ModelObject::facets_count() const
     size_t num = 0;
     for (ModelVolumePtrs::const_iterator v = this->volumes.begin(); v != this->volumes.end(); ++v) {
         if ((*v)->modifier) continue;
-        num += (*v)->mesh.stl.stats.number_of_facets;
+        num += (*v)->facets_count();
     }
     return num;
 }
@@ -913,7 +922,7 @@ ModelObject::needed_repair() const
 {
     for (ModelVolumePtrs::const_iterator v = this->volumes.begin(); v != this->volumes.end(); ++v) {
         if ((*v)->modifier) continue;
-        if ((*v)->mesh.needed_repair()) return true;
+        if ((*v)->untransformed_mesh().needed_repair()) return true;
     }
     return false;
 }
@@ -947,11 +956,11 @@ ModelObject::cut(Axis axis, coordf_t z, Model* model) const
             TriangleMesh upper_mesh, lower_mesh;
             
             if (axis == X) {
-                TriangleMeshSlicer<X>(&volume->mesh).cut(z, &upper_mesh, &lower_mesh);
+                TriangleMeshSlicer<X>(&volume->mutable_mesh()).cut(z, &upper_mesh, &lower_mesh);
             } else if (axis == Y) {
-                TriangleMeshSlicer<Y>(&volume->mesh).cut(z, &upper_mesh, &lower_mesh);
+                TriangleMeshSlicer<Y>(&volume->mutable_mesh()).cut(z, &upper_mesh, &lower_mesh);
             } else if (axis == Z) {
-                TriangleMeshSlicer<Z>(&volume->mesh).cut(z, &upper_mesh, &lower_mesh);
+                TriangleMeshSlicer<Z>(&volume->mutable_mesh()).cut(z, &upper_mesh, &lower_mesh);
             }
             
             upper_mesh.repair();
@@ -986,7 +995,7 @@ ModelObject::split(ModelObjectPtrs* new_objects)
     }
     
     ModelVolume* volume = this->volumes.front();
-    TriangleMeshPtrs meshptrs = volume->mesh.split();
+    TriangleMeshPtrs meshptrs = volume->mesh().split();
     for (TriangleMeshPtrs::iterator mesh = meshptrs.begin(); mesh != meshptrs.end(); ++mesh) {
         (*mesh)->repair();
         
@@ -1051,19 +1060,27 @@ ModelObject::print_info() const
 
 
 ModelVolume::ModelVolume(ModelObject* object, const TriangleMesh &mesh)
-:   mesh(mesh), input_file(""), modifier(false), object(object)
-{}
+:   input_file(""), modifier(false), object(object), _mesh(std::make_shared<_SharedMesh>())
+{
+    this->_mesh->facets = std::make_shared<TriangleMesh>(mesh);
+}
+
+ModelVolume::ModelVolume(ModelObject* object, TriangleMesh &&mesh)
+:   input_file(""), modifier(false), object(object), _mesh(std::make_shared<_SharedMesh>())
+{
+    this->_mesh->facets = std::make_shared<TriangleMesh>(std::move(mesh));
+}
 
 ModelVolume::ModelVolume(ModelObject* object, const ModelVolume &other)
 :   name(other.name),
-    mesh(other.mesh),
     trafo(other.trafo),
     config(other.config),
     input_file(other.input_file),
     input_file_obj_idx(other.input_file_obj_idx),
     input_file_vol_idx(other.input_file_vol_idx),
     modifier(other.modifier),
-    object(object)
+    object(object),
+    _mesh(other._mesh)
 {
     this->material_id(other.material_id());
 }
@@ -1078,7 +1095,7 @@ void
 ModelVolume::swap(ModelVolume &other)
 {
     std::swap(this->name,       other.name);
-    std::swap(this->mesh,       other.mesh);
+    std::swap(this->_mesh,      other._mesh);
     std::swap(this->trafo,      other.trafo);
     std::swap(this->config,     other.config);
     std::swap(this->modifier,   other.modifier);
@@ -1088,22 +1105,80 @@ ModelVolume::swap(ModelVolume &other)
 	std::swap(this->input_file_vol_idx,    other.input_file_vol_idx);
 }
 
+TriangleMesh
+ModelVolume::mesh() const
+{
+    const _SharedMesh &shared = *this->_mesh;
+    TriangleMesh mesh(*shared.facets);
+    if (shared.transformed) mesh.transform(shared.trafo);
+    return mesh;
+}
+
+const TriangleMesh&
+ModelVolume::untransformed_mesh() const
+{
+    return *this->_mesh->facets;
+}
+
+TriangleMesh&
+ModelVolume::mutable_mesh()
+{
+    if (this->_mesh.use_count() > 1 || this->_mesh->transformed || this->_mesh->facets.use_count() > 1) {
+        std::shared_ptr<_SharedMesh> shared = std::make_shared<_SharedMesh>();
+        shared->facets = std::make_shared<TriangleMesh>(this->mesh());
+        this->_mesh = shared;
+    } else {
+        // the caller may change the facets in place
+        this->_mesh->id = _SharedMesh::next_id();
+    }
+    return *this->_mesh->facets;
+}
+
+size_t
+ModelVolume::facets_count() const
+{
+    return this->_mesh->facets->facets_count();
+}
+
 TriangleMesh
 ModelVolume::get_transformed_mesh(TransformationMatrix const & trafo) const
 {
-    return this->mesh.get_transformed_mesh(trafo);
+    const _SharedMesh &shared = *this->_mesh;
+    if (!shared.transformed) return shared.facets->get_transformed_mesh(trafo);
+    return shared.facets->get_transformed_mesh(trafo.multiplyRight(shared.trafo));
 }
 
 BoundingBoxf3
 ModelVolume::get_transformed_bounding_box(TransformationMatrix const & trafo) const
 {
-    return this->mesh.get_transformed_bounding_box(trafo);
+    const _SharedMesh &shared = *this->_mesh;
+    if (!shared.transformed) return shared.facets->get_transformed_bounding_box(trafo);
+    return shared.facets->get_transformed_bounding_box(trafo.multiplyRight(shared.trafo));
 }
 
 BoundingBoxf3
 ModelVolume::bounding_box() const
 {
-    return this->mesh.bounding_box();
+    _SharedMesh &shared = *this->_mesh;
+    if (!shared.transformed) return shared.facets->bounding_box();
+    boost::lock_guard<boost::mutex> lock(shared.mutex);
+    // same arithmetic as the transformation of the facets in mesh()
+    if (!shared.bbox.defined)
+        shared.bbox = shared.facets->get_transformed_bounding_box(shared.trafo);
+    return shared.bbox;
+}
+
+Polygon
+ModelVolume::convex_hull() const
+{
+    const TriangleMesh mesh = this->mesh();
+    const stl_file &stl = mesh.stl;
+    Points pp;
+    pp.reserve(3 * stl.stats.number_of_facets);
+    for (int i = 0; i < stl.stats.number_of_facets; ++i)
+        for (int j = 0; j < 3; ++j)
+            pp.push_back(Point(stl.facet_start[i].vertex[j].x / SCALING_FACTOR, stl.facet_start[i].vertex[j].y / SCALING_FACTOR));
+    return Slic3r::Geometry::convex_hull(pp);
 }
 
 void ModelVolume::translate(double x, double y, double z)
@@ -1138,7 +1213,12 @@ void ModelVolume::rotate(double angle_rad, const Axis &axis)
 
 void ModelVolume::apply_transformation(TransformationMatrix const & trafo)
 {
-    this->mesh.transform(trafo);
+    // record the transformation in a new state, as the current one may be shared with copies
+    std::shared_ptr<_SharedMesh> shared = std::make_shared<_SharedMesh>();
+    shared->facets = this->_mesh->facets;
+    shared->transformed = true;
+    shared->trafo = this->_mesh->transformed ? this->_mesh->trafo.multiplyLeft(trafo) : trafo;
+    this->_mesh = shared;
     this->trafo.applyLeft(trafo);
 }
 
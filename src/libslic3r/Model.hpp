@@ -9,7 +9,10 @@
 #include "TriangleMesh.hpp"
 #include "TransformationMatrix.hpp"
 #include "LayerHeightSpline.hpp"
+#include <atomic>
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -295,6 +298,11 @@ class ModelObject
     /// \return ModelVolume* pointer to the new volume
     ModelVolume* add_volume(const TriangleMesh &mesh);
 
+    /// Add a new ModelVolume to the current ModelObject, taking over the facets of the mesh.
+    /// \param mesh TriangularMesh
+    /// \return ModelVolume* pointer to the new volume
+    ModelVolume* add_volume(TriangleMesh &&mesh);
+
     /// Add a new ModelVolume to the current ModelObject.
     /// \param volume the ModelVolume object to be copied
     /// \return ModelVolume* pointer to the new volume
@@ -499,7 +507,6 @@ class ModelVolume
     public:
 
     std::string name;   ///< Name of this ModelVolume object
-    TriangleMesh mesh;  ///< The triangular model
 
     TransformationMatrix trafo; 
     ///< The transformation matrix of this volume, representing which transformation has been
@@ -520,6 +527,28 @@ class ModelVolume
     /// \return ModelObject* pointer to the owner ModelObject
     ModelObject* get_object() const { return this->object; };
 
+    /// The triangular model, with all the transformations applied to this volume.
+    /// Copies of a volume share their facets until one of them is changed, and transformations
+    /// are only recorded: each call builds the transformed mesh, which nothing keeps afterwards.
+    /// \return TriangleMesh the transformed mesh
+    TriangleMesh mesh() const;
+
+    /// The shared facets, without the transformations recorded since they were last modified,
+    /// for the properties these don't change (repair state and statistics).
+    /// \return TriangleMesh& valid until the volume is modified through mutable_mesh()
+    const TriangleMesh& untransformed_mesh() const;
+
+    /// The triangular model for modification, detached from the copies of this volume.
+    /// \return TriangleMesh& valid until the volume is transformed
+    TriangleMesh& mutable_mesh();
+
+    /// Number of facets, without applying pending transformations.
+    size_t facets_count() const;
+
+    /// Identifies the mesh with its transformations: it changes when the volume is
+    /// transformed or mutable_mesh() is called, and is shared by unchanged copies.
+    uint64_t mesh_id() const { return this->_mesh->id; };
+
     /// Get the ModelVolume's mesh, transformed by the argument's TransformationMatrix
     /// \param trafo
     /// \return TriangleMesh the transformed mesh
@@ -528,6 +557,10 @@ class ModelVolume
     BoundingBoxf3 get_transformed_bounding_box(TransformationMatrix const & trafo) const;
     BoundingBoxf3 bounding_box() const;
 
+    /// Convex hull of the XY projection of the mesh, leaving the shared facets untouched.
+    /// \return Polygon the convex hull
+    Polygon convex_hull() const;
+
     //Transformation matrix manipulators
     
     /// performs translation
@@ -583,11 +616,34 @@ class ModelVolume
     ///< The id of the this ModelVolume
     t_model_material_id _material_id;
 
+    /// Facets shared by copies of a volume, which are never modified in place,
+    /// and the transformation still to be applied to them.
+    struct _SharedMesh {
+        uint64_t id {_SharedMesh::next_id()};
+        std::shared_ptr<TriangleMesh> facets;
+        bool transformed {false};
+        TransformationMatrix trafo;
+        /// bounding box of the transformed facets, computed by the first call to bounding_box()
+        BoundingBoxf3 bbox;
+        boost::mutex mutex;
+        /// ids are never reused, unlike the addresses of the states
+        static uint64_t next_id() {
+            static std::atomic<uint64_t> last {0};
+            return ++last;
+        };
+    };
+    std::shared_ptr<_SharedMesh> _mesh;
+
     /// Constructor
     /// \param object ModelObject* pointer to the owner ModelObject
     /// \param mesh TriangleMesh the mesh of the new ModelVolume object
     ModelVolume(ModelObject *object, const TriangleMesh &mesh);
 
+    /// Constructor
+    /// \param object ModelObject* pointer to the owner ModelObject
+    /// \param mesh TriangleMesh the mesh of the new ModelVolume object, moved into it
+    ModelVolume(ModelObject *object, TriangleMesh &&mesh);
+
     /// Constructor
     /// \param object ModelObject* pointer to the owner ModelObject
     /// \param other ModelVolume the ModelVolume object to be copied
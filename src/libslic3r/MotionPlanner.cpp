@@ -1,6 +1,9 @@
 #include "BoundingBox.hpp"
 #include "MotionPlanner.hpp"
+#include <algorithm>
+#include <functional>
 #include <limits> // for numeric_limits
+#include <queue>
 #include <assert.h>
 
 #include "boost/polygon/voronoi.hpp"
@@ -45,6 +48,7 @@ MotionPlanner::initialize()
         // we'll use these inner rings for motion planning (endpoints of the Voronoi-based
         // graph, visibility check) in order to avoid moving too close to the boundaries
         island.env = offset_ex(island.island, -MP_INNER_MARGIN);
+        island.grown_env = offset_ex((Polygons)island.env, +SCALED_EPSILON);
         
         // island contours are holes of our external environment
         outer_holes.push_back(island.island.contour);
@@ -65,6 +69,7 @@ MotionPlanner::initialize()
     this->outer.island = outer.front();
     
     this->outer.env = ExPolygonCollection(diff_ex(contour, offset(outer_holes, +MP_OUTER_MARGIN)));
+    this->outer.grown_env = offset_ex((Polygons)this->outer.env, +SCALED_EPSILON);
     
     this->graphs.resize(this->islands.size() + 1, NULL);
     this->initialized = true;
@@ -105,7 +110,7 @@ MotionPlanner::shortest_path(const Point &from, const Point &to)
     this->initialize();
     
     // get environment
-    MotionPlannerEnv env = this->get_env(island_idx);
+    const MotionPlannerEnv &env = this->get_env(island_idx);
     if (env.env.expolygons.empty()) {
         // if this environment is empty (probably because it's too small), perform straight move
         // and avoid running the algorithms on empty dataset
@@ -140,9 +145,9 @@ MotionPlanner::shortest_path(const Point &from, const Point &to)
     polyline.points.push_back(to);
     
     {
-        // grow our environment slightly in order for simplify_by_visibility()
+        // our environment grown slightly in order for simplify_by_visibility()
         // to work best by considering moves on boundaries valid as well
-        ExPolygonCollection grown_env(offset_ex((Polygons)env.env, +SCALED_EPSILON));
+        const ExPolygonCollection &grown_env = env.grown_env;
         
         if (island_idx == -1) {
             /*  If 'from' or 'to' are not inside our env, they were connected using the 
@@ -218,7 +223,7 @@ MotionPlanner::init_graph(int island_idx)
         t_vd_vertices vd_vertices;
         
         // get boundaries as lines
-        MotionPlannerEnv env = this->get_env(island_idx);
+        const MotionPlannerEnv &env = this->get_env(island_idx);
         Lines lines = env.env.lines();
         boost::polygon::construct_voronoi(lines.begin(), lines.end(), &vd);
         
@@ -256,6 +261,7 @@ MotionPlanner::init_graph(int island_idx)
             double dist = graph->nodes[v0_idx].distance_to(graph->nodes[v1_idx]);
             graph->add_edge(v0_idx, v1_idx, dist);
         }
+        graph->index_nodes();
         
         return graph;
     }
@@ -326,17 +332,81 @@ MotionPlannerGraph::add_edge(node_t from, node_t to, double weight)
     this->adjacency_list[from].push_back(neighbor(to, weight));
 }
 
+void
+MotionPlannerGraph::index_nodes()
+{
+    // every node gets an adjacency list, even without outgoing edges
+    this->adjacency_list.resize(std::max(this->adjacency_list.size(), this->nodes.size()));
+    
+    this->_tree.resize(this->nodes.size());
+    for (size_t i = 0; i < this->_tree.size(); ++i)
+        this->_tree[i] = i;
+    this->_build_tree(0, this->_tree.size(), true);
+}
+
+void
+MotionPlannerGraph::_build_tree(size_t begin, size_t end, bool split_x)
+{
+    if (end - begin < 2) return;
+    
+    const size_t mid = (begin + end) / 2;
+    std::nth_element(this->_tree.begin() + begin, this->_tree.begin() + mid, this->_tree.begin() + end,
+        [this, split_x](node_t a, node_t b) {
+            return split_x ? this->nodes[a].x < this->nodes[b].x : this->nodes[a].y < this->nodes[b].y;
+        });
+    this->_build_tree(begin, mid, !split_x);
+    this->_build_tree(mid + 1, end, !split_x);
+}
+
+void
+MotionPlannerGraph::_nearest_node(const Point &point, size_t begin, size_t end, bool split_x,
+    node_t* best, double* best_distance) const
+{
+    if (begin >= end) return;
+    
+    const size_t mid = (begin + end) / 2;
+    const node_t node = this->_tree[mid];
+    const double dx = double(point.x) - double(this->nodes[node].x);
+    const double dy = double(point.y) - double(this->nodes[node].y);
+    const double distance = dx*dx + dy*dy;
+    
+    // break ties like Point::nearest_point_index() does on the nodes vector:
+    // the first coinciding node, otherwise the last of the nearest ones
+    if (*best == -1 || distance < *best_distance
+        || (distance == *best_distance && (distance < EPSILON ? node < *best : node > *best))) {
+        *best = node;
+        *best_distance = distance;
+    }
+    
+    // visit the side of the split containing point first, and the other one
+    // only if it may hold a node as close as the best one found so far
+    const double delta = split_x ? dx : dy;
+    if (delta < 0) {
+        this->_nearest_node(point, begin, mid, !split_x, best, best_distance);
+        if (delta*delta <= *best_distance)
+            this->_nearest_node(point, mid + 1, end, !split_x, best, best_distance);
+    } else {
+        this->_nearest_node(point, mid + 1, end, !split_x, best, best_distance);
+        if (delta*delta <= *best_distance)
+            this->_nearest_node(point, begin, mid, !split_x, best, best_distance);
+    }
+}
+
 size_t
 MotionPlannerGraph::find_node(const Point &point) const
 {
-    /*
-    for (Points::const_iterator p = this->nodes.begin(); p != this->nodes.end(); ++p) {
-        if (p->coincides_with(point)) return p - this->nodes.begin();
-    }
-    */
-    return point.nearest_point_index(this->nodes);
+    if (this->_tree.size() != this->nodes.size())
+        return point.nearest_point_index(this->nodes);
+    
+    node_t best = -1;
+    double best_distance = 0;
+    this->_nearest_node(point, 0, this->_tree.size(), true, &best, &best_distance);
+    return best;
 }
 
+/// A* search; edge weights are Euclidean distances between nodes, so the straight
+/// distance to the target never overestimates the remaining length and the first
+/// time the target is popped its distance is the shortest one.
 Polyline
 MotionPlannerGraph::shortest_path(node_t from, node_t to)
 {
@@ -345,63 +415,43 @@ MotionPlannerGraph::shortest_path(node_t from, node_t to)
     
     const weight_t max_weight = std::numeric_limits<weight_t>::infinity();
     
-    std::vector<weight_t> dist;
-    std::vector<node_t> previous;
-    {
-        // number of nodes
-        const int n = this->adjacency_list.size();
-        
-        // initialize dist and previous
-        dist.clear();
-        dist.resize(n, max_weight);
-        dist[from] = 0;  // distance from 'from' to itself
-        previous.clear();
-        previous.resize(n, -1);
+    // number of nodes
+    const size_t n = this->adjacency_list.size();
+    
+    std::vector<weight_t> dist(n, max_weight);
+    std::vector<node_t> previous(n, -1);
+    std::vector<bool> visited(n, false);
+    dist[from] = 0;  // distance from 'from' to itself
+    
+    // nodes to visit, ordered by the estimated length of the path through them
+    typedef std::pair<weight_t, node_t> queued_node;
+    std::priority_queue< queued_node, std::vector<queued_node>, std::greater<queued_node> > queue;
+    queue.push(queued_node(this->nodes[from].distance_to(this->nodes[to]), from));
+    
+    while (!queue.empty()) {
+        const node_t u = queue.top().second;
+        queue.pop();
+        if (visited[u]) continue;  // stale entry of a node reached again by a shorter path
+        visited[u] = true;
         
-        // initialize the Q with all nodes
-        std::set<node_t> Q;
-        for (node_t i = 0; i < n; ++i) Q.insert(i);
+        // stop searching if we reached our destination
+        if (u == to) break;
         
-        while (!Q.empty()) 
-        {
-            // get node in Q having the minimum dist ('from' in the first loop)
-            node_t u;
-            {
-                double min_dist = -1;
-                for (std::set<node_t>::const_iterator n = Q.begin(); n != Q.end(); ++n) {
-                    if (dist[*n] < min_dist || min_dist == -1) {
-                        u = *n;
-                        min_dist = dist[*n];
-                    }
-                }
-            }
-            Q.erase(u);
+        // Visit each edge starting from node u
+        for (const neighbor &edge : this->adjacency_list[u]) {
+            // neighbor node is v
+            const node_t v = edge.target;
             
-            // stop searching if we reached our destination
-            if (u == to) break;
+            // skip if we already visited this
+            if (visited[v]) continue;
             
-            // Visit each edge starting from node u
-            const std::vector<neighbor> &neighbors = this->adjacency_list[u];
-            for (std::vector<neighbor>::const_iterator neighbor_iter = neighbors.begin();
-                 neighbor_iter != neighbors.end();
-                 ++neighbor_iter)
-            {
-                // neighbor node is v
-                node_t v = neighbor_iter->target;
-                
-                // skip if we already visited this
-                if (Q.find(v) == Q.end()) continue;
-                
-                // calculate total distance
-                weight_t alt = dist[u] + neighbor_iter->weight;
-                
-                // if total distance through u is shorter than the previous
-                // distance (if any) between 'from' and 'v', replace it
-                if (alt < dist[v]) {
-                    dist[v]     = alt;
-                    previous[v] = u;
-                }
-
+            // if total distance through u is shorter than the previous
+            // distance (if any) between 'from' and 'v', replace it
+            const weight_t alt = dist[u] + edge.weight;
+            if (alt < dist[v]) {
+                dist[v]     = alt;
+                previous[v] = u;
+                queue.push(queued_node(alt + this->nodes[v].distance_to(this->nodes[to]), v));
             }
         }
     }
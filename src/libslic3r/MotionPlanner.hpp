@@ -23,6 +23,8 @@ class MotionPlannerEnv
     public:
     ExPolygon island;
     ExPolygonCollection env;
+    /// env grown by SCALED_EPSILON, so that moves on its boundaries are considered valid.
+    ExPolygonCollection grown_env;
     MotionPlannerEnv() {};
     MotionPlannerEnv(const ExPolygon &island) : island(island) {};
     Point nearest_env_point(const Point &from, const Point &to) const;
@@ -43,11 +45,20 @@ class MotionPlannerGraph
     };
     typedef std::vector< std::vector<neighbor> > adjacency_list_t;
     adjacency_list_t adjacency_list;
+    /// Node indices arranged as an implicit balanced 2D tree: the median of each
+    /// range splits it along x and y alternately.
+    std::vector<node_t> _tree;
+    
+    void _build_tree(size_t begin, size_t end, bool split_x);
+    void _nearest_node(const Point &point, size_t begin, size_t end, bool split_x,
+        node_t* best, double* best_distance) const;
     
     public:
     Points nodes;
     //std::map<std::pair<size_t,size_t>, double> edges;
     void add_edge(node_t from, node_t to, double weight);
+    /// Builds the spatial index used by find_node(); to be called once all the nodes are added.
+    void index_nodes();
     size_t find_node(const Point &point) const;
     Polyline shortest_path(node_t from, node_t to);
 };
@@ -121,7 +121,7 @@ PerimeterGenerator::process()
                             for (ExPolygon &bound : bounds) {
                                 if (!intersection_ex(*ex, bound).empty()) {
                                     // the maximum thickness of our thin wall area is equal to the minimum thickness of a single loop
-                                    ex->medial_axis(bound, ext_pwidth + ext_pspacing2, min_width, &thin_walls);
+                                    this->_medial_axis(*ex, bound, ext_pwidth + ext_pspacing2, min_width, &thin_walls);
                                     continue;
                                 }
                             }
@@ -293,7 +293,7 @@ PerimeterGenerator::process()
             
             ThickPolylines polylines;
             for (ExPolygons::const_iterator ex = gaps_ex.begin(); ex != gaps_ex.end(); ++ex)
-                ex->medial_axis(*ex, max, min, &polylines);
+                this->_medial_axis(*ex, *ex, max, min, &polylines);
             
             if (!polylines.empty()) {
                 ExtrusionEntityCollection gap_fill = this->_variable_width(polylines, 
@@ -348,6 +348,17 @@ PerimeterGenerator::process()
     }
 }
 
+void
+PerimeterGenerator::_medial_axis(const ExPolygon &expolygon, const ExPolygon &bounds,
+    double max_width, double min_width, ThickPolylines* polylines) const
+{
+    if (this->medial_axis_cache != NULL) {
+        this->medial_axis_cache->medial_axis(expolygon, bounds, max_width, min_width, polylines);
+    } else {
+        expolygon.medial_axis(bounds, max_width, min_width, polylines);
+    }
+}
+
 ExtrusionEntityCollection
 PerimeterGenerator::_traverse_loops(const PerimeterGeneratorLoops &loops,
     ThickPolylines &thin_walls) const
@@ -8,6 +8,7 @@
 #include "Polygon.hpp"
 #include "PrintConfig.hpp"
 #include "SurfaceCollection.hpp"
+#include "MedialAxisCache.hpp"
 
 namespace Slic3r {
 
@@ -49,6 +50,8 @@ public:
     PrintRegionConfig* config;
     PrintObjectConfig* object_config;
     PrintConfig* print_config;
+    // Optional cache of thin wall / gap fill skeletons shared across layers.
+    MedialAxisCache* medial_axis_cache;
     // Outputs:
     ExtrusionEntityCollection* loops;
     ExtrusionEntityCollection* gap_fill;
@@ -73,7 +76,7 @@ public:
             layer_id(-1), perimeter_flow(flow), ext_perimeter_flow(flow),
             overhang_flow(flow), solid_infill_flow(flow),
             config(config), object_config(object_config), print_config(print_config),
-            loops(loops), gap_fill(gap_fill), fill_surfaces(fill_surfaces),
+            medial_axis_cache(NULL), loops(loops), gap_fill(gap_fill), fill_surfaces(fill_surfaces),
             _ext_mm3_per_mm(-1), _mm3_per_mm(-1), _mm3_per_mm_overhang(-1)
         {};
     void process();
@@ -84,6 +87,9 @@ public:
     double _mm3_per_mm_overhang;
     Polygons _lower_slices_p;
     
+    void _medial_axis(const ExPolygon &expolygon, const ExPolygon &bounds,
+        double max_width, double min_width, ThickPolylines* polylines) const;
+    
     ExtrusionEntityCollection _traverse_loops(const PerimeterGeneratorLoops &loops,
         ThickPolylines &thin_walls) const;
     ExtrusionEntityCollection _variable_width
@@ -2,10 +2,12 @@
 #include "PrintGCode.hpp"
 #include "BoundingBox.hpp"
 #include "ClipperUtils.hpp"
+#include "FileWriter.hpp"
 #include "Fill/Fill.hpp"
 #include "Flow.hpp"
 #include "Geometry.hpp"
 #include "SupportMaterial.hpp"
+#include "ToolpathFile.hpp"
 #include <algorithm>
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
@@ -15,7 +17,6 @@
 #include <thread>
 #include <sstream>
 #include <system_error>
-#include <boost/nowide/fstream.hpp>
 
 #ifdef __cpp_lib_quoted_string_io
     #include <iomanip>
@@ -108,15 +109,33 @@ Print::delete_object(size_t idx)
 void
 Print::process() 
 {
-    /// No need to call this as we call it as part of prepare_infill()
-    /// until we fix the idempotency issue.
-//    if (this->status_cb != nullptr)
-//        this->status_cb(20, "Generating perimeters");
-  //  for(auto& obj : this->objects) { obj->make_perimeters(); }
+    // the steps are checked between objects and by the workers of parallelize();
+    // a cancelled step stays started and runs again from the start next time
+    CancellationScope scope(&this->cancellation);
+    cancellation_point();
+
+    if (this->status_cb != nullptr)
+        this->status_cb(20, "Generating perimeters");
+    for(auto& obj : this->objects) {
+        obj->make_perimeters();
+        cancellation_point();
+    }
     if (this->status_cb != nullptr)
         this->status_cb(70, "Infilling layers");
-    for(auto& obj : this->objects) { obj->infill(); }
-    for(auto& obj : this->objects) { obj->generate_support_material(); }
+    for(auto& obj : this->objects) {
+        // infill() publishes the layers it fills as they are done
+        const bool done = obj->state.is_done(posInfill);
+        obj->infill();
+        if (done && this->layer_done_cb != nullptr)
+            for (const Layer* layer : obj->layers) this->layer_done_cb(layer);
+        cancellation_point();
+    }
+    for(auto& obj : this->objects) {
+        obj->generate_support_material();
+        if (this->layer_done_cb != nullptr)
+            for (const SupportLayer* layer : obj->support_layers) this->layer_done_cb(layer);
+        cancellation_point();
+    }
 
     this->make_skirt();
     this->make_brim(); // must follow make_skirt
@@ -328,6 +347,110 @@ Print::delete_region(size_t idx)
     this->regions.erase(i);
 }
 
+bool
+Print::steps_depending_on(const t_config_option_key &opt_key, std::set<PrintStep>* steps, std::set<PrintObjectStep>* osteps)
+{
+    if (opt_key == "skirts"
+        || opt_key == "skirt_height"
+        || opt_key == "skirt_distance"
+        || opt_key == "min_skirt_length"
+        || opt_key == "ooze_prevention") {
+        steps->insert(psSkirt);
+    } else if (opt_key == "brim_width") {
+        steps->insert(psBrim);
+        steps->insert(psSkirt);
+        osteps->insert(posSupportMaterial);
+    } else if (opt_key == "brim_width"
+        || opt_key == "interior_brim_width"
+        || opt_key == "brim_ears"
+        || opt_key == "brim_ears_max_angle"
+        || opt_key == "brim_connections_width") {
+        steps->insert(psBrim);
+        steps->insert(psSkirt);
+    } else if (opt_key == "nozzle_diameter") {
+            osteps->insert(posLayers);
+    } else if (opt_key == "resolution"
+        || opt_key == "z_steps_per_mm") {
+        osteps->insert(posSlice);
+    } else if (opt_key == "avoid_crossing_perimeters"
+        || opt_key == "bed_shape"
+        || opt_key == "bed_temperature"
+        || opt_key == "between_objects_gcode"
+        || opt_key == "bridge_acceleration"
+        || opt_key == "bridge_fan_speed"
+        || opt_key == "complete_objects"
+        || opt_key == "cooling"
+        || opt_key == "default_acceleration"
+        || opt_key == "disable_fan_first_layers"
+        || opt_key == "duplicate_distance"
+        || opt_key == "end_gcode"
+        || opt_key == "extruder_clearance_height"
+        || opt_key == "extruder_clearance_radius"
+        || opt_key == "extruder_offset"
+        || opt_key == "extrusion_axis"
+        || opt_key == "extrusion_multiplier"
+        || opt_key == "fan_always_on"
+        || opt_key == "fan_below_layer_time"
+        || opt_key == "filament_colour"
+        || opt_key == "filament_diameter"
+        || opt_key == "filament_notes"
+        || opt_key == "first_layer_acceleration"
+        || opt_key == "first_layer_bed_temperature"
+        || opt_key == "first_layer_speed"
+        || opt_key == "first_layer_temperature"
+        || opt_key == "gcode_arcs"
+        || opt_key == "gcode_comments"
+        || opt_key == "gcode_compression"
+        || opt_key == "gcode_flavor"
+        || opt_key == "infill_acceleration"
+        || opt_key == "infill_first"
+        || opt_key == "layer_gcode"
+        || opt_key == "min_fan_speed"
+        || opt_key == "max_fan_speed"
+        || opt_key == "min_print_speed"
+        || opt_key == "notes"
+        || opt_key == "only_retract_when_crossing_perimeters"
+        || opt_key == "output_filename_format"
+        || opt_key == "perimeter_acceleration"
+        || opt_key == "post_process"
+        || opt_key == "pressure_advance"
+        || opt_key == "printer_notes"
+        || opt_key == "retract_before_travel"
+        || opt_key == "retract_layer_change"
+        || opt_key == "retract_length"
+        || opt_key == "retract_length_toolchange"
+        || opt_key == "retract_lift"
+        || opt_key == "retract_lift_above"
+        || opt_key == "retract_lift_below"
+        || opt_key == "retract_restart_extra"
+        || opt_key == "retract_restart_extra_toolchange"
+        || opt_key == "retract_speed"
+        || opt_key == "slowdown_below_layer_time"
+        || opt_key == "spiral_vase"
+        || opt_key == "standby_temperature_delta"
+        || opt_key == "start_gcode"
+        || opt_key == "temperature"
+        || opt_key == "threads"
+        || opt_key == "toolchange_gcode"
+        || opt_key == "travel_speed"
+        || opt_key == "use_firmware_retraction"
+        || opt_key == "use_relative_e_distances"
+        || opt_key == "vibration_limit"
+        || opt_key == "wipe"
+        || opt_key == "z_offset") {
+        // these options only affect G-code export, so nothing to invalidate
+    } else if (opt_key == "first_layer_extrusion_width") {
+        osteps->insert(posPerimeters);
+        osteps->insert(posInfill);
+        osteps->insert(posSupportMaterial);
+        steps->insert(psSkirt);
+        steps->insert(psBrim);
+    } else {
+        return false;
+    }
+    return true;
+}
+
 bool
 Print::invalidate_state_by_config(const PrintConfigBase &config)
 {
@@ -339,101 +462,7 @@ Print::invalidate_state_by_config(const PrintConfigBase &config)
     
     // this method only accepts PrintConfig option keys
     for (const t_config_option_key &opt_key : diff) {
-        if (opt_key == "skirts"
-            || opt_key == "skirt_height"
-            || opt_key == "skirt_distance"
-            || opt_key == "min_skirt_length"
-            || opt_key == "ooze_prevention") {
-            steps.insert(psSkirt);
-        } else if (opt_key == "brim_width") {
-            steps.insert(psBrim);
-            steps.insert(psSkirt);
-            osteps.insert(posSupportMaterial);
-        } else if (opt_key == "brim_width"
-            || opt_key == "interior_brim_width"
-            || opt_key == "brim_ears"
-            || opt_key == "brim_ears_max_angle"
-            || opt_key == "brim_connections_width") {
-            steps.insert(psBrim);
-            steps.insert(psSkirt);
-        } else if (opt_key == "nozzle_diameter") {
-                osteps.insert(posLayers);
-        } else if (opt_key == "resolution"
-            || opt_key == "z_steps_per_mm") {
-            osteps.insert(posSlice);
-        } else if (opt_key == "avoid_crossing_perimeters"
-            || opt_key == "bed_shape"
-            || opt_key == "bed_temperature"
-            || opt_key == "between_objects_gcode"
-            || opt_key == "bridge_acceleration"
-            || opt_key == "bridge_fan_speed"
-            || opt_key == "complete_objects"
-            || opt_key == "cooling"
-            || opt_key == "default_acceleration"
-            || opt_key == "disable_fan_first_layers"
-            || opt_key == "duplicate_distance"
-            || opt_key == "end_gcode"
-            || opt_key == "extruder_clearance_height"
-            || opt_key == "extruder_clearance_radius"
-            || opt_key == "extruder_offset"
-            || opt_key == "extrusion_axis"
-            || opt_key == "extrusion_multiplier"
-            || opt_key == "fan_always_on"
-            || opt_key == "fan_below_layer_time"
-            || opt_key == "filament_colour"
-            || opt_key == "filament_diameter"
-            || opt_key == "filament_notes"
-            || opt_key == "first_layer_acceleration"
-            || opt_key == "first_layer_bed_temperature"
-            || opt_key == "first_layer_speed"
-            || opt_key == "first_layer_temperature"
-            || opt_key == "gcode_arcs"
-            || opt_key == "gcode_comments"
-            || opt_key == "gcode_flavor"
-            || opt_key == "infill_acceleration"
-            || opt_key == "infill_first"
-            || opt_key == "layer_gcode"
-            || opt_key == "min_fan_speed"
-            || opt_key == "max_fan_speed"
-            || opt_key == "min_print_speed"
-            || opt_key == "notes"
-            || opt_key == "only_retract_when_crossing_perimeters"
-            || opt_key == "output_filename_format"
-            || opt_key == "perimeter_acceleration"
-            || opt_key == "post_process"
-            || opt_key == "pressure_advance"
-            || opt_key == "printer_notes"
-            || opt_key == "retract_before_travel"
-            || opt_key == "retract_layer_change"
-            || opt_key == "retract_length"
-            || opt_key == "retract_length_toolchange"
-            || opt_key == "retract_lift"
-            || opt_key == "retract_lift_above"
-            || opt_key == "retract_lift_below"
-            || opt_key == "retract_restart_extra"
-            || opt_key == "retract_restart_extra_toolchange"
-            || opt_key == "retract_speed"
-            || opt_key == "slowdown_below_layer_time"
-            || opt_key == "spiral_vase"
-            || opt_key == "standby_temperature_delta"
-            || opt_key == "start_gcode"
-            || opt_key == "temperature"
-            || opt_key == "threads"
-            || opt_key == "toolchange_gcode"
-            || opt_key == "travel_speed"
-            || opt_key == "use_firmware_retraction"
-            || opt_key == "use_relative_e_distances"
-            || opt_key == "vibration_limit"
-            || opt_key == "wipe"
-            || opt_key == "z_offset") {
-            // these options only affect G-code export, so nothing to invalidate
-        } else if (opt_key == "first_layer_extrusion_width") {
-            osteps.insert(posPerimeters);
-            osteps.insert(posInfill);
-            osteps.insert(posSupportMaterial);
-            steps.insert(psSkirt);
-            steps.insert(psBrim);
-        } else {
+        if (!Print::steps_depending_on(opt_key, &steps, &osteps)) {
             // for legacy, if we can't handle this option let's invalidate all steps
             all = true;
             break;
@@ -700,11 +729,14 @@ Print::export_gcode(std::string outfile, bool quiet)
     // compute the actual output filepath
     outfile = this->output_filepath(outfile);
     
-    // write G-code to a temporary file in order to make the export atomic
+    // write G-code to a temporary file in order to make the export atomic;
+    // FileWriter writes (and compresses) it while PrintGCode generates the next layers
     const std::string tempfile{ outfile + ".tmp" };
     {
-        boost::nowide::ofstream outstream(tempfile);
+        FileWriter writer(tempfile, this->config.gcode_compression ? FileWriter::Gzip : FileWriter::Text);
+        std::ostream outstream(&writer);
         this->export_gcode(outstream);
+        writer.close();
     }
     
     // rename the temporary file to the destination file
@@ -747,6 +779,39 @@ Print::export_gcode(std::string outfile, bool quiet)
     }
 }
 
+void
+Print::export_toolpaths(std::ostream& output)
+{
+    // prerequisites
+    this->process();
+    
+    if (this->status_cb != nullptr) 
+        this->status_cb(90, "Exporting toolpaths...");
+    
+    ToolpathWriter writer;
+    {
+        std::ostream gcode(&writer);
+        Slic3r::PrintGCode(*this, gcode, true).output();
+    }
+    writer.write(output);
+}
+
+void
+Print::export_toolpaths(std::string outfile)
+{
+    const std::string tempfile{ outfile + ".tmp" };
+    {
+        FileWriter writer(tempfile);
+        std::ostream outstream(&writer);
+        this->export_toolpaths(outstream);
+        writer.close();
+    }
+    
+    std::error_code ec = Slic3r::rename_file(tempfile, outfile);
+    if (ec)
+        throw std::runtime_error("Failed to replace the toolpath file at " + outfile + ": " + ec.message());
+}
+
 #ifndef SLIC3RXS
 bool
 Print::apply_config(config_ptr config) {
@@ -890,7 +955,7 @@ Print::validate() const
                     Polygons mesh_convex_hulls;
                     for (size_t i = 0; i < this->regions.size(); ++i) {
                         for (std::vector<int>::const_iterator it = object->region_volumes[i].begin(); it != object->region_volumes[i].end(); ++it) {
-                            Polygon hull = object->model_object()->volumes[*it]->mesh.convex_hull();
+                            Polygon hull = object->model_object()->volumes[*it]->convex_hull();
                             mesh_convex_hulls.push_back(hull);
                         }
                     }
@@ -949,6 +1014,9 @@ Print::validate() const
             throw InvalidPrintException{"The Spiral Vase option can only be used when printing single material objects."};
     }
     
+    if (this->config.gcode_compression && !this->config.post_process.values.empty())
+        throw InvalidPrintException{"Post-processing scripts cannot read compressed G-code; disable G-code compression or the scripts."};
+    
     if (this->extruders().empty())
         throw InvalidPrintException{"The supplied settings will cause an empty print."};
 }
@@ -1420,7 +1488,10 @@ std::string
 Print::output_filename()
 {
     this->placeholder_parser.update_timestamp();
-    return this->placeholder_parser.process(this->config.output_filename_format.value);
+    std::string filename = this->placeholder_parser.process(this->config.output_filename_format.value);
+    if (this->config.gcode_compression)
+        filename += ".gz";
+    return filename;
 }
 
 std::string
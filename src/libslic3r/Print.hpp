@@ -19,10 +19,15 @@
 #include "PlaceholderParser.hpp"
 #include "SlicingAdaptive.hpp"
 #include "LayerHeightSpline.hpp"
+#include "MedialAxisCache.hpp"
+#include "LayerResultCache.hpp"
+#include "Fill/FillPool.hpp"
 #include "SupportMaterial.hpp"
 
 namespace Slic3r {
 
+class SliceCache;
+
 class InvalidPrintException : public std::runtime_error {
     using std::runtime_error::runtime_error;
 };
@@ -67,6 +72,9 @@ class PrintRegion
     Print* print();
     Flow flow(FlowRole role, double layer_height, bool bridge, bool first_layer, double width, const PrintObject &object) const;
     bool invalidate_state_by_config(const PrintConfigBase &config);
+    /// Adds the steps of the objects using a region which depend on a region option.
+    /// Returns false for unknown options, which any step may depend on.
+    static bool steps_depending_on(const t_config_option_key &opt_key, std::set<PrintObjectStep>* steps);
 
     private:
     Print* _print;
@@ -95,7 +103,7 @@ class PrintObject
     LayerHeightSpline layer_height_spline;
 
     /// this is set to true when LayerRegion->slices is split in top/internal/bottom
-    /// so that next call to make_perimeters() performs a union() before computing loops
+    /// so that next call to make_perimeters() restores the untyped slices before computing loops
     bool typed_slices;
 
     Point3 size;           //< XYZ in scaled coordinates
@@ -110,8 +118,15 @@ class PrintObject
 
     LayerPtrs layers;
     SupportLayerPtrs support_layers;
-    // TODO: Fill* fill_maker        => (is => 'lazy');
     PrintState<PrintObjectStep> state;
+
+    /// Thin wall and gap fill skeletons shared by the layers during make_perimeters()
+    MedialAxisCache medial_axis_cache;
+    /// Perimeters and infill of earlier layers, reused by layers having identical inputs
+    PerimeterResultCache perimeter_cache;
+    FillResultCache fill_cache;
+    /// Infill generators reused by the layers during infill()
+    FillPool fill_pool;
     
     Print* print() { return this->_print; };
     ModelObject* model_object() { return this->_model_object; };
@@ -151,7 +166,13 @@ class PrintObject
     
     // methods for handling state
     bool invalidate_state_by_config(const PrintConfigBase &config);
+    /// Adds the steps depending on an object option.
+    /// Returns false for unknown options, which any step may depend on.
+    static bool steps_depending_on(const t_config_option_key &opt_key, std::set<PrintObjectStep>* steps);
     bool invalidate_step(PrintObjectStep step);
+    /// Invalidates a step for the layers of a single region, keeping the perimeters
+    /// and fills of the other regions
+    bool invalidate_region_step(PrintObjectStep step, size_t region_id);
     bool invalidate_all_steps();
     
     bool has_support_material() const;
@@ -162,7 +183,12 @@ class PrintObject
     coordf_t adjust_layer_height(coordf_t layer_height) const;
     std::vector<coordf_t> generate_object_layers(coordf_t first_layer_height);
     void _slice();
-    std::vector<ExPolygons> _slice_region(size_t region_id, std::vector<float> z, bool modifier);
+    /// Slices the volumes used by the regions at the given heights, each one on its own;
+    /// items are indexed by volume id, and empty for unused volumes.
+    std::vector< std::vector<ExPolygons> > _slice_volumes(const std::vector<float> &z);
+    /// Merges the slices of the modifier or non-modifier volumes of a region.
+    std::vector<ExPolygons> _slice_region(size_t region_id,
+        const std::vector< std::vector<ExPolygons> > &volume_slices, bool modifier) const;
 
     void _infill();
 
@@ -210,8 +236,22 @@ class PrintObject
     PrintObject(Print* print, ModelObject* model_object, const BoundingBoxf3 &modobj_bbox);
     ~PrintObject();
 
+    /// Slicers of the volumes as placed for slicing, indexed by volume id; they hold
+    /// their own compact copy of the mesh and are kept across slice() calls as long as
+    /// the placement of the object and the ModelVolume::mesh_id() of the volume don't change.
+    std::vector< std::unique_ptr< TriangleMeshSlicer<Z> > > _volume_slicers;
+    std::vector<uint64_t> _volume_slicers_mesh_ids;
+    TransformationMatrix _volume_slicers_trafo;
+
+    void _invalidate_layer_regions(PrintObjectStep step, size_t region_id);
+    /// Invalidates step and the steps depending on it, without flagging any layer region
+    bool _invalidate_step(PrintObjectStep step);
+
+    /// Number of layers the shells below top surfaces (type stTop) or above bottom ones reach from layer i
+    size_t _solid_layers(const LayerRegion* layerm, const size_t& i, const SurfaceType& type) const;
     /// Outer loop of logic for horizontal shell discovery
-    void _discover_external_horizontal_shells(LayerRegion* layerm, const size_t& i, const size_t& region_id);
+    void _discover_external_horizontal_shells(LayerRegion* layerm, const size_t& i, const size_t& region_id,
+        const size_t& top_solid_layers, const size_t& bottom_solid_layers);
     /// Inner loop of logic for horizontal shell discovery
     void _discover_neighbor_horizontal_shells(LayerRegion* layerm, const size_t& i, const size_t& region_id, const SurfaceType& type, Polygons& solid, const size_t& solid_layers);  
 
@@ -236,6 +276,19 @@ class Print
     
     std::function<void(int, const std::string&)> status_cb {nullptr};
 
+    /// Called by process() as the toolpaths of the layers of the objects and of their
+    /// support are finished, in no particular order and from any of its threads.
+    /// A layer is not modified again until a step of its object is invalidated.
+    std::function<void(const Layer*)> layer_done_cb {nullptr};
+
+    /// Cancels process() from another thread: it throws CancelledException at its next
+    /// cancellation point, keeping the steps it finished. Reset it before processing again.
+    CancellationToken cancellation;
+
+    /// Slices, perimeters and infill of earlier runs, reused by objects having
+    /// the same meshes and settings (optional, may be shared by several prints)
+    std::shared_ptr<SliceCache> slice_cache;
+
     /// Function pointer for the UI side to call post-processing scripts.
     /// Vector is assumed to be the executable script and all arguments.
     std::function<void(std::vector<std::string>)> post_process_cb {nullptr};
@@ -264,7 +317,8 @@ class Print
     const PrintRegion* get_region(size_t idx) const { return this->regions.at(idx); };
     PrintRegion* add_region();
 
-    /// Triggers the rest of the print process
+    /// Triggers the rest of the print process, from the first step of each object which
+    /// is not done; throws CancelledException if cancelled (see cancellation).
     void process(); 
 
     /// Performs a gcode export.
@@ -275,9 +329,19 @@ class Print
 
     /// commands a gcode export to a temporary file and return its name
     std::string export_gcode(bool quiet = false);
+
+    /// Exports the G-code as a binary toolpath file (see ToolpathFile).
+    void export_toolpaths(std::ostream& output);
+
+    /// Exports a binary toolpath file, replacing the file atomically.
+    void export_toolpaths(std::string filename);
     
     // methods for handling state
     bool invalidate_state_by_config(const PrintConfigBase &config);
+    /// Adds the steps of the print and of its objects depending on a print option.
+    /// Returns false for unknown options, which any step may depend on.
+    static bool steps_depending_on(const t_config_option_key &opt_key, std::set<PrintStep>* steps,
+        std::set<PrintObjectStep>* osteps);
     bool invalidate_step(PrintStep step);
     bool invalidate_all_steps();
     bool step_done(PrintObjectStep step) const;
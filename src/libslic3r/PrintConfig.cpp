@@ -653,6 +653,12 @@ PrintConfigDef::PrintConfigDef()
     def->cli = "gcode-comments!";
     def->default_value = new ConfigOptionBool(0);
 
+    def = this->add("gcode_compression", coBool);
+    def->label = __TRANS("Compress G-code");
+    def->tooltip = __TRANS("Write the G-code file compressed with gzip, adding the .gz extension to generated file names. The file is several times smaller, but only hosts and firmwares which decompress it can print it. It cannot be post-processed, nor sent to a printer by Slic3r.");
+    def->cli = "gcode-compression!";
+    def->default_value = new ConfigOptionBool(0);
+
     def = this->add("gcode_flavor", coEnum);
     def->label = __TRANS("G-code flavor");
     def->tooltip = __TRANS("Some G/M-code commands, including temperature control and others, are not universal. Set this option to your printer's firmware to get a compatible output. The \"No extrusion\" flavor prevents Slic3r from exporting any extrusion value at all.");
@@ -1255,6 +1261,21 @@ PrintConfigDef::PrintConfigDef()
     def->enum_values.push_back("250000");
     def->default_value = new ConfigOptionInt(250000);
 
+    def = this->add("serial_window", coInt);
+    def->label = __TRANS("Lines in flight");
+    def->tooltip = __TRANS("Number of lines sent to the printer without waiting for their acknowledgement. More than one keeps the firmware's planner fed on short segments at high speeds; the firmware must then have room for them in its serial buffer (BUFSIZE for Marlin).");
+    def->cli = "serial-window=i";
+    def->min = 1;
+    def->default_value = new ConfigOptionInt(1);
+
+    def = this->add("serial_window_bytes", coInt);
+    def->label = __TRANS("Bytes in flight");
+    def->tooltip = __TRANS("Maximum size of the lines sent without waiting for their acknowledgement, for firmwares with a small serial buffer such as Grbl (127 bytes). Set zero to count only lines.");
+    def->sidetext = __TRANS("bytes");
+    def->cli = "serial-window-bytes=i";
+    def->min = 0;
+    def->default_value = new ConfigOptionInt(0);
+
     def = this->add("skirt_distance", coFloat);
     def->label = __TRANS("Distance from object");
     def->category = __TRANS("Skirt and brim");
@@ -1969,6 +1990,18 @@ CLIActionsConfigDef::CLIActionsConfigDef()
     def->cli = "export-gcode|gcode|g";
     def->default_value = new ConfigOptionBool(false);
 
+    def = this->add("export_toolpaths", coBool);
+    def->label = __TRANS("Export toolpaths");
+    def->tooltip = __TRANS("Slice the model and export toolpaths as a binary file, indexed by layer, which tools can read without parsing G-code and convert back to the same G-code.");
+    def->cli = "export-toolpaths";
+    def->default_value = new ConfigOptionBool(false);
+
+    def = this->add("toolpaths_to_gcode", coString);
+    def->label = __TRANS("Convert toolpaths to G-code");
+    def->tooltip = __TRANS("Convert the given file exported by --export-toolpaths back to the G-code it was exported with, written to --output or next to it.");
+    def->cli = "toolpaths-to-gcode";
+    def->default_value = new ConfigOptionString();
+
     def = this->add("help", coBool);
     def->label = __TRANS("Help");
     def->tooltip = __TRANS("Show this help.");
@@ -2108,6 +2141,31 @@ CLIMiscConfigDef::CLIMiscConfigDef()
 {
     ConfigOptionDef* def;
     
+    def = this->add("batch_jobs", coInt);
+    def->label = __TRANS("Concurrent prints");
+    def->tooltip = __TRANS("Number of input files sliced at the same time by --export-gcode. The threads set by --threads are divided among them. Each concurrent print holds its own slices and toolpaths in memory.");
+    def->cli = "batch-jobs=i";
+    def->min = 1;
+    def->default_value = new ConfigOptionInt(1);
+
+    def = this->add("batch_summary", coString);
+    def->label = __TRANS("Batch summary file");
+    def->tooltip = __TRANS("Write a JSON summary of --export-gcode to the specified file, with the output path, the time taken, the filament used and the error of each input file.");
+    def->cli = "batch-summary";
+
+    def = this->add("cache_dir", coString);
+    def->label = __TRANS("Slice cache directory");
+    def->tooltip = __TRANS("Reuse the slices, perimeters and infill of unchanged objects across runs by storing them in the specified directory.");
+    def->cli = "cache-dir";
+    
+    def = this->add("cache_size", coInt);
+    def->label = __TRANS("Slice cache size");
+    def->tooltip = __TRANS("Maximum size of the slice cache directory. The least recently used entries are deleted when it grows larger.");
+    def->sidetext = "MB";
+    def->cli = "cache-size";
+    def->min = 0;
+    def->default_value = new ConfigOptionInt(1024);
+    
     def = this->add("ignore_nonexistent_config", coBool);
     def->label = __TRANS("Ignore non-existent config files");
     def->tooltip = __TRANS("Do not fail if a file supplied to --load does not exist.");
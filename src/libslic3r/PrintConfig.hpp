@@ -455,6 +455,7 @@ class PrintConfig : public GCodeConfig
     ConfigOptionFloatOrPercent      first_layer_speed;
     ConfigOptionInts                first_layer_temperature;
     ConfigOptionBool                gcode_arcs;
+    ConfigOptionBool                gcode_compression;
     ConfigOptionFloat               infill_acceleration;
     ConfigOptionBool                infill_first;
     ConfigOptionFloat               interior_brim_width;
@@ -519,6 +520,7 @@ class PrintConfig : public GCodeConfig
         OPT_PTR(first_layer_speed);
         OPT_PTR(first_layer_temperature);
         OPT_PTR(gcode_arcs);
+        OPT_PTR(gcode_compression);
         OPT_PTR(infill_acceleration);
         OPT_PTR(infill_first);
         OPT_PTR(interior_brim_width);
@@ -566,6 +568,8 @@ class HostConfig : public virtual StaticPrintConfig
     ConfigOptionString              octoprint_apikey;
     ConfigOptionString              serial_port;
     ConfigOptionInt                 serial_speed;
+    ConfigOptionInt                 serial_window;
+    ConfigOptionInt                 serial_window_bytes;
     
     HostConfig(bool initialize = true) : StaticPrintConfig() {
         if (initialize)
@@ -578,6 +582,8 @@ class HostConfig : public virtual StaticPrintConfig
         OPT_PTR(octoprint_apikey);
         OPT_PTR(serial_port);
         OPT_PTR(serial_speed);
+        OPT_PTR(serial_window);
+        OPT_PTR(serial_window_bytes);
         
         return NULL;
     };
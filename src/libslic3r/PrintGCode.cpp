@@ -1,8 +1,11 @@
 #include "PrintGCode.hpp"
 #include "PrintConfig.hpp"
 #include "Log.hpp"
+#include "ToolpathFile.hpp"
 #include <ctime>
 #include <iostream>
+#include <memory>
+#include <sstream>
 
 namespace Slic3r {
 void
@@ -301,6 +304,8 @@ PrintGCode::output()
 
         this->flush_filters();
     }
+    if (_gcodegen.enable_toolpath_markers)
+        fh << ToolpathFile::layers_end_marker << "\n";
 
     // Write end commands to file.
     fh << _gcodegen.retract(); // TODO: process this retract through PressureRegulator in order to discharge fully
@@ -380,6 +385,11 @@ void
 PrintGCode::process_layer(size_t idx, const Layer* layer, const Points& copies)
 {
     std::string gcode {""};
+    if (_gcodegen.enable_toolpath_markers) {
+        std::ostringstream marker;
+        marker << ToolpathFile::layer_marker << layer->print_z << "\n";
+        gcode += marker.str();
+    }
 
     const PrintObject& obj { *layer->object() };
     _gcodegen.config.apply(obj.config, true);
@@ -523,7 +533,9 @@ PrintGCode::process_layer(size_t idx, const Layer* layer, const Points& copies)
             const Flow skirt_flow { _print.skirt_flow() };
 
             // distribute skirt loops across all extruders in layer 0
-            const auto skirt_loops = _print.skirt.flatten().entities;
+            // flattened copy, as the loops are adjusted to the layer height below
+            ExtrusionEntityCollection skirt_coll = _print.skirt.flatten();
+            const ExtrusionEntitiesPtr &skirt_loops = skirt_coll.entities;
             for (size_t i = 0; i < skirt_loops.size(); ++i) {
 
                 // when printing layers > 0 ignore 'min_skirt_length' and
@@ -572,57 +584,26 @@ PrintGCode::process_layer(size_t idx, const Layer* layer, const Points& copies)
         _gcodegen.avoid_crossing_perimeters.disable_once = true;
     }
 
-    auto copy_idx = 0U;
-    for (const auto& copy : copies) {
-        if (config.label_printed_objects) {
-            gcode +=   "; printing object " + obj.model_object().name + " id:" + std::to_string(idx) + " copy "  + std::to_string(copy_idx) + "\n";
-        }
-
-        // when starting a new object, use the external motion planner for the first travel move
-        if (this->_last_obj_copy.first != copy && this->_last_obj_copy.second )
-            _gcodegen.avoid_crossing_perimeters.use_external_mp = true;
-        this->_last_obj_copy.first = copy;
-        this->_last_obj_copy.second = true;
-        _gcodegen.set_origin(Pointf::new_unscale(copy));
-
-        // extrude support material before other things because it might use a lower Z
-        // and also because we avoid travelling on other things when printing it
-        if(layer->is_support()) {
-            const SupportLayer* slayer = dynamic_cast<const SupportLayer*>(layer);
-            ExtrusionEntityCollection paths;
-            if (slayer->support_interface_fills.size() > 0) {
-                gcode += _gcodegen.set_extruder(obj.config.support_material_interface_extruder - 1);
-                slayer->support_interface_fills.chained_path_from(_gcodegen.last_pos(), &paths, false);
-                for (const auto& path : paths) {
-                    gcode += _gcodegen.extrude(*path, "support material interface", obj.config.get_abs_value("support_material_interface_speed"));
-                }
-            }
-            if (slayer->support_fills.size() > 0) {
-                gcode += _gcodegen.set_extruder(obj.config.support_material_extruder - 1);
-                slayer->support_fills.chained_path_from(_gcodegen.last_pos(), &paths, false);
-                for (const auto& path : paths) {
-                    gcode += _gcodegen.extrude(*path, "support material", obj.config.get_abs_value("support_material_speed"));
-                }
-            }
-        }
-        // We now define a strategy for building perimeters and fills. The separation
-        // between regions doesn't matter in terms of printing order, as we follow
-        // another logic instead:
-        // - we group all extrusions by extruder so that we minimize toolchanges
-        // - we start from the last used extruder
-        // - for each extruder, we group extrusions by island
-        // - for each island, we extrude perimeters first, unless user set the infill_first
-        //   option
-        // (Still, we have to keep track of regions because we need to apply their config)
-
-        // group extrusions by extruder and then by island
-        //       extruder        island
-        std::map<size_t,std::map<size_t,
-            //                  region
-            std::tuple<std::map<size_t,ExtrusionEntityCollection>, // perimeters
-                       std::map<size_t,ExtrusionEntityCollection>>  // infill
-        >> by_extruder;
-
+    // We now define a strategy for building perimeters and fills. The separation
+    // between regions doesn't matter in terms of printing order, as we follow
+    // another logic instead:
+    // - we group all extrusions by extruder so that we minimize toolchanges
+    // - we start from the last used extruder
+    // - for each extruder, we group extrusions by island
+    // - for each island, we extrude perimeters first, unless user set the infill_first
+    //   option
+    // (Still, we have to keep track of regions because we need to apply their config)
+    // The grouping doesn't depend on the copy, so it is done once per layer. The groups
+    // point to the extrusions of the layer instead of copying them.
+
+    // group extrusions by extruder and then by island
+    //       extruder        island
+    std::map<size_t,std::map<size_t,
+        //                  region
+        std::tuple<std::map<size_t,ExtrusionEntitiesConstPtr>, // perimeters
+                   std::map<size_t,ExtrusionEntitiesConstPtr>>  // infill
+    >> by_extruder;
+    {
         // cache bounding boxes of layer slices
         std::vector<BoundingBox> layer_slices_bb;
         std::transform(layer->slices.cbegin(), layer->slices.cend(), std::back_inserter(layer_slices_bb), [] (const ExPolygon& s)-> BoundingBox { return s.bounding_box(); });
@@ -632,6 +613,7 @@ PrintGCode::process_layer(size_t idx, const Layer* layer, const Points& copies)
         };
         const size_t n_slices { layer->slices.size() };
 
+        ExtrusionEntitiesConstPtr entities;
         for (auto region_id = 0U; region_id < _print.regions.size(); ++region_id) {
             const LayerRegion* layerm;
             try {
@@ -643,8 +625,9 @@ PrintGCode::process_layer(size_t idx, const Layer* layer, const Points& copies)
             // process perimeters
             {
                 auto extruder_id = region->config.perimeter_extruder-1;
-                // Casting away const just to avoid double dereferences
-                for(const auto* perimeter_coll : layerm->perimeters.flatten().entities) {
+                entities.clear();
+                layerm->perimeters.flatten(&entities);
+                for(const auto* perimeter_coll : entities) {
 
                     if(perimeter_coll->length() == 0) continue;  // this shouldn't happen but first_point() would fail
 
@@ -654,7 +637,7 @@ PrintGCode::process_layer(size_t idx, const Layer* layer, const Points& copies)
                             i == n_slices - 1
                             // perimeter_coll->first_point fits inside ith slice
                             || point_inside_surface(i, perimeter_coll->first_point())) {
-                            std::get<0>(by_extruder[extruder_id][i])[region_id].append(*perimeter_coll);
+                            std::get<0>(by_extruder[extruder_id][i])[region_id].push_back(perimeter_coll);
                             break;
                         }
                     }
@@ -666,7 +649,9 @@ PrintGCode::process_layer(size_t idx, const Layer* layer, const Points& copies)
             // the ExtrusionPath objects of a certain infill "group" (also called "surface"
             // throughout the code). We can redefine the order of such Collections but we have to
             // do each one completely at once.
-            for(auto* fill : layerm->fills.flatten(true).entities) {
+            entities.clear();
+            layerm->fills.flatten(&entities, true);
+            for(const auto* fill : entities) {
                 if(fill->length() == 0) continue;  // this shouldn't happen but first_point() would fail
 
                 auto extruder_id = fill->is_solid_infill()
@@ -677,13 +662,47 @@ PrintGCode::process_layer(size_t idx, const Layer* layer, const Points& copies)
                 for(auto i = 0U; i < n_slices; i++){
                     if (i == n_slices - 1
                         || point_inside_surface(i, fill->first_point())) {
-                        std::get<1>(by_extruder[extruder_id][i])[region_id].append(*fill);
+                        std::get<1>(by_extruder[extruder_id][i])[region_id].push_back(fill);
                         break;
                     }
                 }
             }
         }
+    }
+
+    auto copy_idx = 0U;
+    for (const auto& copy : copies) {
+        if (config.label_printed_objects) {
+            gcode +=   "; printing object " + obj.model_object().name + " id:" + std::to_string(idx) + " copy "  + std::to_string(copy_idx) + "\n";
+        }
+
+        // when starting a new object, use the external motion planner for the first travel move
+        if (this->_last_obj_copy.first != copy && this->_last_obj_copy.second )
+            _gcodegen.avoid_crossing_perimeters.use_external_mp = true;
+        this->_last_obj_copy.first = copy;
+        this->_last_obj_copy.second = true;
+        _gcodegen.set_origin(Pointf::new_unscale(copy));
 
+        // extrude support material before other things because it might use a lower Z
+        // and also because we avoid travelling on other things when printing it
+        if(layer->is_support()) {
+            const SupportLayer* slayer = dynamic_cast<const SupportLayer*>(layer);
+            ExtrusionEntityCollection paths;
+            if (slayer->support_interface_fills.size() > 0) {
+                gcode += _gcodegen.set_extruder(obj.config.support_material_interface_extruder - 1);
+                slayer->support_interface_fills.chained_path_from(_gcodegen.last_pos(), &paths, false);
+                for (const auto& path : paths) {
+                    gcode += _gcodegen.extrude(*path, "support material interface", obj.config.get_abs_value("support_material_interface_speed"));
+                }
+            }
+            if (slayer->support_fills.size() > 0) {
+                gcode += _gcodegen.set_extruder(obj.config.support_material_extruder - 1);
+                slayer->support_fills.chained_path_from(_gcodegen.last_pos(), &paths, false);
+                for (const auto& path : paths) {
+                    gcode += _gcodegen.extrude(*path, "support material", obj.config.get_abs_value("support_material_speed"));
+                }
+            }
+        }
         // tweak extruder ordering to save toolchanges
 
         auto last_extruder = _gcodegen.writer.extruder()->id;
@@ -733,12 +752,12 @@ PrintGCode::process_layer(size_t idx, const Layer* layer, const Points& copies)
 
 // Extrude perimeters: Decide where to put seams (hide or align seams).
 std::string
-PrintGCode::_extrude_perimeters(std::map<size_t,ExtrusionEntityCollection> &by_region)
+PrintGCode::_extrude_perimeters(const std::map<size_t,ExtrusionEntitiesConstPtr> &by_region)
 {
     std::string gcode = "";
     for(auto& pair : by_region) {
         this->_gcodegen.config.apply(this->_print.get_region(pair.first)->config);
-        for(auto& ee : pair.second){
+        for(auto* ee : pair.second){
             gcode += this->_gcodegen.extrude(*ee, "perimeter");
         }
     }
@@ -747,15 +766,26 @@ PrintGCode::_extrude_perimeters(std::map<size_t,ExtrusionEntityCollection> &by_r
 
 // Chain the paths hierarchically by a greedy algorithm to minimize a travel distance.
 std::string
-PrintGCode::_extrude_infill(std::map<size_t,ExtrusionEntityCollection> &by_region)
+PrintGCode::_extrude_infill(const std::map<size_t,ExtrusionEntitiesConstPtr> &by_region)
 {
     std::string gcode = "";
+    std::vector<size_t> order;
+    std::vector<bool>   reversed;
     for(auto& pair : by_region) {
         this->_gcodegen.config.apply(this->_print.get_region(pair.first)->config);
-        ExtrusionEntityCollection tmp;
-        pair.second.chained_path_from(this->_gcodegen.last_pos(),&tmp);
-        for(auto& ee : tmp){
-            gcode += this->_gcodegen.extrude(*ee, "infill");
+        order.clear();
+        reversed.clear();
+        ExtrusionEntityCollection::chained_path_from(pair.second, this->_gcodegen.last_pos(), &order, &reversed);
+        for (size_t i = 0; i < order.size(); ++i) {
+            const ExtrusionEntity* ee = pair.second[order[i]];
+            if (reversed[i]) {
+                // only the extrusions to be printed backwards are copied
+                std::unique_ptr<ExtrusionEntity> reversed_ee(ee->clone());
+                reversed_ee->reverse();
+                gcode += this->_gcodegen.extrude(*reversed_ee, "infill");
+            } else {
+                gcode += this->_gcodegen.extrude(*ee, "infill");
+            }
         }
     }
     return gcode;
@@ -782,7 +812,7 @@ PrintGCode::_print_config(const ConfigBase& config)
     }
 }
 
-PrintGCode::PrintGCode(Slic3r::Print& print, std::ostream& _fh) :
+PrintGCode::PrintGCode(Slic3r::Print& print, std::ostream& _fh, bool toolpath_markers) :
         _print(print),
         config(_print.config),
         _gcodegen(Slic3r::GCode()),
@@ -800,6 +830,7 @@ PrintGCode::PrintGCode(Slic3r::Print& print, std::ostream& _fh) :
     _gcodegen.placeholder_parser = &(_print.placeholder_parser); // initialize
     _gcodegen.layer_count = layer_count;
     _gcodegen.enable_cooling_markers = true;
+    _gcodegen.enable_toolpath_markers = toolpath_markers;
     _gcodegen.apply_print_config(config);
 
     if (config.spiral_vase) _spiral_vase.enable = true;
@@ -18,7 +18,8 @@ namespace Slic3r {
 class PrintGCode {
 public:
     /// Constructor.
-    PrintGCode(Slic3r::Print& print, std::ostream& _fh);
+    /// \param toolpath_markers put the markers ToolpathWriter needs in the G-code
+    PrintGCode(Slic3r::Print& print, std::ostream& _fh, bool toolpath_markers = false);
 
     /// Perform the export. export is a reserved name in C++, so changed to output
     void output();
@@ -62,10 +63,10 @@ private:
     void _print_config(const ConfigBase& config);
 
     // Extrude perimeters: Decide where to put seams (hide or align seams).
-    std::string _extrude_perimeters(std::map<size_t,ExtrusionEntityCollection> &by_region);
+    std::string _extrude_perimeters(const std::map<size_t,ExtrusionEntitiesConstPtr> &by_region);
 
     // Chain the paths hierarchically by a greedy algorithm to minimize a travel distance.
-    std::string _extrude_infill(std::map<size_t,ExtrusionEntityCollection> &by_region);
+    std::string _extrude_infill(const std::map<size_t,ExtrusionEntitiesConstPtr> &by_region);
 
     /// regular expression to match heater gcodes
     std::regex bed_temp_regex { std::regex("M(?:190|140)", std::regex_constants::icase)};
@@ -3,6 +3,7 @@
 #include "ClipperUtils.hpp"
 #include "Geometry.hpp"
 #include "Log.hpp"
+#include "SliceCache.hpp"
 #include "TransformationMatrix.hpp"
 #include <boost/version.hpp>
 #if BOOST_VERSION >= 107300
@@ -29,7 +30,7 @@ PrintObject::PrintObject(Print* print, ModelObject* model_object, const Bounding
     {
         // Translate meshes so that our toolpath generation algorithms work with smaller
         // XY coordinates; this translation is an optimization and not strictly required.
-        // A cloned mesh will be aligned to 0 before slicing in _slice_region() since we
+        // A cloned mesh will be aligned to 0 before slicing in _slice_volumes() since we
         // don't assume it's already aligned and we don't alter the original position in model.
         // We store the XY translation so that we can place copies correctly in the output G-code
         // (copies are expressed in G-code coordinates and this translation is not publicly exposed).
@@ -217,6 +218,54 @@ PrintObject::delete_support_layer(int idx)
     this->support_layers.erase(i);
 }
 
+bool
+PrintObject::steps_depending_on(const t_config_option_key &opt_key, std::set<PrintObjectStep>* steps)
+{
+    if (opt_key == "layer_height"
+        || opt_key == "first_layer_height"
+        || opt_key == "adaptive_slicing"
+        || opt_key == "adaptive_slicing_quality"
+        || opt_key == "match_horizontal_surfaces"
+        || opt_key == "regions_overlap") {
+        steps->insert(posLayers);
+    } else if (opt_key == "xy_size_compensation"
+        || opt_key == "raft_layers") {
+        steps->insert(posSlice);
+    } else if (opt_key == "support_material_contact_distance") {
+        steps->insert(posSlice);
+        steps->insert(posPerimeters);
+        steps->insert(posSupportMaterial);
+    } else if (opt_key == "support_material") {
+        steps->insert(posPerimeters);
+        steps->insert(posSupportMaterial);
+    } else if (opt_key == "support_material_angle"
+        || opt_key == "support_material_extruder"
+        || opt_key == "support_material_extrusion_width"
+        || opt_key == "support_material_interface_layers"
+        || opt_key == "support_material_interface_extruder"
+        || opt_key == "support_material_interface_extrusion_width"
+        || opt_key == "support_material_interface_spacing"
+        || opt_key == "support_material_interface_speed"
+        || opt_key == "support_material_buildplate_only"
+        || opt_key == "support_material_pattern"
+        || opt_key == "support_material_spacing"
+        || opt_key == "support_material_threshold"
+        || opt_key == "support_material_pillar_size"
+        || opt_key == "support_material_pillar_spacing"
+        || opt_key == "dont_support_bridges") {
+        steps->insert(posSupportMaterial);
+    } else if (opt_key == "interface_shells"
+        || opt_key == "infill_only_where_needed") {
+        steps->insert(posPrepareInfill);
+    } else if (opt_key == "seam_position"
+        || opt_key == "support_material_speed") {
+        // these options only affect G-code export, so nothing to invalidate
+    } else {
+        return false;
+    }
+    return true;
+}
+
 bool
 PrintObject::invalidate_state_by_config(const PrintConfigBase &config)
 {
@@ -227,46 +276,7 @@ PrintObject::invalidate_state_by_config(const PrintConfigBase &config)
     
     // this method only accepts PrintObjectConfig and PrintRegionConfig option keys
     for (const t_config_option_key &opt_key : diff) {
-        if (opt_key == "layer_height"
-            || opt_key == "first_layer_height"
-            || opt_key == "adaptive_slicing"
-            || opt_key == "adaptive_slicing_quality"
-            || opt_key == "match_horizontal_surfaces"
-            || opt_key == "regions_overlap") {
-            steps.insert(posLayers);
-        } else if (opt_key == "xy_size_compensation"
-            || opt_key == "raft_layers") {
-            steps.insert(posSlice);
-        } else if (opt_key == "support_material_contact_distance") {
-            steps.insert(posSlice);
-            steps.insert(posPerimeters);
-            steps.insert(posSupportMaterial);
-        } else if (opt_key == "support_material") {
-            steps.insert(posPerimeters);
-            steps.insert(posSupportMaterial);
-        } else if (opt_key == "support_material_angle"
-            || opt_key == "support_material_extruder"
-            || opt_key == "support_material_extrusion_width"
-            || opt_key == "support_material_interface_layers"
-            || opt_key == "support_material_interface_extruder"
-            || opt_key == "support_material_interface_extrusion_width"
-            || opt_key == "support_material_interface_spacing"
-            || opt_key == "support_material_interface_speed"
-            || opt_key == "support_material_buildplate_only"
-            || opt_key == "support_material_pattern"
-            || opt_key == "support_material_spacing"
-            || opt_key == "support_material_threshold"
-            || opt_key == "support_material_pillar_size"
-            || opt_key == "support_material_pillar_spacing"
-            || opt_key == "dont_support_bridges") {
-            steps.insert(posSupportMaterial);
-        } else if (opt_key == "interface_shells"
-            || opt_key == "infill_only_where_needed") {
-            steps.insert(posPrepareInfill);
-        } else if (opt_key == "seam_position"
-            || opt_key == "support_material_speed") {
-            // these options only affect G-code export, so nothing to invalidate
-        } else {
+        if (!PrintObject::steps_depending_on(opt_key, &steps)) {
             // for legacy, if we can't handle this option let's invalidate all steps
             all = true;
             break;
@@ -290,6 +300,36 @@ PrintObject::invalidate_state_by_config(const PrintConfigBase &config)
 
 bool
 PrintObject::invalidate_step(PrintObjectStep step)
+{
+    for (size_t region_id = 0; region_id < this->_print->regions.size(); ++region_id)
+        this->_invalidate_layer_regions(step, region_id);
+    return this->_invalidate_step(step);
+}
+
+bool
+PrintObject::invalidate_region_step(PrintObjectStep step, size_t region_id)
+{
+    this->_invalidate_layer_regions(step, region_id);
+    return this->_invalidate_step(step);
+}
+
+/// Flags the perimeters and/or the fills of a region to be regenerated the next
+/// time their step runs; the layer regions not flagged keep their results.
+void
+PrintObject::_invalidate_layer_regions(PrintObjectStep step, size_t region_id)
+{
+    if (step != posPerimeters && step != posInfill) return;
+    for (Layer* layer : this->layers) {
+        if (region_id >= layer->region_count()) continue;
+        LayerRegion* layerm = layer->get_region(region_id);
+        if (step == posPerimeters)
+            layerm->perimeters_valid = false;
+        layerm->fills_valid = false;
+    }
+}
+
+bool
+PrintObject::_invalidate_step(PrintObjectStep step)
 {
     bool invalidated = this->state.invalidate(step);
     
@@ -301,7 +341,8 @@ PrintObject::invalidate_step(PrintObjectStep step)
     } else if (step == posDetectSurfaces) {
         invalidated |= this->invalidate_step(posPrepareInfill);
     } else if (step == posPrepareInfill) {
-        invalidated |= this->invalidate_step(posInfill);
+        // fills are kept for the layer regions whose fill_surfaces come out the same
+        invalidated |= this->_invalidate_step(posInfill);
     } else if (step == posInfill) {
         invalidated |= this->_print->invalidate_step(psSkirt);
         invalidated |= this->_print->invalidate_step(psBrim);
@@ -603,12 +644,16 @@ std::vector<coordf_t> PrintObject::generate_object_layers(coordf_t first_layer_h
     } else { // create new set of layers
         // create stateful objects and variables for the adaptive slicing process
         SlicingAdaptive as;
+        // the facets of these meshes are referenced by as
+        std::vector<TriangleMesh> meshes;
         coordf_t adaptive_quality = this->config.adaptive_slicing_quality.value;
         if(this->config.adaptive_slicing.value) {
             const ModelVolumePtrs volumes = this->model_object()->volumes;
             for (ModelVolumePtrs::const_iterator it = volumes.begin(); it != volumes.end(); ++ it)
                 if (! (*it)->modifier)
-                    as.add_mesh(&(*it)->mesh);
+                    meshes.push_back((*it)->mesh());
+            for (const TriangleMesh &mesh : meshes)
+                as.add_mesh(&mesh);
             as.prepare(unscale(this->size.z));
         }
 
@@ -815,21 +860,23 @@ void PrintObject::_slice()
         }
     }
 
+    // Slice each volume once, then assign the slices to the regions.
+    const std::vector< std::vector<ExPolygons> > volume_slices = this->_slice_volumes(slice_zs);
     if (this->print()->regions.size() == 1) {
-        // Optimized for a single region. Slice the single non-modifier mesh.
-        std::vector<ExPolygons> expolygons_by_layer = this->_slice_region(0, slice_zs, false);
+        // Optimized for a single region. Take the slices of the non-modifier volumes.
+        std::vector<ExPolygons> expolygons_by_layer = this->_slice_region(0, volume_slices, false);
         for (size_t layer_id = 0; layer_id < expolygons_by_layer.size(); ++ layer_id)
             this->layers[layer_id]->regions.front()->slices.append(std::move(expolygons_by_layer[layer_id]), stInternal);
     } else {
-        // Slice all non-modifier volumes.
+        // Take the slices of all non-modifier volumes.
         for (size_t region_id = 0; region_id < this->print()->regions.size(); ++ region_id) {
-            std::vector<ExPolygons> expolygons_by_layer = this->_slice_region(region_id, slice_zs, false);
+            std::vector<ExPolygons> expolygons_by_layer = this->_slice_region(region_id, volume_slices, false);
             for (size_t layer_id = 0; layer_id < expolygons_by_layer.size(); ++ layer_id)
                 this->layers[layer_id]->regions[region_id]->slices.append(std::move(expolygons_by_layer[layer_id]), stInternal);
         }
-        // Slice all modifier volumes.
+        // Take the slices of all modifier volumes.
         for (size_t region_id = 0; region_id < this->print()->regions.size(); ++ region_id) {
-            std::vector<ExPolygons> expolygons_by_layer = this->_slice_region(region_id, slice_zs, true);
+            std::vector<ExPolygons> expolygons_by_layer = this->_slice_region(region_id, volume_slices, true);
             // loop through the other regions and 'steal' the slices belonging to this one
             for (size_t other_region_id = 0; other_region_id < this->print()->regions.size(); ++ other_region_id) {
                 if (region_id == other_region_id)
@@ -934,18 +981,11 @@ void PrintObject::_slice()
     }
 }
 
-// called from slice()
-std::vector<ExPolygons>
-PrintObject::_slice_region(size_t region_id, std::vector<float> z, bool modifier)
+// called from _slice()
+std::vector< std::vector<ExPolygons> >
+PrintObject::_slice_volumes(const std::vector<float> &z)
 {
-    std::vector<ExPolygons> layers;
-    std::vector<int> &region_volumes = this->region_volumes[region_id];
-    if (region_volumes.empty()) return layers;
-    
     ModelObject &object = *this->model_object();
-    
-    // compose mesh
-    TriangleMesh mesh;
 
     // we ignore the per-instance transformations currently and only 
     // consider the first one
@@ -958,18 +998,76 @@ PrintObject::_slice_region(size_t region_id, std::vector<float> z, bool modifier
         -object.bounding_box().min.z
     ));
 
-    for (const auto& i : region_volumes) {
-        
-        const ModelVolume &volume = *(object.volumes[i]);
+    // the slicers of an earlier call remain valid while the placement and the meshes are the same
+    if (trafo != this->_volume_slicers_trafo || this->_volume_slicers.size() != object.volumes.size()) {
+        this->_volume_slicers.clear();
+        this->_volume_slicers.resize(object.volumes.size());
+        this->_volume_slicers_mesh_ids.assign(object.volumes.size(), 0);
+        this->_volume_slicers_trafo = trafo;
+    }
 
-        if (volume.modifier != modifier) continue;
-        
-        mesh.merge(volume.get_transformed_mesh(trafo));
+    std::queue<int> volumes;
+    {
+        std::set<int> used;
+        for (const auto &region : this->region_volumes)
+            used.insert(region.second.begin(), region.second.end());
+        for (int volume_id : used)
+            volumes.push(volume_id);
     }
-    if (mesh.facets_count() == 0) return layers;
 
-    // perform actual slicing
-    TriangleMeshSlicer<Z>(&mesh).slice(z, &layers);
+    std::vector< std::vector<ExPolygons> > slices(object.volumes.size());
+    parallelize<int>(
+        volumes,
+        [this, &object, &trafo, &z, &slices](int volume_id) {
+            const ModelVolume &volume = *object.volumes[volume_id];
+            if (volume.facets_count() == 0) return;
+            std::unique_ptr< TriangleMeshSlicer<Z> > &slicer = this->_volume_slicers[volume_id];
+            if (slicer == nullptr || this->_volume_slicers_mesh_ids[volume_id] != volume.mesh_id()) {
+                this->_volume_slicers_mesh_ids[volume_id] = volume.mesh_id();
+                // the transformed mesh is only needed until the slicer has its own copy
+                TriangleMesh mesh = volume.get_transformed_mesh(trafo);
+                mesh.require_shared_vertices();
+                slicer.reset(new TriangleMeshSlicer<Z>(IndexedMesh(mesh)));
+            }
+            // perform actual slicing
+            slicer->slice(z, &slices[volume_id]);
+        },
+        this->_print->config.threads.value
+    );
+    return slices;
+}
+
+// called from _slice()
+std::vector<ExPolygons>
+PrintObject::_slice_region(size_t region_id, const std::vector< std::vector<ExPolygons> > &volume_slices, bool modifier) const
+{
+    std::vector<ExPolygons> layers;
+    const auto region_volumes = this->region_volumes.find(region_id);
+    if (region_volumes == this->region_volumes.end()) return layers;
+    
+    const ModelObject &object = this->model_object();
+    std::vector<const std::vector<ExPolygons>*> parts;
+    for (int volume_id : region_volumes->second)
+        if (object.volumes[volume_id]->modifier == modifier && !volume_slices[volume_id].empty())
+            parts.push_back(&volume_slices[volume_id]);
+    if (parts.empty()) return layers;
+
+    // a single volume is taken as is, several ones are merged layer by layer, closing
+    // the gaps between them as TriangleMeshSlicer did when slicing their merged meshes
+    layers = *parts.front();
+    if (parts.size() > 1) {
+        const double safety_offset = scale_(0.0499);
+        parallelize<size_t>(
+            0, layers.size() - 1,
+            [&layers, &parts, safety_offset](size_t layer_id) {
+                Polygons polygons = to_polygons(layers[layer_id]);
+                for (size_t i = 1; i < parts.size(); ++i)
+                    polygons_append(polygons, to_polygons((*parts[i])[layer_id]));
+                layers[layer_id] = offset2_ex(polygons, +safety_offset, -safety_offset);
+            },
+            this->_print->config.threads.value
+        );
+    }
     return layers;
 }
 
@@ -993,6 +1091,15 @@ PrintObject::slice()
         _print->status_cb(10, "Processing triangulated mesh");
     }
     
+    // computed before generate_object_layers() clamps the layer height
+    const std::string cache_key = this->_print->slice_cache != nullptr
+        ? this->_print->slice_cache->key(*this, posSlice) : std::string();
+    if (this->_print->slice_cache != nullptr && this->_print->slice_cache->load(this, posSlice, cache_key)) {
+        this->typed_slices = false;
+        this->state.set_done(posSlice);
+        return;
+    }
+    
     this->_slice(); 
 
     // detect slicing errors
@@ -1071,7 +1178,13 @@ PrintObject::slice()
         return; // make this throw an exception instead?
     }
     
+    FOREACH_LAYER(this, layer_it)
+        for (LayerRegion* layerm : (*layer_it)->regions)
+            layerm->untyped_slices = layerm->slices;
+    
     this->typed_slices = false;
+    if (this->_print->slice_cache != nullptr)
+        this->_print->slice_cache->store(*this, posSlice, cache_key);
     this->state.set_done(posSlice);
 }
 
@@ -1079,30 +1192,30 @@ void
 PrintObject::make_perimeters()
 {
     if (this->state.is_done(posPerimeters)) return;
-    
-    // Temporary workaround for detect_surfaces_type() not being idempotent (see #3764).
-    // We can remove this when idempotence is restored. This make_perimeters() method
-    // will just call merge_slices() to undo the typed slices and invalidate posDetectSurfaces.
-    if (this->typed_slices) {
-        this->invalidate_step(posSlice);
-    }
     this->state.set_started(posPerimeters);
 
     // prerequisites
     this->slice();
     
-    // merge slices if they were split into types
-    // This is not currently taking place because since merge_slices + detect_surfaces_type
-    // are not truly idempotent we are invalidating posSlice here (see the Perl part of 
-    // this method).
+    // start again from the untyped slices, as merge_slices() doesn't exactly undo
+    // detect_surfaces_type() (see #3764)
+    FOREACH_LAYER(this, layer_it) {
+        for (LayerRegion* layerm : (*layer_it)->regions) {
+            layerm->slices = layerm->untyped_slices;
+            if (!layerm->perimeters_valid)
+                for (Surface &s : layerm->slices.surfaces) s.extra_perimeters = 0;
+        }
+    }
     if (this->typed_slices) {
-        // merge_slices() undoes detect_surfaces_type()
-        FOREACH_LAYER(this, layer_it)
-            (*layer_it)->merge_slices();
         this->typed_slices = false;
         this->state.invalidate(posDetectSurfaces);
     }
     
+    if (this->_print->slice_cache != nullptr && this->_print->slice_cache->load(this, posPerimeters)) {
+        this->state.set_done(posPerimeters);
+        return;
+    }
+    
     // compare each layer to the one below, and mark those slices needing
     // one additional inner perimeter, like the top of domed objects-
     
@@ -1122,6 +1235,7 @@ PrintObject::make_perimeters()
         for (size_t i = 0; i <= (this->layer_count()-2); ++i) {
             LayerRegion &layerm                     = *this->get_layer(i)->get_region(region_id);
             const LayerRegion &upper_layerm         = *this->get_layer(i+1)->get_region(region_id);
+            if (layerm.perimeters_valid) continue;
             
             // In order to avoid diagonal gaps (GH #3732) we ignore the external half of the upper
             // perimeter, since it's not truly covering this layer.
@@ -1193,11 +1307,33 @@ PrintObject::make_perimeters()
         }
     }
     
-    parallelize<size_t>(
-        0, this->layers.size() - 1,
-        [this](size_t i) { this->layers[i]->make_perimeters(); },
-        this->_print->config.threads.value
-    );
+    try {
+        parallelize<size_t>(
+            0, this->layers.size() - 1,
+            [this](size_t i) { this->layers[i]->make_perimeters(); },
+            this->_print->config.threads.value
+        );
+    } catch (...) {
+        // the keys don't cover the region config, which may change before a restart
+        this->medial_axis_cache.clear();
+        this->perimeter_cache.clear();
+        throw;
+    }
+    
+    {
+        const MedialAxisCache::Stats stats = this->medial_axis_cache.stats();
+        if (stats.hits + stats.misses > 0)
+            Slic3r::Log::info("PrintObject") << "make_perimeters(): medial axis cache "
+                << stats.hits << " hits, " << stats.misses << " misses ("
+                << int(stats.hit_rate() * 100) << "% hit rate), "
+                << stats.saved_time << "s saved of " << (stats.compute_time + stats.saved_time) << "s\n";
+        const PerimeterResultCache::Stats layer_stats = this->perimeter_cache.stats();
+        Slic3r::Log::info("PrintObject") << "make_perimeters(): reused perimeters of "
+            << layer_stats.hits << " layer regions, generated " << layer_stats.misses << "\n";
+        // results are only shared within a single pass
+        this->medial_axis_cache.clear();
+        this->perimeter_cache.clear();
+    }
     
     /*
         simplify slices (both layer and region slices),
@@ -1206,6 +1342,8 @@ PrintObject::make_perimeters()
     ###$self->_simplify_slices(&Slic3r::SCALED_RESOLUTION);
     */
     
+    if (this->_print->slice_cache != nullptr)
+        this->_print->slice_cache->store(*this, posPerimeters);
     this->state.set_done(posPerimeters);
 }
 
@@ -1216,18 +1354,52 @@ PrintObject::infill()
     this->state.set_started(posInfill);
     
     // prerequisites
+    this->make_perimeters();
+    
+    // a cached entry holds the output of prepare_infill() too
+    if (this->_print->slice_cache != nullptr && this->_print->slice_cache->load(this, posInfill)) {
+        this->typed_slices = true;
+        for (PrintObjectStep step : { posDetectSurfaces, posPrepareInfill, posInfill }) {
+            this->state.set_started(step);
+            this->state.set_done(step);
+        }
+        if (this->_print->layer_done_cb != nullptr)
+            for (const Layer* layer : this->layers) this->_print->layer_done_cb(layer);
+        return;
+    }
     this->prepare_infill();
     
-    parallelize<size_t>(
-        0, this->layers.size() - 1,
-        [this](size_t i) { this->layers[i]->make_fills(); },
-        this->_print->config.threads.value
-    );
+    try {
+        parallelize<size_t>(
+            0, this->layers.size() - 1,
+            [this](size_t i) {
+                this->layers[i]->make_fills();
+                if (this->_print->layer_done_cb != nullptr)
+                    this->_print->layer_done_cb(this->layers[i]);
+            },
+            this->_print->config.threads.value
+        );
+    } catch (...) {
+        // the keys don't cover the region config, which may change before a restart
+        this->fill_cache.clear();
+        this->fill_pool.clear();
+        throw;
+    }
+    
+    {
+        const FillResultCache::Stats stats = this->fill_cache.stats();
+        Slic3r::Log::info("PrintObject") << "infill(): reused infill of "
+            << stats.hits << " layer regions, generated " << stats.misses << "\n";
+        this->fill_cache.clear();
+        this->fill_pool.clear();
+    }
     
     /*  we could free memory now, but this would make this step not idempotent
     ### $_->fill_surfaces->clear for map @{$_->regions}, @{$object->layers};
     */
     
+    if (this->_print->slice_cache != nullptr)
+        this->_print->slice_cache->store(*this, posInfill);
     this->state.set_done(posInfill);
 }
 
@@ -1236,16 +1408,21 @@ PrintObject::prepare_infill()
 {
     if (this->state.is_done(posPrepareInfill)) return;
     
-    // This prepare_infill() is not really idempotent.
-    // TODO: It should clear and regenerate fill_surfaces at every run 
-    // instead of modifying it in place.
-
-    this->state.invalidate(posPerimeters);
+    // prerequisites
     this->make_perimeters();
 
     this->state.set_started(posPrepareInfill);
 
-    // prerequisites
+    // detect_surfaces_type() and the steps below modify slices and fill_surfaces
+    // in place, so start again from the output of make_perimeters()
+    FOREACH_LAYER(this, layer_it) {
+        for (LayerRegion* layerm : (*layer_it)->regions) {
+            layerm->slices        = layerm->untyped_slices;
+            layerm->fill_surfaces = layerm->perimeter_fill_surfaces;
+        }
+    }
+    this->typed_slices = false;
+    this->state.invalidate(posDetectSurfaces);
     this->detect_surfaces_type();
 
     if (this->_print->status_cb != nullptr) 
@@ -1505,15 +1682,49 @@ PrintObject::generate_support_material()
 }
 
 
-void 
+void
 PrintObject::discover_horizontal_shells()
 {
     #ifdef SLIC3R_DEBUG
     std::cout << "==> DISCOVERING HORIZONTAL SHELLS" << std::endl;
     #endif
-    
+
+    // Each layer turns the internal surfaces of the solid_layers below its top surfaces and
+    // above its bottom surfaces into solid ones. Layers whose ranges of neighbors don't
+    // overlap don't depend on each other and are processed in parallel, while the others
+    // keep their order; regions never touch each other's surfaces.
+    // Top and bottom surfaces are only ever trimmed, never added to a layer, so the
+    // ranges can be computed upfront from the current surfaces.
+    const size_t layer_count = this->layer_count();
+    const size_t task_count  = _print->regions.size() * layer_count;
+    std::vector< std::pair<size_t,size_t> > ranges(task_count);
+    std::vector<size_t> top_solid_layers(task_count, 0), bottom_solid_layers(task_count, 0);
     for (size_t region_id = 0U; region_id < _print->regions.size(); ++region_id) {
-        for (size_t i = 0; i < this->layer_count(); ++i) {
+        for (size_t i = 0; i < layer_count; ++i) {
+            const LayerRegion* layerm = this->get_layer(i)->get_region(region_id);
+            const size_t task = region_id * layer_count + i;
+
+            size_t first = i, last = i;
+            if (!layerm->slices.filter_by_type(stTop).empty() || !layerm->fill_surfaces.filter_by_type(stTop).empty()) {
+                top_solid_layers[task] = this->_solid_layers(layerm, i, stTop);
+                if (top_solid_layers[task] > 1)
+                    first -= std::min(first, top_solid_layers[task] - 1);
+            }
+            if (!layerm->slices.filter_by_type({ stBottom, (stBottom | stBridge) }).empty()
+                || !layerm->fill_surfaces.filter_by_type({ stBottom, (stBottom | stBridge) }).empty()) {
+                bottom_solid_layers[task] = this->_solid_layers(layerm, i, stBottom);
+                if (bottom_solid_layers[task] > 1)
+                    last = std::min(layer_count - 1, last + bottom_solid_layers[task] - 1);
+            }
+            ranges[task] = std::make_pair(region_id * layer_count + first, region_id * layer_count + last);
+        }
+    }
+
+    parallelize_ordered<size_t>(
+        ranges,
+        [this, layer_count, &top_solid_layers, &bottom_solid_layers](size_t task) {
+            const size_t region_id = task / layer_count;
+            const size_t i         = task % layer_count;
             auto* layerm = this->get_layer(i)->get_region(region_id);
             const auto& region_config = layerm->region()->config;
 
@@ -1523,15 +1734,48 @@ PrintObject::discover_horizontal_shells()
                 for (auto* s : layerm->fill_surfaces.filter_by_type(stInternal))
                     s->surface_type = type;
             }
-            this->_discover_external_horizontal_shells(layerm, i, region_id);
+            this->_discover_external_horizontal_shells(layerm, i, region_id,
+                top_solid_layers[task], bottom_solid_layers[task]);
+        },
+        this->_print->config.threads.value
+    );
+}
+
+size_t
+PrintObject::_solid_layers(const LayerRegion* layerm, const size_t& i, const SurfaceType& type) const
+{
+    const auto& region_config = layerm->region()->config;
+    size_t solid_layers = type == stTop
+        ? region_config.top_solid_layers()
+        : region_config.bottom_solid_layers();
+    solid_layers = min(solid_layers, this->layers.size());
+
+    if (region_config.min_top_bottom_shell_thickness() > 0) {
+        auto current_shell_thickness = static_cast<coordf_t>(solid_layers) * this->get_layer(i)->height;
+        const auto min_shell_thickness = region_config.min_top_bottom_shell_thickness();
+        Slic3r::Log::debug("vertical_shell_thickness") << "Initial shell thickness for layer " << i << " "
+                                                       << current_shell_thickness << " "
+                                                       << "Minimum: " << min_shell_thickness << "\n";
+        while (std::abs(min_shell_thickness - current_shell_thickness) > Slic3r::Geometry::epsilon && current_shell_thickness < min_shell_thickness) {
+            solid_layers++;
+            current_shell_thickness = static_cast<coordf_t>(solid_layers) * this->get_layer(i)->height;
+            Slic3r::Log::debug("vertical_shell_thickness") << "Solid layer count: "
+                                                           << solid_layers << "; "
+                                                           << "current_shell_thickness: "
+                                                           << current_shell_thickness
+                                                           << "\n";
+            if (solid_layers > this->layers.size()) {
+                throw std::runtime_error("Infinite loop when determining vertical shell thickness");
+            }
         }
     }
+    return solid_layers;
 }
 
 void
-PrintObject::_discover_external_horizontal_shells(LayerRegion* layerm, const size_t& i, const size_t& region_id)
+PrintObject::_discover_external_horizontal_shells(LayerRegion* layerm, const size_t& i, const size_t& region_id,
+    const size_t& top_solid_layers, const size_t& bottom_solid_layers)
 {
-    const auto& region_config = layerm->region()->config;
     for (auto& type : { stTop, stBottom, (stBottom | stBridge) }) {
         // find slices of current type for current layer
         // use slices instead of fill_surfaces because they also include the perimeter area
@@ -1552,30 +1796,7 @@ PrintObject::_discover_external_horizontal_shells(LayerRegion* layerm, const siz
         std::cout << "Layer " << i << " has " << (type == stTop ? "top" : "bottom") << " surfaces" << std::endl;
         #endif
         
-        size_t solid_layers = type == stTop
-            ? region_config.top_solid_layers()
-            : region_config.bottom_solid_layers();
-        solid_layers = min(solid_layers, this->layers.size());
-
-        if (region_config.min_top_bottom_shell_thickness() > 0) {
-            auto current_shell_thickness = static_cast<coordf_t>(solid_layers) * this->get_layer(i)->height;
-            const auto min_shell_thickness = region_config.min_top_bottom_shell_thickness();
-            Slic3r::Log::debug("vertical_shell_thickness") << "Initial shell thickness for layer " << i << " " 
-                                                           << current_shell_thickness << " "
-                                                           << "Minimum: " << min_shell_thickness << "\n";
-            while (std::abs(min_shell_thickness - current_shell_thickness) > Slic3r::Geometry::epsilon && current_shell_thickness < min_shell_thickness) {
-                solid_layers++;
-                current_shell_thickness = static_cast<coordf_t>(solid_layers) * this->get_layer(i)->height;
-                Slic3r::Log::debug("vertical_shell_thickness") << "Solid layer count: "
-                                                               << solid_layers << "; "
-                                                               << "current_shell_thickness: "
-                                                               << current_shell_thickness
-                                                               << "\n";
-                if (solid_layers > this->layers.size()) {
-                    throw std::runtime_error("Infinite loop when determining vertical shell thickness");
-                }
-            }
-        }
+        const size_t solid_layers = type == stTop ? top_solid_layers : bottom_solid_layers;
         _discover_neighbor_horizontal_shells(layerm, i, region_id, type, solid, solid_layers);
     }
 }
@@ -1589,8 +1810,8 @@ PrintObject::_discover_neighbor_horizontal_shells(LayerRegion* layerm, const siz
         if (n < 0 || static_cast<size_t>(n) >= this->layer_count()) continue;
 
         LayerRegion* neighbor_layerm { this->get_layer(n)->get_region(region_id) };
-        // make a copy so we can use them even after clearing the original collection
-        SurfaceCollection neighbor_fill_surfaces{ neighbor_layerm->fill_surfaces };
+        // read the surfaces in place, they are only replaced once the new ones are computed
+        const SurfaceCollection &neighbor_fill_surfaces = neighbor_layerm->fill_surfaces;
         
         // find intersection between neighbor and current layer's surfaces
         // intersections have contours and holes
@@ -1682,27 +1903,37 @@ PrintObject::_discover_neighbor_horizontal_shells(LayerRegion* layerm, const siz
         tmp = to_polygons(neighbor_fill_surfaces.filter_by_type(stInternal));
         const ExPolygons internal = diff_ex(tmp, to_polygons(internal_solid), 1);
 
+        // top and bottom surfaces of the layer, grouped like SurfaceCollection::group() does
+        std::vector<SurfacesConstPtr> top_bottom;
+        for (const Surface& s : neighbor_fill_surfaces.surfaces) {
+            if (!s.is_top() && !s.is_bottom()) continue;
+            auto group = std::find_if(top_bottom.begin(), top_bottom.end(),
+                [&s](const SurfacesConstPtr &g) { return surfaces_could_merge(*g.front(), s); });
+            if (group == top_bottom.end()) {
+                top_bottom.push_back(SurfacesConstPtr());
+                group = top_bottom.end() - 1;
+            }
+            group->push_back(&s);
+        }
+
         // assign resulting internal surfaces to layer
-        neighbor_layerm->fill_surfaces.clear();
-        neighbor_layerm->fill_surfaces.append(internal, stInternal);
+        SurfaceCollection new_fill_surfaces;
+        new_fill_surfaces.append(internal, stInternal);
 
         // assign new internal-solid surfaces to layer
-        neighbor_layerm->fill_surfaces.append(internal_solid, (stInternal | stSolid));
+        new_fill_surfaces.append(internal_solid, (stInternal | stSolid));
 
         // assign top and bottom surfaces to layer
-        SurfaceCollection tmp_coll;
-        for (const Surface& s : neighbor_fill_surfaces.surfaces)
-            if (s.is_top() || s.is_bottom())
-                tmp_coll.append(s);
-        
-        for (auto s : tmp_coll.group()) {
+        if (!top_bottom.empty()) {
             Polygons tmp;
             append_to(tmp, to_polygons(internal_solid));
             append_to(tmp, to_polygons(internal));
-            
-            const auto solid_surfaces = diff_ex(to_polygons(s), tmp, true);
-            neighbor_layerm->fill_surfaces.append(solid_surfaces, s.front()->surface_type);
+            for (const SurfacesConstPtr &s : top_bottom) {
+                const auto solid_surfaces = diff_ex(to_polygons(s), tmp, true);
+                new_fill_surfaces.append(solid_surfaces, s.front()->surface_type);
+            }
         }
+        neighbor_layerm->fill_surfaces.set(std::move(new_fill_surfaces));
     }
 }
 
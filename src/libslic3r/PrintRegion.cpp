@@ -1,4 +1,5 @@
 #include "Print.hpp"
+#include <algorithm>
 
 namespace Slic3r {
 
@@ -65,6 +66,72 @@ PrintRegion::flow(FlowRole role, double layer_height, bool bridge, bool first_la
     return Flow::new_from_config_width(role, config_width, nozzle_diameter, layer_height, bridge ? (float)this->config.bridge_flow_ratio : 0.0);
 }
 
+bool
+PrintRegion::steps_depending_on(const t_config_option_key &opt_key, std::set<PrintObjectStep>* steps)
+{
+    if (opt_key == "perimeters"
+        || opt_key == "extra_perimeters"
+        || opt_key == "min_shell_thickness"
+        || opt_key == "gap_fill_speed"
+        || opt_key == "overhangs"
+        || opt_key == "first_layer_extrusion_width"
+        || opt_key == "perimeter_extrusion_width"
+        || opt_key == "thin_walls"
+        || opt_key == "external_perimeters_first") {
+        steps->insert(posPerimeters);
+    } else if (opt_key == "first_layer_extrusion_width") {
+        steps->insert(posSupportMaterial);
+    } else if (opt_key == "solid_infill_below_area") {
+        // prepare_infill() starts again from the fill_surfaces generated along with the perimeters
+        steps->insert(posPrepareInfill);
+    } else if (opt_key == "infill_every_layers"
+        || opt_key == "solid_infill_every_layers"
+        || opt_key == "bottom_solid_layers"
+        || opt_key == "top_solid_layers"
+        || opt_key == "min_top_bottom_shell_thickness"
+        || opt_key == "min_shell_thickness"
+        || opt_key == "infill_extruder"
+        || opt_key == "solid_infill_extruder"
+        || opt_key == "infill_extrusion_width") {
+        steps->insert(posPrepareInfill);
+    } else if (opt_key == "top_infill_pattern"
+        || opt_key == "bottom_infill_pattern"
+        || opt_key == "fill_angle"
+        || opt_key == "fill_pattern"
+        || opt_key == "top_infill_extrusion_width"
+        || opt_key == "first_layer_extrusion_width"
+        || opt_key == "infill_overlap") {
+        steps->insert(posInfill);
+    } else if (opt_key == "solid_infill_extrusion_width") {
+        steps->insert(posPerimeters);
+        steps->insert(posPrepareInfill);
+    } else if (opt_key == "fill_density") {
+        // perimeters only depend on whether the density is 0 or 100%,
+        // bridge_over_infill() depends on its value
+        steps->insert(posPerimeters);
+        steps->insert(posPrepareInfill);
+        steps->insert(posInfill);
+    } else if (opt_key == "external_perimeter_extrusion_width"
+        || opt_key == "perimeter_extruder") {
+        steps->insert(posPerimeters);
+        steps->insert(posSupportMaterial);
+    } else if (opt_key == "bridge_flow_ratio") {
+        steps->insert(posPerimeters);
+        steps->insert(posInfill);
+    } else if (opt_key == "bridge_speed"
+        || opt_key == "external_perimeter_speed"
+        || opt_key == "infill_speed"
+        || opt_key == "perimeter_speed"
+        || opt_key == "small_perimeter_speed"
+        || opt_key == "solid_infill_speed"
+        || opt_key == "top_solid_infill_speed") {
+        // these options only affect G-code export, so nothing to invalidate
+    } else {
+        return false;
+    }
+    return true;
+}
+
 bool
 PrintRegion::invalidate_state_by_config(const PrintConfigBase &config)
 {
@@ -74,71 +141,16 @@ PrintRegion::invalidate_state_by_config(const PrintConfigBase &config)
     bool all = false;
     
     for (const t_config_option_key &opt_key : diff) {
-        if (opt_key == "perimeters"
-            || opt_key == "extra_perimeters"
-            || opt_key == "min_shell_thickness"
-            || opt_key == "gap_fill_speed"
-            || opt_key == "overhangs"
-            || opt_key == "first_layer_extrusion_width"
-            || opt_key == "perimeter_extrusion_width"
-            || opt_key == "thin_walls"
-            || opt_key == "external_perimeters_first") {
-            steps.insert(posPerimeters);
-        } else if (opt_key == "first_layer_extrusion_width") {
-            steps.insert(posSupportMaterial);
-        } else if (opt_key == "solid_infill_below_area") {
-            const float &cur_value = config.opt<ConfigOptionFloat>(opt_key)->value;
-            const float &new_value = this->config.solid_infill_below_area.value;
-            if (new_value >= cur_value) {
-                steps.insert(posPrepareInfill);
-            } else {
-                // prepare_infill is not idempotent when solid_infill_below_area is reduced
-                steps.insert(posPerimeters);
-            }
-        } else if (opt_key == "infill_every_layers"
-            || opt_key == "solid_infill_every_layers"
-            || opt_key == "bottom_solid_layers"
-            || opt_key == "top_solid_layers"
-            || opt_key == "min_top_bottom_shell_thickness"
-            || opt_key == "min_shell_thickness"
-            || opt_key == "infill_extruder"
-            || opt_key == "solid_infill_extruder"
-            || opt_key == "infill_extrusion_width") {
-            steps.insert(posPrepareInfill);
-        } else if (opt_key == "top_infill_pattern"
-            || opt_key == "bottom_infill_pattern"
-            || opt_key == "fill_angle"
-            || opt_key == "fill_pattern"
-            || opt_key == "top_infill_extrusion_width"
-            || opt_key == "first_layer_extrusion_width"
-            || opt_key == "infill_overlap") {
-            steps.insert(posInfill);
-        } else if (opt_key == "solid_infill_extrusion_width") {
-            steps.insert(posPerimeters);
-            steps.insert(posPrepareInfill);
-        } else if (opt_key == "fill_density") {
+        if (opt_key == "fill_density") {
             const float &cur_value = config.opt<ConfigOptionFloat>("fill_density")->value;
             const float &new_value = this->config.fill_density.value;
             if ((cur_value == 0) != (new_value == 0) || (cur_value == 100) != (new_value == 100))
                 steps.insert(posPerimeters);
             
+            // bridge_over_infill() depends on the density
+            steps.insert(posPrepareInfill);
             steps.insert(posInfill);
-        } else if (opt_key == "external_perimeter_extrusion_width"
-            || opt_key == "perimeter_extruder") {
-            steps.insert(posPerimeters);
-            steps.insert(posSupportMaterial);
-        } else if (opt_key == "bridge_flow_ratio") {
-            steps.insert(posPerimeters);
-            steps.insert(posInfill);
-        } else if (opt_key == "bridge_speed"
-            || opt_key == "external_perimeter_speed"
-            || opt_key == "infill_speed"
-            || opt_key == "perimeter_speed"
-            || opt_key == "small_perimeter_speed"
-            || opt_key == "solid_infill_speed"
-            || opt_key == "top_solid_infill_speed") {
-            // these options only affect G-code export, so nothing to invalidate
-        } else {
+        } else if (!PrintRegion::steps_depending_on(opt_key, &steps)) {
             // for legacy, if we can't handle this option let's invalidate all steps
             all = true;
             break;
@@ -148,16 +160,23 @@ PrintRegion::invalidate_state_by_config(const PrintConfigBase &config)
     if (!diff.empty())
         this->config.apply(config, true);
     
+    const PrintRegionPtrs &regions = this->print()->regions;
+    const size_t region_id = std::find(regions.begin(), regions.end(), this) - regions.begin();
+    
     bool invalidated = false;
-    if (all) {
-        for (PrintObject* object : this->print()->objects)
+    for (PrintObject* object : this->print()->objects) {
+        // objects not using this region don't depend on its config
+        const auto volumes = object->region_volumes.find(region_id);
+        if (volumes == object->region_volumes.end() || volumes->second.empty()) continue;
+        
+        if (all) {
             if (object->invalidate_all_steps())
                 invalidated = true;
-    } else {
-        for (const PrintObjectStep &step : steps)
-            for (PrintObject* object : this->print()->objects)
-                if (object->invalidate_step(step))
+        } else {
+            for (const PrintObjectStep &step : steps)
+                if (object->invalidate_region_step(step, region_id))
                     invalidated = true;
+        }
     }
     
     return invalidated;
@@ -36,6 +36,7 @@ SimplePrint::set_model(const Model &model) {
 void
 SimplePrint::export_gcode(std::string outfile) {
     this->_print.status_cb = this->status_cb;
+    this->_print.slice_cache = this->slice_cache;
     this->_print.validate();
     this->_print.export_gcode(outfile);
     
@@ -50,4 +51,13 @@ SimplePrint::export_gcode(std::string outfile) {
     this->_print.status_cb = nullptr;
 }
 
+void
+SimplePrint::export_toolpaths(std::string outfile) {
+    this->_print.status_cb = this->status_cb;
+    this->_print.slice_cache = this->slice_cache;
+    this->_print.validate();
+    this->_print.export_toolpaths(outfile);
+    this->_print.status_cb = nullptr;
+}
+
 }
@@ -12,12 +12,14 @@ class SimplePrint {
     bool arrange{true};
     bool center{true};
     std::function<void(int, const std::string&)> status_cb {nullptr};
+    std::shared_ptr<SliceCache> slice_cache {nullptr};
     
     bool apply_config(DynamicPrintConfig config) { return this->_print.apply_config(config); }
     double total_used_filament() const { return this->_print.total_used_filament; }
     double total_extruded_volume() const { return this->_print.total_extruded_volume; }
     void set_model(const Model &model);
     void export_gcode(std::string outfile);
+    void export_toolpaths(std::string outfile);
     const Model& model() const { return this->_model; };
     const Print& print() const { return this->_print; };
     
@@ -0,0 +1,600 @@
+#include "SliceCache.hpp"
+#include "Log.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/uuid/detail/sha1.hpp>
+
+namespace Slic3r {
+
+/// Bump whenever the layout of the entries or the output of the cached steps changes,
+/// so that entries written by other versions are never reused.
+static const uint32_t SLICE_CACHE_VERSION = 2;
+static const char SLICE_CACHE_MAGIC[4] = { 'S', 'L', 'C', 'E' };
+
+/// SHA-1 of the inputs of a step.
+class _Digest
+{
+    public:
+    void bytes(const void* data, size_t size) { this->_sha1.process_bytes(data, size); };
+    template <class T> void value(T value) { this->bytes(&value, sizeof(T)); };
+    void string(const std::string &s) {
+        this->value<uint64_t>(s.size());
+        this->bytes(s.data(), s.size());
+    };
+    std::string hex() {
+        boost::uuids::detail::sha1::digest_type digest;
+        this->_sha1.get_digest(digest);
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&digest);
+        static const char digits[] = "0123456789abcdef";
+        std::string hex;
+        for (size_t i = 0; i < sizeof(digest); ++i) {
+            hex += digits[bytes[i] >> 4];
+            hex += digits[bytes[i] & 0xf];
+        }
+        return hex;
+    };
+
+    private:
+    boost::uuids::detail::sha1 _sha1;
+};
+
+/// Appends the results of a step to a buffer, in native byte order.
+class _Writer
+{
+    public:
+    std::string data;
+
+    template <class T> void value(T value) {
+        this->data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    };
+    void points(const Points &points) {
+        this->value<uint64_t>(points.size());
+        for (const Point &p : points) {
+            this->value<int64_t>(p.x);
+            this->value<int64_t>(p.y);
+        }
+    };
+    void polygons(const Polygons &polygons) {
+        this->value<uint64_t>(polygons.size());
+        for (const Polygon &polygon : polygons) this->points(polygon.points);
+    };
+    void polylines(const Polylines &polylines) {
+        this->value<uint64_t>(polylines.size());
+        for (const Polyline &polyline : polylines) this->points(polyline.points);
+    };
+    void expolygon(const ExPolygon &expolygon) {
+        this->points(expolygon.contour.points);
+        this->polygons(expolygon.holes);
+    };
+    void expolygons(const ExPolygons &expolygons) {
+        this->value<uint64_t>(expolygons.size());
+        for (const ExPolygon &expolygon : expolygons) this->expolygon(expolygon);
+    };
+    void surfaces(const SurfaceCollection &surfaces) {
+        this->value<uint64_t>(surfaces.surfaces.size());
+        for (const Surface &surface : surfaces.surfaces) {
+            this->value<uint16_t>(surface.surface_type);
+            this->value<double>(surface.thickness);
+            this->value<uint16_t>(surface.thickness_layers);
+            this->value<double>(surface.bridge_angle);
+            this->value<uint16_t>(surface.extra_perimeters);
+            this->expolygon(surface.expolygon);
+        }
+    };
+    void path(const ExtrusionPath &path) {
+        this->value<uint8_t>(path.role);
+        this->value<double>(path.mm3_per_mm);
+        this->value<float>(path.width);
+        this->value<float>(path.height);
+        this->points(path.polyline.points);
+    };
+    void extrusions(const ExtrusionEntityCollection &collection) {
+        this->value<uint8_t>(collection.no_sort);
+        this->value<uint64_t>(collection.entities.size());
+        for (const ExtrusionEntity* entity : collection.entities) {
+            if (entity->is_collection()) {
+                this->value<uint8_t>(eCollection);
+                this->extrusions(*static_cast<const ExtrusionEntityCollection*>(entity));
+            } else if (entity->is_loop()) {
+                const ExtrusionLoop &loop = *static_cast<const ExtrusionLoop*>(entity);
+                this->value<uint8_t>(eLoop);
+                this->value<uint8_t>(loop.role);
+                this->value<uint64_t>(loop.paths.size());
+                for (const ExtrusionPath &path : loop.paths) this->path(path);
+            } else {
+                this->value<uint8_t>(ePath);
+                this->path(*static_cast<const ExtrusionPath*>(entity));
+            }
+        }
+    };
+
+    enum EntityType : uint8_t { ePath, eLoop, eCollection };
+};
+
+/// Decodes the buffer written by _Writer, throwing on truncated or corrupt data.
+class _Reader
+{
+    public:
+    _Reader(const char* data, size_t size) : _data(data), _size(size), _pos(0) {};
+
+    template <class T> T value() {
+        if (this->_size - this->_pos < sizeof(T))
+            throw std::runtime_error("truncated slice cache entry");
+        T value;
+        std::memcpy(&value, this->_data + this->_pos, sizeof(T));
+        this->_pos += sizeof(T);
+        return value;
+    };
+    /// Reads a number of items, which must fit in the rest of the data.
+    size_t count(size_t item_size) {
+        const uint64_t n = this->value<uint64_t>();
+        if (n > (this->_size - this->_pos) / item_size)
+            throw std::runtime_error("corrupt slice cache entry");
+        return size_t(n);
+    };
+    bool at_end() const { return this->_pos == this->_size; };
+
+    void points(Points* points) {
+        points->resize(this->count(2 * sizeof(int64_t)));
+        for (Point &p : *points) {
+            p.x = coord_t(this->value<int64_t>());
+            p.y = coord_t(this->value<int64_t>());
+        }
+    };
+    void polygons(Polygons* polygons) {
+        polygons->resize(this->count(sizeof(uint64_t)));
+        for (Polygon &polygon : *polygons) this->points(&polygon.points);
+    };
+    void polylines(Polylines* polylines) {
+        polylines->resize(this->count(sizeof(uint64_t)));
+        for (Polyline &polyline : *polylines) this->points(&polyline.points);
+    };
+    void expolygon(ExPolygon* expolygon) {
+        this->points(&expolygon->contour.points);
+        this->polygons(&expolygon->holes);
+    };
+    void expolygons(ExPolygons* expolygons) {
+        expolygons->resize(this->count(2 * sizeof(uint64_t)));
+        for (ExPolygon &expolygon : *expolygons) this->expolygon(&expolygon);
+    };
+    void surfaces(SurfaceCollection* surfaces) {
+        const size_t n = this->count(3 * sizeof(uint16_t) + 2 * sizeof(double) + 2 * sizeof(uint64_t));
+        surfaces->surfaces.clear();
+        surfaces->surfaces.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            Surface surface(SurfaceType(this->value<uint16_t>()), ExPolygon());
+            surface.thickness           = this->value<double>();
+            surface.thickness_layers    = this->value<uint16_t>();
+            surface.bridge_angle        = this->value<double>();
+            surface.extra_perimeters    = this->value<uint16_t>();
+            this->expolygon(&surface.expolygon);
+            surfaces->surfaces.push_back(std::move(surface));
+        }
+    };
+    void path(ExtrusionPath* path) {
+        path->role          = ExtrusionRole(this->value<uint8_t>());
+        path->mm3_per_mm    = this->value<double>();
+        path->width         = this->value<float>();
+        path->height        = this->value<float>();
+        this->points(&path->polyline.points);
+    };
+    void extrusions(ExtrusionEntityCollection* collection) {
+        collection->clear();
+        collection->no_sort = this->value<uint8_t>() != 0;
+        const size_t n = this->count(sizeof(uint8_t));
+        collection->entities.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            const uint8_t type = this->value<uint8_t>();
+            if (type == _Writer::eCollection) {
+                ExtrusionEntityCollection* child = new ExtrusionEntityCollection();
+                collection->entities.push_back(child);
+                this->extrusions(child);
+            } else if (type == _Writer::eLoop) {
+                ExtrusionLoop* loop = new ExtrusionLoop(ExtrusionLoopRole(this->value<uint8_t>()));
+                collection->entities.push_back(loop);
+                loop->paths.resize(this->count(sizeof(uint8_t)), ExtrusionPath(erNone));
+                for (ExtrusionPath &path : loop->paths) this->path(&path);
+            } else if (type == _Writer::ePath) {
+                ExtrusionPath* path = new ExtrusionPath(erNone);
+                collection->entities.push_back(path);
+                this->path(path);
+            } else {
+                throw std::runtime_error("corrupt slice cache entry");
+            }
+        }
+    };
+
+    private:
+    const char* _data;
+    size_t _size;
+    size_t _pos;
+};
+
+/// Everything a layer region gets from the cached steps.
+struct _LayerRegionData
+{
+    SurfaceCollection           slices;
+    SurfaceCollection           fill_surfaces;
+    ExtrusionEntityCollection   perimeters;
+    ExtrusionEntityCollection   thin_fills;
+    ExtrusionEntityCollection   fills;
+    Polygons                    bridged;
+    Polylines                   unsupported_bridge_edges;
+};
+
+struct _LayerData
+{
+    int         id;
+    coordf_t    height, print_z, slice_z;
+    bool        slicing_errors;
+    ExPolygons  slices;
+    std::vector<_LayerRegionData> regions;
+};
+
+static const char*
+_step_name(PrintObjectStep step)
+{
+    return step == posSlice ? "slices" : step == posPerimeters ? "perimeters" : "infill";
+}
+
+struct _Entry {
+    boost::filesystem::path path;
+    std::time_t             time;
+    uintmax_t               size;
+};
+
+/// Total size of the entries in directory, which are listed into entries if not NULL.
+static uintmax_t
+_scan(const std::string &directory, std::vector<_Entry>* entries)
+{
+    uintmax_t total = 0;
+    boost::system::error_code ec;
+    for (boost::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != ".slc") continue;
+        _Entry entry { it->path(), boost::filesystem::last_write_time(it->path(), ec), boost::filesystem::file_size(it->path(), ec) };
+        if (ec) continue;
+        total += entry.size;
+        if (entries != nullptr) entries->push_back(entry);
+    }
+    return total;
+}
+
+SliceCache::SliceCache(const std::string &directory, size_t max_size)
+    : _directory(directory), _max_size(max_size), _size(0)
+{
+    boost::filesystem::create_directories(directory);
+    this->_size = _scan(directory, nullptr);
+}
+
+SliceCache::Stats&
+SliceCache::_stats_of(PrintObjectStep step)
+{
+    return this->_stats[step == posSlice ? 0 : step == posPerimeters ? 1 : 2];
+}
+
+SliceCache::Stats
+SliceCache::stats(PrintObjectStep step) const
+{
+    boost::lock_guard<boost::mutex> l(this->_mutex);
+    return this->_stats[step == posSlice ? 0 : step == posPerimeters ? 1 : 2];
+}
+
+std::string
+SliceCache::_path(const std::string &key) const
+{
+    return (boost::filesystem::path(this->_directory) / (key + ".slc")).string();
+}
+
+std::string
+SliceCache::key(const PrintObject &object, PrintObjectStep step) const
+{
+    // layer heights edited by hand are not part of the key
+    if (object.layer_height_spline.layerHeightsUpdated()) return std::string();
+
+    // steps whose options affect the results of step
+    std::set<PrintObjectStep> steps { posLayers, posSlice };
+    if (step != posSlice) steps.insert(posPerimeters);
+    if (step == posInfill) {
+        steps.insert(posDetectSurfaces);
+        steps.insert(posPrepareInfill);
+        steps.insert(posInfill);
+    }
+    auto relevant = [&steps](bool known, const std::set<PrintObjectStep> &osteps) {
+        if (!known) return true;
+        for (PrintObjectStep ostep : osteps)
+            if (steps.count(ostep) > 0) return true;
+        return false;
+    };
+
+    _Digest digest;
+    digest.value<uint32_t>(SLICE_CACHE_VERSION);
+    digest.value<uint32_t>(step);
+
+    const Print &print = *const_cast<PrintObject&>(object).print();
+    for (const t_config_option_key &opt_key : print.config.keys()) {
+        std::set<PrintStep> psteps;
+        std::set<PrintObjectStep> osteps;
+        const bool known = Print::steps_depending_on(opt_key, &psteps, &osteps);
+        if (!relevant(known, osteps)) continue;
+        digest.string(opt_key);
+        digest.string(print.config.serialize(opt_key));
+    }
+    for (const t_config_option_key &opt_key : object.config.keys()) {
+        std::set<PrintObjectStep> osteps;
+        const bool known = PrintObject::steps_depending_on(opt_key, &osteps);
+        if (!relevant(known, osteps)) continue;
+        digest.string(opt_key);
+        digest.string(object.config.serialize(opt_key));
+    }
+    for (const auto &range : object.layer_height_ranges) {
+        digest.value<double>(range.first.first);
+        digest.value<double>(range.first.second);
+        digest.value<double>(range.second);
+    }
+
+    // meshes of each region, as placed by PrintObject::_slice_volumes()
+    const ModelObject &model_object = object.model_object();
+    if (model_object.instances.empty()) return std::string();
+    const TransformationMatrix trafo = model_object.instances.front()->get_trafo_matrix(true);
+    for (double m : { trafo.m00, trafo.m01, trafo.m02, trafo.m03, trafo.m10, trafo.m11,
+        trafo.m12, trafo.m13, trafo.m20, trafo.m21, trafo.m22, trafo.m23 })
+        digest.value<double>(m);
+    digest.value<int64_t>(object._copies_shift.x);
+    digest.value<int64_t>(object._copies_shift.y);
+
+    digest.value<uint64_t>(print.regions.size());
+    for (size_t region_id = 0; region_id < print.regions.size(); ++region_id) {
+        const auto volumes = object.region_volumes.find(region_id);
+        if (volumes == object.region_volumes.end() || volumes->second.empty()) continue;
+        digest.value<uint64_t>(region_id);
+
+        if (step != posSlice) {
+            const PrintRegionConfig &config = print.regions[region_id]->config;
+            for (const t_config_option_key &opt_key : config.keys()) {
+                std::set<PrintObjectStep> osteps;
+                const bool known = PrintRegion::steps_depending_on(opt_key, &osteps);
+                if (!relevant(known, osteps)) continue;
+                digest.string(opt_key);
+                digest.string(config.serialize(opt_key));
+            }
+        }
+
+        for (int volume_id : volumes->second) {
+            const ModelVolume &volume = *model_object.volumes.at(volume_id);
+            const TriangleMesh mesh = volume.mesh();
+            const stl_file &stl = mesh.stl;
+            digest.value<uint8_t>(volume.modifier);
+            digest.value<uint64_t>(stl.stats.number_of_facets);
+            for (int i = 0; i < stl.stats.number_of_facets; ++i)
+                digest.bytes(stl.facet_start[i].vertex, sizeof(stl.facet_start[i].vertex));
+        }
+    }
+    return digest.hex();
+}
+
+bool
+SliceCache::load(PrintObject* object, PrintObjectStep step, const std::string &key)
+{
+    if (key.empty()) return false;
+    const std::string path = this->_path(key);
+
+    bool found = false;
+    try {
+        if (boost::filesystem::exists(path) && boost::filesystem::file_size(path) > 0) {
+            namespace bip = boost::interprocess;
+            const bip::file_mapping file(path.c_str(), bip::read_only);
+            const bip::mapped_region region(file, bip::read_only);
+            _Reader reader(static_cast<const char*>(region.get_address()), region.get_size());
+
+            char magic[4];
+            for (char &c : magic) c = reader.value<char>();
+            if (std::memcmp(magic, SLICE_CACHE_MAGIC, 4) != 0
+                || reader.value<uint32_t>() != SLICE_CACHE_VERSION
+                || reader.value<uint32_t>() != uint32_t(step))
+                throw std::runtime_error("not a slice cache entry");
+
+            // decode everything before touching the object, so that it is left
+            // untouched by corrupt entries
+            const size_t region_count = object->print()->regions.size();
+            // layer height as clamped by generate_object_layers()
+            const double layer_height = step == posSlice ? reader.value<double>() : 0;
+            std::vector<_LayerData> layers(reader.count(sizeof(uint64_t)));
+            if (step != posSlice && layers.size() != object->layers.size())
+                throw std::runtime_error("layer count mismatch");
+            for (_LayerData &layer : layers) {
+                if (step == posSlice) {
+                    layer.id                = int(reader.value<int64_t>());
+                    layer.height            = reader.value<double>();
+                    layer.print_z           = reader.value<double>();
+                    layer.slice_z           = reader.value<double>();
+                    layer.slicing_errors    = reader.value<uint8_t>() != 0;
+                    reader.expolygons(&layer.slices);
+                }
+                layer.regions.resize(reader.count(sizeof(uint64_t)));
+                if (layer.regions.size() != region_count)
+                    throw std::runtime_error("region count mismatch");
+                for (_LayerRegionData &layerm : layer.regions) {
+                    reader.surfaces(&layerm.slices);
+                    if (step == posPerimeters) {
+                        reader.surfaces(&layerm.fill_surfaces);
+                        reader.extrusions(&layerm.perimeters);
+                        reader.extrusions(&layerm.thin_fills);
+                    } else if (step == posInfill) {
+                        reader.surfaces(&layerm.fill_surfaces);
+                        reader.polygons(&layerm.bridged);
+                        reader.polylines(&layerm.unsupported_bridge_edges);
+                        reader.extrusions(&layerm.fills);
+                    }
+                }
+            }
+            if (!reader.at_end())
+                throw std::runtime_error("corrupt slice cache entry");
+
+            if (step == posSlice) {
+                object->config.layer_height.value = layer_height;
+                object->clear_layers();
+                Layer* prev = nullptr;
+                for (_LayerData &data : layers) {
+                    Layer* layer = object->add_layer(data.id, data.height, data.print_z, data.slice_z);
+                    layer->slicing_errors = data.slicing_errors;
+                    layer->slices.expolygons = std::move(data.slices);
+                    if (prev != nullptr) {
+                        prev->upper_layer = layer;
+                        layer->lower_layer = prev;
+                    }
+                    for (size_t region_id = 0; region_id < region_count; ++region_id) {
+                        LayerRegion* layerm = layer->add_region(object->print()->regions[region_id]);
+                        layerm->slices = std::move(data.regions[region_id].slices);
+                        layerm->untyped_slices = layerm->slices;
+                    }
+                    prev = layer;
+                }
+            } else {
+                for (size_t i = 0; i < layers.size(); ++i) {
+                    for (size_t region_id = 0; region_id < region_count; ++region_id) {
+                        LayerRegion* layerm = object->layers[i]->get_region(region_id);
+                        _LayerRegionData &data = layers[i].regions[region_id];
+                        if (step == posPerimeters) {
+                            layerm->untyped_slices          = std::move(data.slices);
+                            layerm->slices                  = layerm->untyped_slices;
+                            layerm->perimeter_fill_surfaces = std::move(data.fill_surfaces);
+                            layerm->fill_surfaces           = layerm->perimeter_fill_surfaces;
+                            layerm->perimeters              = std::move(data.perimeters);
+                            layerm->thin_fills              = std::move(data.thin_fills);
+                            layerm->perimeters_valid        = true;
+                            layerm->fills_valid             = false;
+                        } else {
+                            layerm->slices                  = std::move(data.slices);
+                            layerm->fill_surfaces           = std::move(data.fill_surfaces);
+                            layerm->bridged                 = std::move(data.bridged);
+                            layerm->unsupported_bridge_edges.polylines = std::move(data.unsupported_bridge_edges);
+                            layerm->fills                   = std::move(data.fills);
+                            layerm->filled_surfaces         = layerm->fill_surfaces;
+                            layerm->fills_valid             = true;
+                        }
+                    }
+                }
+            }
+            found = true;
+
+            // mark the entry as recently used
+            boost::filesystem::last_write_time(path, std::time(nullptr));
+        }
+    } catch (std::exception &e) {
+        Slic3r::Log::warn("SliceCache") << "Ignoring " << path << ": " << e.what() << "\n";
+        boost::system::error_code ec;
+        uintmax_t size = boost::filesystem::file_size(path, ec);
+        if (ec) size = 0;
+        if (boost::filesystem::remove(path, ec)) {
+            boost::lock_guard<boost::mutex> l(this->_mutex);
+            this->_size -= std::min(size, this->_size);
+        }
+    }
+
+    boost::lock_guard<boost::mutex> l(this->_mutex);
+    if (found)
+        ++this->_stats_of(step).hits;
+    else
+        ++this->_stats_of(step).misses;
+    return found;
+}
+
+void
+SliceCache::store(const PrintObject &object, PrintObjectStep step, const std::string &key)
+{
+    if (key.empty()) return;
+
+    _Writer writer;
+    for (char c : SLICE_CACHE_MAGIC) writer.value<char>(c);
+    writer.value<uint32_t>(SLICE_CACHE_VERSION);
+    writer.value<uint32_t>(step);
+    if (step == posSlice)
+        writer.value<double>(object.config.layer_height.value);
+    writer.value<uint64_t>(object.layers.size());
+    for (const Layer* layer : object.layers) {
+        if (step == posSlice) {
+            writer.value<int64_t>(layer->id());
+            writer.value<double>(layer->height);
+            writer.value<double>(layer->print_z);
+            writer.value<double>(layer->slice_z);
+            writer.value<uint8_t>(layer->slicing_errors);
+            writer.expolygons(layer->slices.expolygons);
+        }
+        writer.value<uint64_t>(layer->regions.size());
+        for (const LayerRegion* layerm : layer->regions) {
+            if (step == posSlice) {
+                writer.surfaces(layerm->slices);
+            } else if (step == posPerimeters) {
+                writer.surfaces(layerm->untyped_slices);
+                writer.surfaces(layerm->perimeter_fill_surfaces);
+                writer.extrusions(layerm->perimeters);
+                writer.extrusions(layerm->thin_fills);
+            } else {
+                writer.surfaces(layerm->slices);
+                writer.surfaces(layerm->fill_surfaces);
+                writer.polygons(layerm->bridged);
+                writer.polylines(layerm->unsupported_bridge_edges.polylines);
+                writer.extrusions(layerm->fills);
+            }
+        }
+    }
+
+    // write to a private file first, so that concurrent readers never see partial entries
+    const std::string path = this->_path(key);
+    const boost::filesystem::path tmp = boost::filesystem::path(this->_directory)
+        / boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%.tmp");
+    uintmax_t replaced = 0;
+    try {
+        {
+            std::ofstream out(tmp.string(), std::ios::out | std::ios::binary | std::ios::trunc);
+            out.write(writer.data.data(), writer.data.size());
+            if (!out) throw std::runtime_error("write failed");
+        }
+        boost::system::error_code ec;
+        const uintmax_t size = boost::filesystem::file_size(path, ec);
+        if (!ec) replaced = size;
+        boost::filesystem::rename(tmp, path);
+    } catch (std::exception &e) {
+        Slic3r::Log::warn("SliceCache") << "Could not store the " << _step_name(step)
+            << " of " << path << ": " << e.what() << "\n";
+        boost::system::error_code ec;
+        boost::filesystem::remove(tmp, ec);
+        return;
+    }
+
+    boost::lock_guard<boost::mutex> l(this->_mutex);
+    ++this->_stats_of(step).stores;
+    this->_size += writer.data.size();
+    this->_size -= std::min(replaced, this->_size);
+    if (this->_size > this->_max_size)
+        this->_evict();
+}
+
+void
+SliceCache::_evict()
+{
+    // the directory may be shared with other processes: start again from its actual content
+    std::vector<_Entry> entries;
+    this->_size = _scan(this->_directory, &entries);
+    if (this->_size <= this->_max_size) return;
+
+    // leave some room, so that the next stores don't scan the directory again
+    const uintmax_t target = this->_max_size - this->_max_size / 4;
+    std::sort(entries.begin(), entries.end(),
+        [](const _Entry &a, const _Entry &b) { return a.time < b.time; });
+    boost::system::error_code ec;
+    for (const _Entry &entry : entries) {
+        if (this->_size <= target) break;
+        if (boost::filesystem::remove(entry.path, ec))
+            this->_size -= entry.size;
+    }
+}
+
+}
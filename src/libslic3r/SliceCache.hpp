@@ -0,0 +1,61 @@
+#ifndef slic3r_SliceCache_hpp_
+#define slic3r_SliceCache_hpp_
+
+#include "libslic3r.h"
+#include "Print.hpp"
+#include <string>
+#include <boost/thread.hpp>
+
+namespace Slic3r {
+
+/// Persistent cache of the results of posSlice, posPerimeters and posInfill,
+/// shared across runs (and processes) through a directory holding one file per entry.
+/// Entries are named after a digest of everything the step depends on: the meshes
+/// and placement of the object and the options the step or an earlier one depends on,
+/// as told by the steps_depending_on() methods. Options only affecting later steps or
+/// the G-code export don't change the key.
+/// Files are memory-mapped and decoded in place on load; the least recently used ones
+/// are deleted whenever the directory grows beyond max_size bytes.
+class SliceCache
+{
+    public:
+    struct Stats {
+        size_t hits     {0};
+        size_t misses   {0};
+        size_t stores   {0};
+    };
+
+    SliceCache(const std::string &directory, size_t max_size);
+
+    /// Digest of the inputs of step, or an empty string if the object can't be cached.
+    std::string key(const PrintObject &object, PrintObjectStep step) const;
+    /// Restores the results of step into object and returns true, if cached.
+    bool load(PrintObject* object, PrintObjectStep step) { return this->load(object, step, this->key(*object, step)); };
+    /// Same as above, with the key computed beforehand.
+    bool load(PrintObject* object, PrintObjectStep step, const std::string &key);
+    /// Stores the results of step, which must be done.
+    void store(const PrintObject &object, PrintObjectStep step) { this->store(object, step, this->key(object, step)); };
+    /// Same as above, with the key computed by key() before step updated the object
+    /// (posSlice rewrites the layer height, for instance).
+    void store(const PrintObject &object, PrintObjectStep step, const std::string &key);
+    Stats stats(PrintObjectStep step) const;
+    const std::string& directory() const { return this->_directory; };
+
+    private:
+    std::string _directory;
+    size_t _max_size;
+    /// Size of the entries, as last known: the directory is only scanned
+    /// when it is opened and when it grows beyond _max_size
+    uintmax_t _size;
+    Stats _stats[3];
+    mutable boost::mutex _mutex;
+
+    std::string _path(const std::string &key) const;
+    Stats& _stats_of(PrintObjectStep step);
+    /// Deletes the least recently used entries until the directory fits in 3/4 of _max_size.
+    void _evict();
+};
+
+}
+
+#endif
@@ -0,0 +1,432 @@
+#include "ToolpathFile.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#ifdef _WIN32
+#include <boost/nowide/convert.hpp>
+#endif
+
+namespace Slic3r {
+
+const char ToolpathFile::magic[8] = { 'S', 'L', '3', 'R', 'T', 'P', 'T', 'H' };
+const char* const ToolpathFile::layer_marker        = ";_LAYER ";
+const char* const ToolpathFile::layers_end_marker   = ";_LAYERS_END";
+const char* const ToolpathFile::path_marker         = ";_TOOLPATH ";
+const char* const ToolpathFile::path_end_marker     = ";_TOOLPATH_END";
+
+static_assert(sizeof(ToolpathLayer) == 72, "ToolpathLayer must have no padding");
+
+enum ToolpathRecord : unsigned char {
+    trLine, trTail, trAttributes, trMove,
+};
+
+/// Flags of a move record, after the ToolpathAxis bits.
+static const unsigned char _MOVE_RAPID = 32, _MOVE_DECIMALS = 64, _MOVE_SUFFIX = 128;
+
+static const char _AXES[] = "XYZEF";
+/// Decimals of the numbers written by GCodeWriter.
+static const unsigned char _DEFAULT_DECIMALS[5] = { 3, 3, 3, 5, 3 };
+static const double _POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+static const size_t _HEADER_SIZE = sizeof(ToolpathFile::magic) + 2 * sizeof(uint32_t) + 2 * sizeof(ToolpathLayer);
+
+static void
+_put_varint(std::string* data, uint64_t value)
+{
+    while (value >= 0x80) {
+        data->push_back(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    data->push_back(char(value));
+}
+
+template <typename T> static void
+_put(std::string* data, const T &value)
+{
+    data->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/// Text of a number of the G-code from its digits and its number of decimals.
+static void
+_format_number(std::string* out, int64_t mantissa, unsigned char decimals)
+{
+    if (mantissa < 0) out->push_back('-');
+    std::string digits = std::to_string(mantissa < 0 ? -mantissa : mantissa);
+    if (digits.size() <= decimals)
+        digits.insert(0, decimals + 1 - digits.size(), '0');
+    if (decimals > 0)
+        digits.insert(digits.size() - decimals, 1, '.');
+    *out += digits;
+}
+
+ToolpathWriter::ToolpathWriter()
+    : _block(&this->_prologue), _role(erNone), _extruder(0), _width(0), _height(0)
+{
+    std::fill(this->_values, this->_values + 5, 0.);
+    this->_start_block(&this->_prologue, 0);
+}
+
+ToolpathWriter::int_type
+ToolpathWriter::overflow(int_type c)
+{
+    if (c != traits_type::eof()) {
+        const char ch = traits_type::to_char_type(c);
+        this->xsputn(&ch, 1);
+    }
+    return traits_type::not_eof(c);
+}
+
+std::streamsize
+ToolpathWriter::xsputn(const char* s, std::streamsize n)
+{
+    const char* end = s + n;
+    while (s < end) {
+        const char* eol = static_cast<const char*>(std::memchr(s, '\n', end - s));
+        if (eol == nullptr) {
+            this->_line.append(s, end);
+            break;
+        }
+        this->_line.append(s, eol);
+        this->_add_line(this->_line, true);
+        this->_line.clear();
+        s = eol + 1;
+    }
+    return n;
+}
+
+void
+ToolpathWriter::_start_block(Block* block, double print_z)
+{
+    this->_block = block;
+    block->entry = ToolpathLayer { print_z, 0, 0, 0, 0,
+        this->_values[0], this->_values[1], this->_values[2], this->_values[3], this->_values[4] };
+    std::fill(this->_mantissas, this->_mantissas + 5, 0);
+    std::copy(_DEFAULT_DECIMALS, _DEFAULT_DECIMALS + 5, this->_decimals);
+    // readers start each block with no role and the first extruder
+    if (this->_role != erNone || this->_extruder != 0 || this->_width != 0 || this->_height != 0)
+        this->_write_attributes();
+}
+
+void
+ToolpathWriter::_write_attributes()
+{
+    std::string* data = &this->_block->data;
+    data->push_back(char(trAttributes));
+    data->push_back(char(this->_role));
+    _put_varint(data, this->_extruder);
+    _put(data, this->_width);
+    _put(data, this->_height);
+}
+
+void
+ToolpathWriter::_add_line(const std::string &line, bool eol)
+{
+    if (line.size() >= 2 && line[0] == ';' && line[1] == '_') {
+        if (line.compare(0, std::strlen(ToolpathFile::layer_marker), ToolpathFile::layer_marker) == 0) {
+            const double print_z = std::atof(line.c_str() + std::strlen(ToolpathFile::layer_marker));
+            // objects printed together share the block of their layer
+            if (this->_block == &this->_prologue || this->_block->entry.print_z != print_z) {
+                this->_layers.emplace_back();
+                this->_start_block(&this->_layers.back(), print_z);
+            }
+            return;
+        } else if (line == ToolpathFile::layers_end_marker) {
+            this->_start_block(&this->_epilogue, 0);
+            return;
+        } else if (line.compare(0, std::strlen(ToolpathFile::path_marker), ToolpathFile::path_marker) == 0) {
+            const char* p = line.c_str() + std::strlen(ToolpathFile::path_marker);
+            char* next;
+            this->_role     = ExtrusionRole(std::strtol(p, &next, 10));
+            this->_extruder = (unsigned int)std::strtoul(next, &next, 10);
+            this->_width    = std::strtof(next, &next);
+            this->_height   = std::strtof(next, &next);
+            this->_write_attributes();
+            return;
+        } else if (line == ToolpathFile::path_end_marker) {
+            this->_role = erNone;
+            this->_width = this->_height = 0;
+            this->_write_attributes();
+            return;
+        }
+    }
+
+    ++this->_block->entry.lines;
+    if (eol && this->_write_move(line)) {
+        ++this->_block->entry.moves;
+        return;
+    }
+    std::string* data = &this->_block->data;
+    data->push_back(char(eol ? trLine : trTail));
+    _put_varint(data, line.size());
+    data->append(line);
+
+    // tool changes written by GCodeWriter outside of the extrusion paths
+    const size_t digits_end = line.find_first_not_of("0123456789", 1);
+    if (line.size() >= 2 && line[0] == 'T' && digits_end != 1
+        && (digits_end == std::string::npos || line[digits_end] == ' ')) {
+        this->_extruder = (unsigned int)std::atoi(line.c_str() + 1);
+        this->_write_attributes();
+    }
+}
+
+/// Encodes a G0/G1 line whose numbers can be written back identically; returns false
+/// for any other line.
+bool
+ToolpathWriter::_write_move(const std::string &line)
+{
+    if (line.size() < 2 || line[0] != 'G' || (line[1] != '0' && line[1] != '1')
+        || (line.size() > 2 && line[2] != ' ' && line[2] != ';'))
+        return false;
+
+    unsigned char flags = (line[1] == '0') ? _MOVE_RAPID : 0;
+    int64_t mantissas[5];
+    unsigned char decimals[5];
+    size_t pos = 2;
+    for (size_t next_axis = 0; pos + 2 < line.size() && line[pos] == ' '; ) {
+        const char* axis = std::strchr(_AXES + next_axis, line[pos + 1]);
+        if (axis == nullptr || *axis == '\0') break;
+        const size_t a = axis - _AXES;
+
+        size_t i = pos + 2;
+        const bool negative = line[i] == '-';
+        if (negative) ++i;
+        const size_t int_begin = i;
+        while (i < line.size() && line[i] >= '0' && line[i] <= '9') ++i;
+        const size_t int_digits = i - int_begin;
+        if (int_digits == 0 || (int_digits > 1 && line[int_begin] == '0')) return false;
+        size_t dec = 0;
+        if (i < line.size() && line[i] == '.') {
+            ++i;
+            while (i < line.size() && line[i] >= '0' && line[i] <= '9') { ++i; ++dec; }
+            if (dec == 0) return false;
+        }
+        if (int_digits + dec > 18) return false;
+        if (i < line.size() && line[i] != ' ' && line[i] != ';') return false;
+
+        int64_t mantissa = 0;
+        for (size_t k = int_begin; k < i; ++k)
+            if (line[k] != '.') mantissa = mantissa * 10 + (line[k] - '0');
+        if (negative) {
+            // "-0.000" would be written back without its sign
+            if (mantissa == 0) return false;
+            mantissa = -mantissa;
+        }
+        mantissas[a] = mantissa;
+        decimals[a] = (unsigned char)dec;
+        flags |= (unsigned char)(1 << a);
+        next_axis = a + 1;
+        pos = i;
+    }
+    // anything after the numbers must be a comment
+    if (pos < line.size() && line[pos] != ';' && line.compare(pos, 2, " ;") != 0)
+        return false;
+
+    std::string* data = &this->_block->data;
+    for (size_t a = 0; a < 5; ++a)
+        if ((flags & (1 << a)) && decimals[a] != this->_decimals[a])
+            flags |= _MOVE_DECIMALS;
+    if (pos < line.size())
+        flags |= _MOVE_SUFFIX;
+    data->push_back(char(trMove));
+    data->push_back(char(flags));
+    if (flags & _MOVE_DECIMALS)
+        for (size_t a = 0; a < 5; ++a)
+            if (flags & (1 << a)) data->push_back(char(decimals[a]));
+    for (size_t a = 0; a < 5; ++a) {
+        if (!(flags & (1 << a))) continue;
+        const int64_t delta = mantissas[a] - this->_mantissas[a];
+        _put_varint(data, (uint64_t(delta) << 1) ^ uint64_t(delta >> 63));
+        this->_mantissas[a] = mantissas[a];
+        this->_decimals[a]  = decimals[a];
+        this->_values[a]    = double(mantissas[a]) / _POW10[decimals[a]];
+    }
+    if (flags & _MOVE_SUFFIX) {
+        _put_varint(data, line.size() - pos);
+        data->append(line, pos, std::string::npos);
+    }
+    return true;
+}
+
+void
+ToolpathWriter::write(std::ostream &out)
+{
+    if (!this->_line.empty()) {
+        this->_add_line(this->_line, false);
+        this->_line.clear();
+    }
+
+    // blocks follow the header and the layer index, in order
+    uint64_t offset = _HEADER_SIZE + this->_layers.size() * sizeof(ToolpathLayer);
+    const auto place = [&offset](Block &block) {
+        block.entry.offset = offset;
+        block.entry.size   = block.data.size();
+        offset += block.data.size();
+    };
+    place(this->_prologue);
+    for (Block &block : this->_layers) place(block);
+    place(this->_epilogue);
+
+    const uint32_t version = ToolpathFile::version;
+    const uint32_t layer_count = uint32_t(this->_layers.size());
+    out.write(ToolpathFile::magic, sizeof(ToolpathFile::magic));
+    out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    out.write(reinterpret_cast<const char*>(&layer_count), sizeof(layer_count));
+    out.write(reinterpret_cast<const char*>(&this->_prologue.entry), sizeof(ToolpathLayer));
+    out.write(reinterpret_cast<const char*>(&this->_epilogue.entry), sizeof(ToolpathLayer));
+    for (const Block &block : this->_layers)
+        out.write(reinterpret_cast<const char*>(&block.entry), sizeof(ToolpathLayer));
+    out << this->_prologue.data;
+    for (const Block &block : this->_layers)
+        out << block.data;
+    out << this->_epilogue.data;
+}
+
+ToolpathReader::ToolpathReader(const std::string &file)
+    : _data(nullptr), _size(0)
+{
+    using namespace boost::interprocess;
+    try {
+        #ifdef _WIN32
+        file_mapping mapping(boost::nowide::widen(file).c_str(), read_only);
+        #else
+        file_mapping mapping(file.c_str(), read_only);
+        #endif
+        this->_region.reset(new mapped_region(mapping, read_only));
+    } catch (interprocess_exception &e) {
+        throw std::runtime_error("Cannot read toolpath file " + file + ": " + e.what());
+    }
+    this->_data = static_cast<const char*>(this->_region->get_address());
+    this->_size = this->_region->get_size();
+
+    uint32_t version = 0, layer_count = 0;
+    if (this->_size < _HEADER_SIZE
+        || std::memcmp(this->_data, ToolpathFile::magic, sizeof(ToolpathFile::magic)) != 0)
+        throw std::runtime_error(file + " is not a toolpath file");
+    const char* p = this->_data + sizeof(ToolpathFile::magic);
+    std::memcpy(&version, p, sizeof(version));          p += sizeof(version);
+    std::memcpy(&layer_count, p, sizeof(layer_count));  p += sizeof(layer_count);
+    if (version != ToolpathFile::version)
+        throw std::runtime_error(file + " has an unsupported toolpath file version");
+    if (this->_size < _HEADER_SIZE + uint64_t(layer_count) * sizeof(ToolpathLayer))
+        throw std::runtime_error(file + " is truncated");
+    std::memcpy(&this->_prologue, p, sizeof(ToolpathLayer));    p += sizeof(ToolpathLayer);
+    std::memcpy(&this->_epilogue, p, sizeof(ToolpathLayer));    p += sizeof(ToolpathLayer);
+    this->_layers.resize(layer_count);
+    if (layer_count > 0)
+        std::memcpy(&this->_layers.front(), p, layer_count * sizeof(ToolpathLayer));
+
+    const auto check = [this, &file](const ToolpathLayer &block) {
+        if (block.offset > this->_size || block.size > this->_size - block.offset)
+            throw std::runtime_error(file + " is truncated");
+    };
+    check(this->_prologue);
+    check(this->_epilogue);
+    for (const ToolpathLayer &layer : this->_layers) check(layer);
+}
+
+ToolpathReader::~ToolpathReader()
+{
+}
+
+void
+ToolpathReader::moves(size_t layer_idx, const std::function<void(const ToolpathMove&)> &callback) const
+{
+    this->_read_block(this->_layers.at(layer_idx), nullptr, callback);
+}
+
+void
+ToolpathReader::write_gcode(std::ostream &out) const
+{
+    const auto write_line = [&out](const std::string &line, bool eol) {
+        out << line;
+        if (eol) out << '\n';
+    };
+    this->_read_block(this->_prologue, write_line, nullptr);
+    for (const ToolpathLayer &layer : this->_layers)
+        this->_read_block(layer, write_line, nullptr);
+    this->_read_block(this->_epilogue, write_line, nullptr);
+}
+
+void
+ToolpathReader::_read_block(const ToolpathLayer &block,
+    const std::function<void(const std::string &line, bool eol)> &on_line,
+    const std::function<void(const ToolpathMove&)> &on_move) const
+{
+    const char* p   = this->_data + block.offset;
+    const char* end = p + block.size;
+    const auto corrupt = []() { return std::runtime_error("Corrupt toolpath file"); };
+    const auto get_byte = [&p, end, &corrupt]() {
+        if (p >= end) throw corrupt();
+        return (unsigned char)*p++;
+    };
+    const auto get_varint = [&get_byte, &corrupt]() {
+        uint64_t value = 0;
+        for (unsigned int shift = 0; ; shift += 7) {
+            if (shift > 63) throw corrupt();
+            const unsigned char byte = get_byte();
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+    };
+    const auto get_string = [&p, end, &get_varint, &corrupt](std::string* str) {
+        const uint64_t size = get_varint();
+        if (size > uint64_t(end - p)) throw corrupt();
+        str->assign(p, size_t(size));
+        p += size;
+    };
+
+    ToolpathMove move;
+    move.x = block.x; move.y = block.y; move.z = block.z; move.e = block.e; move.f = block.f;
+    double* values[5] = { &move.x, &move.y, &move.z, &move.e, &move.f };
+    int64_t mantissas[5] = { 0, 0, 0, 0, 0 };
+    unsigned char decimals[5];
+    std::copy(_DEFAULT_DECIMALS, _DEFAULT_DECIMALS + 5, decimals);
+    std::string line, suffix;
+    while (p < end) {
+        const unsigned char tag = get_byte();
+        if (tag == trLine || tag == trTail) {
+            get_string(&line);
+            if (on_line) on_line(line, tag == trLine);
+        } else if (tag == trAttributes) {
+            move.role = ExtrusionRole(get_byte());
+            move.extruder = (unsigned int)get_varint();
+            if (end - p < 2 * int(sizeof(float))) throw corrupt();
+            std::memcpy(&move.width, p, sizeof(float));     p += sizeof(float);
+            std::memcpy(&move.height, p, sizeof(float));    p += sizeof(float);
+        } else if (tag == trMove) {
+            const unsigned char flags = get_byte();
+            if (flags & _MOVE_DECIMALS)
+                for (size_t a = 0; a < 5; ++a)
+                    if (flags & (1 << a)) {
+                        decimals[a] = get_byte();
+                        if (decimals[a] > 18) throw corrupt();
+                    }
+            move.rapid = (flags & _MOVE_RAPID) != 0;
+            move.axes  = flags & (taX | taY | taZ | taE | taF);
+            if (on_line) line = move.rapid ? "G0" : "G1";
+            for (size_t a = 0; a < 5; ++a) {
+                if (!(flags & (1 << a))) continue;
+                const uint64_t zigzag = get_varint();
+                mantissas[a] += int64_t(zigzag >> 1) ^ -int64_t(zigzag & 1);
+                *values[a] = double(mantissas[a]) / _POW10[decimals[a]];
+                if (on_line) {
+                    line.push_back(' ');
+                    line.push_back(_AXES[a]);
+                    _format_number(&line, mantissas[a], decimals[a]);
+                }
+            }
+            if (flags & _MOVE_SUFFIX) {
+                get_string(&suffix);
+                if (on_line) line += suffix;
+            }
+            if (on_line) on_line(line, true);
+            if (on_move) on_move(move);
+        } else {
+            throw corrupt();
+        }
+    }
+}
+
+}
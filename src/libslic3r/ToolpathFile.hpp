@@ -0,0 +1,141 @@
+#ifndef slic3r_ToolpathFile_hpp_
+#define slic3r_ToolpathFile_hpp_
+
+#include "libslic3r.h"
+#include "ExtrusionEntity.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace boost { namespace interprocess { class mapped_region; } }
+
+namespace Slic3r {
+
+/// Axes written on a G0/G1 line of a toolpath file.
+enum ToolpathAxis {
+    taX = 1, taY = 2, taZ = 4, taE = 8, taF = 16,
+};
+
+/// A G0/G1 line of a toolpath file, with the state of the machine after it.
+struct ToolpathMove {
+    bool rapid {false};             ///< G0 instead of G1
+    unsigned char axes {0};         ///< ToolpathAxis bits of the axes written on the line
+    ExtrusionRole role {erNone};    ///< erNone for travels, retractions and custom G-code
+    unsigned int extruder {0};
+    float width {0}, height {0};    ///< mm, of the extrusion path the move belongs to
+    double x {0}, y {0}, z {0};     ///< mm
+    double e {0};                   ///< as written, relative or absolute depending on use_relative_e_distances
+    double f {0};                   ///< mm/min
+};
+
+/// Entry of the layer index of a toolpath file, at the head of the file.
+struct ToolpathLayer {
+    double print_z;
+    uint64_t offset;    ///< of the block from the start of the file, in bytes
+    uint64_t size;      ///< of the block, in bytes
+    uint32_t moves;     ///< G0/G1 lines
+    uint32_t lines;     ///< all the lines, including the moves
+    double x, y, z, e, f;   ///< state of the machine at the start of the block
+};
+
+/// Binary form of the G-code of a print, for previews and tools which would otherwise parse
+/// it: a header, the layer index, then a block per layer. The G-code before the first layer
+/// (start G-code, preamble) and after the last one (end G-code, statistics, configuration)
+/// have their own blocks, listed in the header.
+///
+/// Blocks are sequences of records, which start with a tag byte:
+///  - a move: a byte with the axes on the line and the G0, decimals and comment flags;
+///    the number of decimals of each axis, if one differs from the previous move (GCodeWriter's
+///    at the start of a block); for each axis, the difference with its previous value in the
+///    block as an integer of these decimals, in zigzag LEB128; the text after the numbers;
+///  - the role, extruder, width and height of the following moves;
+///  - any other line, verbatim.
+/// Lines are rebuilt byte for byte, so converting the file back gives the G-code PrintGCode
+/// wrote when it was exported. Numbers are stored in the byte order of the machine, which
+/// is little-endian on all supported platforms.
+class ToolpathFile {
+    public:
+    static const char magic[8];
+    static const uint32_t version = 1;
+
+    /// Markers which PrintGCode and GCode put in the G-code when exporting toolpaths, and
+    /// which ToolpathWriter consumes.
+    static const char* const layer_marker;          ///< ;_LAYER <print_z>
+    static const char* const layers_end_marker;     ///< ;_LAYERS_END
+    static const char* const path_marker;           ///< ;_TOOLPATH <role> <extruder> <width> <height>
+    static const char* const path_end_marker;       ///< ;_TOOLPATH_END
+};
+
+/// Encodes the G-code written into it; see ToolpathFile.
+/// Use it as the buffer of the std::ostream PrintGCode writes to, then call write().
+class ToolpathWriter : public std::streambuf {
+    public:
+    ToolpathWriter();
+
+    /// Writes the file, once all the G-code has been written into the buffer.
+    void write(std::ostream &out);
+
+    protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+
+    private:
+    struct Block {
+        ToolpathLayer entry;
+        std::string data;
+    };
+    Block _prologue, _epilogue;
+    std::vector<Block> _layers;
+    Block* _block;
+    std::string _line;
+
+    // state of the machine, and of the encoding of the current block
+    double _values[5];
+    int64_t _mantissas[5];
+    unsigned char _decimals[5];
+    ExtrusionRole _role;
+    unsigned int _extruder;
+    float _width, _height;
+
+    void _add_line(const std::string &line, bool eol);
+    void _start_block(Block* block, double print_z);
+    void _write_attributes();
+    bool _write_move(const std::string &line);
+};
+
+/// Reads a toolpath file, mapped in memory; see ToolpathFile.
+class ToolpathReader {
+    public:
+    /// Throws std::runtime_error if the file cannot be read or is not a toolpath file.
+    explicit ToolpathReader(const std::string &file);
+    ~ToolpathReader();
+
+    size_t layer_count() const { return this->_layers.size(); };
+    const ToolpathLayer& layer(size_t idx) const { return this->_layers.at(idx); };
+
+    /// Calls back for each G0/G1 line of a layer, in order.
+    void moves(size_t layer_idx, const std::function<void(const ToolpathMove&)> &callback) const;
+
+    /// Writes the G-code the file was exported from.
+    void write_gcode(std::ostream &out) const;
+
+    private:
+    std::unique_ptr<boost::interprocess::mapped_region> _region;
+    const char* _data;
+    size_t _size;
+    ToolpathLayer _prologue, _epilogue;
+    std::vector<ToolpathLayer> _layers;
+
+    /// Decodes a block, calling back for each line and for each move; line has no newline.
+    void _read_block(const ToolpathLayer &block,
+        const std::function<void(const std::string &line, bool eol)> &on_line,
+        const std::function<void(const ToolpathMove&)> &on_move) const;
+};
+
+}
+
+#endif
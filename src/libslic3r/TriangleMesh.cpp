@@ -974,7 +974,7 @@ TriangleMeshSlicer<A>::slice(const std::vector<float> &z, std::vector<Polygons>*
         boost::mutex lines_mutex;
         parallelize<int>(
             0,
-            this->mesh->stl.stats.number_of_facets-1,
+            int(this->indexed.facets_count()) - 1,
             boost::bind(&TriangleMeshSlicer<A>::_slice_do, this, _1, &lines, &lines_mutex, z)
         );
     }
@@ -995,17 +995,19 @@ void
 TriangleMeshSlicer<A>::_slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, boost::mutex* lines_mutex, 
     const std::vector<float> &z) const
 {
-    const stl_facet &facet = this->mesh->stl.facet_start[facet_idx];
+    const stl_vertex &v0 = this->indexed.vertex(facet_idx, 0);
+    const stl_vertex &v1 = this->indexed.vertex(facet_idx, 1);
+    const stl_vertex &v2 = this->indexed.vertex(facet_idx, 2);
     
     // find facet extents
-    const float min_z = fminf(_z(facet.vertex[0]), fminf(_z(facet.vertex[1]), _z(facet.vertex[2])));
-    const float max_z = fmaxf(_z(facet.vertex[0]), fmaxf(_z(facet.vertex[1]), _z(facet.vertex[2])));
+    const float min_z = fminf(_z(v0), fminf(_z(v1), _z(v2)));
+    const float max_z = fmaxf(_z(v0), fmaxf(_z(v1), _z(v2)));
     
     #ifdef SLIC3R_DEBUG
     printf("\n==> FACET %zu (%f,%f,%f - %f,%f,%f - %f,%f,%f):\n", facet_idx,
-        _x(facet.vertex[0]), _y(facet.vertex[0]), _z(facet.vertex[0]),
-        _x(facet.vertex[1]), _y(facet.vertex[1]), _z(facet.vertex[1]),
-        _x(facet.vertex[2]), _y(facet.vertex[2]), _z(facet.vertex[2]));
+        _x(v0), _y(v0), _z(v0),
+        _x(v1), _y(v1), _z(v1),
+        _x(v2), _y(v2), _z(v2));
     printf("z: min = %.2f, max = %.2f\n", min_z, max_z);
     #endif
     
@@ -1019,7 +1021,7 @@ TriangleMeshSlicer<A>::_slice_do(size_t facet_idx, std::vector<IntersectionLines
     
     for (std::vector<float>::const_iterator it = min_layer; it != max_layer + 1; ++it) {
         std::vector<float>::size_type layer_idx = it - z.begin();
-        this->slice_facet(*it / SCALING_FACTOR, facet, facet_idx, min_z, max_z, &(*lines)[layer_idx], lines_mutex);
+        this->slice_facet(*it / SCALING_FACTOR, facet_idx, min_z, max_z, &(*lines)[layer_idx], lines_mutex);
     }
 }
 
@@ -1054,7 +1056,7 @@ TriangleMeshSlicer<A>::slice(float z, ExPolygons* slices) const
 
 template <Axis A>
 void
-TriangleMeshSlicer<A>::slice_facet(float slice_z, const stl_facet &facet, const int &facet_idx,
+TriangleMeshSlicer<A>::slice_facet(float slice_z, const int &facet_idx,
     const float &min_z, const float &max_z, std::vector<IntersectionLine>* lines,
     boost::mutex* lines_mutex) const
 {
@@ -1065,31 +1067,32 @@ TriangleMeshSlicer<A>::slice_facet(float slice_z, const stl_facet &facet, const
     /* reorder vertices so that the first one is the one with lowest Z
        this is needed to get all intersection lines in a consistent order
        (external on the right of the line) */
+    const IndexedMesh::Triangle &triangle = this->indexed.triangles[facet_idx];
     int i = 0;
-    if (_z(facet.vertex[1]) == min_z) {
+    if (_z(this->indexed.vertices[triangle[1]]) == min_z) {
         // vertex 1 has lowest Z
         i = 1;
-    } else if (_z(facet.vertex[2]) == min_z) {
+    } else if (_z(this->indexed.vertices[triangle[2]]) == min_z) {
         // vertex 2 has lowest Z
         i = 2;
     }
     for (int j = i; (j-i) < 3; j++) {  // loop through facet edges
         int edge_id = this->facets_edges[facet_idx][j % 3];
-        int a_id = this->mesh->stl.v_indices[facet_idx].vertex[j % 3];
-        int b_id = this->mesh->stl.v_indices[facet_idx].vertex[(j+1) % 3];
+        int a_id = triangle[j % 3];
+        int b_id = triangle[(j+1) % 3];
         stl_vertex* a = &this->v_scaled_shared[a_id];
         stl_vertex* b = &this->v_scaled_shared[b_id];
         
         if (_z(*a) == _z(*b) && _z(*a) == slice_z) {
             // edge is horizontal and belongs to the current layer
             
-            stl_vertex &v0 = this->v_scaled_shared[ this->mesh->stl.v_indices[facet_idx].vertex[0] ];
-            stl_vertex &v1 = this->v_scaled_shared[ this->mesh->stl.v_indices[facet_idx].vertex[1] ];
-            stl_vertex &v2 = this->v_scaled_shared[ this->mesh->stl.v_indices[facet_idx].vertex[2] ];
+            stl_vertex &v0 = this->v_scaled_shared[ triangle[0] ];
+            stl_vertex &v1 = this->v_scaled_shared[ triangle[1] ];
+            stl_vertex &v2 = this->v_scaled_shared[ triangle[2] ];
             IntersectionLine line;
             if (min_z == max_z) {
                 line.edge_type = feHorizontal;
-                if (_z(this->mesh->stl.facet_start[facet_idx].normal) < 0) {
+                if (_z(this->indexed.normal(facet_idx)) < 0) {
                     /*  if normal points downwards this is a bottom horizontal facet so we reverse
                         its point order */
                     std::swap(a, b);
@@ -1229,8 +1232,8 @@ TriangleMeshSlicer<A>::make_loops(std::vector<IntersectionLine> &lines, Polygons
     
     // build a map of lines by edge_a_id and a_id
     std::vector<IntersectionLinePtrs> by_edge_a_id, by_a_id;
-    by_edge_a_id.resize(this->mesh->stl.stats.number_of_facets * 3);
-    by_a_id.resize(this->mesh->stl.stats.shared_vertices);
+    by_edge_a_id.resize(this->indexed.facets_count() * 3);
+    by_a_id.resize(this->indexed.vertices.size());
     for (IntersectionLines::iterator line = lines.begin(); line != lines.end(); ++line) {
         if (line->skip) continue;
         if (line->edge_a_id != -1) by_edge_a_id[line->edge_a_id].push_back(&(*line));
@@ -1447,6 +1450,7 @@ TriangleMeshSlicer<A>::cut(float z, TriangleMesh* upper, TriangleMesh* lower) co
 {
     IntersectionLines upper_lines, lower_lines;
     
+    assert(this->mesh != NULL);
     const float scaled_z = scale_(z);
     for (int facet_idx = 0; facet_idx < this->mesh->stl.stats.number_of_facets; facet_idx++) {
         stl_facet* facet = &this->mesh->stl.facet_start[facet_idx];
@@ -1457,7 +1461,7 @@ TriangleMeshSlicer<A>::cut(float z, TriangleMesh* upper, TriangleMesh* lower) co
         
         // intersect facet with cutting plane
         IntersectionLines lines;
-        this->slice_facet(scaled_z, *facet, facet_idx, min_z, max_z, &lines);
+        this->slice_facet(scaled_z, facet_idx, min_z, max_z, &lines);
         
         // save intersection lines for generating correct triangulations
         for (IntersectionLines::const_iterator it = lines.begin(); it != lines.end(); ++it) {
@@ -1601,24 +1605,38 @@ TriangleMeshSlicer<A>::cut(float z, TriangleMesh* upper, TriangleMesh* lower) co
 template <Axis A>
 TriangleMeshSlicer<A>::TriangleMeshSlicer(TriangleMesh* _mesh) : mesh(_mesh), v_scaled_shared(NULL)
 {
-    // build a table to map a facet_idx to its three edge indices
     this->mesh->require_shared_vertices();
+    this->indexed = IndexedMesh(*this->mesh);
+    this->_init();
+}
+
+template <Axis A>
+TriangleMeshSlicer<A>::TriangleMeshSlicer(IndexedMesh _mesh) : mesh(NULL), indexed(std::move(_mesh)), v_scaled_shared(NULL)
+{
+    this->_init();
+}
+
+template <Axis A>
+void
+TriangleMeshSlicer<A>::_init()
+{
+    // build a table to map a facet_idx to its three edge indices
     typedef std::pair<int,int>              t_edge;
     typedef std::vector<t_edge>             t_edges;  // edge_idx => a_id,b_id
     typedef std::map<t_edge,int>            t_edges_map;  // a_id,b_id => edge_idx
     
-    this->facets_edges.resize(this->mesh->stl.stats.number_of_facets);
+    const int number_of_facets = int(this->indexed.facets_count());
+    this->facets_edges.resize(number_of_facets);
     
     {
         t_edges edges;
         // reserve() instead of resize() because otherwise we couldn't read .size() below to assign edge_idx
-        edges.reserve(this->mesh->stl.stats.number_of_facets * 3);  // number of edges = number of facets * 3
+        edges.reserve(number_of_facets * 3);  // number of edges = number of facets * 3
         t_edges_map edges_map;
-        for (int facet_idx = 0; facet_idx < this->mesh->stl.stats.number_of_facets; facet_idx++) {
-            this->facets_edges[facet_idx].resize(3);
+        for (int facet_idx = 0; facet_idx < number_of_facets; facet_idx++) {
             for (int i = 0; i <= 2; i++) {
-                int a_id = this->mesh->stl.v_indices[facet_idx].vertex[i];
-                int b_id = this->mesh->stl.v_indices[facet_idx].vertex[(i+1) % 3];
+                int a_id = this->indexed.triangles[facet_idx][i];
+                int b_id = this->indexed.triangles[facet_idx][(i+1) % 3];
                 
                 int edge_idx;
                 t_edges_map::const_iterator my_edge = edges_map.find(std::make_pair(b_id,a_id));
@@ -1649,9 +1667,10 @@ TriangleMeshSlicer<A>::TriangleMeshSlicer(TriangleMesh* _mesh) : mesh(_mesh), v_
     }
     
     // clone shared vertices coordinates and scale them
-    this->v_scaled_shared = (stl_vertex*)calloc(this->mesh->stl.stats.shared_vertices, sizeof(stl_vertex));
-    std::copy(this->mesh->stl.v_shared, this->mesh->stl.v_shared + this->mesh->stl.stats.shared_vertices, this->v_scaled_shared);
-    for (int i = 0; i < this->mesh->stl.stats.shared_vertices; i++) {
+    const size_t shared_vertices = this->indexed.vertices.size();
+    this->v_scaled_shared = (stl_vertex*)calloc(shared_vertices, sizeof(stl_vertex));
+    std::copy(this->indexed.vertices.begin(), this->indexed.vertices.end(), this->v_scaled_shared);
+    for (size_t i = 0; i < shared_vertices; i++) {
         this->v_scaled_shared[i].x /= SCALING_FACTOR;
         this->v_scaled_shared[i].y /= SCALING_FACTOR;
         this->v_scaled_shared[i].z /= SCALING_FACTOR;
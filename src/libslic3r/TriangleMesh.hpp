@@ -11,6 +11,7 @@
 #include "Polygon.hpp"
 #include "ExPolygon.hpp"
 #include "TransformationMatrix.hpp"
+#include "IndexedMesh.hpp"
 
 namespace Slic3r {
 
@@ -203,13 +204,17 @@ template <Axis A>
 class TriangleMeshSlicer
 {
     public:
+    /// Only used by cut(), NULL when built from an IndexedMesh.
     TriangleMesh* mesh;
     TriangleMeshSlicer(TriangleMesh* _mesh);
+    /// Builds the slicer on a copy of mesh, whose vertices must be shared by the
+    /// neighbor triangles as they are by TriangleMesh::require_shared_vertices().
+    TriangleMeshSlicer(IndexedMesh _mesh);
     ~TriangleMeshSlicer();
     void slice(const std::vector<float> &z, std::vector<Polygons>* layers) const;
     void slice(const std::vector<float> &z, std::vector<ExPolygons>* layers) const;
     void slice(float z, ExPolygons* slices) const;
-    void slice_facet(float slice_z, const stl_facet &facet, const int &facet_idx,
+    void slice_facet(float slice_z, const int &facet_idx,
         const float &min_z, const float &max_z, std::vector<IntersectionLine>* lines,
         boost::mutex* lines_mutex = NULL) const;
     
@@ -220,9 +225,13 @@ class TriangleMeshSlicer
     void cut(float z, TriangleMesh* upper, TriangleMesh* lower) const;
     
     private:
-    typedef std::vector< std::vector<int> > t_facets_edges;
+    /// Facets and shared vertices the slicer works on, so that it doesn't depend on
+    /// the TriangleMesh once built.
+    IndexedMesh indexed;
+    typedef std::vector< std::array<int,3> > t_facets_edges;
     t_facets_edges facets_edges;
     stl_vertex* v_scaled_shared;
+    void _init();
     void _slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, boost::mutex* lines_mutex, const std::vector<float> &z) const;
     void _make_loops_do(size_t i, std::vector<IntersectionLines>* lines, std::vector<Polygons>* layers) const;
     void make_loops(std::vector<IntersectionLine> &lines, Polygons* loops) const;
@@ -11,6 +11,8 @@
 #endif
 
 #include <math.h>
+#include <atomic>
+#include <exception>
 #include <queue>
 #include <sstream>
 #include <vector>
@@ -110,11 +112,87 @@ inline void append_to(std::vector<T> &dst, const std::vector<T> &src)
     dst.insert(dst.end(), src.begin(), src.end());
 }
 
+/// Thrown by cancellation_point() in a thread whose work was cancelled.
+class CancelledException : public std::exception {
+    public:
+    const char* what() const noexcept override { return "Cancelled"; };
+};
+
+/// Flag to cancel work running on other threads cooperatively: the work checks it at its
+/// cancellation points, between units of work whose results stay consistent.
+class CancellationToken {
+    public:
+    void cancel() { this->_cancelled = true; };
+    /// Clears the flag, before starting work again.
+    void reset() { this->_cancelled = false; };
+    bool cancelled() const { return this->_cancelled; };
+
+    private:
+    std::atomic<bool> _cancelled {false};
+};
+
+/// Token of the work running on the calling thread, or nullptr.
+inline CancellationToken*&
+current_cancellation_token()
+{
+    static thread_local CancellationToken* token = nullptr;
+    return token;
+}
+
+/// Makes token the one of the calling thread for the life of the scope.
+class CancellationScope {
+    public:
+    explicit CancellationScope(CancellationToken* token)
+        : _previous(current_cancellation_token()) { current_cancellation_token() = token; };
+    ~CancellationScope() { current_cancellation_token() = this->_previous; };
+    CancellationScope(const CancellationScope&) = delete;
+    CancellationScope& operator=(const CancellationScope&) = delete;
+
+    private:
+    CancellationToken* _previous;
+};
+
+/// Throws CancelledException if the token of the calling thread is cancelled,
+/// or boost::thread_interrupted if the thread is interrupted.
+inline void
+cancellation_point()
+{
+    const CancellationToken* token = current_cancellation_token();
+    if (token != nullptr && token->cancelled()) throw CancelledException();
+    boost::this_thread::interruption_point();
+}
+
+/// Whether the token of the calling thread is cancelled.
+inline bool
+is_cancelled()
+{
+    const CancellationToken* token = current_cancellation_token();
+    return token != nullptr && token->cancelled();
+}
+
+// The workers of parallelize() run with the token of the calling thread; they stop taking
+// items once it is cancelled, and parallelize() throws once they are all joined, so that
+// no worker outlives the data it works on.
+
+/// Joins the workers, without being interrupted as they use the data of the caller;
+/// then throws if the work is cancelled.
+inline void
+_join_workers(boost::thread_group &workers)
+{
+    {
+        boost::this_thread::disable_interruption no_interruption;
+        workers.join_all();
+    }
+    cancellation_point();
+}
+
 template <class T> void
-_parallelize_do(std::queue<T>* queue, boost::mutex* queue_mutex, boost::function<void(T)> func)
+_parallelize_do(std::queue<T>* queue, boost::mutex* queue_mutex, boost::function<void(T)> func,
+    CancellationToken* token)
 {
+    CancellationScope scope(token);
     //std::cout << "THREAD STARTED: " << boost::this_thread::get_id() << std::endl;
-    while (true) {
+    while (!is_cancelled()) {
         T i;
         {
             boost::lock_guard<boost::mutex> l(*queue_mutex);
@@ -123,8 +201,11 @@ _parallelize_do(std::queue<T>* queue, boost::mutex* queue_mutex, boost::function
             queue->pop();
         }
         //std::cout << "  Thread " << boost::this_thread::get_id() << " processing item " << i << std::endl;
-        func(i);
-        boost::this_thread::interruption_point();
+        try {
+            func(i);
+        } catch (CancelledException &) {
+            return;
+        }
     }
 }
 
@@ -136,16 +217,21 @@ parallelize(std::queue<T> queue, boost::function<void(T)> func,
     boost::mutex queue_mutex;
     boost::thread_group workers;
     for (int i = 0; i < std::min(threads_count, (int)queue.size()); i++)
-        workers.add_thread(new boost::thread(&_parallelize_do<T>, &queue, &queue_mutex, func));
-    workers.join_all();
+        workers.add_thread(new boost::thread(&_parallelize_do<T>, &queue, &queue_mutex, func,
+            current_cancellation_token()));
+    _join_workers(workers);
 }
 
 template <class T> void
-_parallelize_range_static_do(T start, T end, boost::function<void(T)> func)
+_parallelize_range_static_do(T start, T end, boost::function<void(T)> func, CancellationToken* token)
 {
-    for (T i = start; i <= end; ++i) {
-        func(i);
-        boost::this_thread::interruption_point();
+    CancellationScope scope(token);
+    for (T i = start; i <= end && !is_cancelled(); ++i) {
+        try {
+            func(i);
+        } catch (CancelledException &) {
+            return;
+        }
     }
 }
 
@@ -168,10 +254,73 @@ parallelize(T start, T end, boost::function<void(T)> func,
         long long size = chunk_size + (i < remainder ? 1 : 0);
         if (size == 0) break;
         T current_end = current_start + (T)size - 1;
-        workers.add_thread(new boost::thread(&_parallelize_range_static_do<T>, current_start, current_end, func));
+        workers.add_thread(new boost::thread(&_parallelize_range_static_do<T>, current_start, current_end, func,
+            current_cancellation_token()));
         current_start = current_end + 1;
     }
-    workers.join_all();
+    _join_workers(workers);
+}
+
+/// Runs func(i) for each i of [0, ranges.size()) on parallel threads, with the same result
+/// as running them in order, provided that func(i) only reads and writes the items of the
+/// inclusive range ranges[i], which must contain i:
+/// i is only started once every lower index whose range overlaps its own is finished.
+template <class T> void
+parallelize_ordered(const std::vector< std::pair<T,T> > &ranges, boost::function<void(T)> func,
+    int threads_count = boost::thread::hardware_concurrency())
+{
+    if (threads_count == 0) threads_count = 2;
+    const T n = (T)ranges.size();
+    if (n == 0) return;
+    
+    enum { pending, running, done };
+    std::vector<char> status(n, pending);
+    T first_unfinished = 0;
+    boost::mutex mutex;
+    boost::condition_variable changed;
+    
+    CancellationToken* token = current_cancellation_token();
+    auto worker = [&]() {
+        CancellationScope scope(token);
+        boost::unique_lock<boost::mutex> l(mutex);
+        while (first_unfinished < n && !is_cancelled()) {
+            // pick the first pending item not overlapping any lower unfinished one;
+            // as ranges[j] contains j, lower ranges can only overlap from below
+            bool found = false, blocked = false;
+            T i = first_unfinished, max_end = 0;
+            for (; i < n; ++i) {
+                if (status[i] == pending && (!blocked || max_end < ranges[i].first)) {
+                    found = true;
+                    break;
+                }
+                if (status[i] != done) {
+                    max_end = blocked ? std::max(max_end, ranges[i].second) : ranges[i].second;
+                    blocked = true;
+                }
+            }
+            if (!found) {
+                changed.wait(l);
+                continue;
+            }
+            
+            status[i] = running;
+            l.unlock();
+            try {
+                func(i);
+            } catch (CancelledException &) {
+            }
+            l.lock();
+            status[i] = done;
+            while (first_unfinished < n && status[first_unfinished] == done) ++first_unfinished;
+            // wakes the workers waiting for i, to stop if cancelled
+            changed.notify_all();
+        }
+    };
+    
+    boost::thread_group workers;
+    for (int i = 0; i < std::min(threads_count, (int)n); i++)
+        workers.add_thread(new boost::thread(worker));
+    _join_workers(workers);
 }
 
 } // namespace Slic3r
@@ -19,8 +19,11 @@
 // #include "SLAPrint.hpp"
 #include "Print.hpp"
 #include "SimplePrint.hpp"
+#include "SliceCache.hpp"
+#include "ToolpathFile.hpp"
 #include "TriangleMesh.hpp"
 #include "libslic3r.h"
+#include <algorithm>
 #include <cmath>
 #include <chrono>
 #include <cstdio>
@@ -30,8 +33,10 @@
 #include <iostream>
 #include <fstream>
 #include <math.h>
+#include <queue>
 #include <boost/filesystem.hpp>
 #include <boost/nowide/args.hpp>
+#include <boost/nowide/fstream.hpp>
 #include <boost/nowide/iostream.hpp>
 #include <stdexcept>
 #include <sstream>
@@ -345,49 +350,77 @@ int CLI::run(int argc, char **argv) {
                 boost::nowide::cout << "SVG file exported to " << outfile << std::endl;
             }
             */
-        } else if (opt_key == "export_gcode") {
-            for (const Model &model : this->models) {
-                // If all objects have defined instances, their relative positions will be
-                // honored when printing (they will be only centered, unless --dont-arrange
-                // is supplied); if any object has no instances, it will get a default one
-                // and all instances will be rearranged (unless --dont-arrange is supplied).
-                SimplePrint print;
-                print.status_cb = [](int ln, const std::string& msg) {
-                    boost::nowide::cout << msg << std::endl;
-                };
-                print.apply_config(this->print_config);
-                print.arrange = !this->config.getBool("dont_arrange", false);
-                print.center = !this->config.has("center")
-                    && !this->config.has("align_xy")
-                    && print.arrange;
-                Slic3r::Log::error("CLI") << "Arrange: " << print.arrange<< ", center: " << print.center << std::endl;
-                print.set_model(model);
-                
-                // start chronometer
-                typedef std::chrono::high_resolution_clock clock_;
-                typedef std::chrono::duration<double, std::ratio<1> > second_;
-                std::chrono::time_point<clock_> t0{ clock_::now() };
-                
-                const std::string outfile = this->output_filepath(model, IO::Gcode);
+        } else if (opt_key == "export_gcode" || opt_key == "export_toolpaths") {
+            const IO::ExportFormat format = (opt_key == "export_gcode") ? IO::Gcode : IO::Toolpaths;
+            // entries are shared by all the models and later runs
+            std::shared_ptr<SliceCache> slice_cache;
+            if (!this->config.getString("cache_dir", "").empty()) {
                 try {
-                    print.export_gcode(outfile);
-                } catch (std::runtime_error &e) {
-                    Slic3r::Log::error("CLI") << e.what() << std::endl;
-                    exit(EXIT_FAILURE);
+                    slice_cache = std::make_shared<SliceCache>(this->config.getString("cache_dir"),
+                        size_t(std::max(0, this->config.getInt("cache_size", 1024))) * 1024 * 1024);
+                } catch (std::exception &e) {
+                    Slic3r::Log::error("CLI") << "Slice cache disabled: " << e.what() << std::endl;
                 }
-                Slic3r::Log::info("CLI") << "G-code exported to " << outfile << std::endl;
-                this->last_outfile = outfile;
-                
-                // output some statistics
-                double duration { std::chrono::duration_cast<second_>(clock_::now() - t0).count() };
-                boost::nowide::cout << std::fixed << std::setprecision(0)
-                    << "Done. Process took " << (duration/60) << " minutes and "
-                    << std::setprecision(3)
-                    << std::fmod(duration, 60.0) << " seconds." << std::endl
-                    << std::setprecision(2)
-                    << "Filament required: " << print.total_used_filament() << "mm"
-                    << " (" << print.total_extruded_volume()/1000 << "cm3)" << std::endl;
             }
+            // slice several files at once, dividing the threads of --threads among them
+            const int jobs = std::max(1, std::min(this->config.getInt("batch_jobs", 1), int(this->models.size())));
+            const int threads = std::max(1, this->full_print_config.threads.value / jobs);
+            std::vector<GCodeJob> results(this->models.size());
+            std::vector<bool> done(this->models.size(), false);
+            size_t reported = 0;
+            boost::mutex report_mutex;
+            std::queue<size_t> queue;
+            for (size_t i = 0; i < this->models.size(); ++i)
+                queue.push(i);
+            parallelize<size_t>(
+                queue,
+                [this, format, &slice_cache, jobs, threads, &results, &done, &reported, &report_mutex](size_t i) {
+                    GCodeJob job = this->export_gcode(this->models[i], format, slice_cache, threads, jobs > 1);
+                    boost::lock_guard<boost::mutex> l(report_mutex);
+                    results[i] = std::move(job);
+                    done[i] = true;
+                    // report each file as soon as all the previous ones are reported
+                    for (; reported < results.size() && done[reported]; ++reported)
+                        this->report(results[reported]);
+                },
+                jobs
+            );
+            
+            if (!this->config.getString("batch_summary", "").empty())
+                this->write_batch_summary(results, this->config.getString("batch_summary"));
+            if (slice_cache != nullptr) {
+                for (PrintObjectStep step : { posSlice, posPerimeters, posInfill }) {
+                    const SliceCache::Stats stats = slice_cache->stats(step);
+                    boost::nowide::cout << "Slice cache (" << (step == posSlice ? "slices" : step == posPerimeters ? "perimeters" : "infill")
+                        << "): " << stats.hits << " hits, " << stats.misses << " misses, "
+                        << stats.stores << " stored" << std::endl;
+                }
+            }
+            
+            const size_t failed = std::count_if(results.begin(), results.end(),
+                [](const GCodeJob &job) { return !job.error.empty(); });
+            if (failed > 0) {
+                Slic3r::Log::error("CLI") << failed << " of " << results.size() << " files failed" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        } else if (opt_key == "toolpaths_to_gcode") {
+            const std::string infile{ this->config.getString("toolpaths_to_gcode") };
+            std::string outfile{ this->config.getString("output", "") };
+            if (outfile.empty())
+                outfile = boost::filesystem::path(infile).replace_extension(".gcode").string();
+            try {
+                ToolpathReader reader(infile);
+                boost::nowide::ofstream out(outfile, std::ios::out | std::ios::binary);
+                reader.write_gcode(out);
+                out.close();
+                if (out.fail())
+                    throw std::runtime_error("Cannot write " + outfile);
+            } catch (std::exception &e) {
+                Slic3r::Log::error("CLI") << infile << ": " << e.what() << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            Slic3r::Log::info("CLI") << "G-code exported to " << outfile << std::endl;
+            this->last_outfile = outfile;
         } else if (opt_key == "print") {
             if (this->models.size() > 1) {
                 Slic3r::Log::error("CLI") <<  "error: --print is not supported for multiple jobs" << std::endl;
@@ -410,21 +443,29 @@ int CLI::run(int argc, char **argv) {
                 exit(EXIT_FAILURE);
             }
 
+            // Map the file, which is read from disk as it is sent
+            std::shared_ptr<GCodeFile> file;
+            try {
+                file = std::make_shared<GCodeFile>(gcode_file);
+            } catch (std::exception &e) {
+                Slic3r::Log::error("CLI") << "error: " << e.what() << std::endl;
+                exit(EXIT_FAILURE);
+            }
+
             // Connect to printer
             Slic3r::GCodeSender sender;
+            sender.set_window(
+                this->print_config.getInt("serial_window", 1),
+                this->print_config.getInt("serial_window_bytes", 0)
+            );
             sender.connect(
                 this->print_config.getString("serial_port"),
                 this->print_config.getInt("serial_speed")
             );
-            while (!sender.is_connected()) {}
+            while (!sender.wait_connected()) {}
             boost::nowide::cout << "Connected to printer" << std::endl;
 
-            // Send file line-by-line
-            std::ifstream infile(gcode_file);
-            std::string line;
-            while (std::getline(infile, line)) {
-                sender.send(line);
-            }
+            sender.send(file);
 
             // Print queue size
             while (sender.queue_size() > 0) {
@@ -493,6 +534,120 @@ CLI::print_help(bool include_print_options) const {
     }
 }
 
+CLI::GCodeJob
+CLI::export_gcode(const Model &model, IO::ExportFormat format,
+    const std::shared_ptr<SliceCache> &slice_cache, int threads, bool buffer_status) const {
+    GCodeJob job;
+    job.format = format;
+    for (auto o : model.objects) {
+        if (!o->input_file.empty()) {
+            job.input_file = o->input_file;
+            break;
+        }
+    }
+    
+    // start chronometer
+    typedef std::chrono::high_resolution_clock clock_;
+    typedef std::chrono::duration<double, std::ratio<1> > second_;
+    std::chrono::time_point<clock_> t0{ clock_::now() };
+    
+    // If all objects have defined instances, their relative positions will be
+    // honored when printing (they will be only centered, unless --dont-arrange
+    // is supplied); if any object has no instances, it will get a default one
+    // and all instances will be rearranged (unless --dont-arrange is supplied).
+    SimplePrint print;
+    if (buffer_status) {
+        print.status_cb = [&job](int ln, const std::string& msg) {
+            job.log += msg + "\n";
+        };
+    } else {
+        print.status_cb = [](int ln, const std::string& msg) {
+            boost::nowide::cout << msg << std::endl;
+        };
+    }
+    DynamicPrintConfig config = this->print_config;
+    config.opt<ConfigOptionInt>("threads", true)->value = threads;
+    print.apply_config(config);
+    print.arrange = !this->config.getBool("dont_arrange", false);
+    print.center = !this->config.has("center")
+        && !this->config.has("align_xy")
+        && print.arrange;
+    print.slice_cache = slice_cache;
+    
+    try {
+        print.set_model(model);
+        job.outfile = this->output_filepath(model, format);
+        if (format == IO::Toolpaths)
+            print.export_toolpaths(job.outfile);
+        else
+            print.export_gcode(job.outfile);
+        job.used_filament = print.total_used_filament();
+        job.extruded_volume = print.total_extruded_volume();
+    } catch (std::exception &e) {
+        job.error = e.what();
+    }
+    job.duration = std::chrono::duration_cast<second_>(clock_::now() - t0).count();
+    return job;
+}
+
+void
+CLI::report(const GCodeJob &job) {
+    boost::nowide::cout << job.log;
+    if (!job.error.empty()) {
+        Slic3r::Log::error("CLI") << job.input_file << ": " << job.error << std::endl;
+        return;
+    }
+    if (job.format == IO::Toolpaths) {
+        Slic3r::Log::info("CLI") << "Toolpaths exported to " << job.outfile << std::endl;
+    } else {
+        Slic3r::Log::info("CLI") << "G-code exported to " << job.outfile << std::endl;
+        this->last_outfile = job.outfile;
+    }
+    
+    // output some statistics
+    boost::nowide::cout << std::fixed << std::setprecision(0)
+        << "Done. Process took " << (job.duration/60) << " minutes and "
+        << std::setprecision(3)
+        << std::fmod(job.duration, 60.0) << " seconds." << std::endl
+        << std::setprecision(2)
+        << "Filament required: " << job.used_filament << "mm"
+        << " (" << job.extruded_volume/1000 << "cm3)" << std::endl;
+}
+
+void
+CLI::write_batch_summary(const std::vector<GCodeJob> &jobs, const std::string &file) const {
+    const auto quote = [](const std::string &str) {
+        std::ostringstream ss;
+        ss << '"';
+        for (const char c : str) {
+            if (c == '"' || c == '\\') ss << '\\' << c;
+            else if (c == '\n') ss << "\\n";
+            else if (static_cast<unsigned char>(c) < 0x20) ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec;
+            else ss << c;
+        }
+        ss << '"';
+        return ss.str();
+    };
+    
+    boost::nowide::ofstream out(file);
+    out << std::fixed << std::setprecision(3) << "[" << std::endl;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const GCodeJob &job = jobs[i];
+        out << "  {"
+            << "\"input\": " << quote(job.input_file) << ", "
+            << "\"output\": " << quote(job.outfile) << ", "
+            << "\"ok\": " << (job.error.empty() ? "true" : "false") << ", "
+            << "\"error\": " << quote(job.error) << ", "
+            << "\"seconds\": " << job.duration << ", "
+            << "\"filament_mm\": " << job.used_filament << ", "
+            << "\"filament_cm3\": " << job.extruded_volume/1000
+            << "}" << (i + 1 < jobs.size() ? "," : "") << std::endl;
+    }
+    out << "]" << std::endl;
+    if (!out)
+        Slic3r::Log::error("CLI") << "Cannot write the batch summary to " << file << std::endl;
+}
+
 void
 CLI::export_models(IO::ExportFormat format) {
     for (const Model& model : this->models) {
@@ -511,6 +666,8 @@ CLI::output_filepath(const Model &model, IO::ExportFormat format) const {
     // strip the file extension and add the correct one
     filename_format = filename_format.substr(0, filename_format.find_last_of("."));
     filename_format += "." + IO::extensions.at(format);
+    if (format == IO::Gcode && this->print_config.getBool("gcode_compression", false))
+        filename_format += ".gz";
     
     // this is the same logic used in Print::output_filepath()
     // TODO: factor it out to a single place?
@@ -4,9 +4,12 @@
 #include "ConfigBase.hpp"
 #include "IO.hpp"
 #include "Model.hpp"
+#include <memory>
 
 namespace Slic3r {
 
+class SliceCache;
+
 class CLI {
     public:
     int run(int argc, char **argv);
@@ -29,10 +32,34 @@ class CLI {
     void export_models(IO::ExportFormat format);
     
     bool has_print_action() const {
-        return this->config.has("export_gcode") || this->config.has("export_sla_svg");
+        return this->config.has("export_gcode") || this->config.has("export_toolpaths")
+            || this->config.has("export_sla_svg");
     };
     
     std::string output_filepath(const Model &model, IO::ExportFormat format) const;
+    
+    /// Outcome of the G-code or toolpaths export of one model, reported in the order of the input files.
+    struct GCodeJob {
+        IO::ExportFormat format {IO::Gcode};   ///< Gcode or Toolpaths
+        std::string input_file;
+        std::string outfile;
+        std::string log;            ///< status messages, when they are not printed right away
+        std::string error;          ///< empty if the G-code was exported
+        double duration {0};        ///< seconds
+        double used_filament {0};   ///< mm
+        double extruded_volume {0}; ///< mm3
+    };
+    
+    /// Slices a model and exports its G-code or toolpaths, using at most the given number of threads.
+    /// Status messages are collected in the log of the job if buffer_status is set.
+    GCodeJob export_gcode(const Model &model, IO::ExportFormat format,
+        const std::shared_ptr<SliceCache> &slice_cache, int threads, bool buffer_status) const;
+    
+    /// Prints the outcome of an exported model.
+    void report(const GCodeJob &job);
+    
+    /// Writes the outcome of all the exported models to a JSON file.
+    void write_batch_summary(const std::vector<GCodeJob> &jobs, const std::string &file) const;
 };
 
 }
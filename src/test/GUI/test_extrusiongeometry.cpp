@@ -0,0 +1,132 @@
+#include <catch2/catch.hpp>
+#include "ExtrusionGeometry.hpp"
+#include "Model.hpp"
+#include "Print.hpp"
+#include <algorithm>
+
+using namespace Slic3r;
+
+typedef ExtrusionGeometry::InstanceBuffer InstanceBuffer;
+
+/// Perimeters in a buffer, everything else in another.
+static ExtrusionGeometry::RoleColors
+_colors()
+{
+    ExtrusionGeometry::RoleColors colors;
+    for (int role = erNone; role <= erSupportMaterialInterface; ++role) {
+        const float shade = float(role) / erSupportMaterialInterface;
+        colors.push_back({ (role == erPerimeter || role == erExternalPerimeter) ? 1u : 2u,
+            { shade, shade, shade, 1.0f } });
+    }
+    return colors;
+}
+
+/// Adds the layers in a single call, in parallel over the buffers.
+static void
+_add(const std::vector<ExtrusionGeometry::LayerInstances> &layers, InstanceBuffer* perimeters, InstanceBuffer* others)
+{
+    ExtrusionGeometry::add_instanced(layers, { { 1u, perimeters }, { 2u, others } }, 2);
+}
+
+/// Instances of a key, in the layers up to print_z.
+static size_t
+_count(const std::vector<ExtrusionGeometry::LayerInstances> &layers, uint32_t key, double print_z)
+{
+    size_t count = 0;
+    for (const ExtrusionGeometry::LayerInstances &layer : layers) {
+        const auto chunk = layer.chunks.find(key);
+        if (layer.print_z <= print_z && chunk != layer.chunks.end()) count += chunk->second.size();
+    }
+    return count;
+}
+
+SCENARIO("Instance buffers keep the toolpaths ordered by layer") {
+    GIVEN("The instances of the layers of a cylinder, built on parallel threads") {
+        Model model;
+        model.add_object()->add_volume(TriangleMesh::make_cylinder(10, 5, 2*PI/60));
+        model.add_default_instances();
+        model.center_instances_around_point(Pointf(100, 100));
+        Print print;
+        DynamicPrintConfig config;
+        config.apply(FullPrintConfig());
+        print.apply_config(config);
+        print.add_model_object(model.objects.front());
+        print.process();
+        std::vector<const Layer*> print_layers(print.objects.front()->layers.begin(), print.objects.front()->layers.end());
+        REQUIRE(print_layers.size() > 10);
+        // as they are finished, in no particular order
+        std::reverse(print_layers.begin(), print_layers.end());
+        const std::vector<ExtrusionGeometry::LayerInstances> layers
+            = ExtrusionGeometry::layers_to_instanced(print_layers, _colors(), 4);
+        REQUIRE(layers.size() == print_layers.size());
+        for (size_t i = 1; i < layers.size(); ++i)
+            REQUIRE(layers[i - 1].print_z < layers[i].print_z);
+
+        InstanceBuffer perimeters, others;
+        const auto check = [&layers, &perimeters, &others]() {
+            for (uint32_t key : { 1u, 2u }) {
+                const InstanceBuffer &buffer = (key == 1u) ? perimeters : others;
+                REQUIRE(buffer.instances.size() == _count(layers, key, 1e9));
+                for (const ExtrusionGeometry::LayerInstances &layer : layers) {
+                    REQUIRE(buffer.count_up_to(layer.print_z) == _count(layers, key, layer.print_z));
+                    REQUIRE(buffer.count_up_to(layer.print_z - 0.01) == _count(layers, key, layer.print_z - 0.01));
+                }
+                // the instances of a layer are below the ones of the next layers
+                for (size_t i = 1; i < buffer.instances.size(); ++i)
+                    REQUIRE(buffer.instances[i - 1].posA[2] <= buffer.instances[i].posA[2]);
+            }
+        };
+
+        WHEN("they are added at once") {
+            _add(layers, &perimeters, &others);
+            THEN("the instances up to each layer are a prefix") {
+                check();
+                REQUIRE(perimeters.count_up_to(0) == 0);
+            }
+        }
+        WHEN("they are added by increasing Z, a few layers at a time") {
+            for (size_t i = 0; i < layers.size(); i += 3) {
+                perimeters.unchanged = perimeters.instances.size();
+                others.unchanged = others.instances.size();
+                const size_t size = perimeters.instances.size();
+                _add(std::vector<ExtrusionGeometry::LayerInstances>(layers.begin() + i,
+                    layers.begin() + std::min(i + 3, layers.size())), &perimeters, &others);
+                REQUIRE(perimeters.unchanged == size);
+            }
+            THEN("the instances up to each layer are a prefix, and are only appended") {
+                check();
+            }
+        }
+        WHEN("the upper layers are added before the lower ones") {
+            const size_t half = layers.size() / 2;
+            _add(std::vector<ExtrusionGeometry::LayerInstances>(layers.begin() + half, layers.end()), &perimeters, &others);
+            perimeters.unchanged = perimeters.instances.size();
+            _add(std::vector<ExtrusionGeometry::LayerInstances>(layers.begin(), layers.begin() + half), &perimeters, &others);
+            THEN("they are merged, and all the instances have to be uploaded again") {
+                check();
+                REQUIRE(perimeters.unchanged == 0);
+            }
+        }
+        WHEN("a layer in the middle is added last") {
+            const size_t middle = layers.size() / 2;
+            std::vector<ExtrusionGeometry::LayerInstances> all_but_middle(layers);
+            all_but_middle.erase(all_but_middle.begin() + middle);
+            _add(all_but_middle, &perimeters, &others);
+            perimeters.unchanged = perimeters.instances.size();
+            _add({ layers[middle] }, &perimeters, &others);
+            THEN("the instances of the layers below it are left unchanged") {
+                check();
+                REQUIRE(perimeters.unchanged == _count(layers, 1u, layers[middle - 1].print_z));
+            }
+        }
+        WHEN("the buffer is cleared") {
+            _add(layers, &perimeters, &others);
+            perimeters.unchanged = perimeters.instances.size();
+            perimeters.clear();
+            THEN("it is empty") {
+                REQUIRE(perimeters.count_up_to(1e9) == 0);
+                REQUIRE(perimeters.unchanged == 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,171 @@
+#ifndef slic3r_test_pty_firmware_hpp_
+#define slic3r_test_pty_firmware_hpp_
+
+// Printer firmware simulated behind a pseudo-terminal, for the tests of GCodeSender.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace Slic3r { namespace Test {
+
+/// Answers the numbered lines written to its terminal as Marlin or Grbl do. Lines are
+/// answered once the sender stops writing, so that its whole window is in flight.
+class PtyFirmware {
+    public:
+    enum Flavor { Marlin, Grbl };
+
+    explicit PtyFirmware(Flavor flavor = Marlin) : _flavor(flavor) {
+        this->_master = ::posix_openpt(O_RDWR | O_NOCTTY);
+        if (this->_master < 0 || ::grantpt(this->_master) != 0 || ::unlockpt(this->_master) != 0)
+            throw std::runtime_error("cannot open a pseudo-terminal");
+        this->_device = ::ptsname(this->_master);
+        // keeps the terminal up while the sender closes and opens it again
+        this->_slave = ::open(this->_device.c_str(), O_RDWR | O_NOCTTY);
+        this->_thread = std::thread([this]() { this->_run(); });
+    };
+    ~PtyFirmware() {
+        this->_stop = true;
+        this->_thread.join();
+        ::close(this->_slave);
+        ::close(this->_master);
+    };
+
+    /// Terminal to connect the sender to.
+    const std::string& device() const { return this->_device; };
+    /// Sends the banner of a firmware that just started.
+    void greet() { this->_write(this->_flavor == Grbl ? "Grbl 1.1h ['$' for help]\n" : "start\n"); };
+    /// The first time it is received, line n fails its checksum (Marlin) or is rejected
+    /// with an error (Grbl).
+    void corrupt_line(size_t n) {
+        std::lock_guard<std::mutex> l(this->_mutex);
+        this->_corrupt.insert(n);
+    };
+
+    /// Commands of the accepted lines, in order, without line number and checksum.
+    std::vector<std::string> commands() const {
+        std::lock_guard<std::mutex> l(this->_mutex);
+        return this->_commands;
+    };
+    /// Most lines taking room in the buffer of the printer at once: those received and not
+    /// answered yet, but the ones Marlin rejects for their number, which it discards.
+    size_t max_in_flight() const { return this->_max_in_flight; };
+    /// Most bytes received and not answered yet at once.
+    size_t max_bytes_in_flight() const { return this->_max_bytes_in_flight; };
+    /// Requests to resend a line, and errors.
+    size_t errors() const { return this->_errors; };
+
+    private:
+    Flavor _flavor;
+    int _master {-1}, _slave {-1};
+    std::string _device;
+    std::thread _thread;
+    std::atomic<bool> _stop {false};
+    mutable std::mutex _mutex;
+    std::set<size_t> _corrupt;
+    std::vector<std::string> _commands;
+    size_t _last_line {0};
+    std::atomic<size_t> _max_in_flight {0}, _max_bytes_in_flight {0}, _errors {0};
+
+    void _write(const std::string &s) {
+        for (size_t done = 0; done < s.size(); ) {
+            const ssize_t n = ::write(this->_master, s.data() + done, s.size() - done);
+            if (n <= 0) return;
+            done += size_t(n);
+        }
+    };
+
+    void _run() {
+        std::string buffer;
+        std::vector<std::string> lines;
+        char chunk[4096];
+        while (!this->_stop) {
+            pollfd fd { this->_master, POLLIN, 0 };
+            if (::poll(&fd, 1, 20) > 0 && (fd.revents & POLLIN)) {
+                const ssize_t n = ::read(this->_master, chunk, sizeof(chunk));
+                if (n <= 0) continue;
+                buffer.append(chunk, size_t(n));
+                for (size_t eol; (eol = buffer.find('\n')) != std::string::npos; buffer.erase(0, eol + 1)) {
+                    std::string line = buffer.substr(0, eol);
+                    if (!line.empty() && line.back() == '\r') line.pop_back();
+                    if (!line.empty()) lines.push_back(line);
+                }
+                continue;
+            }
+            // the sender is waiting: answer
+            size_t in_flight = 0, bytes = 0;
+            for (const std::string &line : lines) {
+                bool discarded = false;
+                this->_write(this->_answer(line, &discarded));
+                if (!discarded) ++in_flight;
+                bytes += line.size() + 1;
+            }
+            this->_max_in_flight = std::max(size_t(this->_max_in_flight), in_flight);
+            this->_max_bytes_in_flight = std::max(size_t(this->_max_bytes_in_flight), bytes);
+            lines.clear();
+        }
+    };
+
+    std::string _answer(const std::string &line, bool* discarded) {
+        std::lock_guard<std::mutex> l(this->_mutex);
+        size_t n = 0;
+        std::string command = line;
+        const size_t star = line.rfind('*');
+        if (line[0] == 'N' && star != std::string::npos) {
+            int cs = 0;
+            for (size_t i = 0; i < star; ++i) cs ^= line[i];
+            const size_t space = line.find(' ');
+            n = std::strtoul(line.c_str() + 1, nullptr, 10);
+            command = line.substr(space + 1, star - space - 1);
+            if (cs != std::atoi(line.c_str() + star + 1))
+                this->_corrupt.insert(n);
+        }
+        const bool corrupt = this->_corrupt.erase(n) > 0;
+        if (this->_flavor == Grbl) {
+            // Grbl rejects the line and goes on with the next one
+            if (corrupt) {
+                ++this->_errors;
+                return "error:20\n";
+            }
+            this->_commands.push_back(command);
+            return "ok\n";
+        }
+        if (corrupt || n != this->_last_line + 1) {
+            ++this->_errors;
+            *discarded = !corrupt;
+            return std::string(corrupt ? "Error:checksum mismatch" : "Error:Line Number is not Last Line Number+1")
+                + ", Last Line: " + std::to_string(this->_last_line) + "\n"
+                + "Resend: " + std::to_string(this->_last_line + 1) + "\nok\n";
+        }
+        this->_last_line = n;
+        this->_commands.push_back(command);
+        return "ok\n";
+    };
+};
+
+/// Polls condition until it holds, for up to timeout seconds.
+inline bool
+wait_for(std::function<bool()> condition, double timeout = 10)
+{
+    const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > end) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+} }
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef _WIN32
+
+#include <catch2/catch.hpp>
+#include "pty_firmware.hpp"
+#include "FileWriter.hpp"
+#include "GCodeSender.hpp"
+#include <fstream>
+#include <boost/filesystem.hpp>
+
+using namespace Slic3r;
+using namespace Slic3r::Test;
+
+// three layers, with E positions needing all their decimals
+static const char* _gcode =
+    "; generated for the tests\n"
+    "G21\n"
+    "G90\n"
+    "M82\n"
+    "G92 E0\n"
+    "G1 Z0.300 F7800.000\n"
+    "G1 X10.000 Y10.000 F7800.000\n"
+    "G1 X20.000 Y10.000 E1.23456 F1800.000\n"
+    "G1 X20.000 Y20.000 E2.46912 ; perimeter\n"
+    "\n"
+    "G1 Z0.600 F7800.000\n"
+    "G1 X10.000 Y10.000 F7800.000\n"
+    "G1 X20.000 Y10.000 E1234.56789 F1800.000\n"
+    "G1 X20.000 Y20.000 E1235.00001\n"
+    "G1 Z0.900 F7800.000\n"
+    "G1 X10.000 Y10.000\n"
+    "G1 X20.000 Y10.000 E1300.12345\n"
+    "M107\n";
+
+SCENARIO("GCodeSender continues a file from a layer") {
+    GIVEN("A file of 3 layers, being sent to a printer") {
+        const boost::filesystem::path path = boost::filesystem::temp_directory_path()
+            / boost::filesystem::unique_path("%%%%-%%%%-%%%%.gcode");
+        {
+            std::ofstream out(path.string());
+            out << _gcode;
+        }
+        std::shared_ptr<GCodeFile> file = std::make_shared<GCodeFile>(path.string());
+        REQUIRE(file->layers().size() == 3);
+        REQUIRE(file->layers()[2].z == Approx(0.9));
+        REQUIRE(file->layers()[2].e == Approx(1235.00001));
+
+        PtyFirmware firmware;
+        GCodeSender sender;
+        REQUIRE(sender.connect(firmware.device(), 115200));
+        firmware.greet();
+        REQUIRE(sender.wait_connected(5));
+        sender.pause_queue();
+        sender.send(file);
+
+        WHEN("it seeks to the last layer") {
+            REQUIRE(sender.seek_layer(2));
+            sender.resume_queue();
+            REQUIRE(wait_for([&sender]() { return sender.stats().acknowledged == 5; }));
+            THEN("E is set to the start of the layer, then the layer is sent from its move to Z") {
+                REQUIRE(firmware.commands() == std::vector<std::string>({
+                    "G92 E1235.00001",
+                    "G1 Z0.900 F7800.000",
+                    "G1 X10.000 Y10.000",
+                    "G1 X20.000 Y10.000 E1300.12345",
+                    "M107",
+                }));
+                REQUIRE(sender.queue_size() == 0);
+            }
+        }
+        WHEN("it seeks to the second layer") {
+            REQUIRE(sender.seek_layer(1));
+            sender.resume_queue();
+            REQUIRE(wait_for([&sender]() { return sender.stats().acknowledged == 9; }));
+            THEN("the lines of the following layers are sent as well") {
+                const std::vector<std::string> commands = firmware.commands();
+                REQUIRE(commands.size() == 9);
+                REQUIRE(commands[0] == "G92 E2.46912");
+                REQUIRE(commands[1] == "G1 Z0.600 F7800.000");
+                REQUIRE(commands[5] == "G1 Z0.900 F7800.000");
+            }
+        }
+        WHEN("it seeks past the last layer") {
+            THEN("nothing is sent") {
+                REQUIRE(!sender.seek_layer(3));
+                REQUIRE(sender.queue_size() == file->line_count());
+            }
+        }
+
+        sender.disconnect();
+        file.reset();
+        boost::filesystem::remove(path);
+    }
+}
+
+SCENARIO("GCodeFile refuses compressed files") {
+    GIVEN("A file written with gcode_compression") {
+        const boost::filesystem::path path = boost::filesystem::temp_directory_path()
+            / boost::filesystem::unique_path("%%%%-%%%%-%%%%.gcode.gz");
+        {
+            FileWriter writer(path.string(), FileWriter::Gzip);
+            std::ostream out(&writer);
+            out << _gcode;
+            writer.close();
+        }
+        THEN("it cannot be opened for sending") {
+            REQUIRE_THROWS_AS(GCodeFile(path.string()), std::runtime_error);
+        }
+        boost::filesystem::remove(path);
+    }
+}
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef _WIN32
+
+#include <catch2/catch.hpp>
+#include "pty_firmware.hpp"
+#include "GCodeSender.hpp"
+
+using namespace Slic3r;
+using namespace Slic3r::Test;
+
+static std::vector<std::string>
+_moves(size_t count)
+{
+    std::vector<std::string> lines;
+    for (size_t i = 0; i < count; ++i)
+        lines.push_back("G1 X" + std::to_string(i % 200) + " Y" + std::to_string(i / 200) + " F1200");
+    return lines;
+}
+
+SCENARIO("GCodeSender keeps a window of lines in flight") {
+    GIVEN("A Marlin printer and a window of 4 lines") {
+        PtyFirmware firmware;
+        GCodeSender sender;
+        sender.set_window(4);
+        REQUIRE(sender.connect(firmware.device(), 115200));
+        firmware.greet();
+        REQUIRE(sender.wait_connected(5));
+
+        const std::vector<std::string> lines = _moves(100);
+        WHEN("lines are sent") {
+            sender.send(lines);
+            REQUIRE(wait_for([&sender, &lines]() { return sender.stats().acknowledged == lines.size(); }));
+            THEN("they are received in order, up to 4 at once") {
+                REQUIRE(firmware.commands() == lines);
+                REQUIRE(firmware.max_in_flight() == 4);
+                REQUIRE(sender.queue_size() == 0);
+                REQUIRE(sender.stats().in_flight == 0);
+            }
+        }
+        WHEN("a line in the middle of the window fails its checksum") {
+            // the 3 lines after it are in flight: the printer asks for it again for each
+            // of them, followed by an ok which acknowledges no line
+            firmware.corrupt_line(10);
+            firmware.corrupt_line(50);
+            sender.send(lines);
+            REQUIRE(wait_for([&sender, &lines]() { return sender.stats().acknowledged == lines.size(); }));
+            THEN("the window is resent from that line, and each line is received once") {
+                REQUIRE(firmware.commands() == lines);
+                REQUIRE(firmware.errors() >= 2);
+                REQUIRE(sender.stats().sent == lines.size() + firmware.errors());
+                REQUIRE(sender.stats().in_flight == 0);
+            }
+            THEN("the duplicate oks don't let more lines than the window go") {
+                REQUIRE(firmware.max_in_flight() <= 4);
+            }
+        }
+    }
+    GIVEN("A Marlin printer and the default window of 1 line") {
+        PtyFirmware firmware;
+        GCodeSender sender;
+        REQUIRE(sender.connect(firmware.device(), 115200));
+        firmware.greet();
+        REQUIRE(sender.wait_connected(5));
+
+        WHEN("a line fails its checksum") {
+            const std::vector<std::string> lines = _moves(30);
+            firmware.corrupt_line(7);
+            sender.send(lines);
+            REQUIRE(wait_for([&sender, &lines]() { return sender.stats().acknowledged == lines.size(); }));
+            THEN("it is resent, one line at a time") {
+                REQUIRE(firmware.commands() == lines);
+                REQUIRE(firmware.errors() == 1);
+                // as it always did, the ok following the request lets the next line go
+                // along with the resent one
+                REQUIRE(firmware.max_in_flight() <= 2);
+            }
+        }
+    }
+    GIVEN("A Grbl controller and a window of 127 bytes") {
+        PtyFirmware firmware(PtyFirmware::Grbl);
+        GCodeSender sender;
+        sender.set_window(100, 127);
+        REQUIRE(sender.connect(firmware.device(), 115200));
+        firmware.greet();
+        REQUIRE(sender.wait_connected(5));
+
+        WHEN("it rejects a line with an error") {
+            std::vector<std::string> lines = _moves(40);
+            firmware.corrupt_line(12);
+            sender.send(lines);
+            REQUIRE(wait_for([&sender, &lines]() { return sender.stats().acknowledged == lines.size(); }));
+            THEN("the error acknowledges the line, which is logged and not resent") {
+                REQUIRE(sender.stats().sent == lines.size());
+                lines.erase(lines.begin() + 11);
+                REQUIRE(firmware.commands() == lines);
+                const std::vector<std::string> log = sender.purge_log();
+                REQUIRE(std::count(log.begin(), log.end(), "error:20") == 1);
+            }
+            THEN("no more than 127 bytes are in flight") {
+                REQUIRE(firmware.max_in_flight() > 1);
+                REQUIRE(firmware.max_bytes_in_flight() <= 127);
+            }
+        }
+    }
+}
+
+#endif
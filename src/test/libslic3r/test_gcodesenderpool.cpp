@@ -0,0 +1,119 @@
+#ifndef _WIN32
+
+#include <catch2/catch.hpp>
+#include "pty_firmware.hpp"
+#include "GCodeSenderPool.hpp"
+#include <future>
+
+using namespace Slic3r;
+using namespace Slic3r::Test;
+
+static std::vector<std::string>
+_messages(const std::string &printer, size_t count)
+{
+    std::vector<std::string> lines;
+    for (size_t i = 0; i < count; ++i)
+        lines.push_back("M117 " + printer + " " + std::to_string(i));
+    return lines;
+}
+
+SCENARIO("GCodeSenderPool drives several printers from a few threads") {
+    GIVEN("3 printers on 2 threads") {
+        PtyFirmware firmwares[3];
+        GCodeSenderPool pool(2);
+        const std::vector<std::string> names { "printer0", "printer1", "printer2" };
+        for (size_t i = 0; i < names.size(); ++i) {
+            GCodeSender* sender = pool.add(names[i], firmwares[i].device(), 115200);
+            REQUIRE(sender != nullptr);
+            sender->set_window(4);
+            firmwares[i].greet();
+        }
+        for (const std::string &name : names)
+            REQUIRE(pool.get(name)->wait_connected(5));
+        REQUIRE(pool.names() == names);
+
+        WHEN("each one is sent its own lines, some failing their checksum") {
+            firmwares[1].corrupt_line(30);
+            firmwares[2].corrupt_line(99);
+            for (const std::string &name : names)
+                pool.get(name)->send(_messages(name, 200));
+            REQUIRE(wait_for([&pool]() {
+                for (const GCodeSenderPool::Metrics &m : pool.metrics())
+                    if (m.stats.acknowledged < 200) return false;
+                return true;
+            }));
+            THEN("each printer receives its lines once, in order") {
+                for (size_t i = 0; i < names.size(); ++i)
+                    REQUIRE(firmwares[i].commands() == _messages(names[i], 200));
+            }
+            THEN("the metrics tell the state of each printer") {
+                const std::vector<GCodeSenderPool::Metrics> metrics = pool.metrics();
+                REQUIRE(metrics.size() == 3);
+                for (size_t i = 0; i < names.size(); ++i) {
+                    REQUIRE(metrics[i].name == names[i]);
+                    REQUIRE(metrics[i].connected);
+                    REQUIRE(!metrics[i].error);
+                    REQUIRE(metrics[i].stats.acknowledged == 200);
+                    REQUIRE(metrics[i].stats.in_flight == 0);
+                    REQUIRE(metrics[i].stats.sent == 200 + firmwares[i].errors());
+                }
+            }
+        }
+        WHEN("a printer is removed") {
+            pool.remove("printer1");
+            THEN("the others keep working") {
+                REQUIRE(pool.get("printer1") == nullptr);
+                REQUIRE(pool.names() == std::vector<std::string>({ "printer0", "printer2" }));
+                GCodeSender* sender = pool.get("printer2");
+                sender->send(_messages("printer2", 50));
+                REQUIRE(wait_for([sender]() { return sender->stats().acknowledged == 50; }));
+                REQUIRE(firmwares[2].commands() == _messages("printer2", 50));
+            }
+        }
+        THEN("names are unique") {
+            REQUIRE_THROWS_AS(pool.add("printer0", firmwares[0].device(), 115200), std::invalid_argument);
+        }
+    }
+}
+
+/// An io_context run by a thread of its own until it is destroyed.
+struct _IoThread {
+    asio::io_context io;
+    asio::executor_work_guard<asio::io_context::executor_type> work { asio::make_work_guard(io) };
+    std::thread thread { [this]() { this->io.run(); } };
+    ~_IoThread() {
+        this->work.reset();
+        this->thread.join();
+    }
+};
+
+SCENARIO("GCodeSender on a shared io_context") {
+    GIVEN("A connected sender") {
+        _IoThread runner;
+        PtyFirmware firmware;
+        GCodeSender sender(runner.io);
+        REQUIRE(sender.connect(firmware.device(), 115200));
+        firmware.greet();
+        REQUIRE(sender.wait_connected(5));
+
+        THEN("disconnecting from one of its threads throws instead of waiting for itself") {
+            std::promise<bool> threw;
+            asio::post(runner.io, [&sender, &threw]() {
+                try {
+                    sender.disconnect();
+                    threw.set_value(false);
+                } catch (std::logic_error &) {
+                    threw.set_value(true);
+                }
+            });
+            REQUIRE(threw.get_future().get());
+            REQUIRE(sender.is_connected());
+        }
+        THEN("disconnecting from another thread waits for its handlers") {
+            sender.disconnect();
+            REQUIRE(!sender.is_connected());
+        }
+    }
+}
+
+#endif
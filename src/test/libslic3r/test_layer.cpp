@@ -0,0 +1,69 @@
+#include <catch2/catch.hpp>
+#include "GeometryHash.hpp"
+#include "Model.hpp"
+#include "Print.hpp"
+
+using namespace Slic3r;
+
+static bool
+_same_surfaces(const SurfaceCollection &a, const SurfaceCollection &b)
+{
+    if (a.surfaces.size() != b.surfaces.size()) return false;
+    for (size_t i = 0; i < a.surfaces.size(); ++i)
+        if (a.surfaces[i].surface_type != b.surfaces[i].surface_type
+            || !same_geometry(a.surfaces[i].expolygon, b.surfaces[i].expolygon))
+            return false;
+    return true;
+}
+
+SCENARIO("Layers only fill again the regions whose fill surfaces changed") {
+    GIVEN("A processed cube, whose fills are then cleared") {
+        Model model;
+        model.add_object()->add_volume(TriangleMesh::make_cube(20, 20, 10));
+        model.add_default_instances();
+        model.center_instances_around_point(Pointf(100, 100));
+        DynamicPrintConfig config;
+        config.apply(FullPrintConfig());
+        config.set_deserialize("top_solid_layers", "3");
+        Print print;
+        print.apply_config(config);
+        print.add_model_object(model.objects.front());
+        print.process();
+        const PrintObject &object = *print.objects.front();
+        std::vector<SurfaceCollection> fill_surfaces;
+        for (Layer* layer : object.layers) {
+            LayerRegion* layerm = layer->get_region(0);
+            REQUIRE(!layerm->fills.entities.empty());
+            fill_surfaces.push_back(layerm->fill_surfaces);
+            // fills kept as they are stay empty
+            layerm->fills.clear();
+        }
+
+        WHEN("more top solid layers are asked for, and it is processed again") {
+            config.set_deserialize("top_solid_layers", "5");
+            print.apply_config(config);
+            print.process();
+            THEN("only the layers whose fill surfaces changed are filled again") {
+                size_t changed = 0;
+                for (size_t i = 0; i < object.layers.size(); ++i) {
+                    const LayerRegion* layerm = object.layers[i]->get_region(0);
+                    const bool same = _same_surfaces(layerm->fill_surfaces, fill_surfaces[i]);
+                    INFO("layer " << i);
+                    REQUIRE(layerm->fills.entities.empty() == same);
+                    if (!same) ++changed;
+                }
+                REQUIRE(changed > 0);
+                REQUIRE(changed < object.layers.size() / 2);
+            }
+        }
+        WHEN("the fill pattern changes, and it is processed again") {
+            config.set_deserialize("fill_pattern", "honeycomb");
+            print.apply_config(config);
+            print.process();
+            THEN("all the layers are filled again") {
+                for (const Layer* layer : object.layers)
+                    REQUIRE(!layer->get_region(0)->fills.entities.empty());
+            }
+        }
+    }
+}
@@ -0,0 +1,128 @@
+#include <catch2/catch.hpp>
+#include "Model.hpp"
+#include "Print.hpp"
+#include <atomic>
+#include <sstream>
+
+using namespace Slic3r;
+
+/// A sphere standing on a cube.
+static Model
+_model()
+{
+    Model model;
+    ModelObject* object = model.add_object();
+    object->add_volume(TriangleMesh::make_cube(20, 20, 5));
+    TriangleMesh sphere = TriangleMesh::make_sphere(12, 2*PI/36);
+    sphere.translate(10, 10, 15);
+    object->add_volume(std::move(sphere));
+    model.add_default_instances();
+    model.center_instances_around_point(Pointf(100, 100));
+    return model;
+}
+
+/// Settings the print starts with, and the ones it may be restarted with: a denser infill
+/// keeps the fill surfaces, wider extrusions change them.
+enum _Settings { _initial, _denser, _wider };
+
+static DynamicPrintConfig
+_config(_Settings settings)
+{
+    DynamicPrintConfig config;
+    config.apply(FullPrintConfig());
+    config.set_deserialize("fill_density", settings == _initial ? "20%" : "40%");
+    config.set_deserialize("support_material", "1");
+    config.set_deserialize("threads", "4");
+    if (settings == _wider) {
+        config.set_deserialize("perimeter_extrusion_width", "0.6");
+        config.set_deserialize("infill_extrusion_width", "0.6");
+    }
+    return config;
+}
+
+static void
+_setup(Print &print, Model &model, _Settings settings)
+{
+    print.apply_config(_config(settings));
+    for (ModelObject* object : model.objects) print.add_model_object(object);
+    print.validate();
+}
+
+/// G-code of the print, without the comment telling when it was generated.
+static std::string
+_gcode(Print &print)
+{
+    std::ostringstream ss;
+    print.export_gcode(ss, true);
+    std::istringstream in(ss.str());
+    std::string line, gcode;
+    while (std::getline(in, line))
+        if (line.find("generated by") == std::string::npos) gcode += line + "\n";
+    return gcode;
+}
+
+SCENARIO("A cancelled print processes again like a fresh one") {
+    GIVEN("An object with support enabled, and the G-code of fresh prints of it") {
+        Model model = _model();
+        std::string expected[3];
+        for (_Settings settings : { _initial, _denser, _wider }) {
+            Print print;
+            _setup(print, model, settings);
+            print.process();
+            expected[settings] = _gcode(print);
+        }
+        REQUIRE(expected[_denser] != expected[_initial]);
+        // the steps process() reports before its last cancellation point, and its layers
+        std::vector<std::string> statuses;
+        size_t layers = 0;
+        {
+            Print print;
+            _setup(print, model, _initial);
+            print.status_cb = [&statuses](int, const std::string &message) {
+                if (message != "Generating skirt" && message != "Generating brim")
+                    statuses.push_back(message);
+            };
+            print.layer_done_cb = [&layers](const Layer*) { ++layers; };
+            print.process();
+        }
+        REQUIRE(statuses.size() > 2);
+        REQUIRE(layers > 10);
+
+        WHEN("it is cancelled at any step or layer, and processed again with the same or other settings") {
+            // the callbacks run between cancellation points: cancelling from them stops
+            // process() at the point following each step start and some layers
+            std::vector<std::pair<size_t, size_t>> cancels;
+            for (size_t i = 1; i <= statuses.size(); ++i) cancels.emplace_back(i, 0);
+            for (size_t i : { size_t(1), layers / 3, layers / 2, layers - 1 }) cancels.emplace_back(0, i);
+
+            THEN("it gives the G-code of a fresh print") {
+                for (const std::pair<size_t, size_t> &cancel : cancels) {
+                    for (_Settings settings : { _initial, _denser, _wider }) {
+                        INFO("cancelled at " << (cancel.first > 0
+                            ? "\"" + statuses[cancel.first - 1] + "\""
+                            : "layer " + std::to_string(cancel.second))
+                            << (settings == _denser ? ", then made denser"
+                                : settings == _wider ? ", then made wider" : ""));
+                        Print print;
+                        _setup(print, model, _initial);
+                        size_t status = 0;
+                        std::atomic<size_t> layer {0};
+                        print.status_cb = [&print, &status, &cancel](int, const std::string&) {
+                            if (++status == cancel.first) print.cancellation.cancel();
+                        };
+                        print.layer_done_cb = [&print, &layer, &cancel](const Layer*) {
+                            if (++layer == cancel.second) print.cancellation.cancel();
+                        };
+                        REQUIRE_THROWS_AS(print.process(), CancelledException);
+                        print.status_cb = nullptr;
+                        print.layer_done_cb = nullptr;
+                        print.cancellation.reset();
+                        if (settings != _initial) print.apply_config(_config(settings));
+                        print.process();
+                        REQUIRE(_gcode(print) == expected[settings]);
+                    }
+                }
+            }
+        }
+    }
+}
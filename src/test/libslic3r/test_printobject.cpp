@@ -0,0 +1,51 @@
+#include <catch2/catch.hpp>
+#include "Model.hpp"
+#include "Print.hpp"
+
+using namespace Slic3r;
+
+/// Area of the slices of a layer, in mm².
+static double
+_area(const Layer &layer)
+{
+    double area = 0;
+    for (const ExPolygon &expolygon : layer.slices.expolygons)
+        area += expolygon.area();
+    return area * SCALING_FACTOR * SCALING_FACTOR;
+}
+
+SCENARIO("PrintObject slices the meshes of its volumes as they are") {
+    GIVEN("A sliced cube") {
+        Model model;
+        ModelObject* object = model.add_object();
+        ModelVolume* volume = object->add_volume(TriangleMesh::make_cube(20, 20, 10));
+        model.add_default_instances();
+        model.center_instances_around_point(Pointf(100, 100));
+        Print print;
+        DynamicPrintConfig config;
+        config.apply(FullPrintConfig());
+        print.apply_config(config);
+        print.add_model_object(object);
+        PrintObject &print_object = *print.objects.front();
+        print_object.slice();
+        REQUIRE(_area(*print_object.layers[5]) == Approx(400).epsilon(0.01));
+
+        WHEN("its mesh is replaced in place by a cylinder of the same bounding box, and it is sliced again") {
+            TriangleMesh cylinder = TriangleMesh::make_cylinder(10, 10, 2*PI/360);
+            cylinder.translate(10, 10, 0);
+            volume->mutable_mesh() = cylinder;
+            print_object.invalidate_step(posSlice);
+            print_object.slice();
+            THEN("the slices are those of the cylinder") {
+                REQUIRE(_area(*print_object.layers[5]) == Approx(PI * 100).epsilon(0.01));
+            }
+        }
+        WHEN("it is sliced again with the same mesh") {
+            print_object.invalidate_step(posSlice);
+            print_object.slice();
+            THEN("the slices are the same") {
+                REQUIRE(_area(*print_object.layers[5]) == Approx(400).epsilon(0.01));
+            }
+        }
+    }
+}
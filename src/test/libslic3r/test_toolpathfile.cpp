@@ -0,0 +1,149 @@
+#include <catch2/catch.hpp>
+#include "Model.hpp"
+#include "Print.hpp"
+#include "ToolpathFile.hpp"
+#include <fstream>
+#include <sstream>
+#include <boost/filesystem.hpp>
+
+using namespace Slic3r;
+
+static Model
+_model(const TriangleMesh &mesh)
+{
+    Model model;
+    model.add_object()->add_volume(mesh);
+    model.add_default_instances();
+    model.center_instances_around_point(Pointf(100, 100));
+    return model;
+}
+
+/// G-code without the comment telling when it was generated.
+static std::string
+_strip_date(const std::string &gcode)
+{
+    std::istringstream in(gcode);
+    std::string line, stripped;
+    while (std::getline(in, line))
+        if (line.find("generated by") == std::string::npos) stripped += line + "\n";
+    return stripped;
+}
+
+/// Exports the G-code and the toolpaths of the model, then converts the toolpaths back.
+static void
+_round_trip(Model &model, const DynamicPrintConfig &config, std::string* gcode, std::string* converted,
+    size_t* layers)
+{
+    Print print;
+    print.apply_config(config);
+    for (ModelObject* object : model.objects) print.add_model_object(object);
+    print.validate();
+    std::ostringstream ss;
+    print.export_gcode(ss, true);
+    *gcode = _strip_date(ss.str());
+
+    const boost::filesystem::path path = boost::filesystem::temp_directory_path()
+        / boost::filesystem::unique_path("%%%%-%%%%-%%%%.s3tp");
+    print.export_toolpaths(path.string());
+    {
+        ToolpathReader reader(path.string());
+        std::ostringstream out;
+        reader.write_gcode(out);
+        *converted = _strip_date(out.str());
+        *layers = reader.layer_count();
+    }
+    boost::filesystem::remove(path);
+}
+
+SCENARIO("Toolpath files convert back to the G-code of the print") {
+    DynamicPrintConfig config;
+    config.apply(FullPrintConfig());
+    config.set_deserialize("threads", "2");
+    std::string gcode, converted;
+    size_t layers = 0;
+
+    GIVEN("A cube") {
+        Model model = _model(TriangleMesh::make_cube(20, 20, 10));
+        WHEN("it is exported with the default settings") {
+            _round_trip(model, config, &gcode, &converted, &layers);
+            THEN("the toolpaths give the same G-code, and have a block for each layer") {
+                REQUIRE(converted == gcode);
+                REQUIRE(layers == 33);
+            }
+        }
+        WHEN("it is exported with relative E distances") {
+            config.set_deserialize("use_relative_e_distances", "1");
+            _round_trip(model, config, &gcode, &converted, &layers);
+            THEN("the toolpaths give the same G-code") {
+                REQUIRE(gcode.find("M83") != std::string::npos);
+                REQUIRE(converted == gcode);
+            }
+        }
+        WHEN("it is exported with custom G-code, written otherwise than by GCodeWriter") {
+            config.opt<ConfigOptionString>("start_gcode", true)->value =
+                "G28 ; home\nG1 Z5 F5000\nG1 X0.1234567 Y-0.5 E-1.5\ng1 x1 y1\nG1  X2 Y2\nG0 X3 Y3 ; rapid\nG1 X4 Y4 E\nM117 Slicing [input_filename]";
+            config.opt<ConfigOptionString>("layer_gcode", true)->value =
+                "G1 Z[layer_z] F600\nG92 E0\nG1 E0.5 F2400\n;comment without a space";
+            config.opt<ConfigOptionString>("end_gcode", true)->value =
+                "G1 X0 Y200 F3000\nM84\n";
+            _round_trip(model, config, &gcode, &converted, &layers);
+            THEN("the toolpaths give the same G-code") {
+                REQUIRE(gcode.find("g1 x1 y1") != std::string::npos);
+                REQUIRE(converted == gcode);
+            }
+        }
+    }
+    GIVEN("A cylinder") {
+        Model model = _model(TriangleMesh::make_cylinder(10, 15, 2*PI/60));
+        WHEN("it is exported as a spiral vase") {
+            config.set_deserialize("spiral_vase", "1");
+            _round_trip(model, config, &gcode, &converted, &layers);
+            THEN("the toolpaths give the same G-code, whose Z changes along the moves") {
+                REQUIRE(converted == gcode);
+                REQUIRE(layers > 0);
+            }
+        }
+        WHEN("it is exported with relative E distances as a spiral vase") {
+            config.set_deserialize("spiral_vase", "1");
+            config.set_deserialize("use_relative_e_distances", "1");
+            _round_trip(model, config, &gcode, &converted, &layers);
+            THEN("the toolpaths give the same G-code") {
+                REQUIRE(converted == gcode);
+            }
+        }
+    }
+}
+
+SCENARIO("Toolpath files give the moves of each layer") {
+    GIVEN("The toolpaths of a cube") {
+        DynamicPrintConfig config;
+        config.apply(FullPrintConfig());
+        Model model = _model(TriangleMesh::make_cube(20, 20, 10));
+        Print print;
+        print.apply_config(config);
+        for (ModelObject* object : model.objects) print.add_model_object(object);
+        print.validate();
+        const boost::filesystem::path path = boost::filesystem::temp_directory_path()
+            / boost::filesystem::unique_path("%%%%-%%%%-%%%%.s3tp");
+        print.export_toolpaths(path.string());
+        {
+            ToolpathReader reader(path.string());
+            THEN("each layer is indexed at its Z, and its moves extrude at that Z") {
+                REQUIRE(reader.layer_count() == print.objects.front()->layers.size());
+                for (size_t i = 0; i < reader.layer_count(); ++i) {
+                    const double print_z = print.objects.front()->layers[i]->print_z;
+                    REQUIRE(reader.layer(i).print_z == Approx(print_z));
+                    size_t extrusions = 0;
+                    reader.moves(i, [&extrusions, print_z](const ToolpathMove &move) {
+                        if (move.role == erNone) return;
+                        ++extrusions;
+                        REQUIRE(move.z == Approx(print_z));
+                        REQUIRE(move.width > 0);
+                    });
+                    REQUIRE(extrusions > 0);
+                }
+            }
+        }
+        boost::filesystem::remove(path);
+    }
+}
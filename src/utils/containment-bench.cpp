@@ -0,0 +1,113 @@
+// Benchmark of the containment tests deciding whether a travel move needs retraction,
+// comparing ContainmentGrid with testing every expolygon as GCode used to.
+// Also checks that both agree on every move.
+//
+//     containment-bench [iterations]
+
+#include "libslic3r.h"
+#include "ClipperUtils.hpp"
+#include "ContainmentGrid.hpp"
+#include "ExPolygon.hpp"
+#include "Polyline.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace Slic3r;
+
+static Polygon
+_square(double x, double y, double size)
+{
+    Polygon polygon;
+    polygon.points.push_back(Point(coord_t(scale_(x)),        coord_t(scale_(y))));
+    polygon.points.push_back(Point(coord_t(scale_(x + size)), coord_t(scale_(y))));
+    polygon.points.push_back(Point(coord_t(scale_(x + size)), coord_t(scale_(y + size))));
+    polygon.points.push_back(Point(coord_t(scale_(x)),        coord_t(scale_(y + size))));
+    return polygon;
+}
+
+/// A circle approximated by 16 segments.
+static Polygon
+_circle(double x, double y, double radius)
+{
+    Polygon polygon;
+    for (size_t i = 0; i < 16; ++i) {
+        const double angle = 2. * PI * i / 16.;
+        polygon.points.push_back(Point(coord_t(scale_(x + radius * cos(angle))), coord_t(scale_(y + radius * sin(angle)))));
+    }
+    return polygon;
+}
+
+int
+main(int argc, char **argv)
+{
+    const int iterations = (argc > 1) ? std::max(1, atoi(argv[1])) : 1;
+
+    // a 100x100mm plate perforated by a 40x40 grid of 1mm holes,
+    // split in four islands, next to a few small solid islands
+    ExPolygons expolygons;
+    {
+        Polygons holes;
+        for (size_t i = 0; i < 40; ++i)
+            for (size_t j = 0; j < 40; ++j)
+                holes.push_back(_circle(1.25 + 2.5 * i, 1.25 + 2.5 * j, 0.5));
+        Polygons plate;
+        for (size_t i = 0; i < 2; ++i)
+            for (size_t j = 0; j < 2; ++j)
+                plate.push_back(_square(50. * i, 50. * j, 49.9));
+        expolygons = diff_ex(plate, holes);
+        for (size_t i = 0; i < 10; ++i)
+            expolygons.push_back(ExPolygon(_square(110. + 5. * i, 0., 4.)));
+    }
+
+    // many short travel moves, as between the perimeters around the holes
+    Polylines travels;
+    {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<double> position(0., 160.);
+        std::uniform_real_distribution<double> step(-3., 3.);
+        for (size_t i = 0; i < 1000; ++i) {
+            Polyline travel;
+            const double x = position(rng), y = position(rng) * 100. / 160.;
+            travel.points.push_back(Point(coord_t(scale_(x)), coord_t(scale_(y))));
+            travel.points.push_back(Point(coord_t(scale_(x + step(rng))), coord_t(scale_(y + step(rng)))));
+            travels.push_back(travel);
+        }
+    }
+
+    double time_reference = 0, time_build = 0, time_grid = 0;
+    size_t contained = 0, mismatches = 0;
+    for (int it = 0; it < iterations; ++it) {
+        std::vector<bool> reference(travels.size(), false);
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < travels.size(); ++i)
+            for (const ExPolygon &expolygon : expolygons)
+                if (expolygon.contains(travels[i])) {
+                    reference[i] = true;
+                    break;
+                }
+        auto t1 = std::chrono::steady_clock::now();
+        const ContainmentGrid grid(expolygons);
+        auto t2 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < travels.size(); ++i) {
+            const bool result = grid.any_contains(travels[i]);
+            if (result != reference[i]) ++mismatches;
+            if (result) ++contained;
+        }
+        auto t3 = std::chrono::steady_clock::now();
+        time_reference += std::chrono::duration<double>(t1 - t0).count();
+        time_build     += std::chrono::duration<double>(t2 - t1).count();
+        time_grid      += std::chrono::duration<double>(t3 - t2).count();
+    }
+
+    std::cout << "reference: " << time_reference / iterations * 1000. << " ms per " << travels.size() << " travels" << std::endl
+        << "grid:      " << time_grid / iterations * 1000. << " ms per " << travels.size() << " travels, "
+        << time_build / iterations * 1000. << " ms to build" << std::endl
+        << "contained: " << contained / iterations << " travels" << std::endl;
+
+    std::cout << (mismatches == 0 ? "OK" : "FAILED: results differ from ExPolygon::contains()") << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
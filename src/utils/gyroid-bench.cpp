@@ -0,0 +1,221 @@
+// Benchmark of the gyroid wave generator against the reference scalar implementation
+// it replaced. Also checks that the new waves follow the curve at least as closely.
+//
+//     gyroid-bench [iterations]
+
+#include "libslic3r.h"
+#include "Point.hpp"
+#include "Polyline.hpp"
+#include "Fill/FillGyroid.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace Slic3r;
+
+namespace Reference {
+
+static inline double f(double x, double z_sin, double z_cos, bool vertical, bool flip)
+{
+    if (vertical) {
+        double phase_offset = (z_cos < 0 ? M_PI : 0) + M_PI;
+        double a   = sin(x + phase_offset);
+        double b   = - z_cos;
+        double res = z_sin * cos(x + phase_offset + (flip ? M_PI : 0.));
+        double r   = sqrt(a*a + b*b);
+        return asin(a/r) + asin(res/r) + M_PI;
+    }
+    else {
+        double phase_offset = z_sin < 0 ? M_PI : 0.;
+        double a   = cos(x + phase_offset);
+        double b   = - z_sin;
+        double res = z_cos * sin(x + phase_offset + (flip ? 0 : M_PI));
+        double r   = sqrt(a*a + b*b);
+        return (asin(a/r) + asin(res/r) + 0.5 * M_PI);
+    }
+}
+
+static inline Polyline make_wave(
+    const std::vector<Pointf>& one_period, double width, double height, double offset, double scaleFactor,
+    double z_cos, double z_sin, bool vertical)
+{
+    std::vector<Pointf> points = one_period;
+    double period = points.back().x;
+    points.pop_back();
+    int n = points.size();
+    do {
+        points.emplace_back(Pointf(points[points.size()-n].x + period, points[points.size()-n].y));
+    } while (points.back().x < width);
+    points.back().x = width;
+
+    Polyline polyline;
+    for (Pointf& point : points) {
+        point.y += offset;
+        point.y = std::max(0., std::min(height, point.y));
+        if (vertical)
+            std::swap(point.x, point.y);
+        polyline.points.emplace_back(Point(coord_t(point.x * scaleFactor), coord_t(point.y * scaleFactor)));
+    }
+    return polyline;
+}
+
+static bool sortPointf (Pointf& lfs,Pointf& rhs) { return lfs.x < rhs.x || (lfs.x == rhs.x && lfs.y < rhs.y); }
+
+static std::vector<Pointf> make_one_period(double width, double scaleFactor, double z_cos, double z_sin, bool vertical, bool flip,
+    double tolerance)
+{
+    std::vector<Pointf> points;
+    double dx = M_PI_4;
+    double limit = std::min(2*M_PI, width);
+    for (double x = 0.; x < limit + EPSILON; x += dx) {
+        x = std::min(x, limit);
+        points.emplace_back(Pointf(x,f(x, z_sin,z_cos, vertical, flip)));
+    }
+
+    for (unsigned int i=1;i<points.size()-1;++i) {
+        Pointf& lp = points[i-1];
+        Pointf& tp = points[i];
+        Pointf& rp = points[i+1];
+        double dist_mm = unscale(scaleFactor * std::abs( (rp.y - lp.y)*tp.x + (lp.x - rp.x)*tp.y + (rp.x*lp.y - rp.y*lp.x) ) / std::hypot((rp.y - lp.y),(lp.x - rp.x)));
+        if (dist_mm > tolerance) {
+            double x = 0.5f * (points[i-1].x + points[i].x);
+            points.emplace_back(Pointf(x, f(x, z_sin, z_cos, vertical, flip)));
+            x = 0.5f * (points[i+1].x + points[i].x);
+            points.emplace_back(Pointf(x, f(x, z_sin, z_cos, vertical, flip)));
+            std::sort(points.begin(), points.end(), sortPointf);
+            --i;
+        }
+    }
+    return points;
+}
+
+static Polylines make_gyroid_waves(double gridZ, double density_adjusted, double line_spacing, double width, double height,
+    double tolerance = .1)
+{
+    const double scaleFactor = scale_(line_spacing) / density_adjusted;
+    const double z     = gridZ / scaleFactor;
+    const double z_sin = sin(z);
+    const double z_cos = cos(z);
+
+    bool vertical = (std::abs(z_sin) <= std::abs(z_cos));
+    double lower_bound = 0.;
+    double upper_bound = height;
+    bool flip = true;
+    if (vertical) {
+        flip = false;
+        lower_bound = -M_PI;
+        upper_bound = width - M_PI_2;
+        std::swap(width,height);
+    }
+
+    std::vector<Pointf> one_period = make_one_period(width, scaleFactor, z_cos, z_sin, vertical, flip, tolerance);
+    Polylines result;
+    for (double y0 = lower_bound; y0 < upper_bound+EPSILON; y0 += 2*M_PI)
+        result.emplace_back(make_wave(one_period, width, height, y0, scaleFactor, z_cos, z_sin, vertical));
+
+    flip = !flip;
+    one_period = make_one_period(width, scaleFactor, z_cos, z_sin, vertical, flip, tolerance);
+    for (double y0 = lower_bound + M_PI; y0 < upper_bound+EPSILON; y0 += 2*M_PI)
+        result.emplace_back(make_wave(one_period, width, height, y0, scaleFactor, z_cos, z_sin, vertical));
+
+    return result;
+}
+
+} // namespace Reference
+
+/// Exposes the wave generator of FillGyroid.
+class BenchGyroid : public FillGyroid
+{
+public:
+    Polylines make_waves(double gridZ, double density_adjusted, double line_spacing, double width, double height)
+        { return this->_make_waves(gridZ, density_adjusted, line_spacing, width, height); }
+    void clear() { this->_wave_periods.clear(); }
+};
+
+/// Largest distance of a point of a to the polylines of b, in scaled coordinates.
+static double
+max_deviation(const Polylines &a, const Polylines &b)
+{
+    double max_dist = 0;
+    for (const Polyline &pl : a) {
+        for (const Point &p : pl.points) {
+            double dist = INFINITY;
+            for (const Polyline &other : b)
+                for (const Line &line : other.lines())
+                    dist = std::min(dist, p.distance_to(line));
+            max_dist = std::max(max_dist, dist);
+        }
+    }
+    return max_dist;
+}
+
+int
+main(int argc, char **argv)
+{
+    const int iterations = (argc > 1) ? std::max(1, atoi(argv[1])) : 20;
+
+    // a 50x50mm surface filled at 20% with 0.45mm lines, over 200 layers of 0.2mm
+    const double line_spacing     = 0.45;
+    const double density_adjusted = 0.2 * 2.;
+    const coord_t distance        = coord_t(scale_(line_spacing) / density_adjusted);
+    const double width            = ceil(scale_(50.) / distance) + 1.;
+    const double height           = width;
+    const size_t layers           = 200;
+
+    // Compare both generators with a dense sampling of the curve over a 10x10mm surface:
+    // the new one must not be less accurate than the reference one.
+    double error_reference = 0, error_new = 0;
+    {
+        const double size = ceil(scale_(10.) / distance) + 1.;
+        BenchGyroid gyroid;
+        for (size_t i = 0; i < layers; i += 5) {
+            const double z = scale_(0.2 * (i + 1));
+            const Polylines exact     = Reference::make_gyroid_waves(z, density_adjusted, line_spacing, size, size, 0.001);
+            const Polylines reference = Reference::make_gyroid_waves(z, density_adjusted, line_spacing, size, size);
+            const Polylines waves     = gyroid.make_waves(z, density_adjusted, line_spacing, size, size);
+            error_reference = std::max(error_reference, max_deviation(exact, reference));
+            error_new       = std::max(error_new,       max_deviation(exact, waves));
+        }
+    }
+
+    // time both generators, one call per layer as for a single island
+    double time_reference = 0, time_new = 0, time_new_cached = 0;
+    size_t points_reference = 0, points_new = 0;
+    for (int it = 0; it < iterations; ++it) {
+        BenchGyroid gyroid;
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < layers; ++i)
+            for (const Polyline &pl : Reference::make_gyroid_waves(scale_(0.2 * (i + 1)), density_adjusted, line_spacing, width, height))
+                points_reference += pl.points.size();
+        auto t1 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < layers; ++i) {
+            gyroid.clear();
+            for (const Polyline &pl : gyroid.make_waves(scale_(0.2 * (i + 1)), density_adjusted, line_spacing, width, height))
+                points_new += pl.points.size();
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        // four islands per layer sharing the sampled periods
+        for (size_t i = 0; i < layers; ++i)
+            for (size_t island = 0; island < 4; ++island)
+                gyroid.make_waves(scale_(0.2 * (i + 1)), density_adjusted, line_spacing, width, height);
+        auto t3 = std::chrono::steady_clock::now();
+        time_reference  += std::chrono::duration<double>(t1 - t0).count();
+        time_new        += std::chrono::duration<double>(t2 - t1).count();
+        time_new_cached += std::chrono::duration<double>(t3 - t2).count() / 4.;
+    }
+
+    std::cout << "reference:          " << time_reference / iterations * 1000. << " ms per " << layers << " layers, "
+        << points_reference / iterations << " points" << std::endl
+        << "new:                " << time_new / iterations * 1000. << " ms per " << layers << " layers, "
+        << points_new / iterations << " points" << std::endl
+        << "new, shared period: " << time_new_cached / iterations * 1000. << " ms per " << layers << " layers" << std::endl
+        << "max error:          " << unscale(error_reference) << " mm (reference), "
+        << unscale(error_new) << " mm (new)" << std::endl;
+
+    const bool ok = unscale(error_new) <= std::max(unscale(error_reference), 0.1) + 0.01;
+    std::cout << (ok ? "OK" : "FAILED: waves are less accurate than the reference") << std::endl;
+    return ok ? 0 : 1;
+}
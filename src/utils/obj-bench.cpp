@@ -0,0 +1,100 @@
+// Benchmark of the OBJ import, comparing IO::OBJ::read with tiny_obj_loader as it was used
+// before. Each run loads the file with one of them, so that the peak resident size it
+// reports is the one of that loader; run it once per loader on the same file.
+//
+//     obj-bench file.obj [slic3r|tinyobj]
+
+#include "libslic3r.h"
+#include "IO.hpp"
+#include "IndexedMesh.hpp"
+#include "Model.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/resource.h>
+#include <boost/nowide/fstream.hpp>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+using namespace Slic3r;
+
+/// Peak resident size of the process, in MB.
+static double
+_peak_rss()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    #ifdef __APPLE__
+    return usage.ru_maxrss / 1024. / 1024.;
+    #else
+    return usage.ru_maxrss / 1024.;
+    #endif
+}
+
+/// The OBJ import as it was done with tiny_obj_loader.
+static void
+_read_tinyobj(const std::string &input_file, Model* model)
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string err;
+    boost::nowide::ifstream ifs(input_file);
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, &ifs))
+        throw std::runtime_error("Error while reading OBJ file");
+
+    ModelObject* object = model->add_object();
+    IndexedMesh indexed;
+    indexed.vertices.resize(attrib.vertices.size() / 3);
+    for (size_t v = 0; v < indexed.vertices.size(); ++v) {
+        indexed.vertices[v].x = attrib.vertices[v*3+0];
+        indexed.vertices[v].y = attrib.vertices[v*3+1];
+        indexed.vertices[v].z = attrib.vertices[v*3+2];
+    }
+    for (const tinyobj::shape_t &shape : shapes) {
+        indexed.triangles.clear();
+        for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); ++f)
+            indexed.triangles.push_back(IndexedMesh::Triangle{{
+                uint32_t(shape.mesh.indices[f*3+0].vertex_index),
+                uint32_t(shape.mesh.indices[f*3+1].vertex_index),
+                uint32_t(shape.mesh.indices[f*3+2].vertex_index)
+            }});
+        TriangleMesh mesh = indexed.to_triangle_mesh();
+        mesh.check_topology();
+        object->add_volume(mesh);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    if (argc < 2) {
+        std::cerr << "Usage: obj-bench file.obj [slic3r|tinyobj]" << std::endl;
+        return 1;
+    }
+    const std::string input_file = argv[1];
+    const bool tinyobj = (argc > 2) && std::strcmp(argv[2], "tinyobj") == 0;
+
+    size_t facets = 0, shapes = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    Model model;
+    if (tinyobj)
+        _read_tinyobj(input_file, &model);
+    else
+        IO::OBJ::read(input_file, &model);
+    for (const ModelObject* object : model.objects)
+        for (const ModelVolume* volume : object->volumes) {
+            facets += volume->facets_count();
+            ++shapes;
+        }
+    auto t1 = std::chrono::steady_clock::now();
+
+    std::cout << (tinyobj ? "tinyobj: " : "slic3r:  ")
+        << std::chrono::duration<double>(t1 - t0).count() * 1000. << " ms, "
+        << _peak_rss() << " MB peak RSS" << std::endl
+        << "facets:  " << facets << " in " << shapes << " volumes" << std::endl;
+    return 0;
+}